@@ -0,0 +1,96 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_ALLOCATOR_H
+#define TENSOR_ALLOCATOR_H
+
+#include <cstddef>
+#include <complex>
+
+namespace tensor {
+
+/**Alignment in bytes of the data of vectors and tensors.*/
+const size_t TENSOR_ALIGNMENT = 64;
+
+/**Provider of the memory for the data of vectors and tensors. Allocators
+   return uninitialized memory aligned to TENSOR_ALIGNMENT bytes. The size of a
+   block is passed back when it is deallocated, so that allocators need not
+   keep track of it.
+   \ingroup Internals
+*/
+class Allocator {
+public:
+  virtual ~Allocator();
+  /**Return a block of at least 'bytes' bytes.*/
+  virtual void *allocate(size_t bytes) = 0;
+  /**Return a block obtained with allocate() of the same size.*/
+  virtual void deallocate(void *p, size_t bytes) = 0;
+};
+
+/**Allocator that gets every block from the operating system.*/
+Allocator *system_allocator();
+/**Allocator that keeps per-thread caches of freed blocks. Blocks are grouped
+   in size classes (four per power of two), so that tensors of similar sizes
+   reuse the same memory. Blocks that are too large, or that do not fit in the
+   cache of the thread, are returned to the operating system.*/
+Allocator *pool_allocator();
+
+/**Allocator used by newly created vectors and tensors.*/
+Allocator *tensor_allocator();
+/**Change the allocator for new vectors and tensors, returning the previous
+   one. Data that was already allocated is freed with the allocator that
+   created it.*/
+Allocator *set_tensor_allocator(Allocator *a);
+
+/**Statistics of the pool_allocator(), summed over all threads.*/
+struct AllocatorStats {
+  size_t allocations;  ///< Number of blocks requested
+  size_t hits;         ///< Requests that were served from a cache
+  size_t bytes_live;   ///< Bytes in use by vectors and tensors
+  size_t bytes_peak;   ///< Largest value of bytes_live
+  size_t bytes_cached; ///< Bytes held in the caches
+  /**Fraction of requests served from the caches.*/
+  double hit_rate() const { return allocations? (double)hits / allocations : 0.0; }
+};
+
+/**Current statistics of the pool_allocator().*/
+const AllocatorStats pool_allocator_stats();
+/**Reset the counters of allocations, hits and peak memory.*/
+void pool_allocator_reset_stats();
+/**Return the blocks cached by the current thread to the operating system.*/
+void pool_allocator_release();
+/**Maximum number of bytes that each thread keeps in its cache.*/
+void set_pool_allocator_limit(size_t bytes);
+
+/**Element types whose storage is obtained from the tensor_allocator(). These
+   are plain numbers that need no construction or destruction; other types are
+   created with new[].
+   \ingroup Internals
+*/
+template<typename elt_t> struct uses_tensor_allocator { enum { value = 0 }; };
+template<> struct uses_tensor_allocator<double> { enum { value = 1 }; };
+template<> struct uses_tensor_allocator<float> { enum { value = 1 }; };
+template<> struct uses_tensor_allocator<long> { enum { value = 1 }; };
+template<> struct uses_tensor_allocator<int> { enum { value = 1 }; };
+template<> struct uses_tensor_allocator<bool> { enum { value = 1 }; };
+template<> struct uses_tensor_allocator<std::complex<double> > { enum { value = 1 }; };
+
+} // namespace tensor
+
+#endif // !TENSOR_ALLOCATOR_H
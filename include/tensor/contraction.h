@@ -0,0 +1,109 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_CONTRACTION_H
+#define TENSOR_CONTRACTION_H
+
+#include <vector>
+#include <tensor/tensor.h>
+
+namespace tensor {
+
+  /**Order in which a network of tensors is contracted. Each tensor of the
+     network is described by its dimensions and by a list of integer labels,
+     one per index. Labels that appear in two tensors are contracted; labels
+     that appear once are the indices of the output, which by default come
+     in increasing order of the labels.
+
+     The plan is a sequence of contractions of pairs of tensors, chosen to
+     minimize the number of floating point operations. The search is
+     exhaustive for small networks, uses dynamic programming over subsets
+     of tensors for medium sized ones, and a greedy heuristic otherwise.
+     A plan can be executed on any set of tensors with the same dimensions.
+
+     \code
+     // C(a,d) = A(a,b) B(b,c) D(c,d)
+     std::vector<Indices> labels, dims;
+     labels.push_back(igen << 0 << 1); dims.push_back(A.dimensions());
+     labels.push_back(igen << 1 << 2); dims.push_back(B.dimensions());
+     labels.push_back(igen << 2 << 3); dims.push_back(D.dimensions());
+     ContractionPlan plan(labels, dims);
+     std::vector<RTensor> network;
+     ...
+     RTensor C = plan.execute(network);
+     \endcode
+
+     \ingroup Tensors
+  */
+  class ContractionPlan {
+  public:
+    enum Method { AUTOMATIC, EXHAUSTIVE, DYNAMIC, GREEDY };
+
+    ContractionPlan(const std::vector<Indices> &labels,
+                    const std::vector<Indices> &dimensions,
+                    const Indices &output = Indices(),
+                    Method method = AUTOMATIC);
+
+    /**Number of floating point operations, counting a product and a sum
+       as two operations.*/
+    double flops() const { return flops_; }
+    /**Largest number of elements stored at once by the input, output and
+       intermediate tensors.*/
+    double peak_memory() const { return peak_; }
+    /**Number of pairwise contractions.*/
+    index steps() const { return steps_.size(); }
+    /**Labels of the output indices.*/
+    const Indices &output_labels() const { return output_; }
+    /**True if the plan can contract tensors with these dimensions.*/
+    bool matches(const std::vector<Indices> &dimensions) const;
+
+    const RTensor execute(const std::vector<RTensor> &tensors) const;
+    const CTensor execute(const std::vector<CTensor> &tensors) const;
+
+  private:
+    struct Step {
+      index a, b;           // Inputs first, then results of earlier steps
+      Indices ia, ib;       // Indices of a and b that are contracted
+    };
+
+    std::vector<Indices> dimensions_;
+    std::vector<Step> steps_;
+    Indices output_;
+    Indices final_permutation_;
+    double flops_, peak_;
+
+    template<class Tensor>
+    const Tensor do_execute(const std::vector<Tensor> &tensors) const;
+  };
+
+  /**Contract a network of tensors, with the indices labelled as in
+     ContractionPlan. The plans are cached, so that repeated contractions of
+     networks with the same labels and dimensions are not planned again.
+     \ingroup Tensors
+  */
+  const RTensor contract_network(const std::vector<RTensor> &tensors,
+                                 const std::vector<Indices> &labels,
+                                 const Indices &output = Indices());
+  const CTensor contract_network(const std::vector<CTensor> &tensors,
+                                 const std::vector<Indices> &labels,
+                                 const Indices &output = Indices());
+
+} // namespace tensor
+
+#endif // !TENSOR_CONTRACTION_H
@@ -23,38 +23,63 @@
 #define TENSOR_DETAIL_REFCOUNT_HPP
 
 #include <tensor/numbers.h>
+#include <tensor/allocator.h>
 
 namespace tensor {
 
-template<typename elt_t>
-class RefPointer<elt_t>::pointer {
+template<typename elt_t, class counter_t>
+class RefPointer<elt_t,counter_t>::pointer {
 public:
   /* Reference counter for null pointer */
   pointer():
-    data_(0), size_(0), references_(1), owned_(true)
+    data_(0), size_(0), references_(1), owned_(true), allocator_(0)
   {}
 
   /* Reference count a given data */
   pointer(elt_t *data, size_t size, bool owned = true) :
-    data_(data), size_(size), references_(1), owned_(owned)
+    data_(data), size_(size), references_(1), owned_(owned), allocator_(0)
   {}
 
+  /* Reference count data that belongs to an allocator */
+  pointer(elt_t *data, size_t size, Allocator *allocator) :
+    data_(data), size_(size), references_(1), owned_(true), allocator_(allocator)
+  {}
+
+  /* Reference count freshly allocated, uninitialized data */
+  pointer(size_t size) :
+    data_(0), size_(size), references_(1), owned_(true), allocator_(0)
+  {
+    if (uses_tensor_allocator<elt_t>::value) {
+      allocator_ = tensor_allocator();
+      data_ = static_cast<elt_t*>(allocator_->allocate(size * sizeof(elt_t)));
+    } else {
+      data_ = new elt_t[size];
+    }
+  }
+
   /* Delete the object and its data */
   ~pointer() {
-    if (owned_)
-      delete[] data_;
+    if (owned_) {
+      if (allocator_)
+        allocator_->deallocate(data_, size_ * sizeof(elt_t));
+      else
+        delete[] data_;
+    }
   }
 
   /* Create a new reference object with the same data and only 1 ro reference. */
   pointer *clone() {
-    elt_t *output = new elt_t[size()];
-    std::copy(begin(), end(), output);
-    return new pointer(output, size());
+    pointer *output = new pointer(size());
+    if (uses_tensor_allocator<elt_t>::value)
+      memcpy(output->begin(), begin(), size() * sizeof(elt_t));
+    else
+      std::copy(begin(), end(), output->begin());
+    return output;
   }
 
-  int reference() { return ++references_; }
-  int dereference() { return --references_; }
-  int references() const { return references_; }
+  int reference() { return references_.increment(); }
+  int dereference() { return references_.decrement(); }
+  int references() const { return references_.value(); }
   size_t size() { return size_; }
   elt_t *begin() { return data_; }
   elt_t *end() { return begin() + size(); }
@@ -65,68 +90,67 @@ private:
 
   elt_t *data_;
   size_t size_;
-  int references_;
+  counter_t references_;
   bool owned_;
+  Allocator *allocator_; // Where the data came from, or NULL for new[]
 };
 
 //////////////////////////////////////////////////////////////////////
 // SHARED POINTER WITH COPY ON WRITE
 //
 
-template<class elt_t>
-RefPointer<elt_t>::RefPointer() {
-  ref_ = new pointer();
-}
+/* Empty pointers share this object, which is not reference counted, so that
+ * creating them or moving out of a pointer needs no memory allocation. */
+template<class elt_t, class counter_t>
+typename RefPointer<elt_t,counter_t>::pointer RefPointer<elt_t,counter_t>::empty_;
 
-template<class elt_t>
-RefPointer<elt_t>::RefPointer(size_t new_size) {
-  ref_ = new pointer(new elt_t[new_size], new_size);
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::RefPointer() {
+  ref_ = &empty_;
 }
 
-/* This is an optimization to ensure that complex double vectors are
- * started uninitialized. */
-template<>
-inline RefPointer<cdouble>::RefPointer(size_t new_size) {
-  ref_ = new pointer(reinterpret_cast<cdouble*>(new double[2*new_size]), new_size);
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::RefPointer(size_t new_size) {
+  ref_ = new pointer(new_size);
 }
 
-template<>
-inline RefPointer<cdouble>::pointer *
-RefPointer<cdouble>::pointer::clone() {
-  cdouble *output = reinterpret_cast<cdouble*>(new double[2*size()]);
-  memcpy(output, begin(), sizeof(*output)*size());
-  return new pointer(output, size());
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::RefPointer(elt_t *data, size_t new_size, bool owned) {
+    ref_ = new pointer(data, new_size, owned);
 }
 
-template<class elt_t>
-RefPointer<elt_t>::RefPointer(elt_t *data, size_t new_size, bool owned) {
-    ref_ = new pointer(data, new_size, owned);
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::RefPointer(elt_t *data, size_t new_size,
+                                        Allocator *allocator) {
+    ref_ = new pointer(data, new_size, allocator);
 }
 
-template<class elt_t>
-RefPointer<elt_t>::RefPointer(const RefPointer<elt_t> &p) {
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::RefPointer(const RefPointer &p) {
   ref_ = p.reference();
 }
 
-template<class elt_t>
-RefPointer<elt_t>::~RefPointer() {
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t>::~RefPointer() {
   dereference();
 }
 
-template<class elt_t>
-typename RefPointer<elt_t>::pointer *RefPointer<elt_t>::reference() const {
-  ref_->reference();
+template<class elt_t, class counter_t>
+typename RefPointer<elt_t,counter_t>::pointer *
+RefPointer<elt_t,counter_t>::reference() const {
+  if (ref_ != &empty_)
+    ref_->reference();
   return ref_;
 }
 
-template<class elt_t>
-void RefPointer<elt_t>::dereference() {
-  if (ref_->dereference() <= 0)
+template<class elt_t, class counter_t>
+void RefPointer<elt_t,counter_t>::dereference() {
+  if (ref_ != &empty_ && ref_->dereference() <= 0)
     delete ref_;
 }
 
-template<class elt_t>
-void RefPointer<elt_t>::appropriate() {
+template<class elt_t, class counter_t>
+void RefPointer<elt_t,counter_t>::appropriate() {
   if (ref_count() > 1) {
     pointer *new_ref = ref_->clone();
     dereference();
@@ -134,14 +158,15 @@ void RefPointer<elt_t>::appropriate() {
   }
 }
 
-template<class elt_t>
-void RefPointer<elt_t>::reallocate(size_t new_size) {
+template<class elt_t, class counter_t>
+void RefPointer<elt_t,counter_t>::reallocate(size_t new_size) {
   dereference();
-  ref_ = new pointer(new elt_t[new_size], new_size);
+  ref_ = new pointer(new_size);
 }
 
-template<class elt_t>
-RefPointer<elt_t> &RefPointer<elt_t>::operator=(const RefPointer<elt_t> &other) {
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t> &
+RefPointer<elt_t,counter_t>::operator=(const RefPointer &other) {
   if (other.ref_ != ref_) {
     dereference();
     ref_ = other.reference();
@@ -149,6 +174,19 @@ RefPointer<elt_t> &RefPointer<elt_t>::operator=(const RefPointer<elt_t> &other)
   return *this;
 }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+template<class elt_t, class counter_t>
+RefPointer<elt_t,counter_t> &
+RefPointer<elt_t,counter_t>::operator=(RefPointer &&other) {
+  if (&other != this) {
+    dereference();
+    ref_ = other.ref_;
+    other.ref_ = &empty_;
+  }
+  return *this;
+}
+#endif
+
 } // namespace tensor
 
 #endif // !TENSOR_DETAIL_REFCOUNT
@@ -153,6 +153,25 @@ namespace tensor {
     return *this;
   }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  template<typename elt_t>
+  Sparse<elt_t>::Sparse(Sparse<elt_t> &&s) :
+    dims_(std::move(s.dims_)), row_start_(std::move(s.row_start_)),
+    column_(std::move(s.column_)), data_(std::move(s.data_))
+  {
+  }
+
+  template<typename elt_t>
+  Sparse<elt_t> &Sparse<elt_t>::operator=(Sparse<elt_t> &&s)
+  {
+    row_start_ = std::move(s.row_start_);
+    column_ = std::move(s.column_);
+    data_ = std::move(s.data_);
+    dims_ = std::move(s.dims_);
+    return *this;
+  }
+#endif
+
   //////////////////////////////////////////////////////////////////////
   // CONSTRUCTOR FROM FULL TENSOR TO SPARSE AND VICEVERSA
   //
@@ -122,6 +122,13 @@ Tensor<elt_t>::Tensor(const Tensor<elt_t> &other) :
   dims_(other.dims_), data_(other.data_)
 {}
 
+#ifdef TENSOR_MOVE_SEMANTICS
+template<typename elt_t>
+Tensor<elt_t>::Tensor(Tensor<elt_t> &&other) :
+  data_(std::move(other.data_)), dims_(std::move(other.dims_))
+{}
+#endif
+
 template<typename elt_t>
 Tensor<elt_t>::Tensor(const Vector<elt_t> &data) : dims_(1), data_(data) {
   dims_.at(0) = data.size();
@@ -135,6 +142,16 @@ const Tensor<elt_t> &Tensor<elt_t>::operator=(const Tensor<elt_t> &other)
   return *this;
 }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+template<typename elt_t>
+const Tensor<elt_t> &Tensor<elt_t>::operator=(Tensor<elt_t> &&other)
+{
+  data_ = std::move(other.data_);
+  dims_ = std::move(other.dims_);
+  return *this;
+}
+#endif
+
 //
 // DIMENSIONS
 //
@@ -0,0 +1,335 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#if !defined(TENSOR_TENSOR_H) || defined(TENSOR_DETAIL_TENSOR_EXPR_HPP)
+#error "This header cannot be included manually"
+#else
+#define TENSOR_DETAIL_TENSOR_EXPR_HPP
+
+#include <cassert>
+#include <vector>
+#include <tensor/threads.h>
+
+namespace tensor {
+
+//////////////////////////////////////////////////////////////////////
+// LAZY ELEMENTWISE EXPRESSIONS
+//
+// An expression is a small object with three methods: size(),
+// dimensions() and operator[](i), the latter computing the i-th element
+// of the result on demand. Expressions are combined by the operators
+// below and are only evaluated when assigned to a Tensor, which is done
+// with a single pass and at most one allocation. Large expressions are
+// evaluated in blocks of parallel::CHUNK elements, by the threads of the
+// library.
+//
+
+bool verify_tensor_dimensions_match(const Indices &d1, const Indices &d2);
+
+/* Leaf of an expression: the elements of an existing tensor. */
+template<typename elt>
+class LazyLeaf {
+public:
+  typedef elt elt_t;
+  LazyLeaf(const Tensor<elt_t> &t) : data_(t.begin_const()), t_(t) {}
+  index size() const { return t_.size(); }
+  const Indices &dimensions() const { return t_.dimensions(); }
+  elt_t operator[](index i) const { return data_[i]; }
+private:
+  const elt_t *data_;
+  const Tensor<elt_t> &t_;
+};
+
+/* Leaf of an expression: a number that is broadcast to all elements. */
+template<typename elt>
+class LazyScalar {
+public:
+  typedef elt elt_t;
+  LazyScalar(const elt_t &value) : value_(value) {}
+  elt_t operator[](index) const { return value_; }
+private:
+  elt_t value_;
+};
+
+struct lazy_plus {
+  template<typename t1, typename t2>
+  static typename Binop<t1,t2>::type apply(const t1 &a, const t2 &b) { return a + b; }
+};
+
+struct lazy_minus {
+  template<typename t1, typename t2>
+  static typename Binop<t1,t2>::type apply(const t1 &a, const t2 &b) { return a - b; }
+};
+
+struct lazy_times {
+  template<typename t1, typename t2>
+  static typename Binop<t1,t2>::type apply(const t1 &a, const t2 &b) { return a * b; }
+};
+
+struct lazy_divided {
+  template<typename t1, typename t2>
+  static typename Binop<t1,t2>::type apply(const t1 &a, const t2 &b) { return a / b; }
+};
+
+/* Elementwise operation between two tensor expressions. */
+template<class op, class A, class B>
+class LazyBinop {
+public:
+  typedef typename Binop<typename A::elt_t, typename B::elt_t>::type elt_t;
+  LazyBinop(const A &a, const B &b) : a_(a), b_(b) {
+    assert(verify_tensor_dimensions_match(a.dimensions(), b.dimensions()));
+  }
+  index size() const { return a_.size(); }
+  const Indices &dimensions() const { return a_.dimensions(); }
+  elt_t operator[](index i) const { return op::apply(a_[i], b_[i]); }
+private:
+  A a_;
+  B b_;
+};
+
+/* Elementwise operation between a tensor expression and a number. */
+template<class op, class A, typename number>
+class LazyBinopRight {
+public:
+  typedef typename Binop<typename A::elt_t, number>::type elt_t;
+  LazyBinopRight(const A &a, const number &b) : a_(a), b_(b) {}
+  index size() const { return a_.size(); }
+  const Indices &dimensions() const { return a_.dimensions(); }
+  elt_t operator[](index i) const { return op::apply(a_[i], b_[i]); }
+private:
+  A a_;
+  LazyScalar<number> b_;
+};
+
+/* Elementwise operation between a number and a tensor expression. */
+template<class op, typename number, class B>
+class LazyBinopLeft {
+public:
+  typedef typename Binop<number, typename B::elt_t>::type elt_t;
+  LazyBinopLeft(const number &a, const B &b) : a_(a), b_(b) {}
+  index size() const { return b_.size(); }
+  const Indices &dimensions() const { return b_.dimensions(); }
+  elt_t operator[](index i) const { return op::apply(a_[i], b_[i]); }
+private:
+  LazyScalar<number> a_;
+  B b_;
+};
+
+/* Elementwise negation of a tensor expression. */
+template<class A>
+class LazyNegate {
+public:
+  typedef typename A::elt_t elt_t;
+  LazyNegate(const A &a) : a_(a) {}
+  index size() const { return a_.size(); }
+  const Indices &dimensions() const { return a_.dimensions(); }
+  elt_t operator[](index i) const { return -a_[i]; }
+private:
+  A a_;
+};
+
+/* Writes the blocks of an expression into a buffer. */
+template<class E, typename elt2>
+class LazyEvaluationTask : public parallel::Task {
+public:
+  LazyEvaluationTask(const E &e, elt2 *output) : e_(e), output_(output) {}
+  void run(index c) {
+    for (index i = parallel::chunk_begin(c), n = parallel::chunk_end(c, e_.size());
+         i < n; i++) {
+      output_[i] = e_[i];
+    }
+  }
+private:
+  const E &e_;
+  elt2 *output_;
+};
+
+/**Unevaluated elementwise expression among tensors and numbers. Objects of
+   this type are created with lazy() and the arithmetic operators, and they are
+   evaluated only when they are assigned to a Tensor, in a single pass over
+   memory and with a single allocation for the result. For instance
+   \code
+   p = lazy(r) + beta * lazy(p);
+   \endcode
+   computes all elements of the right-hand side in one loop, reusing the
+   storage of 'p' if it is not shared with any other tensor. The expression
+   keeps references to the tensors it was built from, and should therefore
+   not outlive the statement in which it is created.
+   \ingroup Tensors
+*/
+template<class E>
+class LazyTensor {
+public:
+  typedef typename E::elt_t elt_t;
+
+  LazyTensor(const E &e) : e_(e) {}
+
+  /**Number of elements in the expression.*/
+  index size() const { return e_.size(); }
+  /**Dimensions of the tensor that results from this expression.*/
+  const Indices &dimensions() const { return e_.dimensions(); }
+  /**Compute the i-th element of the expression, in column major order.*/
+  elt_t operator[](index i) const { return e_[i]; }
+
+  /**Evaluate the expression into a freshly allocated Tensor.*/
+  operator Tensor<elt_t>() const {
+    Tensor<elt_t> output(dimensions());
+    evaluate_into(output.begin());
+    return output;
+  }
+
+  /**Write all elements of the expression into the given buffer.*/
+  template<typename elt2>
+  void evaluate_into(elt2 *output) const {
+    index n = size();
+    if (n <= parallel::CHUNK) {
+      for (index i = 0; i < n; i++) {
+        output[i] = e_[i];
+      }
+    } else {
+      LazyEvaluationTask<E,elt2> task(e_, output);
+      parallel::run_chunks(task, parallel::chunks(n));
+    }
+  }
+
+  const E &expression() const { return e_; }
+
+private:
+  E e_;
+};
+
+/**Start a lazy expression with the elements of a tensor. \sa LazyTensor*/
+template<typename elt_t>
+inline LazyTensor<LazyLeaf<elt_t> > lazy(const Tensor<elt_t> &t) {
+  return LazyTensor<LazyLeaf<elt_t> >(LazyLeaf<elt_t>(t));
+}
+
+/* Computes the largest absolute value in each block of an expression. */
+template<class E>
+class LazyNorm0Task : public parallel::Task {
+public:
+  LazyNorm0Task(const E &e, double *partial) : e_(e), partial_(partial) {}
+  void run(index c) {
+    double output = 0;
+    for (index i = parallel::chunk_begin(c), n = parallel::chunk_end(c, e_.size());
+         i < n; i++) {
+      output = std::max<double>(output, abs(e_[i]));
+    }
+    partial_[c] = output;
+  }
+private:
+  const E &e_;
+  double *partial_;
+};
+
+/**Largest absolute value of the elements of a lazy expression. The elements
+   are computed and reduced in one pass, without storing the expression in a
+   temporary tensor. \sa LazyTensor
+   \ingroup Tensors
+*/
+template<class E>
+double norm0(const LazyTensor<E> &e)
+{
+  index n = e.size(), nchunks = parallel::chunks(n);
+  if (nchunks <= 1) {
+    double output = 0;
+    for (index i = 0; i < n; i++) {
+      output = std::max<double>(output, abs(e[i]));
+    }
+    return output;
+  }
+  std::vector<double> partial(nchunks);
+  LazyNorm0Task<E> task(e.expression(), &partial[0]);
+  parallel::run_chunks(task, nchunks);
+  return *std::max_element(partial.begin(), partial.end());
+}
+
+template<typename elt_t>
+template<class E>
+const Tensor<elt_t> &Tensor<elt_t>::operator=(const LazyTensor<E> &e)
+{
+  if (ref_count() == 1 && size() == e.size()) {
+    // Elementwise expressions only read the i-th element of each argument
+    // before writing the i-th element of the output, so we may safely
+    // overwrite our own storage, even if it appears in the expression.
+    e.evaluate_into(begin());
+    dims_ = e.dimensions();
+  } else {
+    Tensor<elt_t> output(e.dimensions());
+    e.evaluate_into(output.begin());
+    *this = TENSOR_MOVE(output);
+  }
+  return *this;
+}
+
+//
+// EXPRESSION <OP> EXPRESSION
+//
+template<class A> inline
+LazyTensor<LazyNegate<A> > operator-(const LazyTensor<A> &a) {
+  return LazyNegate<A>(a.expression());
+}
+
+#define TENSOR_LAZY_BINOP(OPERATOR, op)                                 \
+template<class A, class B> inline                                       \
+LazyTensor<LazyBinop<op,A,B> >                                          \
+OPERATOR(const LazyTensor<A> &a, const LazyTensor<B> &b) {              \
+  return LazyBinop<op,A,B>(a.expression(), b.expression());             \
+}                                                                       \
+template<class A, typename t2> inline                                   \
+LazyTensor<LazyBinop<op,A,LazyLeaf<t2> > >                              \
+OPERATOR(const LazyTensor<A> &a, const Tensor<t2> &b) {                 \
+  return LazyBinop<op,A,LazyLeaf<t2> >(a.expression(), b);              \
+}                                                                       \
+template<typename t1, class B> inline                                   \
+LazyTensor<LazyBinop<op,LazyLeaf<t1>,B> >                               \
+OPERATOR(const Tensor<t1> &a, const LazyTensor<B> &b) {                 \
+  return LazyBinop<op,LazyLeaf<t1>,B>(a, b.expression());               \
+}                                                                       \
+template<class A> inline                                                \
+LazyTensor<LazyBinopRight<op,A,double> >                                \
+OPERATOR(const LazyTensor<A> &a, double b) {                            \
+  return LazyBinopRight<op,A,double>(a.expression(), b);                \
+}                                                                       \
+template<class A> inline                                                \
+LazyTensor<LazyBinopRight<op,A,cdouble> >                               \
+OPERATOR(const LazyTensor<A> &a, cdouble b) {                           \
+  return LazyBinopRight<op,A,cdouble>(a.expression(), b);               \
+}                                                                       \
+template<class B> inline                                                \
+LazyTensor<LazyBinopLeft<op,double,B> >                                 \
+OPERATOR(double a, const LazyTensor<B> &b) {                            \
+  return LazyBinopLeft<op,double,B>(a, b.expression());                 \
+}                                                                       \
+template<class B> inline                                                \
+LazyTensor<LazyBinopLeft<op,cdouble,B> >                                \
+OPERATOR(cdouble a, const LazyTensor<B> &b) {                           \
+  return LazyBinopLeft<op,cdouble,B>(a, b.expression());                \
+}
+
+TENSOR_LAZY_BINOP(operator+, lazy_plus)
+TENSOR_LAZY_BINOP(operator-, lazy_minus)
+TENSOR_LAZY_BINOP(operator*, lazy_times)
+TENSOR_LAZY_BINOP(operator/, lazy_divided)
+
+#undef TENSOR_LAZY_BINOP
+
+} // namespace tensor
+
+#endif // !TENSOR_DETAIL_TENSOR_EXPR_HPP
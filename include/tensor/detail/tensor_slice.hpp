@@ -24,24 +24,71 @@
 
 namespace tensor {
 
+  bool slice_layout(Range **ranges, int n, const Indices &limits,
+                    Indices *dims, Indices *strides, index *offset,
+                    std::vector<Indices> *tables);
+
+  /**A slice of a tensor. It shares the memory of the tensor it was taken
+     from. When the slice is made of equally spaced indices, such as
+     range(1,5,2), it is described by the position of its first element and
+     the distance between consecutive elements along each index, and it can
+     be used in sums, binary operations and contractions without copying
+     its elements. Other lists of indices are kept in tables with the
+     position of each element along that index.
+
+     \ingroup Tensors
+  */
   template<typename elt_t>
   class Tensor<elt_t>::view
   {
   public:
-    ~view() {
-      delete ranges_;
-    };
     operator Tensor<elt_t>() const;
 
+    /**Number of indices of the slice.*/
+    int rank() const { return dims_.size(); }
+    /**Dimensions of the slice.*/
+    const Indices &dimensions() const { return dims_; }
+    /**Length of the given index of the slice.*/
+    index dimension(int which) const {
+      assert(which >= 0 && which < rank());
+      return dims_[which];
+    }
+    /**Number of elements in the slice.*/
+    index size() const { return dims_.total_size(); }
+
+    /**True if the slice is described by offset() and strides().*/
+    bool is_strided() const { return tables_.empty(); }
+    /**Position of the first element in the storage of the parent tensor.*/
+    index offset() const { return offset_; }
+    /**Distance between consecutive elements along each index.*/
+    const Indices &strides() const { return strides_; }
+    /**Pointer to the first element of a strided slice.*/
+    const elt_t *begin_const() const { return data_.begin_const() + offset_; }
+    /**Leading dimension of a strided slice that can be used as a matrix by
+       BLAS, or 0 if the slice has to be copied before that.*/
+    index leading_dimension() const {
+      if (!is_strided() || rank() > 2 || (dims_[0] > 1 && strides_[0] != 1))
+        return 0;
+      if (rank() == 2 && dims_[1] > 1)
+        return strides_[1];
+      return (dims_[0] > 1)? dims_[0] : 1;
+    }
+
   private:
     const Vector<elt_t> data_;
-    Indices dims_;
-    Range *ranges_;
-
-    // Start from another tensor and a set of ranges
-    view(const Tensor<elt_t> &parent, Indices &dims, Range *ranges) :
-      data_(parent.data_), dims_(dims), ranges_(ranges)
-    {}
+    Indices dims_, strides_;
+    index offset_;
+    std::vector<Indices> tables_;
+
+    // Start from another tensor and a set of ranges, which are deleted. If
+    // there is only one range, the tensor is seen as a one-dimensional array.
+    view(const Tensor<elt_t> &parent, Range **ranges, int n) :
+      data_(parent.data_)
+    {
+      slice_layout(ranges, n,
+                   (n == 1)? Indices(igen << parent.size()) : parent.dimensions(),
+                   &dims_, &strides_, &offset_, &tables_);
+    }
 
     // We do not want these objects to be initialized by users nor copied.
     view();
@@ -57,23 +104,24 @@ namespace tensor {
   class Tensor<elt_t>::mutable_view
   {
   public:
-    ~mutable_view() {
-      delete ranges_;
-    };
-
     void operator=(const view &a_stripe);
     void operator=(const Tensor<elt_t> &a_tensor);
     void operator=(elt_t v);
 
   private:
     Vector<elt_t> &data_;
-    Indices dims_;
-    Range *ranges_;
-
-    // Start from another tensor and a set of ranges
-    mutable_view(Tensor<elt_t> &parent, Indices &dims, Range *ranges) :
-      data_(parent.data_), dims_(dims), ranges_(ranges)
-    {}
+    Indices dims_, strides_;
+    index offset_;
+    std::vector<Indices> tables_;
+
+    // Start from another tensor and a set of ranges, as view does.
+    mutable_view(Tensor<elt_t> &parent, Range **ranges, int n) :
+      data_(parent.data_)
+    {
+      slice_layout(ranges, n,
+                   (n == 1)? Indices(igen << parent.size()) : parent.dimensions(),
+                   &dims_, &strides_, &offset_, &tables_);
+    }
 
     // We do not want these objects to be initialized by users nor copied.
     mutable_view();
@@ -20,6 +20,8 @@
 #ifndef TENSOR_FFT_H
 #define TENSOR_FFT_H
 
+#include <string>
+#include <vector>
 #include <tensor/config.h>
 #include <tensor/tensor.h>
 
@@ -53,15 +55,83 @@ namespace tensor {
   /** Like fftw, but overwrites the input. */
   void fftw_inplace(CTensor& in, const Booleans& convert, int direction);
 
+  /** Transforms in place a batch of tensors, which must all have the same
+   * dimensions.
+   *
+   * The tensors share one FFTW plan and are distributed among the threads of
+   * the library (see set_tensor_threads()). Many slices of a single tensor
+   * are best transformed with fftw_inplace(in, convert, direction), with
+   * convert false along the dimensions that label the slices, which does
+   * all of them with a single FFTW plan.
+   */
+  void fftw_inplace(std::vector<CTensor>& batch, int direction);
+  /** Like fftw_inplace(batch, direction), only along some dimensions. */
+  void fftw_inplace(std::vector<CTensor>& batch, const Booleans& convert, int direction);
+  /** Returns the transforms of a batch of tensors with the same dimensions. */
+  const std::vector<CTensor> fftw(const std::vector<CTensor>& batch, int direction);
+  /** Returns the transforms of a batch of tensors along some dimensions. */
+  const std::vector<CTensor> fftw(const std::vector<CTensor>& batch, const Booleans& convert, int direction);
+
+  /** Calculates the (unnormalized) DFT of a real tensor along all dimensions.
+   *
+   * Since the output is Hermitian, only half of it is computed: the first
+   * dimension of the output is in.dimension(0)/2+1. This is the layout used
+   * by the real-to-complex transforms of FFTW, and it takes about half the
+   * time and memory of fftw(to_complex(in), FFTW_FORWARD).
+   */
+  const CTensor rfft(const RTensor& in);
+  /** Calculates the unnormalized DFT of a real tensor along one dimension,
+   * which is reduced to in.dimension(dim)/2+1. */
+  const CTensor rfft(const RTensor& in, index dim);
+  /** Calculates the unnormalized DFT of a real tensor along the dimensions
+   * for which convert is true. The first of them is halved as in rfft(in). */
+  const CTensor rfft(const RTensor& in, const Booleans& convert);
+
+  /** Inverts rfft(), except for the normalization. The output has a
+   * first dimension n, where n/2+1 must be in.dimension(0). */
+  const RTensor irfft(const CTensor& in, index n);
+  /** Inverts rfft(in, dim). The output has a dimension n at dim. */
+  const RTensor irfft(const CTensor& in, index dim, index n);
+  /** Inverts rfft(in, convert). The first dimension for which convert is true
+   * gets the size n in the output. */
+  const RTensor irfft(const CTensor& in, const Booleans& convert, index n);
+
+  /** The effort that FFTW puts in planning a transform.
+   *
+   * FFTW looks for the fastest way to compute each transform by estimating
+   * (the default) or by timing the possible algorithms. The plans are kept
+   * and reused for all transforms with the same dimensions, so a larger
+   * effort pays off when the same transform is repeated many times.
+   */
+  enum {
+    FFTW_PLAN_ESTIMATE = 0,
+    FFTW_PLAN_MEASURE = 1,
+    FFTW_PLAN_PATIENT = 2,
+    FFTW_PLAN_EXHAUSTIVE = 3
+  };
+
+  /** Sets the planner effort for new plans and returns the previous one. */
+  int set_fftw_planner(int effort);
+  /** Returns the current planner effort. */
+  int fftw_planner();
+  /** Destroys all the plans that were kept. Plans that other threads are
+   * using are destroyed when their transforms finish. */
+  void fftw_forget_plans();
+  /** Adds the FFTW wisdom stored in a file, so that plans that were measured
+   * in previous runs are created at once. Returns false if it failed. */
+  bool fftw_load_wisdom(const std::string &filename);
+  /** Saves the accumulated FFTW wisdom to a file. Returns false if it failed. */
+  bool fftw_save_wisdom(const std::string &filename);
+
   /** Shifts the half-planes of the input tensor to reorder the frequencies.
    * 
    * A direction of FFTW_FORWARD applied to the output of fftw() shifts the
    * half-planes such that the frequencies go from minimum to maximum. Setting
    * direction to FFTW_BACKWARD reverses this operation.
    *
-   * Note that by definition, fftshift is not a terribly efficient function, and
-   * the implementation is not the fastest, either, so if possible you should
-   * not use this inside time-critical sections of the code.
+   * All dimensions are shifted in a single pass that copies contiguous runs
+   * of the data. Odd sizes are supported: the zero frequency moves to
+   * position (n-1)/2 and FFTW_BACKWARD moves it back.
    */
   const CTensor fftshift(const CTensor& in, int direction);
   /** fftshift along only one diemnsion. */
@@ -69,6 +139,31 @@ namespace tensor {
   /** fftshift along the given dimensions. */
   const CTensor fftshift(const CTensor& in, const Booleans& convert, int direction);
 
+  /** In-place fftshift, without temporary tensors. It takes one pass over
+   * the data by swapping elements, or two if some shifted dimension has an
+   * odd size. */
+  void fftshift_inplace(CTensor& in, int direction);
+  /** In-place fftshift along only one dimension. */
+  void fftshift_inplace(CTensor& in, index dim, int direction);
+  /** In-place fftshift along the given dimensions. */
+  void fftshift_inplace(CTensor& in, const Booleans& convert, int direction);
+
+  /** FFT followed by fftshift, with the shift folded into the transform.
+   *
+   * The result is that of fftshift(fftw(in, direction), FFTW_FORWARD), up to
+   * rounding errors, but the shift is replaced by phases that multiply the
+   * input, so that no separate pass over the output is needed. For even
+   * dimensions these phases are just signs; for odd ones they are complex
+   * and fftshift_inplace() after the FFT is about as fast.
+   */
+  const CTensor fftw_shifted(const CTensor& in, int direction);
+  /** fftw_shifted() along the given dimensions. */
+  const CTensor fftw_shifted(const CTensor& in, const Booleans& convert, int direction);
+  /** In-place version of fftw_shifted(). */
+  void fftw_shifted_inplace(CTensor& in, int direction);
+  /** In-place fftw_shifted() along the given dimensions. */
+  void fftw_shifted_inplace(CTensor& in, const Booleans& convert, int direction);
+
 } // namespace tensor
 
 #endif // TENSOR_FFT_H
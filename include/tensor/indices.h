@@ -36,6 +36,9 @@ namespace tensor {
   public:
     Indices() : Vector<index>() {}
     Indices(const Vector<index> &v) : Vector<index>(v) {}
+#ifdef TENSOR_MOVE_SEMANTICS
+    Indices(Vector<index> &&v) : Vector<index>(std::move(v)) {}
+#endif
     template<size_t n> Indices(StaticVector<index,n> v) : Vector<index>(v) {}
     explicit Indices(index size) : Vector<index>(size) {}
 
@@ -56,6 +59,11 @@ namespace tensor {
   public:
     Booleans() : Vector<bool>() {}
     Booleans(const Booleans &b) : Vector<bool>(b) {}
+#ifdef TENSOR_MOVE_SEMANTICS
+    Booleans(Booleans &&b) : Vector<bool>(std::move(b)) {}
+    Booleans &operator=(const Booleans &b) { Vector<bool>::operator=(b); return *this; }
+    Booleans &operator=(Booleans &&b) { Vector<bool>::operator=(std::move(b)); return *this; }
+#endif
     explicit Booleans(index size) : Vector<bool>(size) {}
   };
   
@@ -111,6 +119,7 @@ namespace tensor {
     virtual void set_limit(index new_limit);
     virtual index size() const;
     virtual void reset();
+    virtual bool is_strided(index *start, index *step) const;
     index nomore() const { return ~(index)0; }
     index get_offset() const { return base_; }
     index get_limit() const { return limit_; }
@@ -128,6 +137,7 @@ namespace tensor {
     virtual void set_limit(index new_limit);
     virtual index size() const;
     virtual void reset();
+    virtual bool is_strided(index *start, index *step) const;
   private:
     index counter_, counter_end_;
   };
@@ -140,6 +150,7 @@ namespace tensor {
     virtual void set_limit(index new_limit);
     virtual index size() const;
     virtual void reset();
+    virtual bool is_strided(index *start, index *step) const;
   private:
     index ndx_, start_, end_, step_;
   };
@@ -152,6 +163,7 @@ namespace tensor {
     virtual void set_limit(index new_limit);
     virtual index size() const;
     virtual void reset();
+    virtual bool is_strided(index *start, index *step) const;
   private:
     index ndx_, counter_;
   };
@@ -164,6 +176,7 @@ namespace tensor {
     virtual void set_limit(index new_limit);
     virtual index size() const;
     virtual void reset();
+    virtual bool is_strided(index *start, index *step) const;
   private:
     Indices indices_;
     index counter_;
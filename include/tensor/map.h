@@ -42,6 +42,20 @@ namespace tensor {
     const bool transpose_;
   };
 
+  /* Products with sparse matrices use a sliced copy of the matrix, when
+     SlicedSparse::is_suitable() recommends it. */
+  template<typename elt>
+  struct MatrixMap<Sparse<elt> > : public Map<Tensor<elt> > {
+    typedef Tensor<elt> tensor_t;
+    MatrixMap(const Sparse<elt> &m, bool transpose = false);
+    virtual ~MatrixMap();
+    virtual const tensor_t operator()(const tensor_t &arg) const;
+  private:
+    const Sparse<elt> m_;
+    const bool transpose_;
+    const SlicedSparse<elt> sliced_;
+  };
+
   template<class Func, class Tensor>
   struct FunctionMap : public Map<Tensor> {
     FunctionMap(const Func &f) : f_(f) {}
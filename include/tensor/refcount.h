@@ -22,9 +22,58 @@
 
 #include <cstring>
 #include <algorithm>
+#include <tensor/config.h>
+
+/* Compilers that support C++11 give tensors and vectors move constructors
+   and move assignments. TENSOR_MOVE(x) lets code take advantage of them,
+   while still building with older compilers. */
+#if __cplusplus >= 201103L
+# include <utility>
+# define TENSOR_MOVE_SEMANTICS 1
+# define TENSOR_MOVE(x) std::move(x)
+#else
+# define TENSOR_MOVE(x) (x)
+#endif
 
 namespace tensor {
 
+class Allocator;
+
+/**Reference counter that is not protected against concurrent access. This is
+   the fastest option, but tensors sharing data (even when they are only read)
+   must not be used from different threads.
+   \ingroup Internals
+*/
+class SerialRefCounter {
+public:
+  SerialRefCounter(int n) : n_(n) {}
+  int increment() { return ++n_; }
+  int decrement() { return --n_; }
+  int value() const { return n_; }
+private:
+  int n_;
+};
+
+/**Reference counter based on atomic operations. Copies of the same RefPointer
+   may be created, read and destroyed from different threads.
+   \ingroup Internals
+*/
+class AtomicRefCounter {
+public:
+  AtomicRefCounter(int n) : n_(n) {}
+  int increment() { return __atomic_add_fetch(&n_, 1, __ATOMIC_RELAXED); }
+  int decrement() { return __atomic_sub_fetch(&n_, 1, __ATOMIC_ACQ_REL); }
+  int value() const { return __atomic_load_n(&n_, __ATOMIC_ACQUIRE); }
+private:
+  int n_;
+};
+
+#ifdef TENSOR_ATOMIC_REFCOUNT
+typedef AtomicRefCounter DefaultRefCounter;
+#else
+typedef SerialRefCounter DefaultRefCounter;
+#endif
+
 /**A reference counting pointer with copy-on-write. This is a pointer that keeps
    track of whether the same data is shared by other RefPointer structures. It
    internally keeps a reference counter to store how many pointers look at the
@@ -43,9 +92,19 @@ namespace tensor {
    Note that pointers returned by the various begin() and end() functions are
    not reference-counted, so you should not store the returned pointers.
 
+   The reference counter is given by the 'counter_t' policy. By default it is
+   AtomicRefCounter, so that different threads may hold copies of the same
+   data, unless the library was configured with --disable-atomic-refcount.
+   Note that a single RefPointer object must still not be modified by two
+   threads at the same time.
+
+   Storage for plain numbers (see uses_tensor_allocator) is obtained from the
+   tensor_allocator() and is aligned to TENSOR_ALIGNMENT bytes. Other types
+   are created with new[].
+
    \ingroup Internals
 */
-template<class value_type>
+template<class value_type, class counter_t = DefaultRefCounter>
 class RefPointer {
 public:
   typedef value_type elt_t; ///< Type of data pointed to
@@ -56,15 +115,25 @@ public:
   RefPointer(size_t new_size);
   /** Wrap around the given data */
   RefPointer(elt_t *data, size_t size, bool owned = true);
+  /** Wrap around data that is returned to 'allocator' when the last
+      reference is gone. */
+  RefPointer(elt_t *data, size_t size, Allocator *allocator);
   /** Copy constructor that increases the reference count. */
-  RefPointer(const RefPointer<elt_t> &p);
-
+  RefPointer(const RefPointer &p);
+#ifdef TENSOR_MOVE_SEMANTICS
+  /** Move constructor that takes the data, leaving 'p' empty. */
+  RefPointer(RefPointer &&p) : ref_(p.ref_) { p.ref_ = &empty_; }
+#endif
 
   /** Destructor that deletes no longer reference data. */
   ~RefPointer();
 
   /** Copy a pointer increasing the reference count. */
-  RefPointer<elt_t> &operator=(const RefPointer<elt_t> &p);
+  RefPointer &operator=(const RefPointer &p);
+#ifdef TENSOR_MOVE_SEMANTICS
+  /** Take the data from another pointer, leaving it empty. */
+  RefPointer &operator=(RefPointer &&p);
+#endif
 
   /** Retreive the pointer without caring for references (unsafe). */
   elt_t *begin() { appropriate(); return ref_->begin(); }
@@ -90,7 +159,8 @@ public:
 
 private:
   class pointer;
-  mutable pointer *ref_; // Pointer to data we reference or NULL
+  mutable pointer *ref_; // Pointer to data we reference or &empty_
+  static pointer empty_; // Shared by all empty pointers, never counted
 
   /** Ensure that we have a unique copy of the data. If the pointer has more
       than one reference, a fresh new copy of the data is created.
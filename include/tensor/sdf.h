@@ -20,7 +20,9 @@
 #ifndef TENSOR_SDF_H
 #define TENSOR_SDF_H
 
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <string>
 #include <vector>
 #include <tensor/tensor.h>
@@ -36,13 +38,26 @@ namespace sdf {
   bool isdir(const std::string &filename);
   bool make_directory(const std::string &dirname, int mode = 0777);
 
+  /**Entry in the index of an SDF file. It gives the name and type (one of
+     DataFile::file_tags) of a record, the position where it starts and the
+     dimensions of the tensor it contains. For vectors of tensors, the
+     dimensions are just the number of tensors.*/
+  struct DataFileRecord {
+    std::string name;
+    tensor::index tag;
+    size_t offset;
+    Indices dimensions;
+  };
+
   class DataFile {
   public:
     enum file_tags {
       TAG_RTENSOR = 0,
       TAG_CTENSOR = 1,
       TAG_RTENSOR_VECTOR = 2,
-      TAG_CTENSOR_VECTOR = 3
+      TAG_CTENSOR_VECTOR = 3,
+      TAG_RTENSOR_COMPRESSED = 4,
+      TAG_CTENSOR_COMPRESSED = 5
     };
 
     enum endianness {
@@ -70,11 +85,36 @@ namespace sdf {
     DataFile(const std::string &a_filename, int flags = SDF_SHARED);
     ~DataFile();
     const char *tag_to_name(size_t tag);
-    void close();
+    /* Returns false if the file of SDF_PARANOID mode could not replace the
+       original one. */
+    bool close();
     bool is_open() { return _open; }
     bool is_locked() { return _lock; }
     const std::string &actual_filename() { return _actual_filename; }
 
+    /* Index of the records, which is kept next to the file with the suffix
+       ".idx" and only written by OutDataFile. Files without it, or with
+       records that it does not cover, are scanned in memory when they are
+       first searched; readers never write next to the file. Records are
+       read from the stream of the open file, whose position is preserved. */
+    std::vector<DataFileRecord> _records;
+    /* Position in _records of the last record with each name. */
+    std::map<std::string,size_t> _record_positions;
+    bool _indexed;
+
+    const std::vector<DataFileRecord> &indexed_records(std::istream &s);
+    const DataFileRecord *find_record(std::istream &s, const std::string &name);
+    void index_records(std::istream &s, bool use_index_file);
+    bool check_record(std::istream &s, const DataFileRecord &record);
+    std::string index_filename() const { return _filename + ".idx"; }
+
+    static size_t file_size(const std::string &filename);
+    static size_t scan_records(std::istream &s, size_t start, size_t end,
+                               std::vector<DataFileRecord> *records);
+    static bool read_index_file(const std::string &filename, size_t *data_size,
+                                std::vector<DataFileRecord> *records);
+    static bool write_index_file(const std::string &filename, size_t data_size,
+                                 const std::vector<DataFileRecord> &records);
   };
 
 
@@ -94,11 +134,48 @@ namespace sdf {
     void dump(const std::vector<RTensor> &t, const std::string &name = "");
     void dump(const std::vector<CTensor> &t, const std::string &name = "");
 
+    /**Write a tensor in a compressed record, which is read back with
+       load() as any other tensor. The data is split into chunks that are
+       compressed in parallel and which can be read separately (see
+       InDataFile::load(RTensor*,const std::string&,index,index)). This pays
+       off for data that is sparse or smooth; otherwise the chunks are kept
+       uncompressed.*/
+    void dump_compressed(const RTensor &t, const std::string &name = "");
+    /**Write a tensor in a compressed record.*/
+    void dump_compressed(const CTensor &t, const std::string &name = "");
+
+    /**Start a record that is written one slice at a time. A tensor with
+       dimensions (d1,...,dn,k) is made of k slices with dimensions
+       (d1,...,dn), which are written with append_slice() as they are
+       produced. The number of slices need not be known in advance: it is
+       written to the header of the record by end_slices() or close(). No
+       other record can be written until then.*/
+    void begin_slices(const Indices &dimensions, const std::string &name = "",
+                      bool complex = false);
+    /**Append a slice to the record started with begin_slices().*/
+    void append_slice(const RTensor &slice);
+    /**Append a slice to the record started with begin_slices().*/
+    void append_slice(const CTensor &slice);
+    /**Complete the record started with begin_slices().*/
+    void end_slices();
+
+    /**Pass the data written so far to the operating system.*/
+    void flush();
     void close();
 
   private:
 
     std::ofstream _stream;
+    size_t _position;
+    size_t _initial_size;
+    std::vector<DataFileRecord> _new_records;
+
+    /* Record being written with begin_slices(): position of its dimensions
+       in the file, type and dimensions of the slices, and number of them. */
+    size_t _slices_header;
+    tensor::index _slices_tag;
+    Indices _slices_dimensions;
+    tensor::index _slices;
 
     void write_raw(const char *data, size_t n);
     void write_raw(const int *data, size_t n);
@@ -112,12 +189,91 @@ namespace sdf {
     }
 
     template<class Vector> void dump_vector(const Vector &v);
-
+    template<class Tensor> void dump_tensor(const Tensor &t,
+                                            const std::string &name,
+                                            tensor::index tag);
+    void dump_compressed(const double *data, tensor::index n,
+                         const Indices &dimensions, const std::string &name,
+                         tensor::index tag);
+    /* Write a record with chunks compressed by compression::pack_chunks(). */
+    void dump_packed(const std::vector<char> &buffer,
+                     const std::vector<size_t> &sizes, size_t chunk,
+                     tensor::index n, const Indices &dimensions,
+                     const std::string &name, tensor::index tag);
+    friend class CompressedDumpJob;
+    template<class Tensor> void append_slice(const Tensor &t,
+                                             tensor::index tag);
+
+    void add_record(const std::string &name, tensor::index tag,
+                    const Indices &dimensions);
+    void collect_index(std::vector<DataFileRecord> *records);
     void write_header();
     void write_variable_name(const std::string &name);
     void write_tag(const std::string &name, tensor::index tag);
   };
 
+  class AsyncJob;
+  struct AsyncQueue;
+
+  /**Writer of SDF files that does the actual output in a background thread.
+     The dump() functions take a snapshot of their argument and return
+     immediately. Tensors are not copied: the snapshot shares the data of the
+     tensor, which is only duplicated if the tensor is modified before the
+     record is written. This relies on the reference counter being atomic,
+     which is the default. When the library is configured with
+     --disable-atomic-refcount, dump() copies the tensors instead. The
+     records are written in the order in which they were dumped.
+
+     Only one snapshot of tensors is kept at a time: dumping a tensor waits
+     until the previous one has been written, so that there are at most two
+     copies of the data. dump_compressed() compresses the tensor before it
+     returns, using the threads of the library, and only the writing is done
+     in the background.
+
+     close() also happens in the background, including the renaming of the
+     file in SDF_PARANOID mode, so that a checkpoint only replaces the
+     previous one when it is complete. Use flush() or wait() to make sure
+     that the data, or the whole file, is on disk.
+  */
+  class AsyncOutDataFile {
+
+  public:
+
+    AsyncOutDataFile(const std::string &a_filename,
+                     int flags = DataFile::SDF_SHARED);
+    /**Waits for all pending operations and closes the file.*/
+    ~AsyncOutDataFile();
+
+    void dump(const int r, const std::string &name = "");
+    void dump(const size_t r, const std::string &name = "");
+    void dump(const double r, const std::string &name = "");
+    void dump(const cdouble r, const std::string &name = "");
+    void dump(const RTensor &t, const std::string &name = "");
+    void dump(const CTensor &t, const std::string &name = "");
+    void dump(const std::vector<RTensor> &t, const std::string &name = "");
+    void dump(const std::vector<CTensor> &t, const std::string &name = "");
+    void dump_compressed(const RTensor &t, const std::string &name = "");
+    void dump_compressed(const CTensor &t, const std::string &name = "");
+
+    /**Wait until all records dumped so far have been written to the file.*/
+    void flush();
+    /**Close the file once all records are written, without waiting.*/
+    void close();
+    /**Wait until all pending operations, including close(), are done.*/
+    void wait();
+
+  private:
+
+    OutDataFile _file;
+    AsyncQueue *_queue;
+    bool _closed;
+
+    void push(AsyncJob *job);
+
+    AsyncOutDataFile(const AsyncOutDataFile &);
+    AsyncOutDataFile &operator=(const AsyncOutDataFile &);
+  };
+
   class InDataFile : public DataFile {
 
   public:
@@ -133,12 +289,46 @@ namespace sdf {
     void load(std::vector<RTensor> *m, const std::string &name = "");
     void load(std::vector<CTensor> *m, const std::string &name = "");
 
+    /**Read 'count' elements of a tensor, starting with element 'first' in
+       column-major order, as a one-dimensional tensor. Only the chunks of
+       compressed records that contain those elements are decompressed.*/
+    void load(RTensor *t, const std::string &name, tensor::index first,
+              tensor::index count);
+    /**Read 'count' elements of a tensor, starting with element 'first'.*/
+    void load(CTensor *t, const std::string &name, tensor::index first,
+              tensor::index count);
+
+    /**Start reading a tensor one slice at a time, where the slices are the
+       subtensors with a fixed value of the last index (see
+       OutDataFile::begin_slices()). It returns the number of slices, which
+       are read in order with load_slice(), so that only one of them is kept
+       in memory. No other record can be read until all slices are read.*/
+    tensor::index begin_slices(const std::string &name = "");
+    /**Read the next slice of the record opened with begin_slices().*/
+    void load_slice(RTensor *t);
+    /**Read the next slice of the record opened with begin_slices().*/
+    void load_slice(CTensor *t);
+
+    /**List of records in the file, in the order in which they were written.*/
+    const std::vector<DataFileRecord> &records() { return indexed_records(_stream); }
+    /**Move to the given record, so that it is read by the next load(). If
+       several records have the same name, it selects the last one. Returns
+       false if there is no such record.*/
+    bool seek(const std::string &name);
+    /**Move to a record from the list returned by records().*/
+    void seek(const DataFileRecord &record);
+
     void close();
 
   private:
 
     std::ifstream _stream;
 
+    /* Record being read with begin_slices(). */
+    tensor::index _slices_tag;
+    Indices _slices_dimensions;
+    tensor::index _slices;
+
     void read_raw(char *data, size_t n);
     void read_raw(int *data, size_t n);
     void read_raw(size_t *data, size_t n);
@@ -151,12 +341,91 @@ namespace sdf {
     }
 
     template<class Vector> const Vector load_vector();
+    template<class Tensor> void load_slice(Tensor *t, tensor::index tag);
+    void load_elements(double *data, tensor::index words, tensor::index first,
+                       tensor::index count, bool compressed);
+
+    tensor::index read_tag_code();
+    std::string read_variable_name();
+
+    void read_header();
+    tensor::index read_tag(const std::string &record_name, tensor::index tag,
+                           tensor::index compressed_tag = -1);
+  };
+
+  /**Reader of SDF files that maps the whole file into memory. The tensors
+     returned by load() are not copied: they reference the pages of the file,
+     which are only read from disk when accessed, and which are shared with
+     other processes mapping the same file. Modifying such a tensor changes a
+     private copy of the affected pages, never the file.
+
+     The mapping lasts while the MmapDataFile is open or any tensor loaded
+     from it still references the file, and is released with the last of
+     them.
+  */
+  class MmapDataFile : public DataFile {
+
+  public:
+
+    MmapDataFile(const std::string &a_filename, int flags = SDF_SHARED);
+    ~MmapDataFile();
+
+    void load(int *r, const std::string &name = "");
+    void load(size_t *r, const std::string &name = "");
+    void load(double *r, const std::string &name = "");
+    void load(cdouble *r, const std::string &name = "");
+    void load(RTensor *t, const std::string &name = "");
+    void load(CTensor *t, const std::string &name = "");
+    void load(std::vector<RTensor> *m, const std::string &name = "");
+    void load(std::vector<CTensor> *m, const std::string &name = "");
+
+    /**Read 'count' elements of a tensor, starting with element 'first' in
+       column-major order, as a one-dimensional tensor. Only the chunks of
+       compressed records that contain those elements are decompressed.*/
+    void load(RTensor *t, const std::string &name, tensor::index first,
+              tensor::index count);
+    /**Read 'count' elements of a tensor, starting with element 'first'.*/
+    void load(CTensor *t, const std::string &name, tensor::index first,
+              tensor::index count);
+
+    /**List of records in the file, in the order in which they were written.*/
+    const std::vector<DataFileRecord> &records();
+    /**Move to the given record, so that it is read by the next load(). If
+       several records have the same name, it selects the last one. Returns
+       false if there is no such record.*/
+    bool seek(const std::string &name);
+    /**Move to a record from the list returned by records().*/
+    void seek(const DataFileRecord &record);
+
+    void close();
+
+  private:
+
+    class Mapping;
+    Mapping *_mapping;
+    class MemoryStream;
+    MemoryStream *_stream;
+    char *_data;
+    size_t _size;
+    size_t _position;
+
+    const char *read_bytes(size_t bytes);
+
+    template<typename t> void read_raw(t &v) {
+      memcpy(&v, read_bytes(sizeof(t)), sizeof(t));
+    }
+
+    template<typename elt_t> const Vector<elt_t> load_vector();
+    const Indices load_dimensions();
+    void load_elements(double *data, tensor::index words, tensor::index first,
+                       tensor::index count, bool compressed);
 
     tensor::index read_tag_code();
     std::string read_variable_name();
 
     void read_header();
-    void read_tag(const std::string &record_name, tensor::index tag);
+    tensor::index read_tag(const std::string &record_name, tensor::index tag,
+                           tensor::index compressed_tag = -1);
   };
 
 } // namespace sdf
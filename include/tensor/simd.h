@@ -0,0 +1,59 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_SIMD_H
+#define TENSOR_SIMD_H
+
+#include <tensor/tensor.h>
+
+namespace tensor {
+
+/**Instruction sets used by the elementwise operations of RTensor and CTensor.
+   \ingroup Tensors
+*/
+enum SimdLevel {
+  SIMD_NONE = 0,  ///< Plain C++ loops, with the C library math functions
+  SIMD_SSE2 = 1,  ///< 128-bit vectors
+  SIMD_AVX2 = 2,  ///< 256-bit vectors
+  SIMD_AVX512 = 3 ///< 512-bit vectors
+};
+
+/**Instruction set currently used by the elementwise operations.*/
+SimdLevel simd_level();
+/**Best instruction set supported by this processor and this library.*/
+SimdLevel simd_max_level();
+/**Select the instruction set for elementwise operations, returning the
+   previous one. Levels not supported by the processor are lowered to
+   simd_max_level().*/
+SimdLevel set_simd_level(SimdLevel level);
+/**Name of the instruction set, as in "avx2".*/
+const char *simd_level_name(SimdLevel level);
+
+/**Vectorized exponential. Unlike exp(), which calls the C library, it may
+   differ from it by two units in the last place, but gives the same results
+   at all levels above SIMD_NONE.*/
+RTensor fast_exp(const RTensor &t);
+/**Vectorized sine, with the accuracy of fast_exp().*/
+RTensor fast_sin(const RTensor &t);
+/**Vectorized cosine, with the accuracy of fast_exp().*/
+RTensor fast_cos(const RTensor &t);
+
+} // namespace tensor
+
+#endif // !TENSOR_SIMD_H
@@ -56,6 +56,12 @@ namespace tensor {
     Sparse(const Sparse<elt_t> &s);
     /**Assignment operator.*/
     Sparse &operator=(const Sparse<elt_t> &s);
+#ifdef TENSOR_MOVE_SEMANTICS
+    /**Move constructor, which leaves 's' empty.*/
+    Sparse(Sparse<elt_t> &&s);
+    /**Move assignment, which leaves 's' empty.*/
+    Sparse &operator=(Sparse<elt_t> &&s);
+#endif
     /**Implicit conversion from other sparse types.*/
     template<typename e2> Sparse(const Sparse<e2> &other) :
       dims_(other.dims_), row_start_(other.row_start_),
@@ -148,6 +154,12 @@ namespace tensor {
   const RTensor mmult(const RSparse &m1, const RTensor &m2);
   /* Matrix multiplication between tensor and sparse matrix. */
   const CTensor mmult(const CSparse &m1, const CTensor &m2);
+  /* Matrix multiplication between sparse matrices, with sparse output.
+     Elements that cancel exactly are dropped. The rows of the output are
+     computed in parallel using the threads of the library. */
+  const RSparse mmult(const RSparse &m1, const RSparse &m2);
+  /* Matrix multiplication between sparse matrices, with sparse output. */
+  const CSparse mmult(const CSparse &m1, const CSparse &m2);
 
   /* Real part of a sparse matrix.*/
   inline const RSparse &real(const RSparse &A) { return A; }
@@ -210,6 +222,69 @@ namespace tensor {
   /**Implements A+B where A and B act on different spaces of a tensor product.*/
   const CSparse kron2_sum(const CSparse &s1, const CSparse &s2);
 
+  /**A sparse matrix in sliced ELLPACK form (SELL-C-sigma). The rows are
+     sorted by length within windows of 256 rows and grouped in slices of 8
+     rows, which are stored column after column and padded to the longest
+     row of the slice, with columns stored as int. Products with tensors
+     then advance over 8 rows at once and read less memory than with Sparse,
+     which makes them faster unless the rows are very short or of very
+     different lengths. A SlicedSparse is built from a Sparse and can only
+     multiply tensors, giving the same results as the original matrix.
+
+     \ingroup Tensors
+  */
+  template<typename elt>
+  class SlicedSparse {
+  public:
+    typedef elt elt_t;
+
+    /**Build an empty matrix.*/
+    SlicedSparse();
+    /**Convert a sparse matrix to sliced form.*/
+    explicit SlicedSparse(const Sparse<elt_t> &s);
+
+    /**Return SlicedSparse matrix dimensions.*/
+    const Indices &dimensions() const { return dims_; }
+    /**Number of rows.*/
+    index rows() const { return dims_[0]; }
+    /**Number of columns*/
+    index columns() const { return dims_[1]; }
+    /**Number of nonzero elements.*/
+    index length() const;
+    /**Number of stored elements, including the padding.*/
+    index padded_length() const { return data_.size(); }
+
+    /**Empty matrix?*/
+    bool is_empty() const { return (rows() == 0)||(columns() == 0); }
+
+    /**True if products with this matrix are expected to be faster in sliced
+       form: the rows are not too short on average and sorting them by
+       length leaves little padding.*/
+    static bool is_suitable(const Sparse<elt_t> &s);
+
+  public:
+    /** The dimensions (rows and columns) of the matrix. */
+    Indices dims_;
+    /** Gives for each slice at which index the column_/data_ entries start. */
+    Indices slice_start_;
+    /** Gives for each sorted row its position in the original matrix. */
+    Indices row_;
+    /** Gives the length of each sorted row, zero in the padding rows. */
+    Indices row_length_;
+    /** Gives for each data_ entry the column in the matrix, as an int. */
+    Vector<int> column_;
+    /** The single data entries, zero in the padding. */
+    Tensor<elt_t> data_;
+  };
+
+  typedef SlicedSparse<double> RSlicedSparse;
+  typedef SlicedSparse<cdouble> CSlicedSparse;
+
+  /* Matrix multiplication between sliced sparse matrix and tensor. */
+  const RTensor mmult(const RSlicedSparse &m1, const RTensor &m2);
+  /* Matrix multiplication between sliced sparse matrix and tensor. */
+  const CTensor mmult(const CSlicedSparse &m1, const CTensor &m2);
+
 } // namespace tensor
 
 #ifdef TENSOR_LOAD_IMPL
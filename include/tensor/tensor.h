@@ -39,6 +39,8 @@ namespace tensor {
 // BASE CLASS
 //
 
+template<class E> class LazyTensor;
+
 /*!\addtogroup Tensors*/
 /* @{ */
 /**An N-dimensional array of numbers. A Tensor is a multidimensional array of
@@ -80,6 +82,11 @@ class Tensor {
   /**Optimized copy constructor (See \ref Copy "Optimal copy").*/
   Tensor(const Tensor &other);
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  /**Move constructor, which takes the data of 'other' leaving it empty.*/
+  Tensor(Tensor &&other);
+#endif
+
   /**Implicit coercion. */
   template<typename e2> Tensor(const Tensor<e2> &other) :
     data_(other.size()), dims_(other.dimensions())
@@ -117,6 +124,14 @@ class Tensor {
   /**Assignment operator.*/
   const Tensor &operator=(const Tensor<elt_t> &other);
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  /**Move assignment, which takes the data of 'other' leaving it empty.*/
+  const Tensor &operator=(Tensor<elt_t> &&other);
+#endif
+
+  /**Evaluate a lazy elementwise expression (See LazyTensor).*/
+  template<class E> const Tensor &operator=(const LazyTensor<E> &e);
+
   /**Returns total number of elements in Tensor.*/
   index size() const { return data_.size(); }
   /**Does the tensor have elements?*/
@@ -351,6 +366,7 @@ Tensor<typename Binop<t1,t2>::type> operator/(const t1 &a, const Tensor<t2> &b);
 #endif
 #include <tensor/detail/tensor_slice.hpp>
 #include <tensor/detail/tensor_ops.hpp>
+#include <tensor/detail/tensor_expr.hpp>
 
 //////////////////////////////////////////////////////////////////////
 // EXPLICIT INSTANTIATIONS
@@ -374,6 +390,8 @@ namespace tensor {
   double max(const RTensor &r);
   /**Return the sum of the elements in the tensor.*/
   double sum(const RTensor &r);
+  /**Return the sum of the elements in a slice of a tensor.*/
+  double sum(const RTensor::view &r);
   /**Return the mean of the elements in the tensor.*/
   double mean(const RTensor &r);
   /**Return the mean of the elements in the along the given dimension.*/
@@ -382,6 +400,7 @@ namespace tensor {
   double norm0(const RTensor &r);
   double scprod(const RTensor &a, const RTensor &b);
   double norm2(const RTensor &r);
+  double norm2(const RTensor::view &r);
   double matrix_norminf(const RTensor &r);
 
   RTensor abs(const RTensor &t);
@@ -415,6 +434,7 @@ namespace tensor {
 
   const RTensor squeeze(const RTensor &t);
   const RTensor permute(const RTensor &a, index ndx1 = 0, index ndx2 = -1);
+  const RTensor permute(const RTensor &a, const Indices &perm);
   const RTensor transpose(const RTensor &a);
   inline const RTensor adjoint(const RTensor &a) { return transpose(a); }
 
@@ -423,6 +443,41 @@ namespace tensor {
   const RTensor foldin(const RTensor &a, int ndx1, const RTensor &b, int ndx2);
   const RTensor mmult(const RTensor &a, const RTensor &b);
 
+  const RTensor fold(const RTensor::view &a, int ndx1, const RTensor &b, int ndx2);
+  const RTensor fold(const RTensor &a, int ndx1, const RTensor::view &b, int ndx2);
+  const RTensor fold(const RTensor::view &a, int ndx1, const RTensor::view &b, int ndx2);
+  const RTensor mmult(const RTensor::view &a, const RTensor &b);
+  const RTensor mmult(const RTensor &a, const RTensor::view &b);
+  const RTensor mmult(const RTensor::view &a, const RTensor::view &b);
+
+  const std::vector<RTensor> fold(const std::vector<RTensor> &a, int ndx1,
+                                  const std::vector<RTensor> &b, int ndx2);
+  const std::vector<RTensor> foldc(const std::vector<RTensor> &a, int ndx1,
+                                   const std::vector<RTensor> &b, int ndx2);
+  const std::vector<RTensor> mmult(const std::vector<RTensor> &a,
+                                   const std::vector<RTensor> &b);
+  void fold_into(std::vector<RTensor> &output,
+                 const std::vector<RTensor> &a, int ndx1,
+                 const std::vector<RTensor> &b, int ndx2);
+  void mmult_into(std::vector<RTensor> &output,
+                  const std::vector<RTensor> &a, const std::vector<RTensor> &b);
+
+  const RTensor contract(const RTensor &a, const Indices &ia,
+                         const RTensor &b, const Indices &ib,
+                         const Indices &out = Indices());
+
+  /**Largest number of products, m*n*k, of a matrix multiplication that is
+     computed by the library's own kernels instead of by BLAS. The default
+     value may be changed with the environment variable TENSOR_SMALL_GEMM.
+     \ingroup Tensors
+  */
+  index small_gemm_size();
+  /**Change small_gemm_size(), returning the previous value. Zero makes all
+     products go through BLAS.
+     \ingroup Tensors
+  */
+  index set_small_gemm_size(index products);
+
   void fold_into(RTensor &output, const RTensor &a, int ndx1, const RTensor &b, int ndx2);
   void foldin_into(RTensor &output, const RTensor &a, int ndx1, const RTensor &b, int ndx2);
   void mmult_into(RTensor &output, const RTensor &a, const RTensor &b);
@@ -472,6 +527,24 @@ namespace tensor {
   RTensor &operator+=(RTensor &a, const RTensor &b);
   RTensor &operator-=(RTensor &a, const RTensor &b);
 
+  const RTensor operator+(const RTensor &a, const RTensor::view &b);
+  const RTensor operator-(const RTensor &a, const RTensor::view &b);
+  const RTensor operator*(const RTensor &a, const RTensor::view &b);
+  const RTensor operator/(const RTensor &a, const RTensor::view &b);
+
+  const RTensor operator+(const RTensor::view &a, const RTensor &b);
+  const RTensor operator-(const RTensor::view &a, const RTensor &b);
+  const RTensor operator*(const RTensor::view &a, const RTensor &b);
+  const RTensor operator/(const RTensor::view &a, const RTensor &b);
+
+  const RTensor operator+(const RTensor::view &a, const RTensor::view &b);
+  const RTensor operator-(const RTensor::view &a, const RTensor::view &b);
+  const RTensor operator*(const RTensor::view &a, const RTensor::view &b);
+  const RTensor operator/(const RTensor::view &a, const RTensor::view &b);
+
+  RTensor &operator+=(RTensor &a, const RTensor::view &b);
+  RTensor &operator-=(RTensor &a, const RTensor::view &b);
+
   const RTensor kron(const RTensor &a, const RTensor &b);
   const RTensor kron2(const RTensor &a, const RTensor &b);
   const RTensor kron2_sum(const RTensor &a, const RTensor &b);
@@ -488,6 +561,8 @@ namespace tensor {
 
   /**Return the sum of the elements in the tensor.*/
   cdouble sum(const CTensor &r);
+  /**Return the sum of the elements in a slice of a tensor.*/
+  cdouble sum(const CTensor::view &r);
   /**Return the mean of the elements in the tensor.*/
   cdouble mean(const CTensor &r);
   /**Return the mean of the elements in the along the given dimension.*/
@@ -496,6 +571,7 @@ namespace tensor {
   double norm0(const CTensor &r);
   cdouble scprod(const CTensor &a, const CTensor &b);
   double norm2(const CTensor &r);
+  double norm2(const CTensor::view &r);
   double matrix_norminf(const CTensor &r);
 
   inline const RTensor real(const RTensor &r) { return r; }
@@ -540,6 +616,7 @@ namespace tensor {
 
   const CTensor squeeze(const CTensor &t);
   const CTensor permute(const CTensor &a, index ndx1 = 0, index ndx2 = -1);
+  const CTensor permute(const CTensor &a, const Indices &perm);
   const CTensor transpose(const CTensor &a);
   const CTensor adjoint(const CTensor &a);
 
@@ -555,6 +632,38 @@ namespace tensor {
   const CTensor mmult(const RTensor &a, const CTensor &b);
   const CTensor mmult(const CTensor &a, const RTensor &b);
 
+  const CTensor fold(const CTensor::view &a, int ndx1, const CTensor &b, int ndx2);
+  const CTensor fold(const CTensor &a, int ndx1, const CTensor::view &b, int ndx2);
+  const CTensor fold(const CTensor::view &a, int ndx1, const CTensor::view &b, int ndx2);
+  const CTensor mmult(const CTensor::view &a, const CTensor &b);
+  const CTensor mmult(const CTensor &a, const CTensor::view &b);
+  const CTensor mmult(const CTensor::view &a, const CTensor::view &b);
+
+  void fold_into(CTensor &output, const CTensor &a, int ndx1, const CTensor &b, int ndx2);
+  void mmult_into(CTensor &output, const CTensor &a, const CTensor &b);
+
+  const std::vector<CTensor> fold(const std::vector<CTensor> &a, int ndx1,
+                                  const std::vector<CTensor> &b, int ndx2);
+  const std::vector<CTensor> foldc(const std::vector<CTensor> &a, int ndx1,
+                                   const std::vector<CTensor> &b, int ndx2);
+  const std::vector<CTensor> mmult(const std::vector<CTensor> &a,
+                                   const std::vector<CTensor> &b);
+  void fold_into(std::vector<CTensor> &output,
+                 const std::vector<CTensor> &a, int ndx1,
+                 const std::vector<CTensor> &b, int ndx2);
+  void mmult_into(std::vector<CTensor> &output,
+                  const std::vector<CTensor> &a, const std::vector<CTensor> &b);
+
+  const CTensor contract(const CTensor &a, const Indices &ia,
+                         const CTensor &b, const Indices &ib,
+                         const Indices &out = Indices());
+  const CTensor contract(const RTensor &a, const Indices &ia,
+                         const CTensor &b, const Indices &ib,
+                         const Indices &out = Indices());
+  const CTensor contract(const CTensor &a, const Indices &ia,
+                         const RTensor &b, const Indices &ib,
+                         const Indices &out = Indices());
+
   const RTensor scale(const RTensor &t, int ndx1, const RTensor &v);
   const CTensor scale(const CTensor &t, int ndx1, const CTensor &v);
   const CTensor scale(const CTensor &t, int ndx1, const RTensor &v);
@@ -607,6 +716,24 @@ namespace tensor {
   CTensor &operator+=(CTensor &a, const CTensor &b);
   CTensor &operator-=(CTensor &a, const CTensor &b);
 
+  const CTensor operator+(const CTensor &a, const CTensor::view &b);
+  const CTensor operator-(const CTensor &a, const CTensor::view &b);
+  const CTensor operator*(const CTensor &a, const CTensor::view &b);
+  const CTensor operator/(const CTensor &a, const CTensor::view &b);
+
+  const CTensor operator+(const CTensor::view &a, const CTensor &b);
+  const CTensor operator-(const CTensor::view &a, const CTensor &b);
+  const CTensor operator*(const CTensor::view &a, const CTensor &b);
+  const CTensor operator/(const CTensor::view &a, const CTensor &b);
+
+  const CTensor operator+(const CTensor::view &a, const CTensor::view &b);
+  const CTensor operator-(const CTensor::view &a, const CTensor::view &b);
+  const CTensor operator*(const CTensor::view &a, const CTensor::view &b);
+  const CTensor operator/(const CTensor::view &a, const CTensor::view &b);
+
+  CTensor &operator+=(CTensor &a, const CTensor::view &b);
+  CTensor &operator-=(CTensor &a, const CTensor::view &b);
+
   const CTensor kron(const CTensor &a, const CTensor &b);
   const CTensor kron2(const CTensor &a, const CTensor &b);
   const CTensor kron2_sum(const CTensor &a, const CTensor &b);
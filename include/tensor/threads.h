@@ -0,0 +1,78 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_THREADS_H
+#define TENSOR_THREADS_H
+
+#include <algorithm>
+#include <tensor/vector.h>
+
+namespace tensor {
+
+/**Number of threads used by elementwise operations and reductions. When the
+   program starts this is the value of the environment variable
+   TENSOR_NUM_THREADS or, if it is not set, the number of processors.
+   \ingroup Internals
+*/
+int tensor_threads();
+
+/**Change the number of threads used by the library, returning the previous
+   value. A value of zero or less restores the default. Reductions such as
+   sum() and scprod() split tensors into blocks of a fixed size and add the
+   partial results pairwise, so that they give the same result for any number
+   of threads. When called from within a parallel task, the change takes
+   effect once the running job has finished.
+   \ingroup Internals
+*/
+int set_tensor_threads(int n);
+
+//
+// Work sharing among the threads of the library. Arrays are split into
+// blocks of CHUNK elements that are processed by whichever thread is free.
+// The blocks do not depend on the number of threads, so that the output is
+// always the same.
+//
+namespace parallel {
+
+  /* Elements per block: 256kb of real numbers, which fits in L2 caches. */
+  const index CHUNK = 32768;
+
+  inline index chunks(index n) { return (n + CHUNK - 1) / CHUNK; }
+  inline index chunk_begin(index c) { return c * CHUNK; }
+  inline index chunk_end(index c, index n) { return std::min(n, (c + 1) * CHUNK); }
+
+  /* Work that can be split in independent blocks. */
+  class Task {
+  public:
+    virtual ~Task() {}
+    virtual void run(index chunk) = 0;
+  };
+
+  /* Run task.run(c) for c = 0 .. nchunks-1 and wait for all of them. The
+     blocks are processed sequentially if there is a single thread, if there
+     is only one block, or when called from within another parallel task.
+     If a block throws an exception, the remaining blocks are skipped and the
+     exception is rethrown once all threads have stopped. */
+  void run_chunks(Task &task, index nchunks);
+
+} // namespace parallel
+
+} // namespace tensor
+
+#endif // !TENSOR_THREADS_H
@@ -45,11 +45,21 @@ class Vector {
   /* Copy constructor and copy operator */
   Vector(const Vector<elt_t> &v) : data_(v.data_) {}
   Vector &operator=(const Vector<elt_t> &v) { data_ = v.data_; return *this; }
+#ifdef TENSOR_MOVE_SEMANTICS
+  /* Move constructor and move operator, which leave 'v' empty */
+  Vector(Vector<elt_t> &&v) : data_(std::move(v.data_)) {}
+  Vector &operator=(Vector<elt_t> &&v) { data_ = std::move(v.data_); return *this; }
+#endif
 
   /* Create a vector that references data we do not own (own=false in the
      RefPointer constructor. */
   Vector(index size, elt_t *data) : data_(data, size, false) {}
 
+  /* Create a vector that references data owned by an allocator, which
+     gets it back through Allocator::deallocate() with the last reference. */
+  Vector(index size, elt_t *data, Allocator *allocator) :
+    data_(data, size, allocator) {}
+
   index size() const {
     return data_.size();
   }
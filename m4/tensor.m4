@@ -11,6 +11,29 @@ AC_DEFUN([TENSOR_BITS],[
   AC_C_BIGENDIAN([AC_DEFINE(TENSOR_BIGENDIAN, [1], [Machine is big endian])],[],[])
 ])
 
+dnl ------------------------------------------------------------
+dnl Atomic reference counters
+dnl
+AC_DEFUN([TENSOR_REFCOUNT],[
+  AC_MSG_CHECKING([for atomic builtins])
+  AC_LINK_IFELSE(
+    [AC_LANG_PROGRAM([[]],[[
+      int n = 1;
+      __atomic_add_fetch(&n, 1, __ATOMIC_RELAXED);
+      __atomic_sub_fetch(&n, 1, __ATOMIC_ACQ_REL);
+      return __atomic_load_n(&n, __ATOMIC_ACQUIRE) - 1;]])],
+    [have_atomic_builtins=yes],
+    [have_atomic_builtins=no])
+  AC_MSG_RESULT([$have_atomic_builtins])
+  if test "x$enable_atomic_refcount" = xyes; then
+    if test $have_atomic_builtins = yes; then
+      AC_DEFINE(TENSOR_ATOMIC_REFCOUNT, [1], [Thread safe reference counting])
+    else
+      AC_MSG_WARN([Atomic builtins not available: reference counting is not thread safe])
+    fi
+  fi
+])
+
 dnl ------------------------------------------------------------
 dnl Backtraces
 dnl
@@ -391,6 +414,11 @@ AC_DEFUN([TENSOR_FFTW],[
     if test $have_fftw = yes -a $with_fftw = yes ; then
       FFTW_LIBS="-lfftw3 $LIBS"
       AC_DEFINE([TENSOR_USE_FFTW3], [1], [Use FFTW3 library])
+      AC_CHECK_LIB([fftw3_threads], [fftw_init_threads],
+                   [FFTW_LIBS="-lfftw3_threads $FFTW_LIBS"
+                    AC_DEFINE([TENSOR_USE_FFTW3_THREADS], [1],
+                              [Use the multithreaded FFTW3 library])],
+                   [], [-lfftw3 -lpthread])
       have_fftw=yes
     else
       have_fftw=no
@@ -0,0 +1,72 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/refcount.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Plain new[] and delete[], which is what RefPointer used before
+// having allocators.
+//
+class NewAllocator : public Allocator {
+public:
+  virtual void *allocate(size_t bytes) { return new char[bytes]; }
+  virtual void deallocate(void *p, size_t) { delete[] static_cast<char*>(p); }
+};
+
+//
+// Temporaries of the same size that are created and destroyed, as in
+// the expression 'a = b + c * d'.
+//
+void temporaries(size_t size, int n)
+{
+  RefPointer<double> *p[8];
+  for (int j = 0; j < n; j++) p[j] = new RefPointer<double>(size);
+  for (int j = 0; j < n; j++) delete p[j];
+}
+
+void prof_allocator(const char *name, Allocator *a, const int repeats = 100000)
+{
+  Allocator *old = set_tensor_allocator(a);
+  PROF_BEGIN_SET(name) {
+    for (size_t size = 1; size <= 1024*1024; size <<= 2) {
+      PROF_ENTRY(size, temporaries(size, 4), repeats);
+    }
+  } PROF_END_SET;
+  set_tensor_allocator(old);
+}
+
+int main()
+{
+  NewAllocator new_allocator;
+
+  PROF_BEGIN_GROUP("4 temporaries") {
+    prof_allocator("new[]", &new_allocator);
+    prof_allocator("system", system_allocator());
+    pool_allocator_reset_stats();
+    prof_allocator("pool", pool_allocator());
+  } PROF_END_GROUP;
+
+  const AllocatorStats stats = pool_allocator_stats();
+  std::cout << "Pool hit rate: " << stats.hit_rate() << std::endl
+            << "Pool peak memory: " << stats.bytes_peak << " bytes" << std::endl;
+}
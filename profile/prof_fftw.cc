@@ -0,0 +1,113 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <tensor/tensor.h>
+#include <tensor/fftw.h>
+#include <tensor/threads.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Compare a batch of transforms, fftw_inplace(std::vector,...), with a loop
+// that calls fftw_inplace() on each tensor, and with a single tensor that
+// stacks the batch along its last dimension and is transformed with a
+// "howmany" plan, fftw_inplace(t, convert, direction).
+//
+
+void loop_fftw(std::vector<CTensor> &batch, int direction)
+{
+  for (size_t n = 0; n < batch.size(); n++)
+    fftw_inplace(batch[n], direction);
+}
+
+void prof_fftw_batch(const char *name, tensor::index N, tensor::index batch,
+                     const int repeats = 8)
+{
+  std::vector<CTensor> A;
+  for (tensor::index n = 0; n < batch; n++)
+    A.push_back(CTensor::random(N, N));
+  CTensor stack = CTensor::random(N, N, batch);
+  Booleans convert(3);
+  convert.at(0) = convert.at(1) = true;
+  convert.at(2) = false;
+  PROF_BEGIN_SET(name) {
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("loop", loop_fftw(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("batch-single", fftw_inplace(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("slices-single", fftw_inplace(stack, convert, FFTW_FORWARD), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("batch-threads", fftw_inplace(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("slices-threads", fftw_inplace(stack, convert, FFTW_FORWARD), repeats);
+  } PROF_END_SET;
+}
+
+void prof_fftw_large(const char *name, tensor::index N, const int repeats = 8)
+{
+  CTensor A = CTensor::random(N, N);
+  PROF_BEGIN_SET(name) {
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("single", fftw_inplace(A, FFTW_FORWARD), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("threads", fftw_inplace(A, FFTW_FORWARD), repeats);
+  } PROF_END_SET;
+}
+
+//
+// Compare the out-of-place and in-place fftshift() along all dimensions, and
+// an FFT followed by a shift with fftw_shifted(), where the shift is folded
+// into the transform.
+//
+
+void prof_fftshift(const char *name, const Indices &dims, const int repeats = 8)
+{
+  CTensor A = CTensor::random(dims);
+  CTensor B;
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("fftshift", B = fftshift(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("fftshift-inplace", fftshift_inplace(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("fftw+fftshift", B = fftshift(fftw(A, FFTW_FORWARD), FFTW_FORWARD), repeats);
+    PROF_ENTRY("fftw-shifted", B = fftw_shifted(A, FFTW_FORWARD), repeats);
+    PROF_ENTRY("fftw-shifted-inplace", fftw_shifted_inplace(A, FFTW_FORWARD), repeats);
+  } PROF_END_SET;
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("CTensor FFT batch") {
+    prof_fftw_batch("16x16 x 10000", 16, 10000);
+    prof_fftw_batch("64x64 x 1000", 64, 1000);
+    prof_fftw_batch("256x256 x 50", 256, 50);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor FFT large") {
+    prof_fftw_large("512x512", 512);
+    prof_fftw_large("2048x2048", 2048);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor fftshift") {
+    prof_fftshift("512x512", igen << 512 << 512);
+    prof_fftshift("511x511", igen << 511 << 511);
+    prof_fftshift("64x64x64", igen << 64 << 64 << 64);
+    prof_fftshift("63x63x63", igen << 63 << 63 << 63);
+    prof_fftshift("2048x2048", igen << 2048 << 2048);
+  } PROF_END_GROUP;
+}
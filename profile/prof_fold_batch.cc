@@ -0,0 +1,79 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <tensor/tensor.h>
+#include <tensor/threads.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Compare a batch of contractions, fold(std::vector,...), with a loop that
+// calls fold() on each pair of tensors. The shapes are those of a sweep over
+// a matrix product state, A(D,d,D) contracted with B(D,D). fold_into() reuses
+// the output tensors, as in repeated sweeps.
+//
+
+template<class Tensor>
+void loop_fold(std::vector<Tensor> &C, const std::vector<Tensor> &A, int ndx1,
+               const std::vector<Tensor> &B, int ndx2)
+{
+  for (size_t n = 0; n < A.size(); n++)
+    C[n] = fold(A[n], ndx1, B[n], ndx2);
+}
+
+template<class Tensor>
+void prof_fold_batch(const char *name, tensor::index D, tensor::index batch,
+                     const int repeats = 8)
+{
+  std::vector<Tensor> A, B, C(batch);
+  for (tensor::index n = 0; n < batch; n++) {
+    A.push_back(Tensor::random(D, 2, D));
+    B.push_back(Tensor::random(D, D));
+  }
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("loop", loop_fold(C, A, -1, B, 0), repeats);
+    PROF_ENTRY("batch", C = fold(A, -1, B, 0), repeats);
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("into-single", fold_into(C, A, -1, B, 0), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("into-threads", fold_into(C, A, -1, B, 0), repeats);
+    PROF_ENTRY("loop-mmult", loop_fold(C, B, -1, B, 0), repeats);
+    PROF_ENTRY("mmult-into", mmult_into(C, B, B), repeats);
+  } PROF_END_SET;
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("RTensor batch 10000") {
+    prof_fold_batch<RTensor>("D=2", 2, 10000);
+    prof_fold_batch<RTensor>("D=4", 4, 10000);
+    prof_fold_batch<RTensor>("D=8", 8, 10000);
+    prof_fold_batch<RTensor>("D=16", 16, 10000);
+    prof_fold_batch<RTensor>("D=32", 32, 2000);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor batch 10000") {
+    prof_fold_batch<CTensor>("D=2", 2, 10000);
+    prof_fold_batch<CTensor>("D=8", 8, 10000);
+    prof_fold_batch<CTensor>("D=32", 32, 2000);
+  } PROF_END_GROUP;
+}
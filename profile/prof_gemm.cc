@@ -0,0 +1,72 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/tensor.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Matrix products with the library's kernels for small matrices and with
+// BLAS, to find the size at which BLAS becomes faster. The threshold is
+// small_gemm_size(), which counts the products m*n*k.
+//
+
+template<class Tensor>
+void prof_gemm(const char *name, tensor::index m, tensor::index k, tensor::index n)
+{
+  Tensor A(igen << m << k), B(igen << k << n), C;
+  A.randomize();
+  B.randomize();
+  int repeats = std::max<tensor::index>(10, 10000000 / (m * n * k));
+  PROF_BEGIN_SET(name) {
+    tensor::index old = set_small_gemm_size(1000000000);
+    PROF_ENTRY("small", mmult_into(C, A, B), repeats);
+    set_small_gemm_size(0);
+    PROF_ENTRY("blas", mmult_into(C, A, B), repeats);
+    set_small_gemm_size(old);
+  } PROF_END_SET;
+}
+
+template<class Tensor>
+void prof_gemm_sizes()
+{
+  char name[64];
+  for (tensor::index d = 2; d <= 32; d += (d < 8)? 1 : 4) {
+    sprintf(name, "%ldx%ldx%ld", d, d, d);
+    prof_gemm<Tensor>(name, d, d, d);
+  }
+  // Shapes of a sweep over a matrix product state
+  for (tensor::index d = 2; d <= 32; d *= 2) {
+    sprintf(name, "%ldx%ldx%ld", 2*d, d, d);
+    prof_gemm<Tensor>(name, 2*d, d, d);
+  }
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("RTensor mmult") {
+    prof_gemm_sizes<RTensor>();
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor mmult") {
+    prof_gemm_sizes<CTensor>();
+  } PROF_END_GROUP;
+}
@@ -0,0 +1,81 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include <tensor/tensor.h>
+#include <tensor/threads.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Compare permute(A, perm), which moves all indices in one pass, with the
+// equivalent sequence of exchanges of two indices.
+//
+
+const RTensor pairwise_permute(const RTensor &A, const Indices &perm)
+{
+  RTensor P = A;
+  Indices order = iota(0, A.rank() - 1);
+  for (tensor::index k = 0; k < A.rank(); k++) {
+    tensor::index m = std::find(order.begin(), order.end(), perm[k]) - order.begin();
+    if (m != k) {
+      P = permute(P, k, m);
+      std::swap(order.at(k), order.at(m));
+    }
+  }
+  return P;
+}
+
+void prof_permute(const char *name, const Indices &perm, tensor::index d,
+                  const int repeats = 8)
+{
+  Indices dims(perm.size());
+  std::fill(dims.begin(), dims.end(), d);
+  RTensor A(dims);
+  A.randomize();
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("pairwise", pairwise_permute(A, perm), repeats);
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("single", permute(A, perm), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("threads", permute(A, perm), repeats);
+  } PROF_END_SET;
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("RTensor 2048^2") {
+    prof_permute("10", igen << 1 << 0, 2048);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RTensor 64^4") {
+    prof_permute("1023", igen << 1 << 0 << 2 << 3, 64);
+    prof_permute("3210", igen << 3 << 2 << 1 << 0, 64);
+    prof_permute("2301", igen << 2 << 3 << 0 << 1, 64);
+    prof_permute("1230", igen << 1 << 2 << 3 << 0, 64);
+    prof_permute("0321", igen << 0 << 3 << 2 << 1, 64);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RTensor 16^6") {
+    prof_permute("543210", igen << 5 << 4 << 3 << 2 << 1 << 0, 16);
+    prof_permute("103254", igen << 1 << 0 << 3 << 2 << 5 << 4, 16);
+  } PROF_END_GROUP;
+}
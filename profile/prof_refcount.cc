@@ -0,0 +1,75 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/refcount.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Cost of creating and destroying copies of a pointer, which is what
+// happens every time a Tensor is passed or returned by value.
+//
+template<class pointer_t>
+void copy_and_destroy(const pointer_t &p, int copies)
+{
+  pointer_t *q[16];
+  for (int j = 0; j < copies; j++) q[j] = new pointer_t(p);
+  for (int j = 0; j < copies; j++) delete q[j];
+}
+
+template<class pointer_t>
+void prof_copy(const char *name, const int repeats = 1024*1024)
+{
+  PROF_BEGIN_SET(name) {
+    pointer_t p(16);
+    for (int copies = 1; copies <= 16; copies <<= 1) {
+      PROF_ENTRY(copies, copy_and_destroy(p, copies), repeats);
+    }
+  } PROF_END_SET;
+}
+
+//
+// Cost of reassigning pointers, as in 'a = b' between tensors.
+//
+template<class pointer_t>
+void prof_assign(const char *name, const int repeats = 1024*1024)
+{
+  PROF_BEGIN_SET(name) {
+    pointer_t p(16), q(16), r;
+    PROF_ENTRY(1, r = p; r = q, repeats);
+  } PROF_END_SET;
+}
+
+int main()
+{
+  typedef RefPointer<double,SerialRefCounter> SerialPointer;
+  typedef RefPointer<double,AtomicRefCounter> AtomicPointer;
+
+  PROF_BEGIN_GROUP("SerialRefCounter") {
+    prof_copy<SerialPointer>("copy+destroy");
+    prof_assign<SerialPointer>("assign");
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("AtomicRefCounter") {
+    prof_copy<AtomicPointer>("copy+destroy");
+    prof_assign<AtomicPointer>("assign");
+  } PROF_END_GROUP;
+}
@@ -0,0 +1,230 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+
+#include <sstream>
+#include <tensor/sdf.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace sdf;
+using namespace profile;
+
+//
+// Loading a tensor of n doubles from an SDF file, either reading it with
+// InDataFile or mapping the file with MmapDataFile. The "sum" entries also
+// touch all the data, which is what finally brings the mapped pages in.
+//
+
+template<class Reader>
+double load_sum(const char *filename, bool touch)
+{
+  Reader f(filename);
+  RTensor t;
+  f.load(&t, "t");
+  return touch? sum(t) : t[0];
+}
+
+void prof_sdf(const char *name, tensor::index n)
+{
+  const char *filename = "prof_sdf.dat";
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+  {
+    OutDataFile f(filename);
+    f.dump(RTensor::random(n), "t");
+  }
+  int repeats = std::max<tensor::index>(3, 100000000 / n);
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("read", load_sum<InDataFile>(filename, false), repeats);
+    PROF_ENTRY("mmap", load_sum<MmapDataFile>(filename, false), repeats);
+    PROF_ENTRY("read-sum", load_sum<InDataFile>(filename, true), repeats);
+    PROF_ENTRY("mmap-sum", load_sum<MmapDataFile>(filename, true), repeats);
+  } PROF_END_SET;
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+}
+
+//
+// Reading the last record of a file with n records of size (d,d), either
+// loading all records before it or moving to it with the index.
+//
+
+template<class Reader>
+double load_sequential(const char *filename, tensor::index n)
+{
+  Reader f(filename);
+  RTensor t;
+  for (tensor::index i = 0; i < n; i++)
+    f.load(&t);
+  return t[0];
+}
+
+template<class Reader>
+double load_indexed(const char *filename, const char *name)
+{
+  Reader f(filename);
+  RTensor t;
+  f.seek(name);
+  f.load(&t, name);
+  return t[0];
+}
+
+void prof_index(const char *name, tensor::index n, tensor::index d)
+{
+  const char *filename = "prof_sdf.dat";
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+  {
+    OutDataFile f(filename);
+    for (tensor::index i = 0; i < n; i++) {
+      std::ostringstream s;
+      s << "t" << i;
+      f.dump(RTensor::random(d, d), s.str());
+    }
+  }
+  std::ostringstream s;
+  s << "t" << (n - 1);
+  std::string last = s.str();
+  int repeats = std::max<tensor::index>(10, 1000000 / (n * d));
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("read", load_sequential<InDataFile>(filename, n), repeats);
+    PROF_ENTRY("read-index", load_indexed<InDataFile>(filename, last.c_str()), repeats);
+    PROF_ENTRY("mmap", load_sequential<MmapDataFile>(filename, n), repeats);
+    PROF_ENTRY("mmap-index", load_indexed<MmapDataFile>(filename, last.c_str()), repeats);
+  } PROF_END_SET;
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+}
+
+//
+// Writing and reading a tensor of n doubles in raw and compressed records,
+// for random numbers, which do not compress, for a smooth function and
+// for data that is mostly zero.
+//
+
+double write_file(const char *filename, const RTensor &t, bool compressed)
+{
+  delete_file(filename);
+  OutDataFile f(filename);
+  if (compressed)
+    f.dump_compressed(t, "t");
+  else
+    f.dump(t, "t");
+  return t[0];
+}
+
+void prof_compression(const char *name, const RTensor &t)
+{
+  const char *filename = "prof_sdf.dat";
+  int repeats = std::max<tensor::index>(3, 10000000 / t.size());
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("write", write_file(filename, t, false), repeats);
+    PROF_ENTRY("read", load_sum<InDataFile>(filename, false), repeats);
+    PROF_ENTRY("write-compressed", write_file(filename, t, true), repeats);
+    PROF_ENTRY("read-compressed", load_sum<InDataFile>(filename, false), repeats);
+    PROF_ENTRY("mmap-compressed", load_sum<MmapDataFile>(filename, false), repeats);
+  } PROF_END_SET;
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+}
+
+void prof_compressions(tensor::index n)
+{
+  RTensor smooth(n), sparse = RTensor::zeros(n, 1);
+  for (tensor::index i = 0; i < n; i++)
+    smooth.at(i) = sin(1e-5 * i);
+  for (tensor::index i = 0; i < n; i += 100)
+    sparse.at(i) = 1.0 / (1 + i);
+  prof_compression("random", RTensor::random(n));
+  prof_compression("smooth", smooth);
+  prof_compression("sparse", sparse);
+}
+
+//
+// A simulation that saves its state after every step, replacing the previous
+// checkpoint. With AsyncOutDataFile, each checkpoint is written while the
+// following step is computed.
+//
+
+static void simulation_step(RTensor &t)
+{
+  double *p = t.begin();
+  for (tensor::index i = 0; i < t.size(); i++)
+    p[i] = cos(p[i]);
+}
+
+double checkpoints(const char *filename, RTensor t, int steps)
+{
+  for (int i = 0; i < steps; i++) {
+    simulation_step(t);
+    OutDataFile f(filename, DataFile::SDF_PARANOID);
+    f.dump(t, "state");
+  }
+  return t[0];
+}
+
+double async_checkpoints(const char *filename, RTensor t, int steps)
+{
+  AsyncOutDataFile *f = 0;
+  for (int i = 0; i < steps; i++) {
+    simulation_step(t);
+    delete f;
+    f = new AsyncOutDataFile(filename, DataFile::SDF_PARANOID);
+    f->dump(t, "state");
+    f->close();
+  }
+  delete f;
+  return t[0];
+}
+
+void prof_checkpoints(const char *name, tensor::index n)
+{
+  const char *filename = "prof_sdf.dat";
+  int repeats = 3;
+  RTensor t = RTensor::random(n);
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("sync", checkpoints(filename, t, 10), repeats);
+    PROF_ENTRY("async", async_checkpoints(filename, t, 10), repeats);
+  } PROF_END_SET;
+  delete_file(filename);
+  delete_file(std::string(filename) + ".idx");
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("SDF") {
+    prof_sdf("8 kB", 1024);
+    prof_sdf("8 MB", 1024*1024);
+    prof_sdf("256 MB", 32*1024*1024);
+    prof_index("100 records 8x8", 100, 8);
+    prof_index("5000 records 8x8", 5000, 8);
+    prof_index("1000 records 128x128", 1000, 128);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("SDF compression 32 MB") {
+    prof_compressions(4*1024*1024);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("SDF checkpoints, 10 steps") {
+    prof_checkpoints("8 MB", 1024*1024);
+    prof_checkpoints("32 MB", 4*1024*1024);
+  } PROF_END_GROUP;
+}
@@ -0,0 +1,183 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/tensor.h>
+#include <tensor/sparse.h>
+#include <tensor/threads.h>
+#include <tensor/rand.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Products of sparse matrices, mmult(RSparse,RSparse), compared with the
+// products that convert one or both factors to full form. The matrices are
+// Hamiltonians of Heisenberg chains with L spins, built from Kronecker
+// products as in the tests.
+//
+
+RSparse heisenberg(int L)
+{
+  RSparse sz(RTensor(igen << 2 << 2, rgen << 1.0 << 0.0 << 0.0 << -1.0));
+  RSparse sp(RTensor(igen << 2 << 2, rgen << 0.0 << 0.0 << 1.0 << 0.0));
+  RSparse sm = transpose(sp);
+  RSparse bond = kron(sz, sz) + 0.5 * (kron(sp, sm) + kron(sm, sp));
+  RSparse H(1 << L, 1 << L);
+  for (int i = 0; i < L-1; i++) {
+    H = H + kron(kron(RSparse::eye(1 << i), bond), RSparse::eye(1 << (L-2-i)));
+  }
+  return H;
+}
+
+void prof_sparse_mmult(const char *name, int L, int repeats)
+{
+  RSparse H = heisenberg(L), H2 = mmult(H, H), C;
+  RTensor D;
+  PROF_BEGIN_SET(name) {
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("H*H", C = mmult(H, H), repeats);
+    PROF_ENTRY("H^2*H", C = mmult(H2, H), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("H*H-threads", C = mmult(H, H), repeats);
+    PROF_ENTRY("H^2*H-threads", C = mmult(H2, H), repeats);
+    C = RSparse();
+    if (L <= 12) {
+      PROF_ENTRY("H*full(H)", D = mmult(H, full(H)), 1);
+    }
+    if (L <= 10) {
+      PROF_ENTRY("full(H)*full(H)", D = mmult(full(H), full(H)), 1);
+    }
+  } PROF_END_SET;
+}
+
+//
+// Products of sparse matrices with vectors and with matrices of l columns,
+// mmult(RSparse,RTensor) and mmult(RTensor,RSparse), for random matrices
+// with a fixed number of nonzero elements per row, using one or all threads.
+//
+
+RSparse random_sparse(tensor::index rows, tensor::index per_row)
+{
+  tensor::index n = rows * per_row;
+  Indices r(n), c(n);
+  RTensor data = RTensor::random(n);
+  int band = rows / per_row;
+  for (tensor::index i = 0; i < n; i++) {
+    r.at(i) = i / per_row;
+    c.at(i) = (i % per_row) * band + rand<int>(band);
+  }
+  return RSparse(r, c, data, rows, rows);
+}
+
+void prof_sparse_tensor(const char *name, tensor::index rows,
+                        tensor::index per_row, tensor::index l)
+{
+  RSparse S = random_sparse(rows, per_row);
+  RTensor V = RTensor::random(rows, l), U = RTensor::random(l, rows), W;
+  int repeats = std::max<tensor::index>(2, 100000000 / (rows * per_row * l));
+  PROF_BEGIN_SET(name) {
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("S*V", W = mmult(S, V), repeats);
+    PROF_ENTRY("U*S", W = mmult(U, S), repeats);
+    set_tensor_threads(old);
+    PROF_ENTRY("S*V-threads", W = mmult(S, V), repeats);
+    PROF_ENTRY("U*S-threads", W = mmult(U, S), repeats);
+  } PROF_END_SET;
+}
+
+void prof_sparse_tensor_sizes(tensor::index l)
+{
+  char name[64];
+  for (tensor::index rows = 1000; rows <= 1000000; rows *= 10) {
+    for (tensor::index per_row = 4; per_row <= 64; per_row *= 4) {
+      sprintf(name, "N=%ld nnz/row=%ld", rows, per_row);
+      prof_sparse_tensor(name, rows, per_row, l);
+    }
+  }
+}
+
+//
+// Products of sparse matrices with vectors, in Sparse and in SlicedSparse
+// form, using one thread. Besides the Heisenberg Hamiltonians and the
+// random matrices above, we use the Laplacian on a square lattice of side
+// n, kron2_sum(T,T) with T a tridiagonal matrix.
+//
+
+RSparse laplacian(tensor::index n)
+{
+  Indices r(3 * n - 2), c(3 * n - 2);
+  RTensor data(3 * n - 2);
+  for (tensor::index i = 0, k = 0; i < n; i++) {
+    for (tensor::index j = std::max<tensor::index>(0, i-1); j <= i+1 && j < n; j++, k++) {
+      r.at(k) = i;
+      c.at(k) = j;
+      data.at(k) = (i == j)? 2.0 : -1.0;
+    }
+  }
+  RSparse T(r, c, data, n, n);
+  return kron2_sum(T, T);
+}
+
+void prof_sliced(const char *name, const RSparse &S)
+{
+  RTensor v = RTensor::random(S.columns()), w;
+  RSlicedSparse M(S);
+  int repeats = std::max<tensor::index>(2, 100000000 / (S.length() + 1));
+  PROF_BEGIN_SET(name) {
+    int old = set_tensor_threads(1);
+    PROF_ENTRY("S*v", w = mmult(S, v), repeats);
+    PROF_ENTRY("sliced(S)*v", w = mmult(M, v), repeats);
+    PROF_ENTRY("sliced(S)", M = RSlicedSparse(S), 2);
+    set_tensor_threads(old);
+  } PROF_END_SET;
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("RSparse mmult") {
+    prof_sparse_mmult("L=10", 10, 20);
+    prof_sparse_mmult("L=12", 12, 10);
+    prof_sparse_mmult("L=14", 14, 4);
+    prof_sparse_mmult("L=16", 16, 2);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RSparse mmult vector") {
+    prof_sparse_tensor_sizes(1);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RSparse mmult 4 vectors") {
+    prof_sparse_tensor_sizes(4);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RSparse mmult 16 vectors") {
+    prof_sparse_tensor_sizes(16);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RSlicedSparse mmult vector") {
+    prof_sliced("Heisenberg L=12", heisenberg(12));
+    prof_sliced("Heisenberg L=16", heisenberg(16));
+    prof_sliced("Heisenberg L=18", heisenberg(18));
+    prof_sliced("Laplacian 100x100", laplacian(100));
+    prof_sliced("Laplacian 1000x1000", laplacian(1000));
+    prof_sliced("N=1000000 nnz/row=4", random_sparse(1000000, 4));
+    prof_sliced("N=1000000 nnz/row=16", random_sparse(1000000, 16));
+    prof_sliced("N=100000 nnz/row=64", random_sparse(100000, 64));
+  } PROF_END_GROUP;
+}
@@ -18,6 +18,7 @@
 */
 
 #include <tensor/tensor.h>
+#include <tensor/simd.h>
 #include <functional>
 #include "profile.h"
 
@@ -25,7 +26,7 @@ using namespace tensor;
 using namespace profile;
 
 template<class binop>
-void prof_binop(const char *name, binop &f,
+void prof_binop(const char *name, binop f,
 		const int repeats=2*1024,
 		const int maxsize=0x10000)
 {
@@ -35,8 +36,8 @@ void prof_binop(const char *name, binop &f,
     A *a = new A();
     B *b = new B();
     for (int size = 2; size < maxsize; size <<= 2) {
-      *a = A::random(maxsize);
-      *b = B::random(maxsize);
+      *a = A::random(size);
+      *b = B::random(size);
       PROF_ENTRY(size, f(*a,*b), repeats);
     }
     delete a;
@@ -45,22 +46,77 @@ void prof_binop(const char *name, binop &f,
 }
 
 template<class binop>
-void prof_unop(const char *name, binop &f, const int repeats=2*1024,
+void prof_unop(const char *name, binop f, const int repeats=2*1024,
 	       const int maxsize=0x10000)
 {
   typedef typename binop::argument_type A;
   PROF_BEGIN_SET(name) {
     A *a = new A();
     for (int size = 2; size < maxsize; size <<= 2) {
-      *a = A::random(maxsize);
+      *a = A::random(size);
       PROF_ENTRY(size, f(*a), repeats);
     }
     delete a;
   } PROF_END_SET;
 }
 
+//
+// Memory bandwidth of an operation, counting the bytes of the arguments
+// and of the output.
+//
+template<class op>
+void prof_bandwidth(const char *name, op f, int arguments,
+                    const int repeats=64, const int size=0x100000)
+{
+  typedef typename op::result_type A;
+  typedef typename A::elt_t elt_t;
+  A a = A::random(size) + number_one<elt_t>();
+  A b = A::random(size) + number_one<elt_t>();
+  double bytes = (arguments + 1.0) * size * sizeof(elt_t);
+  std::cout << "  <set name='" << name << "'>\n";
+  for (int level = SIMD_NONE; level <= simd_max_level(); level++) {
+    set_simd_level((SimdLevel)level);
+    tic();
+    for (int i = repeats; i; --i) {
+      f(a, b);
+    }
+    double time = toc() / repeats;
+    std::cout << "   <entry id='" << simd_level_name((SimdLevel)level)
+              << "' time='" << time
+              << "' GBs='" << bytes / time / 1e9 << "'/>\n";
+  }
+  std::cout << "  </set>\n";
+}
+
+template<class T, T f(const T &, const T &)>
+struct binop_bw {
+  typedef T result_type;
+  T operator()(const T &a, const T &b) const { return f(a, b); }
+};
+
+template<class T, T f(const T &)>
+struct unop_bw {
+  typedef T result_type;
+  T operator()(const T &a, const T &b) const { return f(a); }
+};
+
+template<class T> T plus_bw(const T &a, const T &b) { return a + b; }
+template<class T> T minus_bw(const T &a, const T &b) { return a - b; }
+template<class T> T times_bw(const T &a, const T &b) { return a * b; }
+template<class T> T divide_bw(const T &a, const T &b) { return a / b; }
+
+template<class T>
+void prof_simd_binops()
+{
+  prof_bandwidth("plus", binop_bw<T,plus_bw<T> >(), 2);
+  prof_bandwidth("minus", binop_bw<T,minus_bw<T> >(), 2);
+  prof_bandwidth("multiplies", binop_bw<T,times_bw<T> >(), 2);
+  prof_bandwidth("divides", binop_bw<T,divide_bw<T> >(), 2);
+}
+
 int main()
 {
+  SimdLevel level = simd_level();
 
   //
   // VECTOR - VECTOR OPERATIONS
@@ -102,4 +158,25 @@ int main()
     prof_unop("divides3", dividesN<CTensor,cdouble>(value));
   } PROF_END_GROUP;
 
+  //
+  // BANDWIDTH AT EACH INSTRUCTION SET
+  //
+
+  PROF_BEGIN_GROUP("RTensor SIMD") {
+    prof_simd_binops<RTensor>();
+    prof_bandwidth("exp", unop_bw<RTensor,exp>(), 1);
+    prof_bandwidth("sin", unop_bw<RTensor,sin>(), 1);
+    prof_bandwidth("cos", unop_bw<RTensor,cos>(), 1);
+    prof_bandwidth("fast_exp", unop_bw<RTensor,fast_exp>(), 1);
+    prof_bandwidth("fast_sin", unop_bw<RTensor,fast_sin>(), 1);
+    prof_bandwidth("fast_cos", unop_bw<RTensor,fast_cos>(), 1);
+    prof_bandwidth("sqrt", unop_bw<RTensor,sqrt>(), 1);
+    prof_bandwidth("abs", unop_bw<RTensor,abs>(), 1);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor SIMD") {
+    prof_simd_binops<CTensor>();
+  } PROF_END_GROUP;
+
+  set_simd_level(level);
 }
@@ -0,0 +1,104 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <tensor/tensor.h>
+#include "profile.h"
+
+using namespace tensor;
+using namespace profile;
+
+//
+// Slices of a matrix A(n,n): a block of columns, a block with unit stride
+// along the rows, and every second row. "copy" converts the slice to a
+// tensor, "gather" does the same with a list of indices that is not equally
+// spaced, which is traversed through a table of positions. "sum" and "mmult"
+// use the slice directly, "sum-copy" and "mmult-copy" convert it first.
+//
+
+template<class Tensor>
+void prof_view(const char *name, tensor::index n, tensor::index r0,
+               tensor::index r1, tensor::index step, tensor::index c0,
+               tensor::index c1)
+{
+  Tensor A = Tensor::random(n, n), C;
+  tensor::index rows = (r1 - r0) / step + 1;
+  Tensor B = Tensor::random(c1 - c0 + 1, 16);
+  Indices gather = iota(r0, r1, step);
+  std::swap(gather.at(rows - 1), gather.at(rows - 2));
+  int repeats = std::max<tensor::index>(10, 100000000 / (rows * (c1 - c0 + 1)));
+  int mmult_repeats = std::max(1, repeats / 16);
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("copy", C = A(range(r0, r1, step), range(c0, c1)), repeats);
+    PROF_ENTRY("gather", C = A(range(gather), range(c0, c1)), repeats);
+    PROF_ENTRY("sum-copy", sum(Tensor(A(range(r0, r1, step), range(c0, c1)))), repeats);
+    PROF_ENTRY("sum", sum(A(range(r0, r1, step), range(c0, c1))), repeats);
+    PROF_ENTRY("mmult-copy", C = mmult(Tensor(A(range(r0, r1, step), range(c0, c1))), B), mmult_repeats);
+    PROF_ENTRY("mmult", C = mmult(A(range(r0, r1, step), range(c0, c1)), B), mmult_repeats);
+  } PROF_END_SET;
+}
+
+//
+// Assignments to a (b,b) block of a matrix A(n,n), as in the assembly of the
+// block decomposition in block_svd(): a contiguous block, every second row,
+// rows and columns given by a list of indices with gaps, and filling the
+// block with a number.
+//
+
+template<class Tensor>
+void prof_assign(const char *name, tensor::index n, tensor::index b)
+{
+  Tensor A = Tensor::zeros(n, n), B = Tensor::random(b, b);
+  Indices list(b);
+  for (tensor::index i = 0; i < b; i++)
+    list.at(i) = i + (i / 4) * 2;
+  int repeats = std::max<tensor::index>(10, 100000000 / (b * b));
+  PROF_BEGIN_SET(name) {
+    PROF_ENTRY("block", A.at(range(n/4, n/4+b-1), range(n/4, n/4+b-1)) = B, repeats);
+    PROF_ENTRY("rows", A.at(range(0, 2*b-1, 2), range(0, b-1)) = B, repeats);
+    PROF_ENTRY("list", A.at(range(list), range(list)) = B, repeats);
+    PROF_ENTRY("fill", A.at(range(list), range(0, b-1)) = B[0], repeats);
+  } PROF_END_SET;
+}
+
+template<class Tensor>
+void prof_views(tensor::index n)
+{
+  prof_view<Tensor>("columns", n, 0, n-1, 1, n/4, 3*n/4);
+  prof_view<Tensor>("block", n, n/4, 3*n/4, 1, n/4, 3*n/4);
+  prof_view<Tensor>("odd-rows", n, 1, n-1, 2, 0, n-1);
+  prof_assign<Tensor>("assign 4x4", n, 4);
+  prof_assign<Tensor>("assign 32x32", n, 32);
+  prof_assign<Tensor>("assign n/2", n, n/2);
+}
+
+int main()
+{
+  PROF_BEGIN_GROUP("RTensor 64x64") {
+    prof_views<RTensor>(64);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("RTensor 1024x1024") {
+    prof_views<RTensor>(1024);
+  } PROF_END_GROUP;
+
+  PROF_BEGIN_GROUP("CTensor 256x256") {
+    prof_views<CTensor>(256);
+  } PROF_END_GROUP;
+}
@@ -17,79 +17,367 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <cmath>
 #include <tensor/fftw.h>
+#include <fftw3.h>
+#include "fftw_common.hpp"
 
 namespace tensor {
 
-  const CTensor
-  fftshift(const CTensor& input, int direction) {
-    // just forward to the simpler function
-    CTensor output(input);
-    for (index dim = 0; dim < input.rank(); dim++) {
-      output = fftshift(output, dim, direction);
+  //
+  // A shift along several dimensions is a permutation of the tensor that
+  // factors into independent permutations of each dimension. We describe one
+  // pass over the data by how it reorders each dimension, merging consecutive
+  // untouched dimensions, and then walk over the contiguous runs of the first
+  // dimension, which are moved as a whole.
+  //
+  // A rotation by s of a dimension of size n is (i) a swap of both halves if
+  // n = 2s, or (ii) a reversal of [0,s) and [s,n) followed by a reversal of
+  // [0,n). Each of these permutations is its own inverse, and so is any
+  // product of them over different dimensions, which can therefore be applied
+  // in place by swapping elements with their images. This gives an in-place
+  // shift with one pass over the data, or two if some dimension has odd size.
+  //
+
+  enum ShiftKind {
+    KEEP,                       // i -> i
+    ROTATE,                     // i -> (i + split) mod size
+    REVERSE_HALVES,             // reverse [0,split) and [split,size)
+    REVERSE                     // i -> size - 1 - i
+  };
+
+  enum ShiftPass {
+    GATHER_PASS,                // rotate every shifted dimension
+    FIRST_SWAP_PASS,            // swap halves, or reverse them if odd
+    SECOND_SWAP_PASS            // reverse odd dimensions
+  };
+
+  struct ShiftAxis {
+    index size, stride, split;
+    ShiftKind kind;
+  };
+
+  typedef std::vector<ShiftAxis> ShiftAxes;
+
+  // Offset of the frequency that fftshift() moves to the first position.
+  static inline index
+  shift_of(index size, int direction) {
+    return (direction == FFTW_BACKWARD)? size/2 : (size+1)/2;
+  }
+
+  static inline index
+  shift_image(const ShiftAxis& a, index i) {
+    switch (a.kind) {
+    case ROTATE:
+      i += a.split;
+      return (i >= a.size)? i - a.size : i;
+    case REVERSE_HALVES:
+      return (i < a.split)? a.split - 1 - i : a.size + a.split - 1 - i;
+    case REVERSE:
+      return a.size - 1 - i;
+    default:
+      return i;
     }
+  }
 
-    return output;
+  static ShiftAxes
+  shift_axes(const Indices& dims, const Booleans& convert, int direction,
+             ShiftPass pass) {
+    ShiftAxes axes;
+    index stride = 1;
+    for (index i = 0; i < dims.size(); i++) {
+      index n = dims[i];
+      ShiftKind kind = KEEP;
+      if (convert[i] && n > 1) {
+        if (pass == GATHER_PASS)
+          kind = ROTATE;
+        else if (n % 2 == 0)
+          kind = (pass == FIRST_SWAP_PASS)? ROTATE : KEEP;
+        else
+          kind = (pass == FIRST_SWAP_PASS)? REVERSE_HALVES : REVERSE;
+      }
+      if (kind == KEEP && !axes.empty() && axes.back().kind == KEEP) {
+        axes.back().size *= n;
+      } else {
+        ShiftAxis a = { n, stride, shift_of(n, direction), kind };
+        axes.push_back(a);
+      }
+      stride *= n;
+    }
+    return axes;
+  }
+
+  static bool
+  nothing_to_shift(const ShiftAxes& axes) {
+    return axes.size() <= 1 && (axes.empty() || axes[0].kind == KEEP);
+  }
+
+  // Walks over the runs of the first dimension, giving the offset of each
+  // run and of its image under the permutation of the remaining dimensions.
+  class ShiftRunIterator {
+  public:
+    ShiftRunIterator(const ShiftAxes& axes) :
+      from(0), to(0), axes_(axes), position_(axes.size(), 0), left_(1)
+    {
+      for (size_t d = 1; d < axes.size(); d++)
+        left_ *= axes[d].size;
+      update();
+    }
+    operator bool() const { return left_ > 0; }
+    index operator[](size_t d) const { return position_[d]; }
+    ShiftRunIterator& operator++() {
+      for (size_t d = 1; d < axes_.size(); d++) {
+        if (++position_[d] < axes_[d].size)
+          break;
+        position_[d] = 0;
+      }
+      --left_;
+      update();
+      return *this;
+    }
+
+    index from, to;
+
+  private:
+    void update() {
+      from = to = 0;
+      for (size_t d = 1; d < axes_.size(); d++) {
+        from += position_[d] * axes_[d].stride;
+        to += shift_image(axes_[d], position_[d]) * axes_[d].stride;
+      }
+    }
+
+    const ShiftAxes& axes_;
+    std::vector<index> position_;
+    index left_;
+  };
+
+  // Swaps the run at x with its image at y. Each pair of runs is visited
+  // twice and only swapped once, when x <= y.
+  static void
+  swap_runs(cdouble *x, cdouble *y, const ShiftAxis& a) {
+    typedef std::reverse_iterator<cdouble*> backwards;
+    const index n = a.size, s = a.split;
+    if (x == y) {
+      switch (a.kind) {
+      case ROTATE:
+        std::swap_ranges(x, x + s, x + s);
+        break;
+      case REVERSE_HALVES:
+        std::reverse(x, x + s);
+        std::reverse(x + s, x + n);
+        break;
+      case REVERSE:
+        std::reverse(x, x + n);
+        break;
+      default:
+        break;
+      }
+    } else if (x < y) {
+      switch (a.kind) {
+      case ROTATE:
+        std::swap_ranges(x, x + n - s, y + s);
+        std::swap_ranges(x + n - s, x + n, y);
+        break;
+      case REVERSE_HALVES:
+        std::swap_ranges(x, x + s, backwards(y + s));
+        std::swap_ranges(x + s, x + n, backwards(y + n));
+        break;
+      case REVERSE:
+        std::swap_ranges(x, x + n, backwards(y + n));
+        break;
+      default:
+        std::swap_ranges(x, x + n, y);
+      }
+    }
+  }
+
+  static void
+  swap_pass(cdouble *data, const ShiftAxes& axes) {
+    if (nothing_to_shift(axes))
+      return;
+    for (ShiftRunIterator it(axes); it; ++it) {
+      swap_runs(data + it.from, data + it.to, axes[0]);
+    }
+  }
+
+  static void
+  gather_pass(cdouble *out, const cdouble *in, const ShiftAxes& axes) {
+    const ShiftAxis& a = axes[0];
+    for (ShiftRunIterator it(axes); it; ++it) {
+      cdouble *x = out + it.from;
+      const cdouble *y = in + it.to;
+      if (a.kind == ROTATE) {
+        std::copy(y + a.split, y + a.size, x);
+        std::copy(y, y + a.split, x + a.size - a.split);
+      } else {
+        std::copy(y, y + a.size, x);
+      }
+    }
+  }
+
+  static Booleans
+  selected_dimensions(index rank, index dim) {
+    Booleans convert(rank);
+    for (index i = 0; i < rank; i++) {
+      convert.at(i) = (dim < 0 || i == dim);
+    }
+    return convert;
+  }
+
+  const CTensor
+  fftshift(const CTensor& input, int direction) {
+    return fftshift(input, selected_dimensions(input.rank(), -1), direction);
   }
 
   const CTensor
   fftshift(const CTensor& input, index dim, int direction) {
     assert(dim >= 0 && dim < input.rank());
+    return fftshift(input, selected_dimensions(input.rank(), dim), direction);
+  }
 
-    const Indices& size = input.dimensions();
-    if (size[dim] == 1) {
-      // nothing to do
+  const CTensor
+  fftshift(const CTensor& input, const Booleans& convert, int direction) {
+    assert(input.rank() == convert.size());
+    ShiftAxes axes = shift_axes(input.dimensions(), convert, direction,
+                                GATHER_PASS);
+    if (input.size() == 0 || nothing_to_shift(axes)) {
       return input;
     }
+    CTensor output(input.dimensions());
+    gather_pass(output.begin(), input.begin_const(), axes);
+    return output;
+  }
 
-    index before = 1;
-    for (index i = 0; i < dim; i++) {
-      before *= size[i];
-    }
+  void
+  fftshift_inplace(CTensor& input, int direction) {
+    fftshift_inplace(input, selected_dimensions(input.rank(), -1), direction);
+  }
 
-    index after = 1;
-    for (index i = dim+1; i < size.size(); i++) {
-      after *= size[i];
+  void
+  fftshift_inplace(CTensor& input, index dim, int direction) {
+    assert(dim >= 0 && dim < input.rank());
+    fftshift_inplace(input, selected_dimensions(input.rank(), dim), direction);
+  }
+
+  void
+  fftshift_inplace(CTensor& input, const Booleans& convert, int direction) {
+    assert(input.rank() == convert.size());
+    if (input.size() == 0) {
+      return;
     }
+    const Indices& dims = input.dimensions();
+    ShiftAxes first = shift_axes(dims, convert, direction, FIRST_SWAP_PASS);
+    ShiftAxes second = shift_axes(dims, convert, direction, SECOND_SWAP_PASS);
+    if (nothing_to_shift(first)) {
+      return;
+    }
+    cdouble *data = input.begin();
+    swap_pass(data, first);
+    swap_pass(data, second);
+  }
 
-    // Transform the tensor into a 3-dimensional form, then use slicing.
-    // Not terribly efficient, but we can delay extensive memory handling to
-    // until someone needs the speed.
-    CTensor output(before, size[dim], after);
-    const CTensor reshape_input = reshape(input, output.dimensions());
+  //
+  // Rotating the output of a DFT of sign d by s, X(k) -> X(k+s), is the same
+  // as multiplying its input by exp(d 2 pi i j s / n). For even sizes these
+  // phases are just +1 and -1.
+  //
 
-    // even number of grid points as default => direction has no effect.
-    index minfreq = size[dim]/2;
-    index Nhalf = size[dim]/2;
-    index end = size[dim]-1;
+  static inline cdouble
+  phase_times(const cdouble& a, const cdouble& b) {
+    return cdouble(a.real() * b.real() - a.imag() * b.imag(),
+                   a.real() * b.imag() + a.imag() * b.real());
+  }
 
-    if (size[dim] % 2 == 1) {
-      minfreq = (size[dim]+1)/2;
-      Nhalf = (size[dim]-1)/2;
-      if (direction == FFTW_BACKWARD) {
-        // undo the effects of the forward shift, requires some creativity
-        minfreq--;
-        Nhalf++;
+  static std::vector<cdouble>
+  shift_phases(index n, index s, int direction) {
+    const double two_pi = 6.28318530717958647692;
+    std::vector<cdouble> phases(n);
+    for (index j = 0; j < n; j++) {
+      if (n % 2 == 0) {
+        phases[j] = (j % 2)? -1.0 : 1.0;
+      } else {
+        double angle = direction * two_pi * ((j * s) % n) / n;
+        phases[j] = cdouble(std::cos(angle), std::sin(angle));
       }
     }
+    return phases;
+  }
 
-    output.at(range(), range(0,Nhalf-1), range()) = reshape_input(range(), range(minfreq,end), range());
-    output.at(range(), range(Nhalf, end), range()) = reshape_input(range(), range(0, minfreq-1), range());
+  static void
+  shift_phase_pass(cdouble *out, const cdouble *in, const Indices& dims,
+                   const Booleans& convert, int direction) {
+    ShiftAxes axes = shift_axes(dims, convert, FFTW_FORWARD, GATHER_PASS);
+    std::vector<std::vector<cdouble> > phases(axes.size());
+    for (size_t d = 0; d < axes.size(); d++) {
+      if (axes[d].kind == ROTATE)
+        phases[d] = shift_phases(axes[d].size, axes[d].split, direction);
+    }
+    const index n = axes[0].size;
+    for (ShiftRunIterator it(axes); it; ++it) {
+      cdouble factor = 1.0;
+      for (size_t d = 1; d < axes.size(); d++) {
+        if (!phases[d].empty())
+          factor = phase_times(factor, phases[d][it[d]]);
+      }
+      cdouble *x = out + it.from;
+      const cdouble *y = in + it.from;
+      if (factor.imag() == 0 && n % 2 == 0) {
+        // Only signs: either the first dimension is not shifted, or it is
+        // even and its phases alternate.
+        const double f = factor.real();
+        const double g = phases[0].empty()? f : -f;
+        for (index j = 0; j < n; j += 2) {
+          x[j] = y[j] * f;
+          x[j+1] = y[j+1] * g;
+        }
+      } else if (phases[0].empty()) {
+        for (index j = 0; j < n; j++)
+          x[j] = phase_times(y[j], factor);
+      } else {
+        const cdouble *w = &phases[0][0];
+        for (index j = 0; j < n; j++)
+          x[j] = phase_times(y[j], phase_times(w[j], factor));
+      }
+    }
+  }
 
-    return reshape(output, size);
+  const CTensor
+  fftw_shifted(const CTensor& in, int direction) {
+    return fftw_shifted(in, selected_dimensions(in.rank(), -1), direction);
   }
 
   const CTensor
-  fftshift(const CTensor& input, const Booleans& convert, int direction) {
-    assert(input.rank() == convert.size());
-    
-    CTensor output(input);
-    for (index dim = 0; dim < input.rank(); dim++) {
-      if (convert[dim]) {
-        output = fftshift(output, dim, direction);
-      }
+  fftw_shifted(const CTensor& in, const Booleans& convert, int direction) {
+    assert(convert.size() == in.rank());
+    CTensor out(in.dimensions());
+    if (out.size()) {
+      shift_phase_pass(out.begin(), in.begin_const(), in.dimensions(), convert,
+                       direction);
+      fftw_complex *pout = reinterpret_cast<fftw_complex*> (out.begin());
+      do_fftw(pout, pout, convert, in.dimensions(), direction);
     }
+    return out;
+  }
 
-    return output;
+  void
+  fftw_shifted_inplace(CTensor& in, int direction) {
+    fftw_shifted_inplace(in, selected_dimensions(in.rank(), -1), direction);
   }
-}
\ No newline at end of file
+
+  void
+  fftw_shifted_inplace(CTensor& in, const Booleans& convert, int direction) {
+    assert(convert.size() == in.rank());
+    if (in.size()) {
+      cdouble *data = in.begin();
+      shift_phase_pass(data, data, in.dimensions(), convert, direction);
+      fftw_complex *pin = reinterpret_cast<fftw_complex*> (data);
+      do_fftw(pin, pin, convert, in.dimensions(), direction);
+    }
+  }
+
+} // namespace tensor
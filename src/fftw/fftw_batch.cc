@@ -0,0 +1,155 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010-2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* MULTIDIMENSIONAL FAST FOURIER TRANSFORM */
+
+/* FOURIER TRANSFORMS OF MANY TENSORS */
+
+#include <tensor/fftw.h>
+#include <fftw3.h>
+#include "fftw_common.hpp"
+#include "../tools/parallel.h"
+
+namespace tensor {
+
+  //
+  // FFTW can apply a plan to other arrays with the same alignment, so the
+  // plan is looked up once for the aligned tensors of a batch and once for
+  // the rest, which get a plan for unaligned data. This matters when the
+  // cache of plans is full and every lookup would make a new plan. The
+  // tensors are distributed among the threads of the library. The plan
+  // itself is single-threaded, unless there is only one tensor.
+  //
+
+  class BatchTask : public parallel::Task {
+  public:
+    BatchTask(const std::vector<fftw_plan>& plans,
+              const std::vector<fftw_complex*>& in,
+              const std::vector<fftw_complex*>& out) :
+      plans_(plans), in_(in), out_(out)
+    {}
+    void run(index c) {
+      fftw_execute_dft(plans_[c], in_[c], out_[c]);
+    }
+  private:
+    const std::vector<fftw_plan>& plans_;
+    const std::vector<fftw_complex*>& in_;
+    const std::vector<fftw_complex*>& out_;
+  };
+
+  static void
+  do_batch(const std::vector<fftw_complex*>& pin,
+           const std::vector<fftw_complex*>& pout, const Booleans& convert,
+           const Indices& dims, int direction) {
+    // Collect the dimensions for the transform, as in do_fftw()
+    fftw_iodim fft_dims[dims.size()];
+    fftw_iodim loop_dims[dims.size()];
+    index fft_size = 0;
+    index loop_size = 0;
+    index stride = 1;
+
+    for (index i = 0; i < dims.size(); i++) {
+      fftw_iodim *d = convert[i]? (fft_dims + fft_size++) : (loop_dims + loop_size++);
+      d->n = dims[i];
+      d->is = stride;
+      d->os = stride;
+      stride *= dims[i];
+    }
+
+    size_t n = pin.size();
+    int nthreads = (n == 1)? fftw_threads(fft_size, fft_dims, loop_size, loop_dims) : 1;
+    std::vector<fftw_plan> plans(n);
+    fftw_plan class_plans[2] = { 0, 0 };
+    bool cached[2];
+    for (size_t i = 0; i < n; i++) {
+      int aligned = !fftw_alignment_of(reinterpret_cast<double*>(pin[i])) &&
+        !fftw_alignment_of(reinterpret_cast<double*>(pout[i]));
+      if (!class_plans[aligned]) {
+        class_plans[aligned] = dft_plan(fft_size, fft_dims, loop_size, loop_dims,
+                                        pin[i], pout[i], direction, nthreads,
+                                        &cached[aligned]);
+      }
+      plans[i] = class_plans[aligned];
+    }
+    BatchTask task(plans, pin, pout);
+    parallel::run_chunks(task, n);
+    for (int aligned = 0; aligned < 2; aligned++) {
+      if (class_plans[aligned])
+        release_plan(class_plans[aligned], cached[aligned]);
+    }
+  }
+
+  static void
+  check_batch(const std::vector<CTensor>& batch, const Booleans& convert) {
+    for (size_t i = 0; i < batch.size(); i++) {
+      assert(all_equal(batch[i].dimensions(), batch[0].dimensions()));
+    }
+    assert(batch.empty() || convert.size() == batch[0].rank());
+  }
+
+  static Booleans
+  all_dimensions(const std::vector<CTensor>& batch) {
+    index rank = batch.empty()? 0 : batch[0].rank();
+    Booleans convert(rank);
+    for (index i = 0; i < rank; i++) {
+      convert.at(i) = true;
+    }
+    return convert;
+  }
+
+  void
+  fftw_inplace(std::vector<CTensor>& batch, const Booleans& convert, int direction) {
+    check_batch(batch, convert);
+    std::vector<fftw_complex*> pin(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      pin[i] = reinterpret_cast<fftw_complex*> (batch[i].begin());
+    }
+    if (batch.size()) {
+      do_batch(pin, pin, convert, batch[0].dimensions(), direction);
+    }
+  }
+
+  void
+  fftw_inplace(std::vector<CTensor>& batch, int direction) {
+    fftw_inplace(batch, all_dimensions(batch), direction);
+  }
+
+  const std::vector<CTensor>
+  fftw(const std::vector<CTensor>& batch, const Booleans& convert, int direction) {
+    check_batch(batch, convert);
+    std::vector<CTensor> output(batch.size());
+    std::vector<fftw_complex*> pin(batch.size()), pout(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      output[i] = CTensor(batch[i].dimensions());
+      pin[i] = const_cast<fftw_complex*>
+        (reinterpret_cast<const fftw_complex*> (batch[i].begin()));
+      pout[i] = reinterpret_cast<fftw_complex*> (output[i].begin());
+    }
+    if (batch.size()) {
+      do_batch(pin, pout, convert, batch[0].dimensions(), direction);
+    }
+    return output;
+  }
+
+  const std::vector<CTensor>
+  fftw(const std::vector<CTensor>& batch, int direction) {
+    return fftw(batch, all_dimensions(batch), direction);
+  }
+
+} // namespace tensor
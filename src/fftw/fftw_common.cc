@@ -17,29 +17,306 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <pthread.h>
+#include <tensor/fftw.h>
 #include "fftw_common.hpp"
+#include "../tools/parallel.h"
 
 
 namespace tensor {
 
+//
+// Plans are created once for each shape of the transform, planner effort,
+// direction and placement of the data, and kept in a cache. They are
+// applied to the actual data with the new-array execute functions, which
+// only require the arrays to have the same alignment as those used for
+// planning; plans for unaligned data are made with FFTW_UNALIGNED. The
+// FFTW planner is not thread safe, so all calls to it are serialized by
+// plan_lock, but plans can be executed by several threads at once. Plans
+// are counted while they are in use, and fftw_forget_plans() leaves the
+// destruction of those plans to the last release_plan().
+//
+// With the multithreaded FFTW library, transforms of at least
+// parallel::CHUNK elements are planned for tensor_threads() threads.
+//
+
+/* Kinds of transforms */
+enum { DFT_C2C = 0, DFT_R2C = 1, DFT_C2R = 2 };
+
+typedef std::vector<long> plan_key;
+typedef std::map<plan_key, fftw_plan> plan_cache;
+
+static pthread_mutex_t plan_lock = PTHREAD_MUTEX_INITIALIZER;
+static plan_cache plans;
+/* Number of transforms that are using each plan. */
+static std::map<fftw_plan, int> plan_users;
+/* Plans removed from the cache while in use. */
+static std::set<fftw_plan> forgotten_plans;
+static int planner_effort = FFTW_PLAN_ESTIMATE;
+
+/* Beyond this number of plans, new plans are destroyed after use. */
+static const size_t max_plans = 256;
+/* Number of calls to the planner. */
+static unsigned long planner_calls = 0;
+
+/* Must be called with plan_lock held, before any other FFTW function. */
+static void
+init_planner()
+{
+#ifdef TENSOR_USE_FFTW3_THREADS
+  static bool initialized = false;
+  if (!initialized) {
+    fftw_init_threads();
+    initialized = true;
+  }
+#endif
+}
+
+int
+fftw_threads(int rank, const fftw_iodim *dims, int howmany_rank,
+             const fftw_iodim *howmany_dims)
+{
+#ifdef TENSOR_USE_FFTW3_THREADS
+  index size = 1;
+  for (int i = 0; i < rank; i++)
+    size *= dims[i].n;
+  for (int i = 0; i < howmany_rank; i++)
+    size *= howmany_dims[i].n;
+  if (size >= parallel::CHUNK)
+    return tensor_threads();
+#else
+  (void)rank;
+  (void)dims;
+  (void)howmany_rank;
+  (void)howmany_dims;
+#endif
+  return 1;
+}
+
+static unsigned
+planner_flags(int effort)
+{
+  switch (effort) {
+  case FFTW_PLAN_MEASURE: return FFTW_MEASURE;
+  case FFTW_PLAN_PATIENT: return FFTW_PATIENT;
+  case FFTW_PLAN_EXHAUSTIVE: return FFTW_EXHAUSTIVE;
+  default: return FFTW_ESTIMATE;
+  }
+}
+
+static void
+add_dims(plan_key &key, int rank, const fftw_iodim *dims)
+{
+  key.push_back(rank);
+  for (int i = 0; i < rank; i++) {
+    key.push_back(dims[i].n);
+    key.push_back(dims[i].is);
+    key.push_back(dims[i].os);
+  }
+}
+
+/* Number of elements spanned by the input or output of a transform. */
+static size_t
+extent(int rank, const fftw_iodim *dims, bool input)
+{
+  size_t n = 1;
+  for (int i = 0; i < rank; i++) {
+    if (dims[i].n == 0)
+      return 0;
+    n += (dims[i].n - 1) * (input? dims[i].is : dims[i].os);
+  }
+  return n;
+}
+
+static void
+destroy_plans()
+{
+  for (plan_cache::iterator it = plans.begin(); it != plans.end(); it++) {
+    if (plan_users.count(it->second))
+      forgotten_plans.insert(it->second);
+    else
+      fftw_destroy_plan(it->second);
+  }
+  plans.clear();
+}
+
+/* Return the plan for a transform of the given kind. Planning with an
+   effort other than FFTW_ESTIMATE overwrites the arrays, so it is done on
+   scratch arrays instead of the data. If the cache is full, the plan is
+   not kept and *cached is false. The plan must be given back with
+   release_plan(). Must be called with plan_lock held. */
+static fftw_plan
+find_plan(int kind, int rank, const fftw_iodim *dims, int howmany_rank,
+          const fftw_iodim *howmany_dims, void *pin, void *pout, int direction,
+          int nthreads, bool *cached)
+{
+  bool aligned = !fftw_alignment_of(static_cast<double*>(pin)) &&
+    !fftw_alignment_of(static_cast<double*>(pout));
+  plan_key key;
+  key.push_back(kind);
+  key.push_back(direction);
+  key.push_back(pin == pout);
+  key.push_back(aligned);
+  key.push_back(planner_effort);
+  key.push_back(nthreads);
+  add_dims(key, rank, dims);
+  add_dims(key, howmany_rank, howmany_dims);
+  plan_cache::iterator it = plans.find(key);
+  *cached = true;
+  if (it != plans.end()) {
+    plan_users[it->second]++;
+    return it->second;
+  }
+
+  init_planner();
+  planner_calls++;
+#ifdef TENSOR_USE_FFTW3_THREADS
+  fftw_plan_with_nthreads(nthreads);
+#endif
+  unsigned flags = planner_flags(planner_effort);
+  if (!aligned)
+    flags |= FFTW_UNALIGNED;
+  void *in = pin, *out = pout;
+  if (planner_effort != FFTW_PLAN_ESTIMATE) {
+    size_t in_size = extent(rank, dims, true) *
+      extent(howmany_rank, howmany_dims, true) *
+      ((kind == DFT_R2C)? sizeof(double) : sizeof(fftw_complex));
+    size_t out_size = extent(rank, dims, false) *
+      extent(howmany_rank, howmany_dims, false) *
+      ((kind == DFT_C2R)? sizeof(double) : sizeof(fftw_complex));
+    in = fftw_malloc(std::max<size_t>(sizeof(fftw_complex),
+                                      std::max(in_size, out_size)));
+    out = (pin == pout)? in :
+      fftw_malloc(std::max<size_t>(sizeof(fftw_complex), out_size));
+  }
+  fftw_plan plan;
+  switch (kind) {
+  case DFT_R2C:
+    plan = fftw_plan_guru_dft_r2c(rank, dims, howmany_rank, howmany_dims,
+                                  static_cast<double*>(in),
+                                  static_cast<fftw_complex*>(out), flags);
+    break;
+  case DFT_C2R:
+    plan = fftw_plan_guru_dft_c2r(rank, dims, howmany_rank, howmany_dims,
+                                  static_cast<fftw_complex*>(in),
+                                  static_cast<double*>(out), flags);
+    break;
+  default:
+    plan = fftw_plan_guru_dft(rank, dims, howmany_rank, howmany_dims,
+                              static_cast<fftw_complex*>(in),
+                              static_cast<fftw_complex*>(out), direction, flags);
+  }
+  if (in != pin) {
+    if (out != in)
+      fftw_free(out);
+    fftw_free(in);
+  }
+  if (!plan) {
+    std::cerr << "FFTW could not create a plan for the transform\n";
+    abort();
+  }
+  if (plans.size() < max_plans)
+    plans[key] = plan;
+  else
+    *cached = false;
+  plan_users[plan]++;
+  return plan;
+}
+
+fftw_plan
+dft_plan(int rank, const fftw_iodim *dims, int howmany_rank,
+         const fftw_iodim *howmany_dims, fftw_complex *pin,
+         fftw_complex *pout, int direction, int nthreads, bool *cached)
+{
+  pthread_mutex_lock(&plan_lock);
+  fftw_plan plan = find_plan(DFT_C2C, rank, dims, howmany_rank, howmany_dims,
+                             pin, pout, direction, nthreads, cached);
+  pthread_mutex_unlock(&plan_lock);
+  return plan;
+}
+
+unsigned long
+fftw_planner_calls()
+{
+  pthread_mutex_lock(&plan_lock);
+  unsigned long n = planner_calls;
+  pthread_mutex_unlock(&plan_lock);
+  return n;
+}
+
+void
+release_plan(fftw_plan plan, bool cached)
+{
+  pthread_mutex_lock(&plan_lock);
+  std::map<fftw_plan, int>::iterator it = plan_users.find(plan);
+  if (--it->second == 0) {
+    plan_users.erase(it);
+    if (!cached || forgotten_plans.erase(plan))
+      fftw_destroy_plan(plan);
+  }
+  pthread_mutex_unlock(&plan_lock);
+}
+
+void
+do_guru_dft(int rank, const fftw_iodim *dims, int howmany_rank,
+            const fftw_iodim *howmany_dims, fftw_complex *pin,
+            fftw_complex *pout, int direction)
+{
+  bool cached;
+  int nthreads = fftw_threads(rank, dims, howmany_rank, howmany_dims);
+  fftw_plan plan = dft_plan(rank, dims, howmany_rank, howmany_dims, pin, pout,
+                            direction, nthreads, &cached);
+  fftw_execute_dft(plan, pin, pout);
+  release_plan(plan, cached);
+}
+
+void
+do_guru_r2c(int rank, const fftw_iodim *dims, int howmany_rank,
+            const fftw_iodim *howmany_dims, double *pin, fftw_complex *pout)
+{
+  bool cached;
+  int nthreads = fftw_threads(rank, dims, howmany_rank, howmany_dims);
+  pthread_mutex_lock(&plan_lock);
+  fftw_plan plan = find_plan(DFT_R2C, rank, dims, howmany_rank, howmany_dims,
+                             pin, pout, FFTW_FORWARD, nthreads, &cached);
+  pthread_mutex_unlock(&plan_lock);
+  fftw_execute_dft_r2c(plan, pin, pout);
+  release_plan(plan, cached);
+}
+
+void
+do_guru_c2r(int rank, const fftw_iodim *dims, int howmany_rank,
+            const fftw_iodim *howmany_dims, fftw_complex *pin, double *pout)
+{
+  bool cached;
+  int nthreads = fftw_threads(rank, dims, howmany_rank, howmany_dims);
+  pthread_mutex_lock(&plan_lock);
+  fftw_plan plan = find_plan(DFT_C2R, rank, dims, howmany_rank, howmany_dims,
+                             pin, pout, FFTW_BACKWARD, nthreads, &cached);
+  pthread_mutex_unlock(&plan_lock);
+  fftw_execute_dft_c2r(plan, pin, pout);
+  release_plan(plan, cached);
+}
+
 // basic FFTW along all degrees of freedom
 void
 do_fftw(fftw_complex* pin, fftw_complex* pout, const Indices& dims, int direction) {
-  fftw_plan plan;
   int d = dims.size();
+  fftw_iodim fft_dims[d];
+  index stride = 1;
 
-  if (d == 1) {
-    plan = fftw_plan_dft_1d(dims[0], pin, pout, direction, FFTW_ESTIMATE);
-  } else {
-    int dimensions[d];
-    for (int i = 0; i < d; i++) {
-      dimensions[d - i - 1] = dims[i];
-    }
-    plan = fftw_plan_dft(d, dimensions, pin, pout, direction, FFTW_ESTIMATE);
+  for (int i = 0; i < d; i++) {
+    fft_dims[i].n = dims[i];
+    fft_dims[i].is = stride;
+    fft_dims[i].os = stride;
+    stride *= dims[i];
   }
-    
-  fftw_execute(plan);
-  fftw_destroy_plan(plan);
+
+  do_guru_dft(d, fft_dims, 0, 0, pin, pout, direction);
 }
 
 void
@@ -68,11 +345,7 @@ do_fftw(fftw_complex* pin, fftw_complex* pout, index dim, const Indices& dims, i
     stride *= loop_dims[i-1].n;
   }
 
-  // Now make a Guru plan and execute it.
-  fftw_plan plan = fftw_plan_guru_dft(1, &fft_dim, dims.size()-1, loop_dims,
-          pin, pout, direction, FFTW_ESTIMATE);
-  fftw_execute(plan);
-  fftw_destroy_plan(plan);
+  do_guru_dft(1, &fft_dim, dims.size()-1, loop_dims, pin, pout, direction);
 }
 
 void
@@ -100,11 +373,99 @@ do_fftw(fftw_complex* pin, fftw_complex* pout, const Booleans& convert, const In
     stride *= dims[i];
   }
 
-  // Now make a Guru plan and execute it.
-  fftw_plan plan = fftw_plan_guru_dft(fft_size, fft_dims, loop_size, loop_dims,
-          pin, pout, direction, FFTW_ESTIMATE);
-  fftw_execute(plan);
-  fftw_destroy_plan(plan);
+  do_guru_dft(fft_size, fft_dims, loop_size, loop_dims, pin, pout, direction);
+}
+
+/* Real transform along the dimensions for which convert is true. The first
+   of them is halved in the complex array, which has dimensions
+   dims[i]/2+1 along it. The real array has dimensions 'dims'. */
+void
+do_rfftw(double* preal, fftw_complex* pcomplex, const Booleans& convert,
+         const Indices& dims, int direction) {
+  fftw_iodim fft_dims[dims.size()];
+  fftw_iodim loop_dims[dims.size()];
+  index fft_size = 0;
+  index loop_size = 0;
+  index real_stride = 1;
+  index complex_stride = 1;
+  index halved = -1;
+
+  for (index i = 0; i < dims.size(); i++) {
+    index complex_dim = dims[i];
+    fftw_iodim *d;
+    if (convert[i] == false) {
+      d = loop_dims + (loop_size++);
+    } else {
+      d = fft_dims + (fft_size++);
+      if (halved < 0) {
+        halved = i;
+        complex_dim = dims[i] / 2 + 1;
+      }
+    }
+    d->n = dims[i];
+    if (direction == FFTW_FORWARD) {
+      d->is = real_stride;
+      d->os = complex_stride;
+    } else {
+      d->is = complex_stride;
+      d->os = real_stride;
+    }
+    real_stride *= dims[i];
+    complex_stride *= complex_dim;
+  }
+
+  // FFTW halves the last dimension of the transform
+  if (fft_size)
+    std::rotate(fft_dims, fft_dims + 1, fft_dims + fft_size);
+
+  if (direction == FFTW_FORWARD)
+    do_guru_r2c(fft_size, fft_dims, loop_size, loop_dims, preal, pcomplex);
+  else
+    do_guru_c2r(fft_size, fft_dims, loop_size, loop_dims, pcomplex, preal);
+}
+
+int
+set_fftw_planner(int effort)
+{
+  pthread_mutex_lock(&plan_lock);
+  int old = planner_effort;
+  planner_effort = effort;
+  pthread_mutex_unlock(&plan_lock);
+  return old;
+}
+
+int
+fftw_planner()
+{
+  return planner_effort;
+}
+
+void
+fftw_forget_plans()
+{
+  pthread_mutex_lock(&plan_lock);
+  destroy_plans();
+  pthread_mutex_unlock(&plan_lock);
+}
+
+bool
+fftw_load_wisdom(const std::string &filename)
+{
+  pthread_mutex_lock(&plan_lock);
+  init_planner();
+  int ok = fftw_import_wisdom_from_filename(filename.c_str());
+  pthread_mutex_unlock(&plan_lock);
+  return ok != 0;
+}
+
+bool
+fftw_save_wisdom(const std::string &filename)
+{
+  pthread_mutex_lock(&plan_lock);
+  init_planner();
+  int ok = fftw_export_wisdom_to_filename(filename.c_str());
+  pthread_mutex_unlock(&plan_lock);
+  return ok != 0;
 }
 
-} // namespace tensor
\ No newline at end of file
+} // namespace tensor
@@ -22,8 +22,29 @@
 
 namespace tensor {
 
+  int fftw_threads(int rank, const fftw_iodim *dims, int howmany_rank,
+                   const fftw_iodim *howmany_dims);
+  fftw_plan dft_plan(int rank, const fftw_iodim *dims, int howmany_rank,
+                     const fftw_iodim *howmany_dims, fftw_complex *pin,
+                     fftw_complex *pout, int direction, int nthreads,
+                     bool *cached);
+  void release_plan(fftw_plan plan, bool cached);
+  /* Number of plans that have been made so far, used by the tests. */
+  unsigned long fftw_planner_calls();
+
+  void do_guru_dft(int rank, const fftw_iodim *dims, int howmany_rank,
+                   const fftw_iodim *howmany_dims, fftw_complex *pin,
+                   fftw_complex *pout, int direction);
+  void do_guru_r2c(int rank, const fftw_iodim *dims, int howmany_rank,
+                   const fftw_iodim *howmany_dims, double *pin,
+                   fftw_complex *pout);
+  void do_guru_c2r(int rank, const fftw_iodim *dims, int howmany_rank,
+                   const fftw_iodim *howmany_dims, fftw_complex *pin,
+                   double *pout);
+
   void do_fftw(fftw_complex* pin, fftw_complex* pout, const Indices& dims, int direction);
   void do_fftw(fftw_complex* pin, fftw_complex* pout, index dim, const Indices& dims, int direction);
   void do_fftw(fftw_complex* pin, fftw_complex* pout, const Booleans& convert, const Indices& dims, int direction);
+  void do_rfftw(double* preal, fftw_complex* pcomplex, const Booleans& convert, const Indices& dims, int direction);
 
 }
\ No newline at end of file
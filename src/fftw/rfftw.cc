@@ -0,0 +1,110 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010-2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* MULTIDIMENSIONAL FAST FOURIER TRANSFORM */
+
+/* FAST FOURIER TRANSFORM OF REAL DATA */
+
+#include <tensor/fftw.h>
+#include <fftw3.h>
+#include "fftw_common.hpp"
+
+namespace tensor {
+
+  static index
+  halved_dimension(const Booleans& convert) {
+    for (index i = 0; i < convert.size(); i++) {
+      if (convert[i])
+        return i;
+    }
+    return -1;
+  }
+
+  // All dimensions if dim < 0, or only the given one.
+  static Booleans
+  selected_dimensions(index rank, index dim) {
+    Booleans convert(rank);
+    for (index i = 0; i < rank; i++) {
+      convert.at(i) = (dim < 0 || i == dim);
+    }
+    return convert;
+  }
+
+  const CTensor
+  rfft(const RTensor& in, const Booleans& convert) {
+    assert(convert.size() == in.rank());
+    index halved = halved_dimension(convert);
+    if (halved < 0)
+      return to_complex(in);
+
+    Indices dims(in.dimensions());
+    dims.at(halved) = dims[halved] / 2 + 1;
+    CTensor out(dims);
+
+    double *pin = const_cast<double*>(in.begin());
+    fftw_complex *pout = reinterpret_cast<fftw_complex*> (out.begin());
+    do_rfftw(pin, pout, convert, in.dimensions(), FFTW_FORWARD);
+
+    return out;
+  }
+
+  const CTensor
+  rfft(const RTensor& in) {
+    return rfft(in, selected_dimensions(in.rank(), -1));
+  }
+
+  const CTensor
+  rfft(const RTensor& in, index dim) {
+    assert(dim >= 0 && dim < in.rank());
+    return rfft(in, selected_dimensions(in.rank(), dim));
+  }
+
+  const RTensor
+  irfft(const CTensor& in, const Booleans& convert, index n) {
+    assert(convert.size() == in.rank());
+    index halved = halved_dimension(convert);
+    if (halved < 0)
+      return real(in);
+    assert(n >= 0 && n / 2 + 1 == in.dimension(halved));
+
+    Indices dims(in.dimensions());
+    dims.at(halved) = n;
+    RTensor out(dims);
+
+    // The complex to real transform overwrites its input, which is
+    // therefore copied as soon as we ask for a non-constant pointer.
+    CTensor aux(in);
+    fftw_complex *pin = reinterpret_cast<fftw_complex*> (aux.begin());
+    do_rfftw(out.begin(), pin, convert, dims, FFTW_BACKWARD);
+
+    return out;
+  }
+
+  const RTensor
+  irfft(const CTensor& in, index n) {
+    return irfft(in, selected_dimensions(in.rank(), -1), n);
+  }
+
+  const RTensor
+  irfft(const CTensor& in, index dim, index n) {
+    assert(dim >= 0 && dim < in.rank());
+    return irfft(in, selected_dimensions(in.rank(), dim), n);
+  }
+
+} // namespace tensor
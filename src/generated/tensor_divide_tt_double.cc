@@ -18,18 +18,14 @@
 */
 
 #include <tensor/tensor.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   const Tensor<double> operator/(const Tensor<double> &a, const Tensor<double> &b) {
     assert(a.size() == b.size());
     Tensor<double> output(a.dimensions());
-    Tensor<double>::const_iterator ita = a.begin();
-    Tensor<double>::const_iterator itb = b.begin();
-    Tensor<double>::iterator dest = output.begin();
-    for (index i = a.size(); i; --i, ++dest, ++ita, ++itb) {
-      *dest = (*ita) / (*itb);
-    }
+    simd::binop(simd::DIVIDE, output.begin(), a.begin(), b.begin(), a.size());
     return output;
   }
 
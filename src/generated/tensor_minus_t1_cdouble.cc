@@ -19,6 +19,7 @@
 
 #include <tensor/tensor.h>
 #include <tensor/tensor_blas.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
@@ -26,13 +27,7 @@ namespace tensor {
     assert(a.size() == b.size());
 #if 1
     Tensor<cdouble>::iterator ita = a.begin();
-    Tensor<cdouble>::iterator itae = a.end();
-    Tensor<cdouble>::const_iterator itb = b.begin();
-    while (ita != itae) {
-      (*ita) -= (*itb);
-      ++ita;
-      ++itb;
-    }
+    simd::binop(simd::MINUS, ita, ita, b.begin(), a.size());
 #else
     cblas_daxpy(2*a.size(),
                 -1.0, static_cast<const double*>((void*)b.begin_const()), 1,
@@ -19,6 +19,7 @@
 
 #include <tensor/tensor.h>
 #include <tensor/tensor_blas.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
@@ -26,13 +27,7 @@ namespace tensor {
     assert(a.size() == b.size());
 #if 1
     Tensor<double>::iterator ita = a.begin();
-    Tensor<double>::iterator itae = a.end();
-    Tensor<double>::const_iterator itb = b.begin();
-    while (ita != itae) {
-      (*ita) -= (*itb);
-      ++ita;
-      ++itb;
-    }
+    simd::binop(simd::MINUS, ita, ita, b.begin(), a.size());
 #else
     cblas_daxpy(a.size(),
 		-1.0, static_cast<const double*>((void*)b.begin_const()), 1,
@@ -18,26 +18,19 @@
 */
 
 #include <tensor/tensor.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   const Tensor<cdouble> operator-(const Tensor<cdouble> &a, cdouble b) {
     Tensor<cdouble> output(a.dimensions());
-    Tensor<cdouble>::const_iterator ita = a.begin();
-    Tensor<cdouble>::iterator dest = output.begin();
-    for (index i = a.size(); i; --i, ++dest, ++ita) {
-      *dest = (*ita) - (b);
-    }
+    simd::binop(simd::MINUS, output.begin(), a.begin(), b, a.size());
     return output;
   }
 
   const Tensor<cdouble> operator-(cdouble a, const Tensor<cdouble> &b) {
     Tensor<cdouble> output(b.dimensions());
-    Tensor<cdouble>::const_iterator itb = b.begin();
-    Tensor<cdouble>::iterator dest = output.begin();
-    for (index i = b.size(); i; --i, ++dest, ++itb) {
-      *dest = (a) - (*itb);
-    }
+    simd::binop(simd::MINUS, output.begin(), a, b.begin(), b.size());
     return output;
   }
 
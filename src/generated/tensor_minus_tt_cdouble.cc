@@ -18,18 +18,14 @@
 */
 
 #include <tensor/tensor.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   const Tensor<cdouble> operator-(const Tensor<cdouble> &a, const Tensor<cdouble> &b) {
     assert(a.size() == b.size());
     Tensor<cdouble> output(a.dimensions());
-    Tensor<cdouble>::const_iterator ita = a.begin();
-    Tensor<cdouble>::const_iterator itb = b.begin();
-    Tensor<cdouble>::iterator dest = output.begin();
-    for (index i = a.size(); i; --i, ++dest, ++ita, ++itb) {
-      *dest = (*ita) - (*itb);
-    }
+    simd::binop(simd::MINUS, output.begin(), a.begin(), b.begin(), a.size());
     return output;
   }
 
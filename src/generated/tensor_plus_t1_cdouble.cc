@@ -19,19 +19,14 @@
 
 #include <tensor/tensor.h>
 #include <tensor/tensor_blas.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   Tensor<cdouble> &operator+=(Tensor<cdouble> &a, const Tensor<cdouble> &b) {
     assert(a.size() == b.size());
     Tensor<cdouble>::iterator ita = a.begin();
-    Tensor<cdouble>::iterator itae = a.end();
-    Tensor<cdouble>::const_iterator itb = b.begin();
-    while (ita != itae) {
-      (*ita) += (*itb);
-      ++ita;
-      ++itb;
-    }
+    simd::binop(simd::PLUS, ita, ita, b.begin(), a.size());
     return a;
   }
 
@@ -18,26 +18,19 @@
 */
 
 #include <tensor/tensor.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   const Tensor<double> operator*(const Tensor<double> &a, double b) {
     Tensor<double> output(a.dimensions());
-    Tensor<double>::const_iterator ita = a.begin();
-    Tensor<double>::iterator dest = output.begin();
-    for (index i = a.size(); i; --i, ++dest, ++ita) {
-      *dest = (*ita) * (b);
-    }
+    simd::binop(simd::TIMES, output.begin(), a.begin(), b, a.size());
     return output;
   }
 
   const Tensor<double> operator*(double a, const Tensor<double> &b) {
     Tensor<double> output(b.dimensions());
-    Tensor<double>::const_iterator itb = b.begin();
-    Tensor<double>::iterator dest = output.begin();
-    for (index i = b.size(); i; --i, ++dest, ++itb) {
-      *dest = (a) * (*itb);
-    }
+    simd::binop(simd::TIMES, output.begin(), a, b.begin(), b.size());
     return output;
   }
 
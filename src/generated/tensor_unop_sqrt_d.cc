@@ -17,18 +17,14 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
-#include <cmath>
 #include <tensor/tensor.h>
+#include "../simd/simd.h"
 
 namespace tensor {
 
   Tensor<double> sqrt(const Tensor<double> &t) {
     Tensor<double> output(t.dimensions());
-    Tensor<double>::const_iterator src = t.begin();
-    Tensor<double>::iterator dest = output.begin();
-    for (; src != t.end(); src++, dest++) {
-      *dest = std::sqrt(*src);
-    }
+    simd::unop(simd::SQRT, output.begin(), t.begin(), t.size());
     return output;
   }
 
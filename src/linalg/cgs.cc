@@ -50,12 +50,12 @@ namespace linalg {
           abort();
         }
         number alpha = rsold / scprod(p, Ap);
-        x += alpha * p;
-        r -= alpha * Ap;
+        x = lazy(x) + alpha * lazy(p);
+        r = lazy(r) - alpha * lazy(Ap);
         number rsnew = scprod(r, r);
         if (sqrt(abs(rsnew)) < tol)
           break;
-        p = r + (rsnew / rsold) * p;
+        p = lazy(r) + (rsnew / rsold) * lazy(p);
         rsold = rsnew;
       }
     }
@@ -53,8 +53,9 @@ namespace linalg {
     for (size_t i = 0; i <= iter; i++) {
       Tensor<elt_t> v_new = (*A)(v);
       eig = scprod(v, v_new);
-      double err = norm0(v_new - eig * v);
-      v = (v_new /= norm2(v_new));
+      double err = norm0(lazy(v_new) - eig * lazy(v));
+      v_new /= norm2(v_new);
+      v = TENSOR_MOVE(v_new);
       // Stop if the vector is sufficiently close to an eigenstate
       if (err < tol * std::abs(eig))
         break;
@@ -0,0 +1,343 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <algorithm>
+#include <deque>
+#include <pthread.h>
+#include <tensor/sdf.h>
+#include "compression.h"
+
+namespace sdf {
+
+  //
+  // The records are passed to a single I/O thread through a queue of jobs,
+  // which owns snapshots of the data. Jobs are processed in order and the
+  // queue signals when it becomes empty, which is what flush() and wait()
+  // wait for. If the thread cannot be created, jobs are run right away.
+  //
+  // Only one snapshot of tensors may be pending at a time: push() waits for
+  // the previous one to be written, before the job is prepared in the
+  // calling thread. Together with the data of the caller, this makes at most
+  // two copies of the state.
+  //
+
+  class AsyncJob {
+  public:
+    explicit AsyncJob(bool snapshot = false) : snapshot(snapshot) {}
+    virtual ~AsyncJob() {}
+    /* Work done in the calling thread before the job is queued. */
+    virtual void prepare() {}
+    virtual void run(OutDataFile *file) = 0;
+    const bool snapshot;
+  };
+
+  //
+  // A snapshot normally shares the data of the tensors. Without an atomic
+  // reference counter the I/O thread may not hold copies of a RefPointer
+  // that the caller also uses, so the data is copied instead.
+  //
+
+  template<class T>
+  static inline const T &snapshot_of(const T &value) { return value; }
+
+#ifndef TENSOR_ATOMIC_REFCOUNT
+  template<class elt_t>
+  static inline Tensor<elt_t> snapshot_of(const Tensor<elt_t> &t)
+  {
+    Tensor<elt_t> output(t.dimensions());
+    std::copy(t.begin(), t.end(), output.begin());
+    return output;
+  }
+
+  template<class elt_t>
+  static inline std::vector<Tensor<elt_t> >
+  snapshot_of(const std::vector<Tensor<elt_t> > &v)
+  {
+    std::vector<Tensor<elt_t> > output;
+    output.reserve(v.size());
+    for (size_t i = 0; i < v.size(); i++)
+      output.push_back(snapshot_of(v[i]));
+    return output;
+  }
+#endif
+
+  template<class T>
+  class DumpJob : public AsyncJob {
+  public:
+    DumpJob(const T &value, const std::string &name, bool snapshot) :
+      AsyncJob(snapshot), value_(snapshot_of(value)), name_(name)
+    {}
+    void run(OutDataFile *file) { file->dump(value_, name_); }
+  private:
+    const T value_;
+    const std::string name_;
+  };
+
+  /*
+   * The tensor is compressed by prepare(), so that the compression uses the
+   * threads of the library. From the I/O thread it would run serially, and
+   * it would keep the thread pool from the caller while it lasts.
+   */
+  class CompressedDumpJob : public AsyncJob {
+  public:
+    CompressedDumpJob(const RTensor &t, const std::string &name) :
+      AsyncJob(true), real_(t), n_(t.size()), dimensions_(t.dimensions()),
+      name_(name), tag_(DataFile::TAG_RTENSOR_COMPRESSED)
+    {}
+    CompressedDumpJob(const CTensor &t, const std::string &name) :
+      AsyncJob(true), complex_(t), n_(2 * t.size()),
+      dimensions_(t.dimensions()), name_(name),
+      tag_(DataFile::TAG_CTENSOR_COMPRESSED)
+    {}
+    void prepare() {
+      const double *data = (tag_ == DataFile::TAG_RTENSOR_COMPRESSED)?
+        real_.begin() : (const double *)complex_.begin();
+      compression::pack_chunks(data, n_, compression::CHUNK, &buffer_, &sizes_);
+      real_ = RTensor();
+      complex_ = CTensor();
+    }
+    void run(OutDataFile *file) {
+      file->dump_packed(buffer_, sizes_, compression::CHUNK, n_, dimensions_,
+                        name_, tag_);
+    }
+  private:
+    RTensor real_;
+    CTensor complex_;
+    tensor::index n_;
+    const Indices dimensions_;
+    const std::string name_;
+    const tensor::index tag_;
+    std::vector<char> buffer_;
+    std::vector<size_t> sizes_;
+  };
+
+  class FlushJob : public AsyncJob {
+  public:
+    void run(OutDataFile *file) { file->flush(); }
+  };
+
+  class CloseJob : public AsyncJob {
+  public:
+    void run(OutDataFile *file) { file->close(); }
+  };
+
+  struct AsyncQueue {
+    OutDataFile *file;
+    pthread_t thread;
+    bool threaded;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    std::deque<AsyncJob*> jobs;
+    int snapshots;
+    bool busy;
+    bool quit;
+  };
+
+  static void *io_thread(void *data)
+  {
+    AsyncQueue *q = static_cast<AsyncQueue*>(data);
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+      while (q->jobs.empty() && !q->quit)
+        pthread_cond_wait(&q->work, &q->lock);
+      if (q->jobs.empty())
+        break;
+      AsyncJob *job = q->jobs.front();
+      q->jobs.pop_front();
+      q->busy = true;
+      pthread_mutex_unlock(&q->lock);
+      bool snapshot = job->snapshot;
+      job->run(q->file);
+      delete job;
+      pthread_mutex_lock(&q->lock);
+      q->busy = false;
+      if (snapshot)
+        q->snapshots--;
+      if (snapshot || q->jobs.empty())
+        pthread_cond_broadcast(&q->done);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+  }
+
+  AsyncOutDataFile::AsyncOutDataFile(const std::string &a_filename, int flags) :
+    _file(a_filename, flags), _queue(new AsyncQueue), _closed(false)
+  {
+    _queue->file = &_file;
+    _queue->snapshots = 0;
+    _queue->busy = _queue->quit = false;
+    pthread_mutex_init(&_queue->lock, 0);
+    pthread_cond_init(&_queue->work, 0);
+    pthread_cond_init(&_queue->done, 0);
+    _queue->threaded =
+      (pthread_create(&_queue->thread, 0, io_thread, _queue) == 0);
+  }
+
+  AsyncOutDataFile::~AsyncOutDataFile()
+  {
+    close();
+    if (_queue->threaded) {
+      pthread_mutex_lock(&_queue->lock);
+      _queue->quit = true;
+      pthread_cond_signal(&_queue->work);
+      pthread_mutex_unlock(&_queue->lock);
+      pthread_join(_queue->thread, 0);
+    }
+    pthread_cond_destroy(&_queue->done);
+    pthread_cond_destroy(&_queue->work);
+    pthread_mutex_destroy(&_queue->lock);
+    delete _queue;
+  }
+
+  void
+  AsyncOutDataFile::push(AsyncJob *job)
+  {
+    if (!_queue->threaded) {
+      job->prepare();
+      job->run(&_file);
+      delete job;
+      return;
+    }
+    if (job->snapshot) {
+      pthread_mutex_lock(&_queue->lock);
+      while (_queue->snapshots)
+        pthread_cond_wait(&_queue->done, &_queue->lock);
+      _queue->snapshots++;
+      pthread_mutex_unlock(&_queue->lock);
+    }
+    job->prepare();
+    pthread_mutex_lock(&_queue->lock);
+    _queue->jobs.push_back(job);
+    pthread_cond_signal(&_queue->work);
+    pthread_mutex_unlock(&_queue->lock);
+  }
+
+  void
+  AsyncOutDataFile::wait()
+  {
+    pthread_mutex_lock(&_queue->lock);
+    while (_queue->busy || !_queue->jobs.empty())
+      pthread_cond_wait(&_queue->done, &_queue->lock);
+    pthread_mutex_unlock(&_queue->lock);
+  }
+
+  void
+  AsyncOutDataFile::flush()
+  {
+    if (!_closed)
+      push(new FlushJob);
+    wait();
+  }
+
+  void
+  AsyncOutDataFile::close()
+  {
+    if (!_closed) {
+      _closed = true;
+      push(new CloseJob);
+    }
+  }
+
+  static void check_open(const std::string &name, bool closed)
+  {
+    if (closed) {
+      std::cerr << "Cannot write record " << name << " to a closed SDF file";
+      abort();
+    }
+  }
+
+  template<class T>
+  static AsyncJob *dump_job(const T &value, const std::string &name,
+                            bool closed, bool snapshot = false)
+  {
+    check_open(name, closed);
+    return new DumpJob<T>(value, name, snapshot);
+  }
+
+  template<class T>
+  static AsyncJob *dump_compressed_job(const T &value, const std::string &name,
+                                       bool closed)
+  {
+    check_open(name, closed);
+    return new CompressedDumpJob(value, name);
+  }
+
+  void
+  AsyncOutDataFile::dump(const int r, const std::string &name)
+  {
+    push(dump_job(r, name, _closed));
+  }
+
+  void
+  AsyncOutDataFile::dump(const size_t r, const std::string &name)
+  {
+    push(dump_job(r, name, _closed));
+  }
+
+  void
+  AsyncOutDataFile::dump(const double r, const std::string &name)
+  {
+    push(dump_job(r, name, _closed));
+  }
+
+  void
+  AsyncOutDataFile::dump(const cdouble r, const std::string &name)
+  {
+    push(dump_job(r, name, _closed));
+  }
+
+  void
+  AsyncOutDataFile::dump(const RTensor &t, const std::string &name)
+  {
+    push(dump_job(t, name, _closed, true));
+  }
+
+  void
+  AsyncOutDataFile::dump(const CTensor &t, const std::string &name)
+  {
+    push(dump_job(t, name, _closed, true));
+  }
+
+  void
+  AsyncOutDataFile::dump(const std::vector<RTensor> &t, const std::string &name)
+  {
+    push(dump_job(t, name, _closed, true));
+  }
+
+  void
+  AsyncOutDataFile::dump(const std::vector<CTensor> &t, const std::string &name)
+  {
+    push(dump_job(t, name, _closed, true));
+  }
+
+  void
+  AsyncOutDataFile::dump_compressed(const RTensor &t, const std::string &name)
+  {
+    push(dump_compressed_job(t, name, _closed));
+  }
+
+  void
+  AsyncOutDataFile::dump_compressed(const CTensor &t, const std::string &name)
+  {
+    push(dump_compressed_job(t, name, _closed));
+  }
+
+} // namespace sdf
@@ -0,0 +1,295 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <algorithm>
+#include <cstring>
+#include "compression.h"
+#include "../tools/parallel.h"
+
+namespace sdf {
+namespace compression {
+
+  static const size_t word = sizeof(double);
+
+  static size_t padded(size_t size)
+  {
+    return (size + word - 1) / word * word;
+  }
+
+  size_t max_packed_size(index n)
+  {
+    size_t bytes = n * word;
+    return padded(1 + bytes + bytes / 128 + 1);
+  }
+
+  typedef unsigned long long word_t;
+
+  static inline word_t load(const unsigned char *p)
+  {
+    word_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline void store(unsigned char *p, word_t v)
+  {
+    memcpy(p, &v, sizeof(v));
+  }
+
+  /* Transpose the 8x8 matrix of bytes of eight words, swapping blocks of
+     4, 2 and 1 bytes. The transposition is its own inverse. */
+  static inline void transpose(word_t *x)
+  {
+    for (int i = 0; i < 4; i++) {
+      word_t t = ((x[i] >> 32) ^ x[i+4]) & 0x00000000FFFFFFFFULL;
+      x[i] ^= t << 32;
+      x[i+4] ^= t;
+    }
+    for (int i = 0; i < 8; i += (i & 1)? 3 : 1) {
+      word_t t = ((x[i] >> 16) ^ x[i+2]) & 0x0000FFFF0000FFFFULL;
+      x[i] ^= t << 16;
+      x[i+2] ^= t;
+    }
+    for (int i = 0; i < 8; i += 2) {
+      word_t t = ((x[i] >> 8) ^ x[i+1]) & 0x00FF00FF00FF00FFULL;
+      x[i] ^= t << 8;
+      x[i+1] ^= t;
+    }
+  }
+
+  /* Byte j of number i goes to position j*n+i. Numbers are processed in
+     groups of eight, whose bytes are transposed in registers. */
+  static void shuffle(const unsigned char *data, index n, unsigned char *output)
+  {
+    index i = 0;
+    for (; i + 8 <= n; i += 8) {
+      word_t x[8];
+      for (int k = 0; k < 8; k++)
+        x[k] = load(data + (i + k) * word);
+      transpose(x);
+      for (int j = 0; j < 8; j++)
+        store(output + j * n + i, x[j]);
+    }
+    for (; i < n; i++) {
+      for (size_t j = 0; j < word; j++) {
+        output[j * n + i] = data[i * word + j];
+      }
+    }
+  }
+
+  static void unshuffle(const unsigned char *data, index n, unsigned char *output)
+  {
+    index i = 0;
+    for (; i + 8 <= n; i += 8) {
+      word_t x[8];
+      for (int j = 0; j < 8; j++)
+        x[j] = load(data + j * n + i);
+      transpose(x);
+      for (int k = 0; k < 8; k++)
+        store(output + (i + k) * word, x[k]);
+    }
+    for (; i < n; i++) {
+      for (size_t j = 0; j < word; j++) {
+        output[i * word + j] = data[j * n + i];
+      }
+    }
+  }
+
+  /* Run-length encoding of n bytes. It gives up, returning a size larger
+     than 'limit', as soon as the output grows beyond that size. */
+  static size_t rle_encode(const unsigned char *data, size_t n,
+                           unsigned char *output, size_t limit)
+  {
+    unsigned char *o = output;
+    size_t i = 0;
+    while (i < n) {
+      if ((size_t)(o - output) > limit)
+        return limit + 1;
+      size_t run = 1, max_run = std::min<size_t>(130, n - i);
+      word_t pattern = data[i] * 0x0101010101010101ULL;
+      while (run + 8 <= max_run && load(data + i + run) == pattern)
+        run += 8;
+      while (run < max_run && data[i + run] == data[i])
+        run++;
+      if (run >= 3) {
+        *(o++) = (unsigned char)(128 + run - 3);
+        *(o++) = data[i];
+        i += run;
+      } else {
+        /* Literal bytes, up to the next run of three equal bytes. Words
+           without two consecutive equal bytes are skipped at once. */
+        size_t start = i, end = std::min(n, start + 128);
+        while (i < end) {
+          if (i + 8 <= end && i + 9 <= n) {
+            word_t eq = load(data + i) ^ load(data + i + 1);
+            if (!((eq - 0x0101010101010101ULL) & ~eq & 0x8080808080808080ULL)) {
+              i += 8;
+              continue;
+            }
+          }
+          if (i + 2 < n && data[i] == data[i+1] && data[i] == data[i+2])
+            break;
+          i++;
+        }
+        *(o++) = (unsigned char)(i - start - 1);
+        memcpy(o, data + start, i - start);
+        o += i - start;
+      }
+    }
+    return o - output;
+  }
+
+  static bool rle_decode(const unsigned char *data, size_t size,
+                         unsigned char *output, size_t n)
+  {
+    const unsigned char *end = data + size;
+    unsigned char *o = output, *o_end = output + n;
+    while (o < o_end) {
+      if (data >= end)
+        return false;
+      size_t c = *(data++);
+      if (c < 128) {
+        size_t length = c + 1;
+        if (length > (size_t)(o_end - o) || length > (size_t)(end - data))
+          return false;
+        memcpy(o, data, length);
+        data += length;
+        o += length;
+      } else {
+        size_t length = c - 125;
+        if (length > (size_t)(o_end - o) || data >= end)
+          return false;
+        memset(o, *(data++), length);
+        o += length;
+      }
+    }
+    return true;
+  }
+
+  size_t pack(const double *data, index n, char *output)
+  {
+    size_t bytes = n * word;
+    std::vector<unsigned char> shuffled(bytes);
+    unsigned char *o = reinterpret_cast<unsigned char*>(output);
+    size_t size = 0;
+    if (bytes) {
+      shuffle(reinterpret_cast<const unsigned char*>(data), n, &shuffled[0]);
+      size = rle_encode(&shuffled[0], bytes, o + 1, bytes);
+    }
+    if (size < bytes) {
+      o[0] = SHUFFLED_RLE;
+    } else {
+      o[0] = RAW;
+      memcpy(o + 1, data, bytes);
+      size = bytes;
+    }
+    size_t total = padded(size + 1);
+    std::fill(o + size + 1, o + total, 0);
+    return total;
+  }
+
+  bool unpack(const char *data, size_t size, double *output, index n)
+  {
+    size_t bytes = n * word;
+    if (size < 1)
+      return false;
+    if (data[0] == RAW) {
+      if (size < bytes + 1)
+        return false;
+      memcpy(output, data + 1, bytes);
+      return true;
+    }
+    if (data[0] != SHUFFLED_RLE)
+      return false;
+    std::vector<unsigned char> shuffled(bytes);
+    if (bytes == 0)
+      return true;
+    if (!rle_decode(reinterpret_cast<const unsigned char*>(data + 1), size - 1,
+                    &shuffled[0], bytes))
+      return false;
+    unshuffle(&shuffled[0], n, reinterpret_cast<unsigned char*>(output));
+    return true;
+  }
+
+  class PackTask : public tensor::parallel::Task {
+  public:
+    PackTask(const double *data, index n, index chunk, char *buffer,
+             size_t *sizes) :
+      data_(data), n_(n), chunk_(chunk), buffer_(buffer), sizes_(sizes),
+      stride_(max_packed_size(chunk))
+    {}
+    void run(index c) {
+      index begin = c * chunk_, end = std::min(n_, begin + chunk_);
+      sizes_[c] = pack(data_ + begin, end - begin, buffer_ + c * stride_);
+    }
+  private:
+    const double *data_;
+    index n_, chunk_;
+    char *buffer_;
+    size_t *sizes_, stride_;
+  };
+
+  void pack_chunks(const double *data, index n, index chunk,
+                   std::vector<char> *buffer, std::vector<size_t> *sizes)
+  {
+    index nchunks = chunks(n, chunk);
+    buffer->resize(std::max<size_t>(1, nchunks * max_packed_size(chunk)));
+    sizes->resize(nchunks);
+    if (nchunks) {
+      PackTask task(data, n, chunk, &(*buffer)[0], &(*sizes)[0]);
+      tensor::parallel::run_chunks(task, nchunks);
+    }
+  }
+
+  class UnpackTask : public tensor::parallel::Task {
+  public:
+    UnpackTask(const char *const *data, const size_t *sizes, index first,
+               index chunk, index n, double *output) :
+      data_(data), sizes_(sizes), first_(first), chunk_(chunk), n_(n),
+      output_(output), ok_(true)
+    {}
+    void run(index c) {
+      index begin = (first_ + c) * chunk_;
+      index end = std::min(n_, begin + chunk_);
+      if (!unpack(data_[c], sizes_[c], output_ + c * chunk_, end - begin))
+        __atomic_store_n(&ok_, false, __ATOMIC_RELAXED);
+    }
+    bool ok() const { return ok_; }
+  private:
+    const char *const *data_;
+    const size_t *sizes_;
+    index first_, chunk_, n_;
+    double *output_;
+    bool ok_;
+  };
+
+  bool unpack_chunks(const char *const *data, const size_t *sizes,
+                     index first, index count, index chunk, index n,
+                     double *output)
+  {
+    if (count <= 0)
+      return true;
+    UnpackTask task(data, sizes, first, chunk, n, output);
+    tensor::parallel::run_chunks(task, count);
+    return task.ok();
+  }
+
+} // namespace compression
+} // namespace sdf
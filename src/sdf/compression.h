@@ -0,0 +1,93 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#ifndef TENSOR_SDF_COMPRESSION_H
+#define TENSOR_SDF_COMPRESSION_H
+
+#include <vector>
+#include <tensor/tensor.h>
+
+//
+// Compression of the data of SDF records. The data is split into chunks of
+// a fixed number of real numbers that are compressed independently, in
+// parallel, and which can be decompressed one by one. Each chunk starts
+// with a byte that tells how it is stored:
+//
+//  - RAW: the numbers themselves.
+//  - SHUFFLED_RLE: the bytes of the numbers are first reordered, so that
+//    the first byte of all numbers comes first, then the second byte and
+//    so on. Smooth data has long sequences of equal sign and exponent
+//    bytes, and zeros become sequences of zero bytes. The result is
+//    compressed with run-length encoding: a control byte c < 128 is
+//    followed by c+1 literal bytes, while c >= 128 is followed by one byte
+//    that is repeated c-125 times.
+//
+// Chunks are padded with zeros to a multiple of eight bytes, so that the
+// records that follow remain aligned.
+//
+
+namespace sdf {
+namespace compression {
+
+  using tensor::index;
+
+  enum method { RAW = 0, SHUFFLED_RLE = 1 };
+
+  /* Real numbers per chunk. */
+  const index CHUNK = 32768;
+
+  /* Number of chunks that hold n numbers. */
+  inline index chunks(index n, index chunk) { return (n + chunk - 1) / chunk; }
+
+  /* True if a record of n numbers in chunks of 'chunk' numbers may have
+     'nchunks' chunks. Used to reject damaged records. */
+  inline bool valid_chunks(size_t n, size_t chunk, size_t nchunks) {
+    return chunk > 0 && nchunks == n / chunk + (n % chunk != 0);
+  }
+
+  /* Largest size of a compressed chunk of n numbers. */
+  size_t max_packed_size(index n);
+
+  /* Compress n numbers into 'output', which must have room for
+     max_packed_size(n) bytes, returning the bytes used. */
+  size_t pack(const double *data, index n, char *output);
+
+  /* Decompress a chunk of 'size' bytes into n numbers. Returns false if
+     the chunk is damaged. */
+  bool unpack(const char *data, size_t size, double *output, index n);
+
+  /* Compress the n numbers of 'data' in chunks, in parallel. The chunks
+     are stored in 'buffer', each one at a multiple of max_packed_size(chunk),
+     and their sizes in 'sizes'. */
+  void pack_chunks(const double *data, index n, index chunk,
+                   std::vector<char> *buffer, std::vector<size_t> *sizes);
+
+  /* Decompress, in parallel, the chunks 'first' to 'first+count-1' of a
+     record with n numbers, given pointers to their data and their sizes.
+     The numbers are written to 'output' starting with the first element of
+     chunk 'first'. Returns false if a chunk is damaged. */
+  bool unpack_chunks(const char *const *data, const size_t *sizes,
+                     index first, index count, index chunk, index n,
+                     double *output);
+
+} // namespace compression
+} // namespace sdf
+
+#endif // !TENSOR_SDF_COMPRESSION_H
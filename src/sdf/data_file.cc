@@ -83,7 +83,8 @@ DataFile::DataFile(const std::string &a_filename, int flags) :
   _filename(_actual_filename),
   _lock_filename(_actual_filename + ".lck"),
   _lock((flags == SDF_SHARED) ? get_lock(_lock_filename.c_str(), true) : 0),
-  _open(true)
+  _open(true),
+  _indexed(false)
 {
   switch (flags) {
   case SDF_OVERWRITE:
@@ -109,7 +110,7 @@ DataFile::~DataFile()
   close();
 }
 
-void
+bool
 DataFile::close()
 {
   if (is_open()) {
@@ -121,21 +122,24 @@ DataFile::close()
       }
       break;
     case SDF_PARANOID:
-      if (file_exists(_actual_filename))
+      return file_exists(_actual_filename) &&
         rename_file(_actual_filename, _filename);
     }
   }
+  return true;
 }
 
 const char *
 DataFile::tag_to_name(size_t tag)
 {
     static const char *names[] = {
-	"RTensor", "CTensor", "Real MPS", "Complex MPS"
+	"RTensor", "CTensor", "Real MPS", "Complex MPS",
+	"compressed RTensor", "compressed CTensor"
     };
 
-    if (tag > 4 /* || tag < 0 */) {
+    if (tag >= sizeof(names) / sizeof(*names)) {
 	std::cerr << "Not a valid tag code, " << tag << " found in " << _filename;
+	return "unknown object";
     }
     return names[tag];
 }
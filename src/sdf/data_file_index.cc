@@ -0,0 +1,360 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <algorithm>
+#include <tensor/sdf.h>
+
+namespace sdf {
+
+  //////////////////////////////////////////////////////////////////////
+  // INDEX OF RECORDS
+  //
+  // The index file starts with a header like that of SDF files, but with
+  // the magic string "idx". It is followed by the size of the part of the
+  // data file that it covers, the number of records and, for each record,
+  // the length of its name, the name, its tag, offset and dimensions. The
+  // index is only a cache: records are checked against the data file before
+  // they are used. It is only written by OutDataFile::close(), so that
+  // reading a file never writes next to it.
+  //
+
+  template<typename t>
+  static bool read_value(std::istream &s, t *v)
+  {
+    s.read((char *)v, sizeof(t));
+    return !s.fail();
+  }
+
+  template<typename t>
+  static void write_value(std::ostream &s, const t &v)
+  {
+    s.write((const char *)&v, sizeof(t));
+  }
+
+  static bool read_name(std::istream &s, size_t name_size, std::string *name)
+  {
+    std::vector<char> buffer(name_size);
+    s.read(&buffer[0], name_size);
+    if (s.fail())
+      return false;
+    *name = std::string(buffer.begin(), std::find(buffer.begin(), buffer.end(), 0));
+    return true;
+  }
+
+  static void write_name(std::ostream &s, size_t name_size, const std::string &name)
+  {
+    std::vector<char> buffer(name_size, 0);
+    std::copy(name.begin(), name.begin() + std::min(name.size(), name_size - 1),
+              buffer.begin());
+    s.write(&buffer[0], name_size);
+  }
+
+  static std::string index_header(int endian)
+  {
+    std::string tag = "idx   ";
+    tag[3] = sizeof(int) + '0';
+    tag[4] = sizeof(long) + '0';
+    tag[5] = endian + '0';
+    return tag;
+  }
+
+  /* Read the header of a tensor record starting at 'position', leaving
+   * 'position' at the end of the record. Returns false if the record is
+   * not complete or is not a tensor. */
+  static bool skip_tensor(std::istream &s, size_t name_size, size_t *position,
+                          size_t end, std::string *name, tensor::index *tag,
+                          Indices *dimensions)
+  {
+    size_t rank, length;
+    if (!read_name(s, name_size, name) || !read_value(s, tag) ||
+        !read_value(s, &rank) || rank > (end - *position) / sizeof(tensor::index))
+      return false;
+    size_t elt_size;
+    bool compressed = false;
+    if (*tag == DataFile::TAG_RTENSOR)
+      elt_size = sizeof(double);
+    else if (*tag == DataFile::TAG_CTENSOR)
+      elt_size = sizeof(cdouble);
+    else if (*tag == DataFile::TAG_RTENSOR_COMPRESSED ||
+             *tag == DataFile::TAG_CTENSOR_COMPRESSED)
+      compressed = true;
+    else
+      return false;
+    Indices dims(rank);
+    if (rank)
+      s.read((char *)dims.begin(), rank * sizeof(tensor::index));
+    if (!read_value(s, &length))
+      return false;
+    size_t header = name_size + sizeof(tensor::index) + 2 * sizeof(size_t) +
+      rank * sizeof(tensor::index);
+    if (end - *position < header)
+      return false;
+    size_t available = end - *position - header, data_size;
+    if (compressed) {
+      /* Number of reals per chunk and number of chunks, followed by the
+         size of each chunk */
+      size_t chunk, nchunks;
+      if (!read_value(s, &chunk) || !read_value(s, &nchunks) ||
+          available < 2 * sizeof(size_t) ||
+          nchunks > (available - 2 * sizeof(size_t)) / sizeof(size_t))
+        return false;
+      data_size = (2 + nchunks) * sizeof(size_t);
+      for (size_t c = 0; c < nchunks; c++) {
+        size_t size;
+        if (!read_value(s, &size) || size > available - data_size)
+          return false;
+        data_size += size;
+      }
+    } else {
+      if (length > available / elt_size)
+        return false;
+      data_size = length * elt_size;
+    }
+    *position += header + data_size;
+    s.seekg(*position);
+    *dimensions = dims;
+    return true;
+  }
+
+  size_t
+  DataFile::file_size(const std::string &filename)
+  {
+    std::ifstream s(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+    s.seekg(0, std::ios_base::end);
+    return s? (size_t)s.tellg() : 0;
+  }
+
+  /* Scan the records of a file between 'start' and 'end', adding them to
+   * the list. Returns the position after the last complete record. */
+  size_t
+  DataFile::scan_records(std::istream &s, size_t start, size_t end,
+                         std::vector<DataFileRecord> *records)
+  {
+    size_t position = start;
+    s.clear();
+    s.seekg(position);
+    while (position < end) {
+      DataFileRecord r;
+      size_t next = position;
+      if (!skip_tensor(s, var_name_size, &next, end, &r.name, &r.tag,
+                       &r.dimensions)) {
+        /* Vectors of tensors: a header with the number of tensors,
+           followed by the tensors themselves without names. */
+        size_t l;
+        s.clear();
+        s.seekg(position);
+        if (!read_name(s, var_name_size, &r.name) || !read_value(s, &r.tag) ||
+            (r.tag != TAG_RTENSOR_VECTOR && r.tag != TAG_CTENSOR_VECTOR) ||
+            !read_value(s, &l))
+          break;
+        next = position + var_name_size + sizeof(tensor::index) + sizeof(size_t);
+        size_t k = 0;
+        for (; k < l && next < end; k++) {
+          std::string name;
+          tensor::index tag;
+          Indices dims;
+          if (!skip_tensor(s, var_name_size, &next, end, &name, &tag, &dims) ||
+              tag != r.tag - TAG_RTENSOR_VECTOR)
+            break;
+        }
+        if (k < l)
+          break;
+        r.dimensions = Indices(igen << (tensor::index)l);
+      }
+      r.offset = position;
+      records->push_back(r);
+      position = next;
+    }
+    return position;
+  }
+
+  /* The index file is read in one go and then parsed from memory, because
+   * for files with many records this is much faster than reading each field
+   * from the stream. */
+  bool
+  DataFile::read_index_file(const std::string &filename, size_t *data_size,
+                            std::vector<DataFileRecord> *records)
+  {
+    std::vector<char> buffer(file_size(filename));
+    {
+      std::ifstream s(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+      if (buffer.empty() || !s.read(&buffer[0], buffer.size()))
+        return false;
+    }
+    const char *p = &buffer[0], *end = p + buffer.size();
+    const size_t fixed = sizeof(tensor::index) + 3 * sizeof(size_t);
+    size_t count;
+    if ((size_t)(end - p) < var_name_size + 2 * sizeof(size_t) ||
+        std::string(p, std::find(p, p + var_name_size, 0)) != index_header(endian))
+      return false;
+    p += var_name_size;
+    memcpy(data_size, p, sizeof(size_t));
+    memcpy(&count, p + sizeof(size_t), sizeof(size_t));
+    p += 2 * sizeof(size_t);
+    if (count > (end - p) / fixed)
+      return false;
+    records->resize(count);
+    for (size_t i = 0; i < count; i++) {
+      DataFileRecord &r = (*records)[i];
+      size_t length, rank;
+      if ((size_t)(end - p) < fixed)
+        return false;
+      memcpy(&length, p, sizeof(size_t));
+      p += sizeof(size_t);
+      if (length > (size_t)(end - p) - (fixed - sizeof(size_t)))
+        return false;
+      r.name.assign(p, length);
+      p += length;
+      memcpy(&r.tag, p, sizeof(tensor::index));
+      p += sizeof(tensor::index);
+      memcpy(&r.offset, p, sizeof(size_t));
+      p += sizeof(size_t);
+      memcpy(&rank, p, sizeof(size_t));
+      p += sizeof(size_t);
+      if (rank > (end - p) / sizeof(tensor::index))
+        return false;
+      r.dimensions = Indices(rank);
+      if (rank)
+        memcpy(r.dimensions.begin(), p, rank * sizeof(tensor::index));
+      p += rank * sizeof(tensor::index);
+    }
+    return true;
+  }
+
+  /* The index is written to a temporary file that replaces the old one
+   * only when complete. Failures are ignored, because the index can always
+   * be reconstructed from the data. */
+  bool
+  DataFile::write_index_file(const std::string &filename, size_t data_size,
+                             const std::vector<DataFileRecord> &records)
+  {
+    std::string tmp = filename + ".tmp";
+    {
+      std::ofstream s(tmp.c_str(), std::ios_base::out | std::ios_base::trunc |
+                      std::ios_base::binary);
+      if (!s)
+        return false;
+      write_name(s, var_name_size, index_header(endian));
+      write_value(s, data_size);
+      write_value(s, records.size());
+      for (size_t i = 0; i < records.size(); i++) {
+        const DataFileRecord &r = records[i];
+        write_value(s, r.name.size());
+        s.write(r.name.c_str(), r.name.size());
+        write_value(s, r.tag);
+        write_value(s, r.offset);
+        write_value(s, (size_t)r.dimensions.size());
+        s.write((const char *)r.dimensions.begin_const(),
+                r.dimensions.size() * sizeof(tensor::index));
+      }
+      if (!s) {
+        s.close();
+        delete_file(tmp);
+        return false;
+      }
+    }
+    return rename_file(tmp, filename);
+  }
+
+  /* Restores the position and state of a stream when it goes out of
+   * scope. */
+  class SavedPosition {
+  public:
+    SavedPosition(std::istream &s) : _s(s), _state(s.rdstate()) {
+      _s.clear();
+      _position = _s.tellg();
+    }
+    ~SavedPosition() {
+      _s.clear();
+      _s.seekg(_position);
+      _s.setstate(_state);
+    }
+  private:
+    std::istream &_s;
+    std::ios_base::iostate _state;
+    std::streampos _position;
+  };
+
+  /* Build the list of records from the index file, scanning the part of the
+   * data file that it does not cover, if any. */
+  void
+  DataFile::index_records(std::istream &s, bool use_index_file)
+  {
+    SavedPosition saved(s);
+    s.seekg(0, std::ios_base::end);
+    size_t size = s.tellg();
+    size_t indexed = 0;
+    _records.clear();
+    if (!use_index_file ||
+        !read_index_file(index_filename(), &indexed, &_records) ||
+        indexed > size ||
+        (_records.size() && !check_record(s, _records.back()))) {
+      _records.clear();
+      indexed = var_name_size;
+    }
+    if (indexed < size) {
+      s.clear();
+      scan_records(s, indexed, size, &_records);
+    }
+    _record_positions.clear();
+    for (size_t i = 0; i < _records.size(); i++)
+      _record_positions[_records[i].name] = i;
+    _indexed = true;
+  }
+
+  const std::vector<DataFileRecord> &
+  DataFile::indexed_records(std::istream &s)
+  {
+    if (!_indexed)
+      index_records(s, true);
+    return _records;
+  }
+
+  /* Verify that the data file has the expected record at that position,
+   * which may not be the case if the file was replaced by a program that
+   * did not update the index. */
+  bool
+  DataFile::check_record(std::istream &s, const DataFileRecord &record)
+  {
+    SavedPosition saved(s);
+    std::string name;
+    tensor::index tag;
+    s.seekg(record.offset);
+    return read_name(s, var_name_size, &name) && read_value(s, &tag) &&
+      name == record.name && tag == record.tag;
+  }
+
+  const DataFileRecord *
+  DataFile::find_record(std::istream &s, const std::string &name)
+  {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (!_indexed || attempt)
+        index_records(s, attempt == 0);
+      std::map<std::string,size_t>::const_iterator it =
+        _record_positions.find(name);
+      if (it == _record_positions.end())
+        return 0;
+      if (check_record(s, _records[it->second]))
+        return &_records[it->second];
+    }
+    return 0;
+  }
+
+} // namespace sdf
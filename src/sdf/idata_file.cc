@@ -18,6 +18,8 @@
 */
 
 #include <tensor/sdf.h>
+#include <tensor/io.h>
+#include "compression.h"
 
 using namespace sdf;
 
@@ -27,11 +29,7 @@ void read_raw_with_endian(std::ifstream &s, number *data, size_t n)
 {
   s.read((char *)data, n * sizeof(number));
   if (s.bad()) {
-#ifdef _MSC_VER
     std::cerr << "I/O error when reading from SDF stream";
-#else
-    std::cerr << "I/O error when reading from stream " << s;
-#endif
     abort();
   }
 }
@@ -43,11 +41,7 @@ void read_raw_with_endian(std::ifstream &s, number *data, size_t n)
   if (size == 1) {
     s.read((char *)data, n * sizeof(number));
     if (s.bad()) {
-#ifdef _MSC_VER
       std::cerr << "I/O error when reading from SDF stream";
-#else
-      std::cerr << "I/O error when reading from stream " << s;
-#endif
       abort();
     }
     return;
@@ -61,7 +55,7 @@ void read_raw_with_endian(std::ifstream &s, number *data, size_t n)
     size_t now = min<size_t>(n*size, buffer_size);
     s.read(buffer, now);
     if (s.bad()) {
-      std::cerr << "I/O error when reading from stream " << s;
+      std::cerr << "I/O error when reading from SDF stream";
       abort();
     }
     for (size_t i = 0; i < now; i+=size) {
@@ -93,7 +87,8 @@ void read_raw_with_endian(std::ifstream &s, number *data, size_t n)
 InDataFile::InDataFile(const std::string &a_filename, int flags) :
   DataFile(a_filename, flags),
   _stream(actual_filename().c_str(),
-          std::ios_base::in | std::ios_base::binary)
+          std::ios_base::in | std::ios_base::binary),
+  _slices(0)
 {
   _stream.seekg(std::ios_base::beg);
   read_header();
@@ -155,12 +150,13 @@ InDataFile::read_variable_name()
   char *buffer = new char[var_name_size];
   read_raw(buffer, var_name_size);
   std::string output(buffer);
-  delete buffer;
+  delete[] buffer;
   return output;
 }
 
-void
-InDataFile::read_tag(const std::string &name, tensor::index type)
+tensor::index
+InDataFile::read_tag(const std::string &name, tensor::index type,
+                     tensor::index compressed_type)
 {
   std::string other_name = read_variable_name();
   if (name.size() && (name != other_name)) {
@@ -170,12 +166,13 @@ InDataFile::read_tag(const std::string &name, tensor::index type)
     abort();
   }
   tensor::index other_type = read_tag_code();
-  if (type != other_type) {
+  if (type != other_type && compressed_type != other_type) {
     std::cerr << "While reading file " << _filename << ", an object of type "
 	      << tag_to_name(type) << " was expected but found a "
 	      << tag_to_name(other_type) << '\n';
     abort();
   }
+  return other_type;
 }
 
 template<class Vector>
@@ -188,18 +185,186 @@ const Vector InDataFile::load_vector()
   return v;
 }
 
+/*
+ * Read elements first to first+count-1 of the data of a record, measured
+ * in real numbers, and skip the rest. Elements of uncompressed records are
+ * made of 'words' real numbers. For compressed records, only the chunks
+ * that contain the elements are read and decompressed.
+ */
+static void
+damaged_record(const std::string &filename)
+{
+  std::cerr << "While reading file " << filename
+            << ", found a damaged compressed record\n";
+  abort();
+}
+
+void
+InDataFile::load_elements(double *data, tensor::index words, tensor::index first,
+                          tensor::index count, bool compressed)
+{
+  size_t length, chunk = 1, nchunks = 0;
+  read_raw(length);
+  if (compressed) {
+    read_raw(chunk);
+    read_raw(nchunks);
+  } else {
+    length *= words;
+  }
+  if (first < 0 || count < 0 || (size_t)(first + count) > length) {
+    std::cerr << "While reading file " << _filename << ", elements "
+              << first << " to " << first + count - 1
+              << " were requested from a record with " << length << '\n';
+    abort();
+  }
+  if (!compressed) {
+    std::streamoff start = _stream.tellg();
+    _stream.seekg(start + first * sizeof(double));
+    read_raw(data, count);
+    _stream.seekg(start + length * sizeof(double));
+    return;
+  }
+  /* The chunks must cover the record and lie within the file. */
+  std::streamoff here = _stream.tellg();
+  _stream.seekg(0, std::ios_base::end);
+  size_t available = (size_t)(_stream.tellg() - here);
+  _stream.seekg(here);
+  if (!compression::valid_chunks(length, chunk, nchunks) ||
+      nchunks > available / sizeof(size_t))
+    damaged_record(_filename);
+  available -= nchunks * sizeof(size_t);
+  std::vector<size_t> sizes(nchunks), offsets(nchunks + 1, 0);
+  if (nchunks)
+    read_raw(&sizes[0], nchunks);
+  for (size_t c = 0; c < nchunks; c++) {
+    if (sizes[c] > available - offsets[c])
+      damaged_record(_filename);
+    offsets[c+1] = offsets[c] + sizes[c];
+  }
+  std::streamoff start = _stream.tellg();
+  if (count) {
+    tensor::index c0 = first / chunk, c1 = (first + count - 1) / chunk + 1;
+    std::vector<char> buffer(offsets[c1] - offsets[c0]);
+    std::vector<const char *> pointers(c1 - c0);
+    _stream.seekg(start + (std::streamoff)offsets[c0]);
+    read_raw(&buffer[0], buffer.size());
+    for (tensor::index c = c0; c < c1; c++)
+      pointers[c - c0] = &buffer[offsets[c] - offsets[c0]];
+    tensor::index begin = c0 * chunk;
+    tensor::index end = std::min<tensor::index>(length, c1 * chunk);
+    std::vector<double> aux;
+    double *output = data;
+    if (begin != first || end != first + count) {
+      aux.resize(end - begin);
+      output = &aux[0];
+    }
+    if (!compression::unpack_chunks(&pointers[0], &sizes[c0], c0, c1 - c0,
+                                    chunk, length, output))
+      damaged_record(_filename);
+    if (output != data)
+      std::copy(output + (first - begin), output + (first - begin) + count, data);
+  }
+  _stream.seekg(start + (std::streamoff)offsets[nchunks]);
+}
+
 void
 InDataFile::load(RTensor *t, const std::string &name) {
-  read_tag(name, TAG_RTENSOR);
+  tensor::index tag = read_tag(name, TAG_RTENSOR, TAG_RTENSOR_COMPRESSED);
   Indices dims = load_vector<Indices>();
-  *t = RTensor(dims, load_vector<RTensor>());
+  if (tag == TAG_RTENSOR) {
+    *t = RTensor(dims, load_vector<RTensor>());
+  } else {
+    RTensor aux(dims);
+    load_elements(aux.begin(), 1, 0, aux.size(), true);
+    *t = aux;
+  }
 }
 
 void
 InDataFile::load(CTensor *t, const std::string &name) {
-  read_tag(name, TAG_CTENSOR);
+  tensor::index tag = read_tag(name, TAG_CTENSOR, TAG_CTENSOR_COMPRESSED);
   Indices dims = load_vector<Indices>();
-  *t = CTensor(dims, load_vector<CTensor>());
+  if (tag == TAG_CTENSOR) {
+    *t = CTensor(dims, load_vector<CTensor>());
+  } else {
+    CTensor aux(dims);
+    load_elements((double*)aux.begin(), 2, 0, 2 * aux.size(), true);
+    *t = aux;
+  }
+}
+
+void
+InDataFile::load(RTensor *t, const std::string &name, tensor::index first,
+                 tensor::index count) {
+  tensor::index tag = read_tag(name, TAG_RTENSOR, TAG_RTENSOR_COMPRESSED);
+  load_vector<Indices>();
+  RTensor aux(count);
+  load_elements(aux.begin(), 1, first, count, tag == TAG_RTENSOR_COMPRESSED);
+  *t = aux;
+}
+
+void
+InDataFile::load(CTensor *t, const std::string &name, tensor::index first,
+                 tensor::index count) {
+  tensor::index tag = read_tag(name, TAG_CTENSOR, TAG_CTENSOR_COMPRESSED);
+  load_vector<Indices>();
+  CTensor aux(count);
+  load_elements((double*)aux.begin(), 2, 2 * first, 2 * count,
+                tag == TAG_CTENSOR_COMPRESSED);
+  *t = aux;
+}
+
+tensor::index
+InDataFile::begin_slices(const std::string &name)
+{
+  tensor::index tag = read_tag(name, TAG_RTENSOR, TAG_CTENSOR);
+  Indices dims = load_vector<Indices>();
+  size_t length;
+  read_raw(length);
+  if (dims.size() == 0) {
+    std::cerr << "While reading file " << _filename << ", variable " << name
+              << " has no dimensions and cannot be read in slices\n";
+    abort();
+  }
+  if (length != (size_t)dims.total_size()) {
+    std::cerr << "While reading file " << _filename << ", variable " << name
+              << " has " << length << " elements but dimensions " << dims
+              << '\n';
+    abort();
+  }
+  tensor::index rank = dims.size() - 1;
+  _slices_tag = tag;
+  _slices_dimensions = Indices(rank);
+  std::copy(dims.begin_const(), dims.begin_const() + rank,
+            _slices_dimensions.begin());
+  _slices = dims[rank];
+  return _slices;
+}
+
+template<class Tensor>
+void InDataFile::load_slice(Tensor *t, tensor::index tag)
+{
+  if (_slices <= 0 || tag != _slices_tag) {
+    std::cerr << "While reading file " << _filename << ", a slice of type "
+              << tag_to_name(tag) << " was requested, but there is none left\n";
+    abort();
+  }
+  Tensor aux(_slices_dimensions);
+  read_raw(aux.begin(), aux.size());
+  *t = aux;
+  _slices--;
+}
+
+void
+InDataFile::load_slice(RTensor *t)
+{
+  load_slice(t, TAG_RTENSOR);
+}
+
+void
+InDataFile::load_slice(CTensor *t)
+{
+  load_slice(t, TAG_CTENSOR);
 }
 
 void
@@ -291,6 +456,25 @@ InDataFile::read_header()
     }
 }
 
+bool
+InDataFile::seek(const std::string &name)
+{
+  const DataFileRecord *r = find_record(_stream, name);
+  if (r) {
+    seek(*r);
+    return true;
+  }
+  return false;
+}
+
+void
+InDataFile::seek(const DataFileRecord &record)
+{
+  assert(is_open());
+  _stream.clear();
+  _stream.seekg(record.offset);
+}
+
 void
 InDataFile::close()
 {
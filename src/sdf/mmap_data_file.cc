@@ -0,0 +1,473 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2013 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#if !defined(_MSC_VER)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+#include <algorithm>
+#include <tensor/sdf.h>
+#include "compression.h"
+
+using namespace sdf;
+
+/*
+ * The mapped file, shared by the MmapDataFile and by the tensors loaded
+ * from it. Tensors reference the mapping as the allocator of their data,
+ * which gives it back with deallocate() when no longer used. The mapping
+ * is released with the last reference.
+ */
+class MmapDataFile::Mapping : public tensor::Allocator {
+public:
+  Mapping(char *data, size_t size) : _data(data), _size(size), _references(1)
+  {}
+  void *allocate(size_t) {
+    std::cerr << "The mapping of an SDF file cannot allocate memory\n";
+    abort();
+    return 0;
+  }
+  void deallocate(void *, size_t) { release(); }
+  void retain() { _references.increment(); }
+  void release() {
+    if (_references.decrement() == 0)
+      delete this;
+  }
+private:
+  ~Mapping() {
+#ifdef _MSC_VER
+    delete[] _data;
+#else
+    if (_data)
+      munmap(_data, _size);
+#endif
+  }
+  char *_data;
+  size_t _size;
+  tensor::AtomicRefCounter _references;
+};
+
+/*
+ * Stream that reads the mapped file, used to build and check the index of
+ * records without opening the file again.
+ */
+class MmapDataFile::MemoryStream : public std::istream {
+public:
+  MemoryStream(char *data, size_t size) : std::istream(0), _buffer(data, size)
+  {
+    rdbuf(&_buffer);
+  }
+private:
+  class Buffer : public std::streambuf {
+  public:
+    Buffer(char *data, size_t size) { setg(data, data, data + size); }
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode) {
+      char *p = (dir == std::ios_base::beg)? eback() :
+        (dir == std::ios_base::end)? egptr() : gptr();
+      if (off < eback() - p || off > egptr() - p)
+        return pos_type(off_type(-1));
+      setg(eback(), p + off, egptr());
+      return pos_type(gptr() - eback());
+    }
+    pos_type seekpos(pos_type pos, std::ios_base::openmode mode) {
+      return seekoff(off_type(pos), std::ios_base::beg, mode);
+    }
+  };
+  Buffer _buffer;
+};
+
+MmapDataFile::MmapDataFile(const std::string &a_filename, int flags) :
+  DataFile(a_filename, flags), _mapping(0), _stream(0), _data(0), _size(0),
+  _position(0)
+{
+#ifdef _MSC_VER
+  std::ifstream s(actual_filename().c_str(),
+                  std::ios_base::in | std::ios_base::binary);
+  s.seekg(0, std::ios_base::end);
+  _size = s.tellg();
+  s.seekg(0, std::ios_base::beg);
+  _data = new char[_size];
+  s.read(_data, _size);
+  if (!s) {
+    std::cerr << "Unable to read SDF file " << _filename << std::endl;
+    abort();
+  }
+#else
+  struct stat info;
+  int fd = open(actual_filename().c_str(), O_RDONLY);
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    std::cerr << "Unable to open SDF file " << _filename << std::endl;
+    abort();
+  }
+  _size = info.st_size;
+  if (_size) {
+    /* A private writable mapping: tensors that are modified get their own
+       copy of the pages, while the rest is shared with the page cache. */
+    void *p = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      std::cerr << "Unable to map SDF file " << _filename << std::endl;
+      abort();
+    }
+    _data = static_cast<char*>(p);
+  }
+  ::close(fd);
+#endif
+  _mapping = new Mapping(_data, _size);
+  _stream = new MemoryStream(_data, _size);
+  read_header();
+}
+
+MmapDataFile::~MmapDataFile()
+{
+  close();
+}
+
+void
+MmapDataFile::close()
+{
+  if (is_open()) {
+    DataFile::close();
+    delete _stream;
+    _stream = 0;
+    _mapping->release();
+    _mapping = 0;
+    _data = 0;
+    _size = _position = 0;
+  }
+}
+
+const std::vector<DataFileRecord> &
+MmapDataFile::records()
+{
+  assert(is_open());
+  return indexed_records(*_stream);
+}
+
+bool
+MmapDataFile::seek(const std::string &name)
+{
+  assert(is_open());
+  const DataFileRecord *r = find_record(*_stream, name);
+  if (r) {
+    seek(*r);
+    return true;
+  }
+  return false;
+}
+
+void
+MmapDataFile::seek(const DataFileRecord &record)
+{
+  assert(is_open());
+  if (record.offset > _size) {
+    std::cerr << "While reading file " << _filename
+              << ", record " << record.name << " is beyond the end of the file\n";
+    abort();
+  }
+  _position = record.offset;
+}
+
+const char *
+MmapDataFile::read_bytes(size_t bytes)
+{
+  assert(is_open());
+  if (bytes > _size - _position) {
+    std::cerr << "While reading file " << _filename
+              << ", found the end of the file in the middle of a record\n";
+    abort();
+  }
+  const char *output = _data + _position;
+  _position += bytes;
+  return output;
+}
+
+tensor::index
+MmapDataFile::read_tag_code()
+{
+  tensor::index output;
+  read_raw(output);
+  return output;
+}
+
+std::string
+MmapDataFile::read_variable_name()
+{
+  const char *buffer = read_bytes(var_name_size);
+  return std::string(buffer, std::find(buffer, buffer + var_name_size, 0));
+}
+
+tensor::index
+MmapDataFile::read_tag(const std::string &name, tensor::index type,
+                       tensor::index compressed_type)
+{
+  std::string other_name = read_variable_name();
+  if (name.size() && (name != other_name)) {
+    std::cerr << "While reading file " << _filename << ", variable "
+              << name << " was expected but found "
+              << other_name << '\n';
+    abort();
+  }
+  tensor::index other_type = read_tag_code();
+  if (type != other_type && compressed_type != other_type) {
+    std::cerr << "While reading file " << _filename << ", an object of type "
+              << tag_to_name(type) << " was expected but found a "
+              << tag_to_name(other_type) << '\n';
+    abort();
+  }
+  return other_type;
+}
+
+/*
+ * The data of a tensor is not copied, but referenced where it lies in the
+ * mapped file, keeping the mapping alive. All records before it have sizes
+ * that are multiples of eight bytes, and so the data is properly aligned.
+ */
+template<typename elt_t>
+const Vector<elt_t> MmapDataFile::load_vector()
+{
+  size_t length;
+  read_raw(length);
+  const char *data = read_bytes(length * sizeof(elt_t));
+  _mapping->retain();
+  return Vector<elt_t>(length, reinterpret_cast<elt_t*>(const_cast<char*>(data)),
+                       _mapping);
+}
+
+const Indices
+MmapDataFile::load_dimensions()
+{
+  size_t length;
+  read_raw(length);
+  Indices output(length);
+  if (length)
+    memcpy(output.begin(), read_bytes(length * sizeof(tensor::index)),
+           length * sizeof(tensor::index));
+  return output;
+}
+
+/*
+ * Copy elements first to first+count-1 of the data of a record, measured
+ * in real numbers, and skip the rest. Elements of uncompressed records are
+ * made of 'words' real numbers. Compressed records are decompressed
+ * straight from the mapped file, only the chunks that contain the
+ * elements.
+ */
+static void
+damaged_record(const std::string &filename)
+{
+  std::cerr << "While reading file " << filename
+            << ", found a damaged compressed record\n";
+  abort();
+}
+
+void
+MmapDataFile::load_elements(double *data, tensor::index words,
+                            tensor::index first, tensor::index count,
+                            bool compressed)
+{
+  size_t length, chunk = 1, nchunks = 0;
+  read_raw(length);
+  if (compressed) {
+    read_raw(chunk);
+    read_raw(nchunks);
+  } else {
+    length *= words;
+  }
+  if (first < 0 || count < 0 || (size_t)(first + count) > length) {
+    std::cerr << "While reading file " << _filename << ", elements "
+              << first << " to " << first + count - 1
+              << " were requested from a record with " << length << '\n';
+    abort();
+  }
+  if (!compressed) {
+    const char *p = read_bytes(length * sizeof(double));
+    memcpy(data, p + first * sizeof(double), count * sizeof(double));
+    return;
+  }
+  /* The chunks must cover the record. read_bytes() checks that they lie
+     within the file. */
+  if (!compression::valid_chunks(length, chunk, nchunks) ||
+      nchunks > (_size - _position) / sizeof(size_t))
+    damaged_record(_filename);
+  std::vector<size_t> sizes(nchunks);
+  if (nchunks)
+    memcpy(&sizes[0], read_bytes(nchunks * sizeof(size_t)),
+           nchunks * sizeof(size_t));
+  std::vector<const char *> pointers(nchunks);
+  for (size_t c = 0; c < nchunks; c++)
+    pointers[c] = read_bytes(sizes[c]);
+  if (count) {
+    tensor::index c0 = first / chunk, c1 = (first + count - 1) / chunk + 1;
+    tensor::index begin = c0 * chunk;
+    tensor::index end = std::min<tensor::index>(length, c1 * chunk);
+    std::vector<double> aux;
+    double *output = data;
+    if (begin != first || end != first + count) {
+      aux.resize(end - begin);
+      output = &aux[0];
+    }
+    if (!compression::unpack_chunks(&pointers[c0], &sizes[c0], c0, c1 - c0,
+                                    chunk, length, output))
+      damaged_record(_filename);
+    if (output != data)
+      std::copy(output + (first - begin), output + (first - begin) + count, data);
+  }
+}
+
+void
+MmapDataFile::load(RTensor *t, const std::string &name) {
+  tensor::index tag = read_tag(name, TAG_RTENSOR, TAG_RTENSOR_COMPRESSED);
+  Indices dims = load_dimensions();
+  if (tag == TAG_RTENSOR) {
+    *t = RTensor(dims, RTensor(load_vector<double>()));
+  } else {
+    RTensor aux(dims);
+    load_elements(aux.begin(), 1, 0, aux.size(), true);
+    *t = aux;
+  }
+}
+
+void
+MmapDataFile::load(CTensor *t, const std::string &name) {
+  tensor::index tag = read_tag(name, TAG_CTENSOR, TAG_CTENSOR_COMPRESSED);
+  Indices dims = load_dimensions();
+  if (tag == TAG_CTENSOR) {
+    *t = CTensor(dims, CTensor(load_vector<cdouble>()));
+  } else {
+    CTensor aux(dims);
+    load_elements((double*)aux.begin(), 2, 0, 2 * aux.size(), true);
+    *t = aux;
+  }
+}
+
+void
+MmapDataFile::load(RTensor *t, const std::string &name, tensor::index first,
+                   tensor::index count) {
+  tensor::index tag = read_tag(name, TAG_RTENSOR, TAG_RTENSOR_COMPRESSED);
+  load_dimensions();
+  RTensor aux(count);
+  load_elements(aux.begin(), 1, first, count, tag == TAG_RTENSOR_COMPRESSED);
+  *t = aux;
+}
+
+void
+MmapDataFile::load(CTensor *t, const std::string &name, tensor::index first,
+                   tensor::index count) {
+  tensor::index tag = read_tag(name, TAG_CTENSOR, TAG_CTENSOR_COMPRESSED);
+  load_dimensions();
+  CTensor aux(count);
+  load_elements((double*)aux.begin(), 2, 2 * first, 2 * count,
+                tag == TAG_CTENSOR_COMPRESSED);
+  *t = aux;
+}
+
+void
+MmapDataFile::load(std::vector<RTensor> *m, const std::string &name)
+{
+  read_tag(name, TAG_RTENSOR_VECTOR);
+  size_t l;
+  read_raw(l);
+  m->resize(l);
+  for (size_t k = 0; k < l; k++) {
+    load(&m->at(k));
+  }
+}
+
+void
+MmapDataFile::load(std::vector<CTensor> *m, const std::string &name)
+{
+  read_tag(name, TAG_CTENSOR_VECTOR);
+  size_t l;
+  read_raw(l);
+  m->resize(l);
+  for (size_t k = 0; k < l; k++) {
+    load(&m->at(k));
+  }
+}
+
+void
+MmapDataFile::load(double *value, const std::string &name)
+{
+  RTensor t;
+  load(&t, name);
+  if (t.size() > 1) {
+    std::cerr << "While reading file " << _filename << " found a tensor of size "
+              << t.size() << " while a single value was expected.";
+    abort();
+  }
+  *value = t[0];
+}
+
+void
+MmapDataFile::load(cdouble *value, const std::string &name)
+{
+  CTensor t;
+  load(&t, name);
+  if (t.size() > 1) {
+    std::cerr << "While reading file " << _filename << " found a tensor of size "
+              << t.size() << " while a single value was expected.";
+    abort();
+  }
+  *value = t[0];
+}
+
+void
+MmapDataFile::load(size_t *v, const std::string &name)
+{
+  double aux;
+  load(&aux, name);
+  *v = (size_t)aux;
+}
+
+void
+MmapDataFile::load(int *v, const std::string &name)
+{
+  double aux;
+  load(&aux, name);
+  *v = (int)aux;
+}
+
+void
+MmapDataFile::read_header()
+{
+  std::string var_name = read_variable_name();
+
+  if (var_name.size() < 6 ||
+      var_name[0] != 's' || var_name[1] != 'd' || var_name[2] != 'f') {
+    std::cerr << "Bogus SDF file" << std::endl
+              << "Wrong header: '" << var_name << "'" << std::endl;
+    abort();
+  }
+  int file_int_size = var_name[3] - '0';
+  int file_long_size = var_name[4] - '0';
+  int file_endianness = var_name[5] - '0';
+  if (file_int_size != sizeof(int) ||
+      file_long_size != sizeof(long) ||
+      file_endianness != endian)
+    {
+      std::cerr << "File " << _filename << " has word sizes (" << file_int_size
+                << ',' << file_long_size << ") and cannot be read by this computer";
+      abort();
+    }
+}
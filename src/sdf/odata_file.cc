@@ -18,21 +18,19 @@
 */
 
 #include <tensor/sdf.h>
+#include <tensor/io.h>
+#include "compression.h"
 
 using namespace sdf;
 
 #if !defined(aix)
 
 template <class number>
-void write_raw_with_endian(std::ofstream &s, const number *data, size_t n)
+void write_raw_with_endian(std::ostream &s, const number *data, size_t n)
 {
   s.write((char *)data, n * sizeof(number));
   if (s.bad()) {
-#ifdef _MSC_VER
     std::cerr << "I/O error when writing to SDF stream";
-#else
-    std::cerr << "I/O error when writing to stream " << s;
-#endif
     abort();
   }
 }
@@ -40,17 +38,13 @@ void write_raw_with_endian(std::ofstream &s, const number *data, size_t n)
 #else
 
 template <class number>
-void write_raw_with_endian(std::ofstream &s, const number *data, size_t n)
+void write_raw_with_endian(std::ostream &s, const number *data, size_t n)
 {
   const int size = sizeof(number);
   if (size == 1) {
     s.write((char *)data, n * sizeof(number));
     if (s.bad()) {
-#ifdef _MSC_VER
       std::cerr << "I/O error when writing to SDF stream";
-#else
-      std::cerr << "I/O error when writing to stream " << s;
-#endif
       abort();
     }
     s.flush();
@@ -87,7 +81,7 @@ void write_raw_with_endian(std::ofstream &s, const number *data, size_t n)
     }
     s.write(buffer, now);
     if (s.bad()) {
-      std::cerr << "I/O error when reading from stream " << s;
+      std::cerr << "I/O error when writing to SDF stream";
       abort();
     }
     s.flush();
@@ -101,9 +95,12 @@ void write_raw_with_endian(std::ofstream &s, const number *data, size_t n)
 //
 
 OutDataFile::OutDataFile(const std::string &a_filename, int flags) :
-  DataFile(a_filename, flags)
+  DataFile(a_filename, flags), _position(0), _initial_size(0), _slices(-1)
 {
   bool existed = file_exists(actual_filename());
+  if (existed) {
+    _initial_size = _position = file_size(actual_filename());
+  }
   _stream.open(actual_filename().c_str(), std::ofstream::app | std::ofstream::binary);
   if (!existed) {
     write_header();
@@ -115,13 +112,72 @@ OutDataFile::~OutDataFile()
   close();
 }
 
+void
+OutDataFile::flush()
+{
+  _stream.flush();
+  if (_stream.bad()) {
+    std::cerr << "I/O error when writing to SDF stream";
+    abort();
+  }
+}
+
 void
 OutDataFile::close()
 {
   if (is_open()) {
+    if (_slices >= 0)
+      end_slices();
     _stream.close();
-    DataFile::close();
+    /* The index must describe the file that is in place. In SDF_PARANOID
+       mode it is written once the new file has replaced the original one;
+       otherwise, before the lock is released. */
+    std::vector<DataFileRecord> records;
+    collect_index(&records);
+    if (_flags == SDF_PARANOID) {
+      if (DataFile::close())
+        write_index_file(index_filename(), _position, records);
+    } else {
+      write_index_file(index_filename(), _position, records);
+      DataFile::close();
+    }
+  }
+}
+
+/*
+ * The index of the file is made of the index of the records that were
+ * already there, which may have to be scanned if the file had no index,
+ * followed by the records that we have written.
+ */
+void
+OutDataFile::collect_index(std::vector<DataFileRecord> *records)
+{
+  size_t indexed = var_name_size;
+  if (_initial_size) {
+    if (!read_index_file(index_filename(), &indexed, records) ||
+        indexed > _initial_size) {
+      records->clear();
+      indexed = var_name_size;
+    }
+    if (indexed < _initial_size) {
+      std::ifstream s(actual_filename().c_str(),
+                      std::ios_base::in | std::ios_base::binary);
+      scan_records(s, indexed, _initial_size, records);
+    }
   }
+  records->insert(records->end(), _new_records.begin(), _new_records.end());
+}
+
+void
+OutDataFile::add_record(const std::string &name, tensor::index tag,
+                        const Indices &dimensions)
+{
+  DataFileRecord r;
+  r.name = name.substr(0, var_name_size - 1);
+  r.tag = tag;
+  r.offset = _position;
+  r.dimensions = dimensions;
+  _new_records.push_back(r);
 }
 
 void
@@ -129,6 +185,7 @@ OutDataFile::write_raw(const char *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, data, n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -136,6 +193,7 @@ OutDataFile::write_raw(const int *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, data, n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -143,6 +201,7 @@ OutDataFile::write_raw(const long *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, data, n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -150,6 +209,7 @@ OutDataFile::write_raw(const size_t *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, data, n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -157,6 +217,7 @@ OutDataFile::write_raw(const double *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, data, n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -164,6 +225,7 @@ OutDataFile::write_raw(const cdouble *data, size_t n)
 {
   assert(is_open());
   write_raw_with_endian(_stream, (double*)data, 2*n);
+  _position += n * sizeof(*data);
 }
 
 void
@@ -173,12 +235,17 @@ OutDataFile::write_variable_name(const std::string &name)
   memset(buffer, 0, var_name_size);
   strncpy(buffer, name.c_str(), std::min<size_t>(var_name_size - 1, name.size()));
   write_raw(buffer, var_name_size);
-  delete buffer;
+  delete[] buffer;
 }
 
 void
 OutDataFile::write_tag(const std::string &name, tensor::index type)
 {
+  if (_slices >= 0) {
+    std::cerr << "Cannot write record " << name << " to file " << _filename
+              << " before the record with slices is completed\n";
+    abort();
+  }
   write_variable_name(name);
   write_raw(type);
 }
@@ -190,30 +257,38 @@ void OutDataFile::dump_vector(const Vector &v)
   write_raw(v.begin(), v.size());
 }
 
-void
-OutDataFile::dump(const RTensor &t, const std::string &name)
+template<class Tensor>
+void OutDataFile::dump_tensor(const Tensor &t, const std::string &name,
+                              tensor::index tag)
 {
-  write_tag(name, TAG_RTENSOR);
+  write_tag(name, tag);
   dump_vector(t.dimensions());
   dump_vector(t);
 }
 
+void
+OutDataFile::dump(const RTensor &t, const std::string &name)
+{
+  add_record(name, TAG_RTENSOR, t.dimensions());
+  dump_tensor(t, name, TAG_RTENSOR);
+}
+
 void
 OutDataFile::dump(const CTensor &t, const std::string &name)
 {
-  write_tag(name, TAG_CTENSOR);
-  dump_vector(t.dimensions());
-  dump_vector(t);
+  add_record(name, TAG_CTENSOR, t.dimensions());
+  dump_tensor(t, name, TAG_CTENSOR);
 }
 
 void
 OutDataFile::dump(const std::vector<RTensor> &m, const std::string &name)
 {
   size_t l = m.size();
+  add_record(name, TAG_RTENSOR_VECTOR, Indices(igen << (tensor::index)l));
   write_tag(name, TAG_RTENSOR_VECTOR);
   write_raw(l);
   for (size_t k = 0; k < l; k++) {
-    dump(m[k]);
+    dump_tensor(m[k], "", TAG_RTENSOR);
   }
 }
 
@@ -221,10 +296,139 @@ void
 OutDataFile::dump(const std::vector<CTensor> &m, const std::string &name)
 {
   size_t l = m.size();
+  add_record(name, TAG_CTENSOR_VECTOR, Indices(igen << (tensor::index)l));
   write_tag(name, TAG_CTENSOR_VECTOR);
   write_raw(l);
   for (size_t k = 0; k < l; k++) {
-    dump(m[k]);
+    dump_tensor(m[k], "", TAG_CTENSOR);
+  }
+}
+
+/*
+ * A compressed record has the usual name, tag and dimensions, followed by
+ * the number of real numbers, the number of them in each chunk, the number
+ * of chunks, the size of each compressed chunk and finally the chunks.
+ */
+void
+OutDataFile::dump_compressed(const double *data, tensor::index n,
+                             const Indices &dimensions, const std::string &name,
+                             tensor::index tag)
+{
+  std::vector<char> buffer;
+  std::vector<size_t> sizes;
+  size_t chunk = compression::CHUNK;
+  compression::pack_chunks(data, n, chunk, &buffer, &sizes);
+  dump_packed(buffer, sizes, chunk, n, dimensions, name, tag);
+}
+
+void
+OutDataFile::dump_packed(const std::vector<char> &buffer,
+                         const std::vector<size_t> &sizes, size_t chunk,
+                         tensor::index n, const Indices &dimensions,
+                         const std::string &name, tensor::index tag)
+{
+  add_record(name, tag, dimensions);
+  write_tag(name, tag);
+  dump_vector(dimensions);
+  write_raw((size_t)n);
+  write_raw(chunk);
+  write_raw(sizes.size());
+  if (sizes.size())
+    write_raw(&sizes[0], sizes.size());
+  size_t stride = compression::max_packed_size(chunk);
+  for (size_t c = 0; c < sizes.size(); c++)
+    write_raw(&buffer[c * stride], sizes[c]);
+}
+
+void
+OutDataFile::dump_compressed(const RTensor &t, const std::string &name)
+{
+  dump_compressed(t.begin(), t.size(), t.dimensions(), name,
+                  TAG_RTENSOR_COMPRESSED);
+}
+
+void
+OutDataFile::dump_compressed(const CTensor &t, const std::string &name)
+{
+  dump_compressed((const double *)t.begin(), 2 * t.size(), t.dimensions(),
+                  name, TAG_CTENSOR_COMPRESSED);
+}
+
+/*
+ * A record written in slices is an ordinary tensor record. Its last
+ * dimension and its size are written as zero and corrected when the record
+ * is completed, from a different stream, because our stream only appends.
+ */
+void
+OutDataFile::begin_slices(const Indices &dimensions, const std::string &name,
+                          bool complex)
+{
+  tensor::index tag = complex? TAG_CTENSOR : TAG_RTENSOR;
+  Indices record_dimensions = dimensions << Indices(igen << 0);
+  add_record(name, tag, record_dimensions);
+  write_tag(name, tag);
+  _slices_header = _position;
+  dump_vector(record_dimensions);
+  write_raw((size_t)0);
+  _slices_tag = tag;
+  _slices_dimensions = dimensions;
+  _slices = 0;
+}
+
+template<class Tensor>
+void OutDataFile::append_slice(const Tensor &t, tensor::index tag)
+{
+  if (_slices < 0 || tag != _slices_tag) {
+    std::cerr << "No record of type " << tag_to_name(tag)
+              << " was started with begin_slices() in file " << _filename
+              << '\n';
+    abort();
+  }
+  if (!all_equal(t.dimensions(), _slices_dimensions)) {
+    std::cerr << "Slice with dimensions " << t.dimensions()
+              << " does not match the record in file " << _filename
+              << ", which expects " << _slices_dimensions << '\n';
+    abort();
+  }
+  write_raw(t.begin_const(), t.size());
+  _slices++;
+}
+
+void
+OutDataFile::append_slice(const RTensor &t)
+{
+  append_slice(t, TAG_RTENSOR);
+}
+
+void
+OutDataFile::append_slice(const CTensor &t)
+{
+  append_slice(t, TAG_CTENSOR);
+}
+
+void
+OutDataFile::end_slices()
+{
+  if (_slices < 0)
+    return;
+  tensor::index rank = _slices_dimensions.size() + 1;
+  tensor::index last = _slices;
+  size_t size = _slices_dimensions.total_size() * _slices;
+  _new_records.back().dimensions.at(rank - 1) = last;
+  _slices = -1;
+  flush();
+  std::fstream s(actual_filename().c_str(),
+                 std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+  if (s.is_open() &&
+      s.seekp(_slices_header + sizeof(size_t) + (rank - 1) * sizeof(tensor::index))) {
+    write_raw_with_endian(s, &last, 1);
+    write_raw_with_endian(s, &size, 1);
+    s.flush();
+  }
+  /* Otherwise the record would look valid but empty. */
+  if (!s.is_open() || !s) {
+    std::cerr << "I/O error when writing to SDF stream";
+    abort();
   }
 }
 
@@ -0,0 +1,178 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <functional>
+#include <tensor/tensor.h>
+#include "simd.h"
+
+namespace tensor {
+namespace simd {
+
+  //////////////////////////////////////////////////////////////////////
+  // PLAIN LOOPS
+  //
+  // These are used with SIMD_NONE and on processors for which we have no
+  // vectorized code.
+  //
+
+  template<class op, typename elt_t>
+  static void loop_vv(op f, elt_t *dest, const elt_t *a, const elt_t *b, index n)
+  {
+    for (index i = 0; i < n; i++) dest[i] = f(a[i], b[i]);
+  }
+
+  template<class op, typename elt_t>
+  static void loop_vs(op f, elt_t *dest, const elt_t *a, elt_t b, index n)
+  {
+    for (index i = 0; i < n; i++) dest[i] = f(a[i], b);
+  }
+
+  template<class op, typename elt_t>
+  static void loop_sv(op f, elt_t *dest, elt_t a, const elt_t *b, index n)
+  {
+    for (index i = 0; i < n; i++) dest[i] = f(a, b[i]);
+  }
+
+#define SIMD_SCALAR_BINOP(name, loop, T1, T2)                           \
+  template<typename elt_t>                                              \
+  static void name(binop_t op, elt_t *dest, T1 a, T2 b, index n)        \
+  {                                                                     \
+    switch (op) {                                                       \
+    case PLUS: loop(std::plus<elt_t>(), dest, a, b, n); break;          \
+    case MINUS: loop(std::minus<elt_t>(), dest, a, b, n); break;        \
+    case TIMES: loop(std::multiplies<elt_t>(), dest, a, b, n); break;   \
+    default: loop(std::divides<elt_t>(), dest, a, b, n);                \
+    }                                                                   \
+  }
+
+  SIMD_SCALAR_BINOP(scalar_binop_vv, loop_vv, const elt_t *, const elt_t *)
+  SIMD_SCALAR_BINOP(scalar_binop_vs, loop_vs, const elt_t *, elt_t)
+  SIMD_SCALAR_BINOP(scalar_binop_sv, loop_sv, elt_t, const elt_t *)
+
+#undef SIMD_SCALAR_BINOP
+
+  template<double f(double)>
+  static void loop_unop(double *dest, const double *a, index n)
+  {
+    for (index i = 0; i < n; i++) dest[i] = f(a[i]);
+  }
+
+  static double abs_d(double x) { return std::abs(x); }
+  static double sqrt_d(double x) { return std::sqrt(x); }
+  static double exp_d(double x) { return std::exp(x); }
+  static double sin_d(double x) { return std::sin(x); }
+  static double cos_d(double x) { return std::cos(x); }
+
+  static void scalar_unop(unop_t op, double *dest, const double *a, index n)
+  {
+    switch (op) {
+    case ABS: loop_unop<abs_d>(dest, a, n); break;
+    case SQRT: loop_unop<sqrt_d>(dest, a, n); break;
+    case EXP: loop_unop<exp_d>(dest, a, n); break;
+    case SIN: loop_unop<sin_d>(dest, a, n); break;
+    default: loop_unop<cos_d>(dest, a, n);
+    }
+  }
+
+  const Kernels scalar_kernels = {
+    scalar_binop_vv<double>,
+    scalar_binop_vs<double>,
+    scalar_binop_sv<double>,
+    scalar_binop_vv<cdouble>,
+    scalar_binop_vs<cdouble>,
+    scalar_binop_sv<cdouble>,
+    scalar_unop
+  };
+
+  //////////////////////////////////////////////////////////////////////
+  // DISPATCH
+  //
+
+  static const Kernels *current_kernels = 0;
+  static SimdLevel current_level = SIMD_NONE;
+
+  static SimdLevel find_max_level()
+  {
+    for (int level = SIMD_AVX512; level > SIMD_NONE; level--) {
+      if (x86_kernels((SimdLevel)level))
+        return (SimdLevel)level;
+    }
+    return SIMD_NONE;
+  }
+
+  const Kernels *kernels()
+  {
+    const Kernels *k = __atomic_load_n(&current_kernels, __ATOMIC_ACQUIRE);
+    if (!k) {
+      set_simd_level(simd_max_level());
+      k = __atomic_load_n(&current_kernels, __ATOMIC_ACQUIRE);
+    }
+    return k;
+  }
+
+} // namespace simd
+
+  SimdLevel simd_max_level()
+  {
+    static SimdLevel max_level = simd::find_max_level();
+    return max_level;
+  }
+
+  SimdLevel simd_level()
+  {
+    simd::kernels();
+    return __atomic_load_n(&simd::current_level, __ATOMIC_ACQUIRE);
+  }
+
+  SimdLevel set_simd_level(SimdLevel level)
+  {
+    if (level > simd_max_level())
+      level = simd_max_level();
+    const simd::Kernels *k = simd::x86_kernels(level);
+    SimdLevel old = __atomic_exchange_n(&simd::current_level, level,
+                                        __ATOMIC_ACQ_REL);
+    const simd::Kernels *old_k =
+      __atomic_exchange_n(&simd::current_kernels,
+                          k? k : &simd::scalar_kernels, __ATOMIC_ACQ_REL);
+    return old_k? old : simd_max_level();
+  }
+
+  const char *simd_level_name(SimdLevel level)
+  {
+    switch (level) {
+    case SIMD_SSE2: return "sse2";
+    case SIMD_AVX2: return "avx2";
+    case SIMD_AVX512: return "avx512";
+    default: return "none";
+    }
+  }
+
+  static RTensor fast_unop(simd::unop_t op, const RTensor &t)
+  {
+    RTensor output(t.dimensions());
+    simd::unop(op, output.begin(), t.begin(), t.size(), true);
+    return output;
+  }
+
+  RTensor fast_exp(const RTensor &t) { return fast_unop(simd::EXP, t); }
+  RTensor fast_sin(const RTensor &t) { return fast_unop(simd::SIN, t); }
+  RTensor fast_cos(const RTensor &t) { return fast_unop(simd::COS, t); }
+
+} // namespace tensor
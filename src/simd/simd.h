@@ -0,0 +1,164 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_SIMD_SIMD_H
+#define TENSOR_SIMD_SIMD_H
+
+#include <tensor/numbers.h>
+#include <tensor/vector.h>
+#include <tensor/simd.h>
+#include "../tools/parallel.h"
+
+//
+// Elementwise kernels on arrays of real and complex numbers. The functions
+// below choose an implementation according to simd_level(). All kernels
+// accept a destination that coincides with one of the arguments.
+//
+// Arithmetic kernels give the same results at all levels, as long as the
+// library is not compiled with flags that fuse products and sums. The
+// vectorized exp(), sin() and cos() differ from the C library by at most two
+// units in the last place, but give the same results at all levels above
+// SIMD_NONE. They are only used when explicitly requested, by fast_exp()
+// and similar functions; otherwise the C library is called at all levels.
+//
+// Large arrays are split among the threads of the library.
+//
+
+namespace tensor {
+namespace simd {
+
+  enum binop_t { PLUS, MINUS, TIMES, DIVIDE };
+  enum unop_t { ABS, SQRT, EXP, SIN, COS };
+
+  /* Table of kernels for one instruction set. */
+  struct Kernels {
+    void (*binop_vv)(binop_t op, double *dest, const double *a, const double *b, index n);
+    void (*binop_vs)(binop_t op, double *dest, const double *a, double b, index n);
+    void (*binop_sv)(binop_t op, double *dest, double a, const double *b, index n);
+    void (*zbinop_vv)(binop_t op, cdouble *dest, const cdouble *a, const cdouble *b, index n);
+    void (*zbinop_vs)(binop_t op, cdouble *dest, const cdouble *a, cdouble b, index n);
+    void (*zbinop_sv)(binop_t op, cdouble *dest, cdouble a, const cdouble *b, index n);
+    void (*unop)(unop_t op, double *dest, const double *a, index n);
+  };
+
+  extern const Kernels scalar_kernels;
+  /* Kernels for the given level, or NULL if this library lacks them. */
+  const Kernels *x86_kernels(SimdLevel level);
+
+  const Kernels *kernels();
+
+  inline const double *advance(const double *p, index i) { return p + i; }
+  inline const cdouble *advance(const cdouble *p, index i) { return p + i; }
+  inline double advance(double x, index) { return x; }
+  inline cdouble advance(cdouble x, index) { return x; }
+
+  template<typename elt_t, typename T1, typename T2>
+  class BinopTask : public parallel::Task {
+  public:
+    typedef void (*kernel_t)(binop_t, elt_t *, T1, T2, index);
+    BinopTask(kernel_t f, binop_t op, elt_t *dest, T1 a, T2 b, index n) :
+      f_(f), op_(op), dest_(dest), a_(a), b_(b), n_(n)
+    {}
+    void run(index c) {
+      index begin = parallel::chunk_begin(c);
+      f_(op_, dest_ + begin, advance(a_, begin), advance(b_, begin),
+         parallel::chunk_end(c, n_) - begin);
+    }
+  private:
+    kernel_t f_;
+    binop_t op_;
+    elt_t *dest_;
+    T1 a_;
+    T2 b_;
+    index n_;
+  };
+
+  template<typename elt_t, typename T1, typename T2>
+  inline void run_binop(void (*f)(binop_t, elt_t *, T1, T2, index),
+                        binop_t op, elt_t *dest, T1 a, T2 b, index n)
+  {
+    if (n <= parallel::CHUNK) {
+      f(op, dest, a, b, n);
+    } else {
+      BinopTask<elt_t,T1,T2> task(f, op, dest, a, b, n);
+      parallel::run_chunks(task, parallel::chunks(n));
+    }
+  }
+
+  class UnopTask : public parallel::Task {
+  public:
+    typedef void (*kernel_t)(unop_t, double *, const double *, index);
+    UnopTask(kernel_t f, unop_t op, double *dest, const double *a, index n) :
+      f_(f), op_(op), dest_(dest), a_(a), n_(n)
+    {}
+    void run(index c) {
+      index begin = parallel::chunk_begin(c);
+      f_(op_, dest_ + begin, a_ + begin, parallel::chunk_end(c, n_) - begin);
+    }
+  private:
+    kernel_t f_;
+    unop_t op_;
+    double *dest_;
+    const double *a_;
+    index n_;
+  };
+
+  /* dest[i] = a[i] op b[i] */
+  inline void binop(binop_t op, double *dest, const double *a, const double *b, index n) {
+    run_binop(kernels()->binop_vv, op, dest, a, b, n);
+  }
+  /* dest[i] = a[i] op b */
+  inline void binop(binop_t op, double *dest, const double *a, double b, index n) {
+    run_binop(kernels()->binop_vs, op, dest, a, b, n);
+  }
+  /* dest[i] = a op b[i] */
+  inline void binop(binop_t op, double *dest, double a, const double *b, index n) {
+    run_binop(kernels()->binop_sv, op, dest, a, b, n);
+  }
+
+  /* dest[i] = a[i] op b[i] */
+  inline void binop(binop_t op, cdouble *dest, const cdouble *a, const cdouble *b, index n) {
+    run_binop(kernels()->zbinop_vv, op, dest, a, b, n);
+  }
+  /* dest[i] = a[i] op b */
+  inline void binop(binop_t op, cdouble *dest, const cdouble *a, cdouble b, index n) {
+    run_binop(kernels()->zbinop_vs, op, dest, a, b, n);
+  }
+  /* dest[i] = a op b[i] */
+  inline void binop(binop_t op, cdouble *dest, cdouble a, const cdouble *b, index n) {
+    run_binop(kernels()->zbinop_sv, op, dest, a, b, n);
+  }
+
+  /* dest[i] = op(a[i]). The transcendental functions use the C library,
+     unless 'fast' asks for the vectorized approximations. */
+  inline void unop(unop_t op, double *dest, const double *a, index n,
+                   bool fast = false) {
+    const Kernels *k = (fast || op == ABS || op == SQRT)? kernels() : &scalar_kernels;
+    if (n <= parallel::CHUNK) {
+      k->unop(op, dest, a, n);
+    } else {
+      UnopTask task(k->unop, op, dest, a, n);
+      parallel::run_chunks(task, parallel::chunks(n));
+    }
+  }
+
+} // namespace simd
+} // namespace tensor
+
+#endif // !TENSOR_SIMD_SIMD_H
@@ -0,0 +1,457 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// Elementwise kernels written with the vector extensions of GCC. This file is
+// included once per instruction set by simd_x86.cc, inside a namespace and
+// with SIMD_BYTES (the size of a vector) and SIMD_SQRT (square root of a
+// vector) defined. Everything here has internal linkage, so that code
+// compiled for one instruction set never replaces that of another one.
+//
+
+typedef double vdouble __attribute__((vector_size(SIMD_BYTES)));
+typedef long long vmask __attribute__((vector_size(SIMD_BYTES)));
+typedef unsigned long long vbits __attribute__((vector_size(SIMD_BYTES)));
+
+static const index width = SIMD_BYTES / sizeof(double);
+
+static inline vdouble load(const double *p)
+{
+  vdouble v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline void store(double *p, vdouble v)
+{
+  memcpy(p, &v, sizeof(v));
+}
+
+static inline vdouble broadcast(double x)
+{
+  vdouble v;
+  for (index i = 0; i < width; i++) v[i] = x;
+  return v;
+}
+
+static inline bool any(vmask m)
+{
+  for (index i = 0; i < width; i++) if (m[i]) return true;
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+// REAL ARITHMETIC
+//
+
+struct vplus {
+  static vdouble apply(vdouble a, vdouble b) { return a + b; }
+  static double apply(double a, double b) { return a + b; }
+};
+
+struct vminus {
+  static vdouble apply(vdouble a, vdouble b) { return a - b; }
+  static double apply(double a, double b) { return a - b; }
+};
+
+struct vtimes {
+  static vdouble apply(vdouble a, vdouble b) { return a * b; }
+  static double apply(double a, double b) { return a * b; }
+};
+
+struct vdivide {
+  static vdouble apply(vdouble a, vdouble b) { return a / b; }
+  static double apply(double a, double b) { return a / b; }
+};
+
+template<class op>
+static void map_vv(double *dest, const double *a, const double *b, index n)
+{
+  index i = 0;
+  for (; i + width <= n; i += width)
+    store(dest + i, op::apply(load(a + i), load(b + i)));
+  for (; i < n; i++)
+    dest[i] = op::apply(a[i], b[i]);
+}
+
+template<class op>
+static void map_vs(double *dest, const double *a, double b, index n)
+{
+  const vdouble vb = broadcast(b);
+  index i = 0;
+  for (; i + width <= n; i += width)
+    store(dest + i, op::apply(load(a + i), vb));
+  for (; i < n; i++)
+    dest[i] = op::apply(a[i], b);
+}
+
+template<class op>
+static void map_sv(double *dest, double a, const double *b, index n)
+{
+  const vdouble va = broadcast(a);
+  index i = 0;
+  for (; i + width <= n; i += width)
+    store(dest + i, op::apply(va, load(b + i)));
+  for (; i < n; i++)
+    dest[i] = op::apply(a, b[i]);
+}
+
+#define SIMD_BINOP(name, map, T1, T2)                                   \
+static void name(binop_t op, double *dest, T1 a, T2 b, index n)         \
+{                                                                       \
+  switch (op) {                                                         \
+  case PLUS: map<vplus>(dest, a, b, n); break;                          \
+  case MINUS: map<vminus>(dest, a, b, n); break;                        \
+  case TIMES: map<vtimes>(dest, a, b, n); break;                        \
+  default: map<vdivide>(dest, a, b, n);                                 \
+  }                                                                     \
+}
+
+SIMD_BINOP(binop_vv, map_vv, const double *, const double *)
+SIMD_BINOP(binop_vs, map_vs, const double *, double)
+SIMD_BINOP(binop_sv, map_sv, double, const double *)
+
+#undef SIMD_BINOP
+
+//////////////////////////////////////////////////////////////////////
+// COMPLEX ARITHMETIC
+//
+// Complex numbers are stored as pairs of real and imaginary parts. Sums and
+// differences are done by the real kernels. For products we reproduce the
+// formula (a*c-b*d, a*d+b*c) used by the compiler, and whenever the result is
+// not a number, we recompute it with the C++ library, which handles
+// infinities in a special way. Divisions are not vectorized: the C++ library
+// uses a scaled algorithm that we must reproduce exactly.
+//
+
+static inline vdouble pairs(cdouble z)
+{
+  vdouble v;
+  for (index i = 0; i < width; i += 2) {
+    v[i] = real(z);
+    v[i+1] = imag(z);
+  }
+  return v;
+}
+
+static inline cdouble zload(const double *p)
+{
+  return cdouble(p[0], p[1]);
+}
+
+static inline void zstore(double *p, cdouble z)
+{
+  p[0] = real(z);
+  p[1] = imag(z);
+}
+
+static inline vdouble ztimes(vdouble a, vdouble b)
+{
+  vmask even, odd, swap;
+  vdouble sign;
+  for (index i = 0; i < width; i += 2) {
+    even[i] = even[i+1] = i;
+    odd[i] = odd[i+1] = i+1;
+    swap[i] = i+1;
+    swap[i+1] = i;
+    sign[i] = -1.0;
+    sign[i+1] = 1.0;
+  }
+  vdouble re = __builtin_shuffle(a, even);
+  vdouble im = __builtin_shuffle(a, odd);
+  return re * b + (im * __builtin_shuffle(b, swap)) * sign;
+}
+
+static inline vmask is_nan(vdouble v)
+{
+  return (vmask)(v != v);
+}
+
+static void ztimes_vv(double *dest, const double *a, const double *b, index n)
+{
+  index i = 0;
+  for (n *= 2; i + width <= n; i += width) {
+    vdouble r = ztimes(load(a + i), load(b + i));
+    if (any(is_nan(r))) {
+      for (index j = i; j < i + width; j += 2)
+        zstore(dest + j, zload(a + j) * zload(b + j));
+    } else {
+      store(dest + i, r);
+    }
+  }
+  for (; i < n; i += 2)
+    zstore(dest + i, zload(a + i) * zload(b + i));
+}
+
+static void ztimes_vs(double *dest, const double *a, cdouble b, index n)
+{
+  const vdouble vb = pairs(b);
+  index i = 0;
+  for (n *= 2; i + width <= n; i += width) {
+    vdouble r = ztimes(load(a + i), vb);
+    if (any(is_nan(r))) {
+      for (index j = i; j < i + width; j += 2)
+        zstore(dest + j, zload(a + j) * b);
+    } else {
+      store(dest + i, r);
+    }
+  }
+  for (; i < n; i += 2)
+    zstore(dest + i, zload(a + i) * b);
+}
+
+template<class op>
+static void zmap_vs(double *dest, const double *a, cdouble b, index n)
+{
+  const vdouble vb = pairs(b);
+  index i = 0;
+  for (n *= 2; i + width <= n; i += width)
+    store(dest + i, op::apply(load(a + i), vb));
+  for (; i < n; i += 2) {
+    dest[i] = op::apply(a[i], real(b));
+    dest[i+1] = op::apply(a[i+1], imag(b));
+  }
+}
+
+template<class op>
+static void zmap_sv(double *dest, cdouble a, const double *b, index n)
+{
+  const vdouble va = pairs(a);
+  index i = 0;
+  for (n *= 2; i + width <= n; i += width)
+    store(dest + i, op::apply(va, load(b + i)));
+  for (; i < n; i += 2) {
+    dest[i] = op::apply(real(a), b[i]);
+    dest[i+1] = op::apply(imag(a), b[i+1]);
+  }
+}
+
+static void zbinop_vv(binop_t op, cdouble *dest, const cdouble *a,
+                      const cdouble *b, index n)
+{
+  double *d = reinterpret_cast<double*>(dest);
+  const double *pa = reinterpret_cast<const double*>(a);
+  const double *pb = reinterpret_cast<const double*>(b);
+  switch (op) {
+  case TIMES: ztimes_vv(d, pa, pb, n); break;
+  case DIVIDE:
+    for (index i = 0; i < n; i++) dest[i] = a[i] / b[i];
+    break;
+  default: binop_vv(op, d, pa, pb, 2*n);
+  }
+}
+
+static void zbinop_vs(binop_t op, cdouble *dest, const cdouble *a,
+                      cdouble b, index n)
+{
+  double *d = reinterpret_cast<double*>(dest);
+  const double *pa = reinterpret_cast<const double*>(a);
+  switch (op) {
+  case PLUS: zmap_vs<vplus>(d, pa, b, n); break;
+  case MINUS: zmap_vs<vminus>(d, pa, b, n); break;
+  case TIMES: ztimes_vs(d, pa, b, n); break;
+  default:
+    for (index i = 0; i < n; i++) dest[i] = a[i] / b;
+  }
+}
+
+static void zbinop_sv(binop_t op, cdouble *dest, cdouble a,
+                      const cdouble *b, index n)
+{
+  double *d = reinterpret_cast<double*>(dest);
+  const double *pb = reinterpret_cast<const double*>(b);
+  switch (op) {
+  case PLUS: zmap_sv<vplus>(d, a, pb, n); break;
+  case MINUS: zmap_sv<vminus>(d, a, pb, n); break;
+  case TIMES: ztimes_vs(d, pb, a, n); break;
+  default:
+    for (index i = 0; i < n; i++) dest[i] = a / b[i];
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// MATHEMATICAL FUNCTIONS
+//
+// exp(), sin() and cos() reduce the argument with a multiple of log(2) or
+// pi/2 and evaluate polynomials in the remainder, using the constants of
+// FDLIBM. Arguments that are too large, infinite or not a number are
+// passed to the C library.
+//
+
+static inline vdouble vabs(vdouble x)
+{
+  vbits mask;
+  for (index i = 0; i < width; i++) mask[i] = ~(1ULL << 63);
+  return (vdouble)((vbits)x & mask);
+}
+
+/* x + 1.5*2^52 rounds x to an integer, which is stored in the lowest bits
+   of the mantissa. */
+static const double round_magic = 6755399441055744.0;
+
+static inline vdouble vexp(vdouble x)
+{
+  const double log2e = 1.44269504088896338700e+00;
+  const double ln2_hi = 6.93147180369123816490e-01;
+  const double ln2_lo = 1.90821492927058770002e-10;
+  vdouble t = x * log2e + round_magic;
+  vdouble k = t - round_magic;
+  vdouble r = (x - k * ln2_hi) - k * ln2_lo;
+  vdouble p = broadcast(1.0/6227020800.0);
+  p = p * r + 1.0/479001600.0;
+  p = p * r + 1.0/39916800.0;
+  p = p * r + 1.0/3628800.0;
+  p = p * r + 1.0/362880.0;
+  p = p * r + 1.0/40320.0;
+  p = p * r + 1.0/5040.0;
+  p = p * r + 1.0/720.0;
+  p = p * r + 1.0/120.0;
+  p = p * r + 1.0/24.0;
+  p = p * r + 1.0/6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+  // 2^k is built directly from its exponent bits
+  vbits e = (vbits)t - (vbits)broadcast(round_magic);
+  return p * (vdouble)((e + 1023) << 52);
+}
+
+static inline void vsincos(vdouble x, vdouble *s, vdouble *c)
+{
+  const double two_over_pi = 6.36619772367581382433e-01;
+  const double pio2_1 = 1.57079632673412561417e+00;
+  const double pio2_2 = 6.07710050630396597660e-11;
+  const double pio2_2t = 2.02226624879595063154e-21;
+  const double S1 = -1.66666666666666324348e-01;
+  const double S2 = 8.33333333332248946124e-03;
+  const double S3 = -1.98412698298579493134e-04;
+  const double S4 = 2.75573137070700676789e-06;
+  const double S5 = -2.50507602534068634195e-08;
+  const double S6 = 1.58969099521155010221e-10;
+  const double C1 = 4.16666666666666019037e-02;
+  const double C2 = -1.38888888888741095749e-03;
+  const double C3 = 2.48015872894767294178e-05;
+  const double C4 = -2.75573143513906633035e-07;
+  const double C5 = 2.08757232129817482790e-09;
+  const double C6 = -1.13596475577881948265e-11;
+  // x = k * pi/2 + r, with |r| <= pi/4
+  vdouble t = x * two_over_pi + round_magic;
+  vdouble k = t - round_magic;
+  vbits q = (vbits)t - (vbits)broadcast(round_magic);
+  vdouble r = ((x - k * pio2_1) - k * pio2_2) - k * pio2_2t;
+  vdouble z = r * r;
+  vdouble ps = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+  vdouble sr = r + (z * r) * (S1 + z * ps);
+  sr = (vmask)(vabs(r) < 7.450580596923828125e-9) ? r : sr;
+  vdouble pc = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+  vdouble hz = 0.5 * z;
+  vdouble w = 1.0 - hz;
+  vdouble cr = w + (((1.0 - w) - hz) + z * pc);
+  // Choose sin(r), cos(r), -sin(r) or -cos(r) depending on the quadrant
+  vmask odd = (vmask)((q & 1) != 0);
+  *s = (vdouble)((vbits)(odd ? cr : sr) ^ ((q & 2) << 62));
+  *c = (vdouble)((vbits)(odd ? sr : cr) ^ (((q + 1) & 2) << 62));
+}
+
+/* Lanes with |x| > limit or x not a number. */
+static inline vmask outside(vdouble x, double limit)
+{
+  vmask inside = (vmask)(vabs(x) <= limit);
+  return (vmask)(inside == 0);
+}
+
+struct vabs_op {
+  static vdouble apply(vdouble x) { return vabs(x); }
+};
+
+struct vsqrt_op {
+  static vdouble apply(vdouble x) { return SIMD_SQRT(x); }
+};
+
+struct vexp_op {
+  static vdouble apply(vdouble x) {
+    vdouble y = vexp(x);
+    vmask bad = outside(x, 708.0);
+    if (any(bad)) {
+      for (index i = 0; i < width; i++)
+        if (bad[i]) y[i] = std::exp(x[i]);
+    }
+    return y;
+  }
+};
+
+struct vsin_op {
+  static vdouble apply(vdouble x) {
+    vdouble s, c;
+    vsincos(x, &s, &c);
+    vmask bad = outside(x, 1e5);
+    if (any(bad)) {
+      for (index i = 0; i < width; i++)
+        if (bad[i]) s[i] = std::sin(x[i]);
+    }
+    return s;
+  }
+};
+
+struct vcos_op {
+  static vdouble apply(vdouble x) {
+    vdouble s, c;
+    vsincos(x, &s, &c);
+    vmask bad = outside(x, 1e5);
+    if (any(bad)) {
+      for (index i = 0; i < width; i++)
+        if (bad[i]) c[i] = std::cos(x[i]);
+    }
+    return c;
+  }
+};
+
+/* The last elements are copied to a padded buffer, so that they get the same
+   treatment as the others. */
+template<class op>
+static void map_unop(double *dest, const double *a, index n)
+{
+  index i = 0;
+  for (; i + width <= n; i += width)
+    store(dest + i, op::apply(load(a + i)));
+  if (i < n) {
+    double buffer[width];
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, a + i, (n - i) * sizeof(double));
+    store(buffer, op::apply(load(buffer)));
+    memcpy(dest + i, buffer, (n - i) * sizeof(double));
+  }
+}
+
+static void unop(unop_t op, double *dest, const double *a, index n)
+{
+  switch (op) {
+  case ABS: map_unop<vabs_op>(dest, a, n); break;
+  case SQRT: map_unop<vsqrt_op>(dest, a, n); break;
+  case EXP: map_unop<vexp_op>(dest, a, n); break;
+  case SIN: map_unop<vsin_op>(dest, a, n); break;
+  default: map_unop<vcos_op>(dest, a, n);
+  }
+}
+
+static const Kernels kernels = {
+  binop_vv, binop_vs, binop_sv,
+  zbinop_vv, zbinop_vs, zbinop_sv,
+  unop
+};
@@ -0,0 +1,105 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <cstring>
+#include "simd.h"
+
+//
+// The kernels for all instruction sets are compiled in this file, each one
+// with its own target options, so that the library runs on any processor and
+// chooses the best kernels when it starts. Contraction of products and sums
+// into FMA instructions is disabled, so that all kernels round the same way.
+//
+#if defined(__GNUC__) && !defined(__clang__) && \
+  (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+namespace tensor {
+namespace simd {
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#pragma GCC optimize("fp-contract=off")
+namespace sse2 {
+#define SIMD_BYTES 16
+#define SIMD_SQRT _mm_sqrt_pd
+#include "simd_kernels.hpp"
+#undef SIMD_SQRT
+#undef SIMD_BYTES
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("fp-contract=off")
+namespace avx2 {
+#define SIMD_BYTES 32
+#define SIMD_SQRT _mm256_sqrt_pd
+#include "simd_kernels.hpp"
+#undef SIMD_SQRT
+#undef SIMD_BYTES
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+namespace avx512 {
+#define SIMD_BYTES 64
+#define SIMD_SQRT(x) _mm512_maskz_sqrt_pd(0xFF, x)
+#include "simd_kernels.hpp"
+#undef SIMD_SQRT
+#undef SIMD_BYTES
+}
+#pragma GCC pop_options
+
+  const Kernels *x86_kernels(SimdLevel level)
+  {
+    __builtin_cpu_init();
+    switch (level) {
+    case SIMD_SSE2:
+      return __builtin_cpu_supports("sse2")? &sse2::kernels : 0;
+    case SIMD_AVX2:
+      return __builtin_cpu_supports("avx2")? &avx2::kernels : 0;
+    case SIMD_AVX512:
+      return __builtin_cpu_supports("avx512f")? &avx512::kernels : 0;
+    default:
+      return 0;
+    }
+  }
+
+} // namespace simd
+} // namespace tensor
+
+#else // !__GNUC__ || !x86
+
+namespace tensor {
+namespace simd {
+
+  const Kernels *x86_kernels(SimdLevel level)
+  {
+    return 0;
+  }
+
+} // namespace simd
+} // namespace tensor
+
+#endif
@@ -0,0 +1,275 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <tensor/sparse.h>
+#include "../tools/parallel.h"
+
+namespace tensor {
+
+  //////////////////////////////////////////////////////////////////////
+  // PRODUCT OF SPARSE MATRICES
+  //
+  // Gustavson's algorithm: row i of A*B is the combination of the rows of B
+  // selected by the nonzero elements of row i of A. A symbolic pass counts
+  // the elements of each row of the output, and a numeric pass writes them
+  // at their final position. The rows are split into blocks with similar
+  // amounts of work, which are processed by the threads of the library.
+  //
+
+  /* Work per block, in multiply-adds. */
+  const index SPARSE_PRODUCT_GRAIN = parallel::CHUNK;
+
+  /* Collects the elements of one row of the output, either in an array with
+     one slot per column or, for matrices with many columns, in a hash table
+     sized for the longest row of the block. */
+  template<typename elt_t>
+  class SparseAccumulator {
+  public:
+    SparseAccumulator(index columns, index max_row_flops, bool dense) :
+      dense_(dense), fresh_(false), mask_(0), shift_(64)
+    {
+      index size = columns;
+      if (!dense) {
+        for (size = 16, shift_ = 60; size < 2 * max_row_flops; size *= 2)
+          shift_--;
+        mask_ = size - 1;
+      }
+      keys_.assign(size, -1);
+      values_.resize(size);
+    }
+
+    /* Number of different columns in the row. */
+    index size() const { return touched_.size(); }
+
+    void insert(index column) {
+      slot(column);
+    }
+
+    void add(index column, const elt_t &value) {
+      index s = slot(column);
+      if (fresh_) {
+        values_[s] = value;
+      } else {
+        values_[s] += value;
+      }
+    }
+
+    /* Write the nonzero elements of the row, sorted by column, and reset
+       the accumulator for the next row. Returns the number of elements. */
+    index flush(index *column, elt_t *data) {
+      if (dense_)
+        std::sort(touched_.begin(), touched_.end());
+      else
+        std::sort(touched_.begin(), touched_.end(), ByKey(&keys_[0]));
+      index n = 0;
+      for (std::vector<index>::const_iterator it = touched_.begin();
+           it != touched_.end(); ++it) {
+        const elt_t &v = values_[*it];
+        if (!(v == number_zero<elt_t>())) {
+          column[n] = keys_[*it];
+          data[n] = v;
+          n++;
+        }
+      }
+      clear();
+      return n;
+    }
+
+    void clear() {
+      for (std::vector<index>::const_iterator it = touched_.begin();
+           it != touched_.end(); ++it)
+        keys_[*it] = -1;
+      touched_.clear();
+    }
+
+  private:
+    struct ByKey {
+      const index *keys;
+      ByKey(const index *k) : keys(k) {}
+      bool operator()(index a, index b) const { return keys[a] < keys[b]; }
+    };
+
+    index slot(index column) {
+      index s = column;
+      if (!dense_) {
+        s = (index)(((unsigned long)column * 0x9E3779B97F4A7C15UL) >> shift_);
+        while (keys_[s] != column && keys_[s] != -1)
+          s = (s + 1) & mask_;
+      }
+      fresh_ = (keys_[s] == -1);
+      if (fresh_) {
+        keys_[s] = column;
+        touched_.push_back(s);
+      }
+      return s;
+    }
+
+    bool dense_, fresh_;
+    index mask_;
+    int shift_;
+    std::vector<index> keys_, touched_;
+    std::vector<elt_t> values_;
+  };
+
+  template<typename elt_t>
+  class SparseProductTask : public parallel::Task {
+  public:
+    SparseProductTask(const Sparse<elt_t> &A, const Sparse<elt_t> &B,
+                      const std::vector<index> &blocks,
+                      const std::vector<index> &flops,
+                      index *row_length) :
+      A_(A), B_(B), blocks_(blocks), flops_(flops), row_length_(row_length),
+      row_start_(0), column_(0), data_(0)
+    {}
+
+    /* Switch to the numeric pass, which writes row i at row_start[i]. */
+    void numeric(const index *row_start, index *column, elt_t *data) {
+      row_start_ = row_start;
+      column_ = column;
+      data_ = data;
+    }
+
+    void run(index c) {
+      const index *a_start = A_.priv_row_start().begin_const();
+      const index *a_column = A_.priv_column().begin_const();
+      const elt_t *a_data = A_.priv_data().begin_const();
+      const index *b_start = B_.priv_row_start().begin_const();
+      const index *b_column = B_.priv_column().begin_const();
+      const elt_t *b_data = B_.priv_data().begin_const();
+
+      index begin = blocks_[c], end = blocks_[c+1];
+      index block_flops = 0, max_row_flops = 0;
+      for (index i = begin; i < end; i++) {
+        block_flops += flops_[i];
+        max_row_flops = std::max(max_row_flops, flops_[i]);
+      }
+      SparseAccumulator<elt_t> accumulator(B_.columns(), max_row_flops,
+                                           B_.columns() <= 2 * block_flops);
+      for (index i = begin; i < end; i++) {
+        if (!data_) {
+          for (index p = a_start[i]; p < a_start[i+1]; p++) {
+            index k = a_column[p];
+            for (index q = b_start[k]; q < b_start[k+1]; q++)
+              accumulator.insert(b_column[q]);
+          }
+          row_length_[i] = accumulator.size();
+          accumulator.clear();
+        } else {
+          for (index p = a_start[i]; p < a_start[i+1]; p++) {
+            index k = a_column[p];
+            elt_t a = a_data[p];
+            for (index q = b_start[k]; q < b_start[k+1]; q++)
+              accumulator.add(b_column[q], a * b_data[q]);
+          }
+          row_length_[i] = accumulator.flush(column_ + row_start_[i],
+                                             data_ + row_start_[i]);
+        }
+      }
+    }
+
+  private:
+    const Sparse<elt_t> &A_, &B_;
+    const std::vector<index> &blocks_, &flops_;
+    index *row_length_;
+    const index *row_start_;
+    index *column_;
+    elt_t *data_;
+  };
+
+  template<typename elt_t>
+  static const Sparse<elt_t>
+  do_mmult(const Sparse<elt_t> &A, const Sparse<elt_t> &B)
+  {
+    if (A.columns() != B.rows()) {
+      std::cerr <<
+        "In mmult(A,B), the number of columns of sparse matrix A does not\n"
+        "match the number of rows of sparse matrix B.";
+      abort();
+    }
+    index rows = A.rows(), cols = B.columns();
+    if (A.length() == 0 || B.length() == 0 || cols == 0)
+      return Sparse<elt_t>(rows, cols);
+
+    // Work in each row, and blocks of rows with similar work.
+    const index *a_start = A.priv_row_start().begin_const();
+    const index *a_column = A.priv_column().begin_const();
+    const index *b_start = B.priv_row_start().begin_const();
+    std::vector<index> flops(rows), blocks(1, 0);
+    index work = 0;
+    for (index i = 0; i < rows; i++) {
+      index f = 0;
+      for (index p = a_start[i]; p < a_start[i+1]; p++)
+        f += b_start[a_column[p]+1] - b_start[a_column[p]];
+      flops[i] = f;
+      work += f + 1;
+      if (work >= SPARSE_PRODUCT_GRAIN) {
+        blocks.push_back(i+1);
+        work = 0;
+      }
+    }
+    if (blocks.back() != rows)
+      blocks.push_back(rows);
+    index nblocks = blocks.size() - 1;
+
+    // Symbolic pass: upper bound to the length of each row.
+    std::vector<index> length(rows);
+    SparseProductTask<elt_t> task(A, B, blocks, flops, &length[0]);
+    parallel::run_chunks(task, nblocks);
+
+    Indices row_start(rows+1);
+    row_start.at(0) = 0;
+    for (index i = 0; i < rows; i++)
+      row_start.at(i+1) = row_start[i] + length[i];
+    index bound = row_start[rows];
+    if (bound == 0)
+      return Sparse<elt_t>(rows, cols);
+
+    // Numeric pass, which drops the elements that cancel.
+    Indices column(bound);
+    Tensor<elt_t> data(bound);
+    task.numeric(row_start.begin_const(), column.begin(), data.begin());
+    parallel::run_chunks(task, nblocks);
+
+    index nonzero = 0;
+    for (index i = 0; i < rows; i++)
+      nonzero += length[i];
+    if (nonzero < bound) {
+      Indices the_column(nonzero);
+      Tensor<elt_t> the_data(nonzero);
+      index *c = the_column.begin();
+      elt_t *d = the_data.begin();
+      for (index i = 0, out = 0; i < rows; i++) {
+        const index *c0 = column.begin_const() + row_start[i];
+        const elt_t *d0 = data.begin_const() + row_start[i];
+        std::copy(c0, c0 + length[i], c + out);
+        std::copy(d0, d0 + length[i], d + out);
+        row_start.at(i) = out;
+        out += length[i];
+      }
+      row_start.at(rows) = nonzero;
+      column = the_column;
+      data = the_data;
+    }
+    return Sparse<elt_t>(igen << rows << cols, row_start, column, data);
+  }
+
+} // namespace tensor
@@ -23,56 +23,180 @@
 //////////////////////////////////////////////////////////////////////
 // RAW ROUTINES FOR THE SPARSE-TENSOR PRODUCT
 //
+// dest(i,l) = matrix(i,j) vector(j,l), computed for the rows i0 <= i < i1.
+// A single vector is multiplied row by row. Several vectors are first copied
+// into panels of up to SPARSE_PANEL columns that are stored row by row, so
+// that each nonzero element of the matrix multiplies a few contiguous
+// numbers. Each output is summed in the same order in both cases, and
+// independently of how the rows are split among threads.
+//
+
+static const index SPARSE_PANEL = 8;
 
 template<typename elt_t>
 static void
-mult_sp_t(elt_t *dest,
+mult_sp_v(elt_t *dest,
 	  const index *row_start, const index *column, const elt_t *matrix,
-	  const elt_t *vector,
-	  index i_len, index j_len, index k_len, index l_len)
+	  const elt_t *vector, index i0, index i1)
 {
-    if (k_len == 1) {
-#if 0
-	// dest(i,l) = matrix(i,j) vector(j,l)
-	for (; l_len; l_len--, vector+=j_len) {
-	    for (index i = 0; i < i_len; i++) {
-		elt_t accum = *dest;
-		for (index j = row_start[i]; j < row_start[i+1]; j++) {
-		    accum += matrix[j] * vector[column[j]];
-		}
-		*(dest++) = accum;
-	    }
+    for (index i = i0; i < i1; i++) {
+	elt_t accum = number_zero<elt_t>();
+	for (index x = row_start[i]; x < row_start[i+1]; x++) {
+	    accum += matrix[x] * vector[column[x]];
+	}
+	dest[i] = accum;
+    }
+}
+
+template<typename elt_t, int W>
+static void
+mult_sp_panel(elt_t *dest, index i_len, index width,
+	      const index *row_start, const index *column, const elt_t *matrix,
+	      const elt_t *panel, index i0, index i1)
+{
+    for (index i = i0; i < i1; i++) {
+	elt_t accum[W];
+	for (int t = 0; t < W; t++) {
+	    accum[t] = number_zero<elt_t>();
 	}
-#else
-	for (; l_len; l_len--, vector+=j_len) {
-	    const elt_t *m = matrix;
-	    const index *c = column;
-	    for (index i = 0; i < i_len; i++) {
-		elt_t accum = *dest;
-		for (index j = row_start[i+1] - row_start[i]; j; j--) {
-		    accum += *(m++) * vector[*(c++)];
-		}
-		*(dest++) = accum;
+	for (index x = row_start[i]; x < row_start[i+1]; x++) {
+	    const elt_t m = matrix[x];
+	    const elt_t *p = panel + column[x] * W;
+	    for (int t = 0; t < W; t++) {
+		accum[t] += m * p[t];
 	    }
 	}
-#endif
-    } else {
-	// dest(i,k,l) = matrix(i,j) vector(k,j,l)
-	for (index l = 0; l < l_len; l++) {
-	    const elt_t *v = vector + l*(k_len*j_len);
-	    for (index k = 0; k < k_len; k++, v++) {
-		for (index i = 0; i < i_len; i++) {
-		    elt_t accum = *dest;
-		    for (index j = row_start[i]; j < row_start[i+1]; j++) {
-			accum += matrix[j] * v[column[j] * k_len];
-		    }
-		    *(dest++) = accum;
-		}
+	for (index t = 0; t < width; t++) {
+	    dest[i + t * i_len] = accum[t];
+	}
+    }
+}
+
+/* Columns in the panel that starts at column l0: SPARSE_PANEL, or the
+   smallest power of two that fits the remaining columns. */
+static inline index
+sparse_panel_width(index l0, index l_len)
+{
+    index w = 2;
+    while (w < SPARSE_PANEL && w < l_len - l0)
+	w *= 2;
+    return w;
+}
+
+/* Copies rows j0 <= j < j1 of vector(j,l) into the panels, padding the last
+   one with zeros. */
+template<typename elt_t>
+static void
+pack_sp_panels(elt_t *panels, const elt_t *vector, index j_len, index l_len,
+	       index j0, index j1)
+{
+    for (index l0 = 0; l0 < l_len; l0 += SPARSE_PANEL) {
+	elt_t *p = panels + l0 * j_len;
+	index W = sparse_panel_width(l0, l_len);
+	index width = std::min(W, l_len - l0);
+	for (index j = j0; j < j1; j++) {
+	    const elt_t *v = vector + l0 * j_len + j;
+	    for (index t = 0; t < width; t++, v += j_len) {
+		p[j * W + t] = *v;
+	    }
+	    for (index t = width; t < W; t++) {
+		p[j * W + t] = number_zero<elt_t>();
 	    }
 	}
     }
 }
 
+//////////////////////////////////////////////////////////////////////
+// PARALLELIZATION
+//
+// The rows of the matrix are split into blocks with similar numbers of
+// nonzero elements (plus one per row, for the rows that are empty). The
+// blocks depend only on the matrix and the number of vectors.
+//
+
+static std::vector<index>
+sparse_row_blocks(const index *row_start, index rows, index l_len)
+{
+    index total = row_start[rows] + rows;
+    index nblocks = std::max<index>(1, std::min(rows, total * l_len / parallel::CHUNK));
+    std::vector<index> blocks(nblocks + 1);
+    blocks[0] = 0;
+    for (index b = 1; b < nblocks; b++) {
+	// First row i with row_start[i] + i >= b * total / nblocks
+	index target = b * (total / nblocks), lo = blocks[b-1], hi = rows;
+	while (lo < hi) {
+	    index mid = lo + (hi - lo) / 2;
+	    if (row_start[mid] + mid < target)
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	blocks[b] = lo;
+    }
+    blocks[nblocks] = rows;
+    return blocks;
+}
+
+template<typename elt_t>
+class PackPanelsTask : public parallel::Task {
+public:
+    PackPanelsTask(elt_t *panels, const elt_t *vector, index j_len, index l_len) :
+	panels_(panels), vector_(vector), j_len_(j_len), l_len_(l_len)
+    {}
+    void run(index c) {
+	pack_sp_panels(panels_, vector_, j_len_, l_len_,
+		       parallel::chunk_begin(c), parallel::chunk_end(c, j_len_));
+    }
+private:
+    elt_t *panels_;
+    const elt_t *vector_;
+    index j_len_, l_len_;
+};
+
+template<typename elt_t>
+class SparseTensorTask : public parallel::Task {
+public:
+    SparseTensorTask(elt_t *dest, const Sparse<elt_t> &m, const elt_t *vector,
+		     index l_len, const std::vector<index> &blocks) :
+	dest_(dest), row_start_(m.priv_row_start().begin_const()),
+	column_(m.priv_column().begin_const()),
+	matrix_(m.priv_data().begin_const()),
+	vector_(vector), i_len_(m.rows()), j_len_(m.columns()), l_len_(l_len),
+	blocks_(blocks)
+    {}
+    void run(index b) {
+	index i0 = blocks_[b], i1 = blocks_[b+1];
+	if (l_len_ == 1) {
+	    mult_sp_v(dest_, row_start_, column_, matrix_, vector_, i0, i1);
+	    return;
+	}
+	for (index l0 = 0; l0 < l_len_; l0 += SPARSE_PANEL) {
+	    elt_t *d = dest_ + l0 * i_len_;
+	    const elt_t *p = vector_ + l0 * j_len_;
+	    index width = std::min(SPARSE_PANEL, l_len_ - l0);
+	    switch (sparse_panel_width(l0, l_len_)) {
+	    case 2:
+		mult_sp_panel<elt_t,2>(d, i_len_, width, row_start_, column_,
+				       matrix_, p, i0, i1);
+		break;
+	    case 4:
+		mult_sp_panel<elt_t,4>(d, i_len_, width, row_start_, column_,
+				       matrix_, p, i0, i1);
+		break;
+	    default:
+		mult_sp_panel<elt_t,SPARSE_PANEL>(d, i_len_, width, row_start_,
+						  column_, matrix_, p, i0, i1);
+	    }
+	}
+    }
+private:
+    elt_t *dest_;
+    const index *row_start_, *column_;
+    const elt_t *matrix_, *vector_;
+    index i_len_, j_len_, l_len_;
+    const std::vector<index> &blocks_;
+};
+
 //////////////////////////////////////////////////////////////////////
 // HIGHER LEVEL INTERFACE
 //
@@ -97,13 +221,24 @@ do_mmult(const Sparse<elt_t> &m1, const Tensor<elt_t> &m2)
 	abort();
     }
 
-    Tensor<elt_t> output = Tensor<elt_t>::zeros(dims);
+    if (i_len == 0 || l_len == 0 || j_len == 0) {
+	return Tensor<elt_t>::zeros(dims);
+    }
 
-    mult_sp_t<elt_t>(output.begin(),
-                     m1.priv_row_start().begin(), m1.priv_column().begin(),
-                     m1.priv_data().begin(),
-                     m2.begin(),
-                     i_len, j_len, 1, l_len);
+    Tensor<elt_t> output(dims);
+    const elt_t *vector = m2.begin_const();
+    Tensor<elt_t> panels;
+    if (l_len > 1) {
+	index npanels = (l_len + SPARSE_PANEL - 1) / SPARSE_PANEL;
+	panels = Tensor<elt_t>(npanels * SPARSE_PANEL * j_len);
+	PackPanelsTask<elt_t> pack(panels.begin(), vector, j_len, l_len);
+	parallel::run_chunks(pack, parallel::chunks(j_len));
+	vector = panels.begin_const();
+    }
+    std::vector<index> blocks =
+	sparse_row_blocks(m1.priv_row_start().begin_const(), i_len, l_len);
+    SparseTensorTask<elt_t> task(output.begin(), m1, vector, l_len, blocks);
+    parallel::run_chunks(task, blocks.size() - 1);
 
     return output;
 }
@@ -23,31 +23,59 @@
 //////////////////////////////////////////////////////////////////////
 // RAW ROUTINE FOR THE TENSOR-SPARSE PRODUCT
 //
+// dest(i,l) += vector(i,j) matrix(j,l), computed for i0 <= i < i1 and
+// l0 <= l < l1. Each nonzero element of the matrix updates a contiguous
+// range of the output. Different ranges of i, or of l when there are too
+// few values of i, are independent and are given to different threads.
+// The columns in each row of the matrix are sorted, so that the elements
+// with l0 <= l < l1 are found by bisection.
+//
 
 template<typename elt_t>
 static void
 mult_t_sp(elt_t *dest,
 	  const elt_t *vector,
 	  const index *row_start, const index *column, const elt_t *matrix,
-	  index i_len, index j_len, index k_len, index l_len)
+	  index i_len, index j_len, index i0, index i1, index l0, index l1)
 {
-    // dest(i,k,l) = vector(i,j,k) matrix(j,l)
     for (index j = 0; j < j_len; j++, vector += i_len) {
-	for (index x = row_start[j]; x < row_start[j+1]; x++) {
-	    index l = column[x];
-	    elt_t *d = dest + l * (k_len*i_len);
-	    const elt_t *v = vector;
-	    elt_t m = matrix[x];
-	    for (index k = 0; k < k_len; k++) {
-		for (index i = 0; i < i_len; i++, d++) {
-		    *d += *(v++) * m;
-		}
-		v += (j_len-1)*i_len;
+	const index *c = column + row_start[j], *end = column + row_start[j+1];
+	if (l0)
+	    c = std::lower_bound(c, end, l0);
+	for (; c < end && *c < l1; c++) {
+	    elt_t *d = dest + *c * i_len;
+	    const elt_t m = matrix[c - column];
+	    for (index i = i0; i < i1; i++) {
+		d[i] += vector[i] * m;
 	    }
 	}
     }
 }
 
+template<typename elt_t>
+class TensorSparseTask : public parallel::Task {
+public:
+    TensorSparseTask(elt_t *dest, const elt_t *vector, const Sparse<elt_t> &m,
+		     index i_len, index i_blocks, index l_blocks) :
+	dest_(dest), vector_(vector), row_start_(m.priv_row_start().begin_const()),
+	column_(m.priv_column().begin_const()), matrix_(m.priv_data().begin_const()),
+	i_len_(i_len), j_len_(m.rows()), l_len_(m.columns()),
+	i_blocks_(i_blocks), l_blocks_(l_blocks)
+    {}
+    void run(index b) {
+	index bi = b % i_blocks_, bl = b / i_blocks_;
+	mult_t_sp(dest_, vector_, row_start_, column_, matrix_, i_len_, j_len_,
+		  bi * i_len_ / i_blocks_, (bi + 1) * i_len_ / i_blocks_,
+		  bl * l_len_ / l_blocks_, (bl + 1) * l_len_ / l_blocks_);
+    }
+private:
+    elt_t *dest_;
+    const elt_t *vector_;
+    const index *row_start_, *column_;
+    const elt_t *matrix_;
+    index i_len_, j_len_, l_len_, i_blocks_, l_blocks_;
+};
+
 //////////////////////////////////////////////////////////////////////
 // HIGHER LEVEL INTERFACE
 //
@@ -63,8 +91,8 @@ do_mmult(const Tensor<elt_t> &m1, const Sparse<elt_t> &m2)
 	dims.at(k) = m1.dimension(k);
 	i_len *= dims[k];
     }
-    index j_len = m1.dimension(-1);
-    index l_len = dims.at(N-1) = m2.columns();
+    index j_len = m1.dimension(N-1);
+    dims.at(N-1) = m2.columns();
 
     if (j_len != m2.rows()) {
 	std::cerr <<
@@ -75,11 +103,20 @@ do_mmult(const Tensor<elt_t> &m1, const Sparse<elt_t> &m2)
 
     Tensor<elt_t> output = Tensor<elt_t>::zeros(dims);
 
-    mult_t_sp<elt_t>(output.begin(),
-                     m1.begin(),
-                     m2.priv_row_start().begin(),
-                     m2.priv_column().begin(), m2.priv_data().begin(),
-                     i_len, j_len, 1, l_len);
+    // Blocks of about parallel::CHUNK updates each, made of ranges of at
+    // least 64 elements of i. When i is too short, as in vector-matrix
+    // products, the columns of the output are split instead. Every block
+    // of columns has to walk all rows of the matrix, so there are no more
+    // blocks than nonzero elements per row.
+    index work = (m2.length() + j_len) * i_len;
+    index nblocks = std::max<index>(1, work / parallel::CHUNK);
+    index i_blocks = std::max<index>(1, std::min(i_len / 64, nblocks));
+    index l_blocks = std::max<index>(1, std::min(nblocks / i_blocks,
+						 m2.length() / std::max<index>(1, j_len)));
+    l_blocks = std::min(l_blocks, std::max<index>(1, m2.columns()));
+    TensorSparseTask<elt_t> task(output.begin(), m1.begin_const(), m2,
+				 i_len, i_blocks, l_blocks);
+    parallel::run_chunks(task, i_blocks * l_blocks);
 
     return output;
 }
@@ -17,7 +17,10 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <algorithm>
+#include <vector>
 #include <tensor/sparse.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
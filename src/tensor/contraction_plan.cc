@@ -0,0 +1,454 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <tensor/contraction.h>
+#include <tensor/io.h>
+
+namespace tensor {
+
+  //////////////////////////////////////////////////////////////////////
+  // NETWORK DESCRIPTION
+  //
+  // During planning, every tensor, original or intermediate, is described
+  // by the sorted list of labels of its indices. Since a label appears in
+  // at most two tensors, contracting two tensors leaves the labels that are
+  // in only one of them, and costs one multiplication per combination of
+  // values of all their labels.
+  //
+
+  typedef std::vector<index> label_set;
+
+  struct Network {
+    std::map<index,index> dimension;  // Dimension of each label
+    std::vector<label_set> tensors;   // Sorted labels of each input
+
+    double size(const label_set &s) const {
+      double output = 1.0;
+      for (label_set::const_iterator it = s.begin(); it != s.end(); ++it)
+        output *= dimension.find(*it)->second;
+      return output;
+    }
+  };
+
+  static const label_set merge_labels(const label_set &a, const label_set &b)
+  {
+    label_set output;
+    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(),
+                                  std::back_inserter(output));
+    return output;
+  }
+
+  static double contraction_cost(const Network &net, const label_set &a,
+                                 const label_set &b)
+  {
+    label_set all;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(all));
+    return net.size(all);
+  }
+
+  /* A contraction order, as pairs of tensors. Inputs are numbered 0 to n-1,
+     and the output of step s is tensor n+s. */
+  typedef std::vector<std::pair<index,index> > contraction_order;
+
+  //////////////////////////////////////////////////////////////////////
+  // EXHAUSTIVE SEARCH
+  //
+  // Depth first search over all sequences of pairwise contractions,
+  // discarding those that already cost more than the best one found.
+  //
+
+  struct ExhaustiveSearch {
+    const Network &net;
+    double best_cost;
+    contraction_order best, current;
+
+    ExhaustiveSearch(const Network &n) : net(n), best_cost(-1) {}
+
+    void search(std::vector<label_set> &nodes, std::vector<index> &ids,
+                index next_id, double cost)
+    {
+      if (best_cost >= 0 && cost >= best_cost)
+        return;
+      if (nodes.size() == 1) {
+        best_cost = cost;
+        best = current;
+        return;
+      }
+      for (size_t i = 0; i < nodes.size(); i++) {
+        for (size_t j = i + 1; j < nodes.size(); j++) {
+          double c = contraction_cost(net, nodes[i], nodes[j]);
+          std::vector<label_set> new_nodes;
+          std::vector<index> new_ids;
+          for (size_t k = 0; k < nodes.size(); k++) {
+            if (k != i && k != j) {
+              new_nodes.push_back(nodes[k]);
+              new_ids.push_back(ids[k]);
+            }
+          }
+          new_nodes.push_back(merge_labels(nodes[i], nodes[j]));
+          new_ids.push_back(next_id);
+          current.push_back(std::make_pair(ids[i], ids[j]));
+          search(new_nodes, new_ids, next_id + 1, cost + c);
+          current.pop_back();
+        }
+      }
+    }
+  };
+
+  static const contraction_order exhaustive_order(const Network &net)
+  {
+    ExhaustiveSearch s(net);
+    std::vector<label_set> nodes(net.tensors);
+    std::vector<index> ids;
+    for (size_t i = 0; i < nodes.size(); i++)
+      ids.push_back(i);
+    s.search(nodes, ids, nodes.size(), 0.0);
+    return s.best;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // DYNAMIC PROGRAMMING
+  //
+  // The best way to contract a subset S of the tensors is the cheapest split
+  // of S into two subsets, each contracted in its best way. The labels of S
+  // are those appearing once in S. The cost of joining S1 and S2 is the
+  // product of the dimensions of all their labels, which is the square root
+  // of size(S1)*size(S2)*size(S), because the shared labels appear in the
+  // first two sizes but not in the last one.
+  //
+
+  struct SubsetSearch {
+    std::vector<double> cost, size;
+    std::vector<unsigned long> split;
+
+    void build(unsigned long s, index n, contraction_order *order,
+               std::vector<index> *ids) {
+      unsigned long s1 = split[s];
+      if (s1 == 0) {
+        index i = 0;
+        while (!(s & (1ul << i))) i++;
+        ids->at(s) = i;
+        return;
+      }
+      build(s1, n, order, ids);
+      build(s ^ s1, n, order, ids);
+      order->push_back(std::make_pair(ids->at(s1), ids->at(s ^ s1)));
+      ids->at(s) = n + order->size() - 1;
+    }
+  };
+
+  static const contraction_order dynamic_order(const Network &net)
+  {
+    index n = net.tensors.size();
+    unsigned long all = (1ul << n) - 1;
+    SubsetSearch s;
+    s.cost.resize(all + 1, 0.0);
+    s.size.resize(all + 1, 1.0);
+    s.split.resize(all + 1, 0);
+    std::vector<label_set> labels(all + 1);
+    for (unsigned long set = 1; set <= all; set++) {
+      unsigned long low = set & (~set + 1);
+      index i = 0;
+      while (!(low & (1ul << i))) i++;
+      labels[set] = merge_labels(labels[set ^ low], net.tensors[i]);
+      s.size[set] = net.size(labels[set]);
+      if (set == low)
+        continue;
+      // Splits where s1 contains the lowest tensor, so that each one is
+      // considered only once.
+      double best = -1;
+      unsigned long rest = set ^ low;
+      for (unsigned long sub = (rest - 1) & rest; ; sub = (sub - 1) & rest) {
+        unsigned long s1 = sub | low, s2 = set ^ s1;
+        double join = std::floor(std::sqrt(s.size[s1] * s.size[s2] * s.size[set]) + 0.5);
+        double c = s.cost[s1] + s.cost[s2] + join;
+        if (best < 0 || c < best) {
+          best = c;
+          s.split[set] = s1;
+        }
+        if (sub == 0) break;
+      }
+      s.cost[set] = best;
+    }
+    contraction_order order;
+    std::vector<index> ids(all + 1);
+    s.build(all, n, &order, &ids);
+    return order;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // GREEDY SEARCH
+  //
+  // Contract first the pair that most reduces the size of the network,
+  // preferring pairs with common labels and, among equals, the cheapest.
+  //
+
+  static const contraction_order greedy_order(const Network &net)
+  {
+    std::vector<label_set> nodes(net.tensors);
+    std::vector<index> ids;
+    for (size_t i = 0; i < nodes.size(); i++)
+      ids.push_back(i);
+    contraction_order order;
+    index next_id = nodes.size();
+    while (nodes.size() > 1) {
+      size_t bi = 0, bj = 1;
+      bool best_connected = false;
+      double best_gain = 0, best_cost = 0;
+      for (size_t i = 0; i < nodes.size(); i++) {
+        for (size_t j = i + 1; j < nodes.size(); j++) {
+          label_set m = merge_labels(nodes[i], nodes[j]);
+          bool connected = m.size() < nodes[i].size() + nodes[j].size();
+          double gain = net.size(m) - net.size(nodes[i]) - net.size(nodes[j]);
+          double cost = contraction_cost(net, nodes[i], nodes[j]);
+          if ((i == 0 && j == 1) ||
+              (connected && !best_connected) ||
+              (connected == best_connected &&
+               (gain < best_gain || (gain == best_gain && cost < best_cost)))) {
+            bi = i; bj = j;
+            best_connected = connected;
+            best_gain = gain;
+            best_cost = cost;
+          }
+        }
+      }
+      order.push_back(std::make_pair(ids[bi], ids[bj]));
+      nodes[bi] = merge_labels(nodes[bi], nodes[bj]);
+      ids[bi] = next_id++;
+      nodes.erase(nodes.begin() + bj);
+      ids.erase(ids.begin() + bj);
+    }
+    return order;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // PLAN
+  //
+
+  static index position(const Indices &v, index x)
+  {
+    return std::find(v.begin(), v.end(), x) - v.begin();
+  }
+
+  ContractionPlan::ContractionPlan(const std::vector<Indices> &labels,
+                                   const std::vector<Indices> &dimensions,
+                                   const Indices &output, Method method) :
+    dimensions_(dimensions), flops_(0), peak_(0)
+  {
+    index n = labels.size();
+    assert(n > 0 && (index)dimensions.size() == n);
+    /*
+     * Verify the labels and find the open ones.
+     */
+    Network net;
+    std::map<index,int> count;
+    for (index t = 0; t < n; t++) {
+      assert(labels[t].size() == dimensions[t].size());
+      label_set s(labels[t].begin(), labels[t].end());
+      std::sort(s.begin(), s.end());
+      for (index k = 0; k < labels[t].size(); k++) {
+        index l = labels[t][k], d = dimensions[t][k];
+        if (count[l]++ && net.dimension[l] != d) {
+          std::cerr << "In ContractionPlan, label " << l
+                    << " has dimensions " << d << " and " << net.dimension[l]
+                    << std::endl;
+          abort();
+        }
+        net.dimension[l] = d;
+      }
+      assert(std::adjacent_find(s.begin(), s.end()) == s.end());
+      net.tensors.push_back(s);
+    }
+    Indices open;
+    for (std::map<index,int>::const_iterator it = count.begin(); it != count.end(); ++it) {
+      assert(it->second <= 2);
+      if (it->second == 1)
+        open = open << Indices(igen << it->first);
+    }
+    if (output.size()) {
+      assert(output.size() == open.size());
+      label_set sorted(output.begin(), output.end());
+      std::sort(sorted.begin(), sorted.end());
+      assert(std::equal(sorted.begin(), sorted.end(), open.begin()));
+      output_ = output;
+    } else {
+      output_ = open;
+    }
+    /*
+     * Find the order of the contractions.
+     */
+    if (method == AUTOMATIC)
+      method = (n <= 6)? EXHAUSTIVE : (n <= 16)? DYNAMIC : GREEDY;
+    contraction_order order;
+    if (n > 1) {
+      if (method == EXHAUSTIVE)
+        order = exhaustive_order(net);
+      else if (method == DYNAMIC)
+        order = dynamic_order(net);
+      else
+        order = greedy_order(net);
+    }
+    /*
+     * Translate the order into calls to contract(), keeping track of the
+     * labels of the intermediate results, their cost and their size.
+     */
+    std::vector<Indices> current(labels);
+    double live = 0;
+    for (index t = 0; t < n; t++)
+      live += net.size(net.tensors[t]);
+    peak_ = live;
+    for (size_t s = 0; s < order.size(); s++) {
+      Step step;
+      step.a = order[s].first;
+      step.b = order[s].second;
+      const Indices &la = current[step.a], &lb = current[step.b];
+      Indices ia, ib, result;
+      for (index k = 0; k < la.size(); k++) {
+        index j = position(lb, la[k]);
+        if (j < lb.size()) {
+          ia = ia << Indices(igen << k);
+          ib = ib << Indices(igen << j);
+        } else {
+          result = result << Indices(igen << la[k]);
+        }
+      }
+      for (index k = 0; k < lb.size(); k++) {
+        if (position(la, lb[k]) == la.size())
+          result = result << Indices(igen << lb[k]);
+      }
+      step.ia = ia;
+      step.ib = ib;
+      steps_.push_back(step);
+      label_set sa(la.begin(), la.end()), sb(lb.begin(), lb.end());
+      std::sort(sa.begin(), sa.end());
+      std::sort(sb.begin(), sb.end());
+      label_set sr(result.begin(), result.end());
+      std::sort(sr.begin(), sr.end());
+      flops_ += 2 * contraction_cost(net, sa, sb);
+      live += net.size(sr);
+      peak_ = std::max(peak_, live);
+      if (step.a >= n) live -= net.size(sa);
+      if (step.b >= n) live -= net.size(sb);
+      current.push_back(result);
+    }
+    const Indices &last = current.back();
+    final_permutation_ = Indices(output_.size());
+    for (index k = 0; k < output_.size(); k++)
+      final_permutation_.at(k) = position(last, output_[k]);
+  }
+
+  bool ContractionPlan::matches(const std::vector<Indices> &dimensions) const
+  {
+    if (dimensions.size() != dimensions_.size())
+      return false;
+    for (size_t i = 0; i < dimensions.size(); i++)
+      if (!all_equal(dimensions[i], dimensions_[i]))
+        return false;
+    return true;
+  }
+
+  template<class Tensor>
+  const Tensor ContractionPlan::do_execute(const std::vector<Tensor> &tensors) const
+  {
+    index n = dimensions_.size();
+    assert((index)tensors.size() == n);
+    for (index i = 0; i < n; i++)
+      assert(all_equal(tensors[i].dimensions(), dimensions_[i]));
+    std::vector<Tensor> work(tensors);
+    for (size_t s = 0; s < steps_.size(); s++) {
+      const Step &step = steps_[s];
+      work.push_back(contract(work[step.a], step.ia, work[step.b], step.ib));
+      // Intermediate results are freed as soon as possible
+      if (step.a >= n) work[step.a] = Tensor();
+      if (step.b >= n) work[step.b] = Tensor();
+    }
+    if (output_.size() == 0)
+      return work.back();
+    return permute(work.back(), final_permutation_);
+  }
+
+  const RTensor ContractionPlan::execute(const std::vector<RTensor> &tensors) const
+  {
+    return do_execute(tensors);
+  }
+
+  const CTensor ContractionPlan::execute(const std::vector<CTensor> &tensors) const
+  {
+    return do_execute(tensors);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // CACHE OF PLANS
+  //
+
+  typedef std::map<std::vector<index>,ContractionPlan> plan_cache;
+  static plan_cache cache;
+  static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+  static const size_t max_cached_plans = 1024;
+
+  /* Returns a copy of the plan, taken while the cache is locked, because
+     other threads may clear the cache while the plan is being executed. */
+  template<class Tensor>
+  static const ContractionPlan
+  cached_plan(const std::vector<Tensor> &tensors,
+              const std::vector<Indices> &labels, const Indices &output)
+  {
+    std::vector<index> key;
+    std::vector<Indices> dimensions;
+    key.push_back(tensors.size());
+    for (size_t i = 0; i < tensors.size(); i++) {
+      dimensions.push_back(tensors[i].dimensions());
+      key.push_back(labels[i].size());
+      key.insert(key.end(), labels[i].begin(), labels[i].end());
+      key.insert(key.end(), dimensions[i].begin(), dimensions[i].end());
+    }
+    key.insert(key.end(), output.begin(), output.end());
+    pthread_mutex_lock(&cache_lock);
+    plan_cache::iterator it = cache.find(key);
+    if (it == cache.end()) {
+      if (cache.size() >= max_cached_plans)
+        cache.clear();
+      ContractionPlan plan(labels, dimensions, output);
+      it = cache.insert(std::make_pair(key, plan)).first;
+    }
+    const ContractionPlan plan = it->second;
+    pthread_mutex_unlock(&cache_lock);
+    return plan;
+  }
+
+  const RTensor contract_network(const std::vector<RTensor> &tensors,
+                                 const std::vector<Indices> &labels,
+                                 const Indices &output)
+  {
+    return cached_plan(tensors, labels, output).execute(tensors);
+  }
+
+  const CTensor contract_network(const std::vector<CTensor> &tensors,
+                                 const std::vector<Indices> &labels,
+                                 const Indices &output)
+  {
+    return cached_plan(tensors, labels, output).execute(tensors);
+  }
+
+} // namespace tensor
@@ -27,10 +27,224 @@
 
 namespace blas {
 
+  //////////////////////////////////////////////////////////////////////
+  // SMALL MATRICES
+  //
+  // For matrices of a few rows and columns, the cost of calling BLAS, which
+  // checks its arguments and packs the matrices in blocks, is larger than
+  // the cost of the product itself. These kernels are used instead when
+  // m*n*k <= small_gemm_size().
+  //
+
+  /* c += x * y, without the checks for infinities of std::complex. */
+  inline void small_madd(double &c, double x, double y)
+  {
+    c += x * y;
+  }
+
+  inline void small_madd(tensor::cdouble &c, const tensor::cdouble &x,
+                         const tensor::cdouble &y)
+  {
+    c = tensor::cdouble(c.real() + x.real() * y.real() - x.imag() * y.imag(),
+                        c.imag() + x.real() * y.imag() + x.imag() * y.real());
+  }
+
+  template<bool do_conj, typename elt_t>
+  inline elt_t small_load(const elt_t *x)
+  {
+    return do_conj? tensor::conj(*x) : *x;
+  }
+
+  template<typename elt_t>
+  inline void small_store(elt_t *C, const elt_t &c, const elt_t &alpha,
+                          const elt_t &beta, bool scale)
+  {
+    if (!scale)
+      *C = c;
+    else if (beta == tensor::number_zero<elt_t>())
+      *C = alpha * c;
+    else
+      *C = alpha * c + beta * (*C);
+  }
+
+  /*
+   * C(p,q) = alpha * sum_l X(p,l) * Y(q,l) + beta * C(p,q), where
+   * X(p,l) = X[p*xp + l*xl], Y(q,l) = Y[q*yq + l*yl], C(p,q) = C[p + q*ldc]
+   * and X or Y may be conjugated. Blocks of 4x2 elements of C are
+   * accumulated in registers, so that each number loaded from X and Y is
+   * used in several products.
+   */
+  template<typename elt_t, bool conj_x, bool conj_y>
+  void
+  small_product(tensor::index P, tensor::index Q, tensor::index L,
+                const elt_t &alpha, const elt_t *X, tensor::index xp, tensor::index xl,
+                const elt_t *Y, tensor::index yq, tensor::index yl,
+                const elt_t &beta, elt_t *C, tensor::index ldc)
+  {
+    typedef tensor::index index;
+    const elt_t zero = tensor::number_zero<elt_t>();
+    const bool scale = !(alpha == tensor::number_one<elt_t>() && beta == zero);
+    const index P4 = P & ~(index)3, Q2 = Q & ~(index)1;
+    for (index q = 0; q < Q2; q += 2) {
+      for (index p = 0; p < P4; p += 4) {
+        elt_t c00 = zero, c10 = zero, c20 = zero, c30 = zero;
+        elt_t c01 = zero, c11 = zero, c21 = zero, c31 = zero;
+        const elt_t *x = X + p*xp, *y = Y + q*yq;
+        for (index l = 0; l < L; l++, x += xl, y += yl) {
+          const elt_t x0 = small_load<conj_x>(x);
+          const elt_t x1 = small_load<conj_x>(x + xp);
+          const elt_t x2 = small_load<conj_x>(x + 2*xp);
+          const elt_t x3 = small_load<conj_x>(x + 3*xp);
+          const elt_t y0 = small_load<conj_y>(y);
+          const elt_t y1 = small_load<conj_y>(y + yq);
+          small_madd(c00, x0, y0); small_madd(c10, x1, y0);
+          small_madd(c20, x2, y0); small_madd(c30, x3, y0);
+          small_madd(c01, x0, y1); small_madd(c11, x1, y1);
+          small_madd(c21, x2, y1); small_madd(c31, x3, y1);
+        }
+        elt_t *c = C + p + q*ldc;
+        small_store(c, c00, alpha, beta, scale);
+        small_store(c + 1, c10, alpha, beta, scale);
+        small_store(c + 2, c20, alpha, beta, scale);
+        small_store(c + 3, c30, alpha, beta, scale);
+        c += ldc;
+        small_store(c, c01, alpha, beta, scale);
+        small_store(c + 1, c11, alpha, beta, scale);
+        small_store(c + 2, c21, alpha, beta, scale);
+        small_store(c + 3, c31, alpha, beta, scale);
+      }
+    }
+    /* Remaining rows and columns */
+    for (index q = 0; q < Q; q++) {
+      for (index p = (q < Q2)? P4 : 0; p < P; p++) {
+        elt_t c = zero;
+        const elt_t *x = X + p*xp, *y = Y + q*yq;
+        for (index l = 0; l < L; l++, x += xl, y += yl)
+          small_madd(c, small_load<conj_x>(x), small_load<conj_y>(y));
+        small_store(C + p + q*ldc, c, alpha, beta, scale);
+      }
+    }
+  }
+
+  /*
+   * Square products of N <= 4 elements keep the whole matrix C in registers
+   * and the loops are unrolled, because N is known at compile time. Beyond
+   * that, BLAS uses vector instructions and is faster.
+   */
+#ifdef __GNUC__
+# define TINY_UNROLL _Pragma("GCC unroll 4")
+#else
+# define TINY_UNROLL
+#endif
+
+  template<typename elt_t, bool conj_x, bool conj_y, int N>
+  void
+  tiny_product(const elt_t &alpha, const elt_t *X, tensor::index xp, tensor::index xl,
+               const elt_t *Y, tensor::index yq, tensor::index yl,
+               const elt_t &beta, elt_t *C, tensor::index ldc)
+  {
+    const elt_t zero = tensor::number_zero<elt_t>();
+    const bool scale = !(alpha == tensor::number_one<elt_t>() && beta == zero);
+    elt_t c[N][N];
+    TINY_UNROLL
+    for (int q = 0; q < N; q++)
+      TINY_UNROLL
+      for (int p = 0; p < N; p++)
+        c[q][p] = zero;
+    TINY_UNROLL
+    for (int l = 0; l < N; l++, X += xl, Y += yl) {
+      elt_t x[N], y[N];
+      TINY_UNROLL
+      for (int i = 0; i < N; i++) {
+        x[i] = small_load<conj_x>(X + i*xp);
+        y[i] = small_load<conj_y>(Y + i*yq);
+      }
+      TINY_UNROLL
+      for (int q = 0; q < N; q++)
+        TINY_UNROLL
+        for (int p = 0; p < N; p++)
+          small_madd(c[q][p], x[p], y[q]);
+    }
+    TINY_UNROLL
+    for (int q = 0; q < N; q++, C += ldc)
+      TINY_UNROLL
+      for (int p = 0; p < N; p++)
+        small_store(C + p, c[q][p], alpha, beta, scale);
+  }
+
+#undef TINY_UNROLL
+
+  template<typename elt_t, bool conj_x, bool conj_y>
+  void
+  small_dispatch(tensor::index P, tensor::index Q, tensor::index L,
+                 const elt_t &alpha, const elt_t *X, tensor::index xp, tensor::index xl,
+                 const elt_t *Y, tensor::index yq, tensor::index yl,
+                 const elt_t &beta, elt_t *C, tensor::index ldc)
+  {
+    if (P == Q && Q == L) {
+      switch (P) {
+      case 2:
+        tiny_product<elt_t,conj_x,conj_y,2>(alpha, X, xp, xl, Y, yq, yl, beta, C, ldc);
+        return;
+      case 3:
+        tiny_product<elt_t,conj_x,conj_y,3>(alpha, X, xp, xl, Y, yq, yl, beta, C, ldc);
+        return;
+      case 4:
+        tiny_product<elt_t,conj_x,conj_y,4>(alpha, X, xp, xl, Y, yq, yl, beta, C, ldc);
+        return;
+      }
+    }
+    small_product<elt_t,conj_x,conj_y>(P, Q, L, alpha, X, xp, xl, Y, yq, yl, beta, C, ldc);
+  }
+
+  /* C = alpha * op1(A) * op2(B) + beta * C, as the BLAS routine. */
+  template<typename elt_t>
+  void
+  small_gemm(char op1, char op2, integer m, integer n, integer k,
+             const elt_t &alpha, const elt_t *A, integer lda,
+             const elt_t *B, integer ldb, const elt_t &beta,
+             elt_t *C, integer ldc)
+  {
+    // op1(A)(p,l) = X[p*xp + l*xl] and op2(B)(l,q) = Y[q*yq + l*yl]
+    tensor::index xp = 1, xl = lda, yq = ldb, yl = 1;
+    if (op1 != 'N') {
+      xp = lda;
+      xl = 1;
+    }
+    if (op2 != 'N') {
+      yq = 1;
+      yl = ldb;
+    }
+    if (op1 == 'C') {
+      if (op2 == 'C')
+        small_dispatch<elt_t,true,true>(m, n, k, alpha, A, xp, xl, B, yq, yl, beta, C, ldc);
+      else
+        small_dispatch<elt_t,true,false>(m, n, k, alpha, A, xp, xl, B, yq, yl, beta, C, ldc);
+    } else {
+      if (op2 == 'C')
+        small_dispatch<elt_t,false,true>(m, n, k, alpha, A, xp, xl, B, yq, yl, beta, C, ldc);
+      else
+        small_dispatch<elt_t,false,false>(m, n, k, alpha, A, xp, xl, B, yq, yl, beta, C, ldc);
+    }
+  }
+
+  inline bool use_small_gemm(integer m, integer n, integer k)
+  {
+    return (double)m * (double)n * (double)k <= (double)tensor::small_gemm_size();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // BLAS
+  //
+
   inline void gemm(char op1, char op2, integer m, integer n, integer k,
                    double alpha, const double *A, integer lda, const double *B,
                    integer ldb, double beta, double *C, integer ldc)
   {
+    if (use_small_gemm(m, n, k)) {
+      small_gemm(op1, op2, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+      return;
+    }
 #ifdef TENSOR_USE_ESSL
     dgemm(&op1, &op2, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
 #endif
@@ -49,6 +263,10 @@ namespace blas {
                    const tensor::cdouble *B, integer ldb, const tensor::cdouble &beta,
                    tensor::cdouble *C, integer ldc)
   {
+    if (use_small_gemm(m, n, k)) {
+      small_gemm(op1, op2, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+      return;
+    }
 #ifdef TENSOR_USE_ESSL
     zgemm(&op1, &op2, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
 #endif
@@ -0,0 +1,52 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cstdlib>
+#include <tensor/tensor.h>
+
+namespace tensor {
+
+  /* With OpenBLAS, the square kernels for 2x2 to 4x4 matrices take a third
+     to a half of the time of dgemm and zgemm. From 5x5 on, BLAS is faster,
+     by a factor three to five for 8x8 and 16x16. See profile/prof_gemm.cc
+     and TENSOR_SMALL_GEMM. */
+  static const index default_small_gemm_size = 64;
+
+  static index read_small_gemm_size()
+  {
+    const char *value = getenv("TENSOR_SMALL_GEMM");
+    index n = value? atol(value) : default_small_gemm_size;
+    return (n >= 0)? n : 0;
+  }
+
+  static index small_gemm_products = read_small_gemm_size();
+
+  index small_gemm_size()
+  {
+    return __atomic_load_n(&small_gemm_products, __ATOMIC_RELAXED);
+  }
+
+  index set_small_gemm_size(index products)
+  {
+    return __atomic_exchange_n(&small_gemm_products,
+                               (products >= 0)? products : 0,
+                               __ATOMIC_RELAXED);
+  }
+
+} // namespace tensor
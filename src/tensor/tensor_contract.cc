@@ -0,0 +1,256 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#define TENSOR_LOAD_IMPL
+#include <iostream>
+#include <vector>
+#include <tensor/tensor.h>
+#include <tensor/io.h>
+#include "gemm.cc"
+
+namespace tensor {
+
+  using namespace blas;
+
+  //
+  // A contraction C = A * B over several pairs of indices is done as a single
+  // matrix product of a tensor X, with rows given by its free indices F and
+  // columns by the contracted ones L, times a tensor Y, with rows L and
+  // columns G. X and Y are A and B, or B and A, and their indices must be
+  // arranged as (F,L) or (L,F), and (L,G) or (G,L) respectively, because
+  // the product can transpose them. The output has the indices (F,G).
+  //
+  // We consider both roles for A and B, both orders of the contracted
+  // indices, and either the order of the free indices in the output or their
+  // order in A and B, followed by a permutation of the output. The cost of
+  // a plan is the number of elements that have to be copied in those
+  // permutations; permutations that only move indices of size one are free.
+  // For a single pair of indices, we also consider fold(), which avoids all
+  // copies by doing one small product per value of the remaining indices.
+  //
+
+  /* True if the permutation only reshapes the tensor. */
+  inline bool trivial_permutation(const Indices &dims, const Indices &perm)
+  {
+    index last = -1;
+    for (index k = 0; k < perm.size(); k++) {
+      if (dims[perm[k]] != 1) {
+        if (perm[k] < last) return false;
+        last = perm[k];
+      }
+    }
+    return true;
+  }
+
+  inline index product_of_dimensions(const Indices &dims, const Indices &which)
+  {
+    index output = 1;
+    for (index k = 0; k < which.size(); k++)
+      output *= dims[which[k]];
+    return output;
+  }
+
+  struct contraction_plan {
+    bool swap;         // X is B and Y is A
+    Indices perm_x;    // X is permuted to (F,L) or (L,F)
+    Indices perm_y;    // Y is permuted to (L,G) or (G,L)
+    char op_x, op_y;   // 'T' if X is (L,F) or Y is (G,L)
+    Indices perm_c;    // Permutation of (F,G) to the final output
+    index cost;
+  };
+
+  /* Arrange the tensor with the given free and contracted indices, so that
+     the free ones come first if 'rows', or last otherwise. */
+  inline index arrange_operand(const Indices &dims, const Indices &free,
+                               const Indices &contracted, bool rows,
+                               index size, Indices *perm, char *op)
+  {
+    Indices p1 = free << contracted;
+    Indices p2 = contracted << free;
+    if (!rows) std::swap(p1, p2);
+    if (trivial_permutation(dims, p1)) {
+      *perm = p1; *op = 'N';
+      return 0;
+    }
+    if (trivial_permutation(dims, p2)) {
+      *perm = p2; *op = 'T';
+      return 0;
+    }
+    *perm = p1; *op = 'N';
+    return size;
+  }
+
+  template<typename elt_t>
+  const Tensor<elt_t> do_contract(const Tensor<elt_t> &A, const Indices &_ia,
+                                  const Tensor<elt_t> &B, const Indices &_ib,
+                                  const Indices &_out)
+  {
+    const index ranka = A.rank(), rankb = B.rank();
+    const index pairs = _ia.size();
+    assert(ranka > 0 && rankb > 0);
+    if (pairs != _ib.size()) {
+      std::cerr << "In contract(), the lists of indices " << _ia
+                << " and " << _ib << " have different lengths" << std::endl;
+      abort();
+    }
+    /*
+     * Contracted indices, in the order in which they appear in A and in
+     * the order in which they appear in B.
+     */
+    Indices ia(pairs), ib(pairs);
+    std::vector<bool> used_a(ranka, false), used_b(rankb, false);
+    for (index k = 0; k < pairs; k++) {
+      index i = ia.at(k) = normalize_index(_ia[k], ranka);
+      index j = ib.at(k) = normalize_index(_ib[k], rankb);
+      if (used_a[i] || used_b[j] || A.dimension(i) != B.dimension(j)) {
+        std::cerr << "Unable to contract() tensors with dimensions" << std::endl
+                  << "\t" << A.dimensions() << " and "
+                  << B.dimensions() << std::endl
+                  << "\tover indices " << _ia << " and " << _ib << std::endl;
+        abort();
+      }
+      used_a[i] = used_b[j] = true;
+    }
+    Indices ia_by_b(pairs), ib_by_b(pairs), ia_by_a(pairs), ib_by_a(pairs);
+    for (index k = 0, n = 0; k < ranka; k++)
+      for (index p = 0; p < pairs; p++)
+        if (ia[p] == k) { ia_by_a.at(n) = k; ib_by_a.at(n++) = ib[p]; }
+    for (index k = 0, n = 0; k < rankb; k++)
+      for (index p = 0; p < pairs; p++)
+        if (ib[p] == k) { ib_by_b.at(n) = k; ia_by_b.at(n++) = ia[p]; }
+    /*
+     * Free indices, their dimensions and their place in the output.
+     * The default order is that of fold(): first A and then B.
+     */
+    const index free_a = ranka - pairs, free_b = rankb - pairs;
+    const index rank = free_a + free_b;
+    Indices fa(free_a), fb(free_b);
+    for (index k = 0, n = 0; k < ranka; k++)
+      if (!used_a[k]) fa.at(n++) = k;
+    for (index k = 0, n = 0; k < rankb; k++)
+      if (!used_b[k]) fb.at(n++) = k;
+    Indices out = _out.size()? _out : iota(0, rank - 1);
+    Indices label_dims(rank), new_dims(std::max<index>(rank, 1));
+    for (index l = 0; l < rank; l++)
+      label_dims.at(l) = (l < free_a)? A.dimension(fa[l]) : B.dimension(fb[l - free_a]);
+    new_dims.at(0) = 1;
+    {
+      std::vector<bool> seen(rank, false);
+      assert(out.size() == rank);
+      for (index k = 0; k < rank; k++) {
+        index l = out[k];
+        assert(l >= 0 && l < rank && !seen[l]);
+        seen[l] = true;
+        new_dims.at(k) = label_dims[l];
+      }
+    }
+    const index size_c = product_of_dimensions(label_dims, iota(0, rank - 1));
+    /*
+     * Find the cheapest plan.
+     */
+    contraction_plan best;
+    best.cost = -1;
+    for (int swap = 0; swap < 2; swap++) {
+      const Tensor<elt_t> &X = swap? B : A, &Y = swap? A : B;
+      const Indices &fx = swap? fb : fa, &fy = swap? fa : fb;
+      const index offset_x = swap? free_a : 0, offset_y = swap? 0 : free_a;
+      for (int by_b = 0; by_b < 2; by_b++) {
+        const Indices &lx = swap? (by_b? ib_by_b : ib_by_a) : (by_b? ia_by_b : ia_by_a);
+        const Indices &ly = swap? (by_b? ia_by_b : ia_by_a) : (by_b? ib_by_b : ib_by_a);
+        for (int natural = 0; natural < 2; natural++) {
+          contraction_plan plan;
+          plan.swap = swap;
+          Indices gx = fx, gy = fy;
+          // Labels of the output that correspond to (F,G)
+          Indices labels(rank);
+          if (!natural) {
+            // The first free indices of the output come from X, in the
+            // requested order, followed by those of Y.
+            index k;
+            for (k = 0; k < fx.size(); k++) {
+              index l = out[k] - offset_x;
+              if (l < 0 || l >= fx.size()) break;
+              gx.at(k) = fx[l];
+            }
+            if (k < fx.size()) continue;
+            for (k = 0; k < fy.size(); k++)
+              gy.at(k) = fy[out[k + fx.size()] - offset_y];
+            plan.perm_c = iota(0, rank - 1);
+            plan.cost = 0;
+          } else {
+            for (index k = 0; k < fx.size(); k++)
+              labels.at(k) = k + offset_x;
+            for (index k = 0; k < fy.size(); k++)
+              labels.at(k + fx.size()) = k + offset_y;
+            plan.perm_c = Indices(rank);
+            for (index k = 0; k < rank; k++)
+              plan.perm_c.at(k) = std::find(labels.begin(), labels.end(), out[k]) - labels.begin();
+            Indices dims_c(rank);
+            for (index k = 0; k < rank; k++)
+              dims_c.at(k) = label_dims[labels[k]];
+            plan.cost = trivial_permutation(dims_c, plan.perm_c)? 0 : size_c;
+          }
+          plan.cost += arrange_operand(X.dimensions(), gx, lx, true, X.size(),
+                                       &plan.perm_x, &plan.op_x);
+          plan.cost += arrange_operand(Y.dimensions(), gy, ly, false, Y.size(),
+                                       &plan.perm_y, &plan.op_y);
+          if (best.cost < 0 || plan.cost < best.cost)
+            best = plan;
+        }
+      }
+    }
+    /*
+     * With a single pair of indices and no reordering, fold() may avoid the
+     * copies by doing several small products. We take that route when the
+     * products are large enough to run efficiently.
+     */
+    if (best.cost > 0 && pairs == 1 && trivial_permutation(label_dims, out)) {
+      index i_len = product_of_dimensions(A.dimensions(), iota(0, ia[0] - 1));
+      index k_len = product_of_dimensions(B.dimensions(), iota(0, ib[0] - 1));
+      index l_len = A.dimension(ia[0]);
+      if (i_len * k_len * l_len >= 32768) {
+        Tensor<elt_t> output = fold(A, ia[0], B, ib[0]);
+        return reshape(output, new_dims);
+      }
+    }
+    /*
+     * Execute the plan.
+     */
+    const Tensor<elt_t> &X0 = best.swap? B : A, &Y0 = best.swap? A : B;
+    index m = product_of_dimensions(X0.dimensions(), best.swap? fb : fa);
+    index n = product_of_dimensions(Y0.dimensions(), best.swap? fa : fb);
+    index k = product_of_dimensions(A.dimensions(), ia);
+    Indices dims_c(rank);
+    for (index i = 0; i < rank; i++)
+      dims_c.at(i) = new_dims[std::find(best.perm_c.begin(), best.perm_c.end(), i) - best.perm_c.begin()];
+    Tensor<elt_t> C(rank? dims_c : new_dims);
+    if (C.size()) {
+      const Tensor<elt_t> X = permute(X0, best.perm_x);
+      const Tensor<elt_t> Y = permute(Y0, best.perm_y);
+      gemm(best.op_x, best.op_y, m, n, k, number_one<elt_t>(),
+           X.begin(), std::max<index>(1, (best.op_x == 'N')? m : k),
+           Y.begin(), std::max<index>(1, (best.op_y == 'N')? k : n),
+           number_zero<elt_t>(), C.begin(), std::max<index>(1, m));
+    }
+    if (rank == 0 || trivial_permutation(dims_c, best.perm_c))
+      return reshape(C, new_dims);
+    return permute(C, best.perm_c);
+  }
+
+} // namespace tensor
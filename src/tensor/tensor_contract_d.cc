@@ -0,0 +1,47 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "tensor_contract.cc"
+
+namespace tensor {
+
+  /**Contraction of two tensors over several pairs of indices. The code
+     \c C=contract(A,ia,B,ib) sums over the indices ia[k] of A and ib[k] of B,
+     for all k. Without a third argument the remaining indices of A are the
+     first indices of C, in the same order, followed by the remaining indices
+     of B. Otherwise, output index k is the remaining index out[k] of this
+     list. For instance, \c contract(A,igen<<1<<2,B,igen<<0<<2,igen<<1<<0)
+     computes
+     \f[
+     C_{jl} = \sum_{mn} A_{lmn} B_{mjn}
+     \f]
+
+     The result is computed with a single matrix product, choosing the order
+     of indices that requires the fewest copies of data.
+
+     \ingroup Tensors
+  */
+  const RTensor contract(const RTensor &a, const Indices &ia,
+                         const RTensor &b, const Indices &ib,
+                         const Indices &out)
+  {
+    return do_contract(a, ia, b, ib, out);
+  }
+
+} // namespace tensor
@@ -23,86 +23,92 @@
 #include <tensor/io.h>
 #include <tensor/tensor_lapack.h>
 #include "gemm.cc"
+#include "../tools/parallel.h"
 
 namespace tensor {
 
   using namespace blas;
 
+  /*
+   * Since we use row-major order, in which the first index varies faster,
+   * a contraction of A and B is written as
+   *		c(i,j,k,m) = a(i,l,j) * b(k,l,m)
+   * where there is a sum over the repeated index "l". This function finds
+   * out the size of the contracted (l_len) and uncontracted (i_len, j_len,
+   * k_len, m_len) dimensions of the tensors, and the dimensions of C.
+   */
+  struct fold_shape {
+    index i_len, j_len, k_len, l_len, m_len;
+    Indices dims;
+
+    template<class tensor_a, class tensor_b>
+    fold_shape(const tensor_a &a, int _ndx1, const tensor_b &b, int _ndx2)
+    {
+      index rank, i;
+      const index ranka = a.rank();
+      const index rankb = b.rank();
+      index ndx1 = normalize_index(_ndx1, ranka);
+      index ndx2 = normalize_index(_ndx2, rankb);
+      Indices new_dims(std::max<index>(ranka + rankb - 2, 1));
+      for (i = 0, rank = 0, i_len=1; i < ndx1; i++) {
+        index di = a.dimension(i);
+        new_dims.at(rank++) = di;
+        i_len *= di;
+      }
+      l_len = a.dimension(i++);
+      if (l_len == 0) {
+        std::cerr << "Unable to fold() tensors with dimensions" << std::endl
+                  << "\t" << a.dimensions() << " and "
+                  << b.dimensions() << std::endl
+                  << "\tbecause indices " << ndx1 << " and " << ndx2
+                  << " are empty" << std::endl;
+        abort();
+      }
+      for (j_len = 1; i < ranka; i++) {
+        index di = a.dimension(i);
+        new_dims.at(rank++) = di;
+        j_len *= di;
+      }
+      for (i = 0, k_len=1; i < ndx2; i++) {
+        index di = b.dimension(i);
+        new_dims.at(rank++) = di;
+        k_len *= di;
+      }
+      if (l_len != b.dimension(i++)) {
+        std::cerr << "Unable to fold() tensors with dimensions" << std::endl
+                  << "\t" << a.dimensions() << " and "
+                  << b.dimensions() << std::endl
+                  << "\tbecause indices " << ndx1 << " and " << ndx2
+                  << " have different sizes" << std::endl;
+        abort();
+      }
+      for (m_len = 1; i < rankb; i++) {
+        index di = b.dimension(i);
+        new_dims.at(rank++) = di;
+        m_len *= di;
+      }
+      /*
+       * Sometimes the output is just a number.
+       */
+      if (rank == 0) {
+        new_dims.at(0) = 1;
+      }
+      dims = new_dims;
+    }
+  };
+
+  /*
+   * C(i,j,k,m) = A(i,l,j) * B(k,l,m) with BLAS, for a C that has been
+   * allocated with the dimensions of the shape.
+   */
   template<typename elt_t, bool do_conj>
   void
-  do_fold(Tensor<elt_t> &output,
-          const Tensor<elt_t> &a, int _ndx1, const Tensor<elt_t> &b, int _ndx2)
+  fold_gemm(const fold_shape &shape, elt_t *pC, const elt_t *pA, const elt_t *pB)
   {
-    index i_len,j_len,k_len,l_len,m_len;
-    index rank, i;
-    const index ranka = a.rank();
-    const index rankb = b.rank();
-    index ndx1 = normalize_index(_ndx1, ranka);
-    index ndx2 = normalize_index(_ndx2, rankb);
-    Indices new_dims(std::max<index>(ranka + rankb - 2, 1));
-    /*
-     * Since we use row-major order, in which the first
-     * index varies faster, we nest the loops beginning with the last index,
-     * and the loop what does is
-     *		c(i,j,k,m) = a(i,l,j) * b(k,l,m)
-     * where there is a sum over the repeated index "l". In the first part of
-     * the code we find out the size of the contracted (l_len,l_len) and
-     * uncontracted (new_dims, i_len,j_len,k_len,m_len) dimensions of the
-     * tensors.
-     */
-    for (i = 0, rank = 0, i_len=1; i < ndx1; i++) {
-      index di = a.dimension(i);
-      new_dims.at(rank++) = di;
-      i_len *= di;
-    }
-    l_len = a.dimension(i++);
-    if (l_len == 0) {
-      std::cerr << "Unable to fold() tensors with dimensions" << std::endl
-                << "\t" << a.dimensions() << " and "
-                << b.dimensions() << std::endl
-                << "\tbecause indices " << ndx1 << " and " << ndx2
-                << " are empty" << std::endl;
-      abort();
-    }
-    for (j_len = 1; i < ranka; i++) {
-      index di = a.dimension(i);
-      new_dims.at(rank++) = di;
-      j_len *= di;
-    }
-    for (i = 0, k_len=1; i < ndx2; i++) {
-      index di = b.dimension(i);
-      new_dims.at(rank++) = di;
-      k_len *= di;
-    }
-    if (l_len != b.dimension(i++)) {
-      std::cerr << "Unable to fold() tensors with dimensions" << std::endl
-                << "\t" << a.dimensions() << " and "
-                << b.dimensions() << std::endl
-                << "\tbecause indices " << ndx1 << " and " << ndx2
-                << " have different sizes" << std::endl;
-      abort();
-    }
-    for (m_len = 1; i < rankb; i++) {
-      index di = b.dimension(i);
-      new_dims.at(rank++) = di;
-      m_len *= di;
-    }
-    /*
-     * Create the output tensor. Sometimes it is just a number.
-     */
-    if (rank == 0) {
-      rank = 1;
-      new_dims.at(0) = 1;
-    }
-    output = Tensor<elt_t>(new_dims);
-    if (output.size() == 0)
-      return;
-
-    elt_t *pC = output.begin();
+    const index i_len = shape.i_len, j_len = shape.j_len, k_len = shape.k_len;
+    const index l_len = shape.l_len, m_len = shape.m_len;
     const elt_t zero = number_zero<elt_t>();
     const elt_t one = number_one<elt_t>();
-    const elt_t *pA = a.begin();
-    const elt_t *pB = b.begin();
     if (i_len == 1) {
       if (k_len == 1) {
         // C(j_len,m_len) = A(l_len,j_len)*B(l_len,m_len);
@@ -155,9 +161,222 @@ namespace tensor {
       }
     }
     if (do_conj) {
-      for (index i = output.size(); i; i--, pC++)
+      for (index i = ij_len*k_len*m_len; i; i--, pC++)
         *pC = tensor::conj(*pC);
     }
   }
 
+  /*
+   * Give C the dimensions of the output, reusing its memory if it already
+   * has them and it is not shared with other tensors.
+   */
+  template<typename elt_t>
+  inline void
+  prepare_output(Tensor<elt_t> &C, const Indices &dims)
+  {
+    if (C.ref_count() != 1 || !all_equal(C.dimensions(), dims))
+      C = Tensor<elt_t>(dims);
+  }
+
+  template<typename elt_t, bool do_conj>
+  void
+  do_fold(Tensor<elt_t> &output,
+          const Tensor<elt_t> &a, int ndx1, const Tensor<elt_t> &b, int ndx2)
+  {
+    const fold_shape shape(a, ndx1, b, ndx2);
+    if (&output == &a || &output == &b)
+      output = Tensor<elt_t>(shape.dims);
+    else
+      prepare_output(output, shape.dims);
+    if (output.size() == 0)
+      return;
+    fold_gemm<elt_t,do_conj>(shape, output.begin(), a.begin(), b.begin());
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // CONTRACTIONS WITH SLICES
+  //
+  // A strided slice whose first index has unit stride is a matrix for BLAS,
+  // with a leading dimension that is larger than its number of rows. It can
+  // be contracted without copying it, provided that the contracted indices
+  // are the first or the last ones of each operand.
+  //
+
+  /*
+   * Leading dimension of a tensor seen as the matrix that BLAS takes when
+   * index NDX is contracted: (rest, l) if NDX is the last one and (l, rest)
+   * otherwise.
+   */
+  template<typename elt_t>
+  static index
+  fold_leading_dimension(const Tensor<elt_t> &t, index ndx)
+  {
+    if (t.size() == 0)
+      return 1;
+    return (ndx == 0)? t.dimension(0) : (t.size() / t.dimension(ndx));
+  }
+
+  template<typename elt_t>
+  static index
+  fold_leading_dimension(const typename Tensor<elt_t>::view &v, index)
+  {
+    return v.leading_dimension();
+  }
+
+  /*
+   * C = fold(A, ndx1, B, ndx2) with one gemm() call, when A and B are
+   * stored as matrices with leading dimensions LDA and LDB. Returns false
+   * if that is not possible.
+   */
+  template<typename elt_t, class tensor_a, class tensor_b>
+  static bool
+  fold_strided(Tensor<elt_t> &output,
+               const tensor_a &a, const elt_t *pA, int _ndx1,
+               const tensor_b &b, const elt_t *pB, int _ndx2)
+  {
+    const index ranka = a.rank();
+    const index rankb = b.rank();
+    const index ndx1 = normalize_index(_ndx1, ranka);
+    const index ndx2 = normalize_index(_ndx2, rankb);
+    if ((ndx1 != 0 && ndx1 != ranka - 1) || (ndx2 != 0 && ndx2 != rankb - 1))
+      return false;
+    const index lda = fold_leading_dimension<elt_t>(a, ndx1);
+    const index ldb = fold_leading_dimension<elt_t>(b, ndx2);
+    if (lda == 0 || ldb == 0)
+      return false;
+    const fold_shape shape(a, ndx1, b, ndx2);
+    prepare_output(output, shape.dims);
+    if (output.size() == 0)
+      return true;
+    // C(p,q) = A(p,l) * B(l,q), where A is stored as A(l,p) when the
+    // contracted index is the first one, and B as B(q,l) when it is the last.
+    const char opa = (ndx1 == 0)? 'T' : 'N';
+    const char opb = (ndx2 == 0)? 'N' : 'T';
+    const index p_len = (ndx1 == 0)? shape.j_len : shape.i_len;
+    const index q_len = (ndx2 == 0)? shape.m_len : shape.k_len;
+    gemm(opa, opb, p_len, q_len, shape.l_len, number_one<elt_t>(),
+         pA, lda, pB, ldb, number_zero<elt_t>(), output.begin(), p_len);
+    return true;
+  }
+
+  template<typename elt_t>
+  void
+  do_fold(Tensor<elt_t> &output,
+          const typename Tensor<elt_t>::view &a, int ndx1,
+          const Tensor<elt_t> &b, int ndx2)
+  {
+    if (!fold_strided<elt_t>(output, a, a.begin_const(), ndx1, b, b.begin(), ndx2))
+      do_fold<elt_t,false>(output, Tensor<elt_t>(a), ndx1, b, ndx2);
+  }
+
+  template<typename elt_t>
+  void
+  do_fold(Tensor<elt_t> &output,
+          const Tensor<elt_t> &a, int ndx1,
+          const typename Tensor<elt_t>::view &b, int ndx2)
+  {
+    if (!fold_strided<elt_t>(output, a, a.begin(), ndx1, b, b.begin_const(), ndx2))
+      do_fold<elt_t,false>(output, a, ndx1, Tensor<elt_t>(b), ndx2);
+  }
+
+  template<typename elt_t>
+  void
+  do_fold(Tensor<elt_t> &output,
+          const typename Tensor<elt_t>::view &a, int ndx1,
+          const typename Tensor<elt_t>::view &b, int ndx2)
+  {
+    if (!fold_strided<elt_t>(output, a, a.begin_const(), ndx1, b, b.begin_const(), ndx2))
+      do_fold<elt_t,false>(output, Tensor<elt_t>(a), ndx1, Tensor<elt_t>(b), ndx2);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // BATCHES OF CONTRACTIONS
+  //
+  // Many contractions of tensors with the same shapes are computed at once.
+  // The shapes are analyzed only once and the work is split among the
+  // threads of the library.
+  //
+
+  template<typename elt_t, bool do_conj>
+  class FoldBatchTask : public parallel::Task {
+  public:
+    FoldBatchTask(const fold_shape &shape, elt_t **pC, const elt_t **pA,
+                  const elt_t **pB, index n, index per_chunk) :
+      shape_(shape), pC_(pC), pA_(pA), pB_(pB), n_(n), per_chunk_(per_chunk)
+    {}
+    void run(index c) {
+      index end = std::min(n_, (c + 1) * per_chunk_);
+      for (index n = c * per_chunk_; n < end; n++)
+        fold_gemm<elt_t,do_conj>(shape_, pC_[n], pA_[n], pB_[n]);
+    }
+  private:
+    const fold_shape &shape_;
+    elt_t **pC_;
+    const elt_t **pA_, **pB_;
+    index n_, per_chunk_;
+  };
+
+  template<typename elt_t>
+  static void
+  check_batch(const std::vector<Tensor<elt_t> > &v, const char *name)
+  {
+    for (size_t n = 1; n < v.size(); n++) {
+      if (!all_equal(v[n].dimensions(), v[0].dimensions())) {
+        std::cerr << "In fold(), tensors in batch " << name
+                  << " have different dimensions" << std::endl
+                  << "\t" << v[0].dimensions() << " and "
+                  << v[n].dimensions() << std::endl;
+        abort();
+      }
+    }
+  }
+
+  /*
+   * output[n] = fold(a[n], ndx1, b[n], ndx2). Either A or B may contain a
+   * single tensor, which is then used in all contractions. Tensors in the
+   * output that have the right dimensions and are not shared are reused.
+   */
+  template<typename elt_t, bool do_conj>
+  void
+  do_fold_batch(std::vector<Tensor<elt_t> > &output,
+                const std::vector<Tensor<elt_t> > &a, int ndx1,
+                const std::vector<Tensor<elt_t> > &b, int ndx2)
+  {
+    if (&output == &a || &output == &b) {
+      std::vector<Tensor<elt_t> > aux;
+      do_fold_batch<elt_t,do_conj>(aux, a, ndx1, b, ndx2);
+      output.swap(aux);
+      return;
+    }
+    const index n = std::max(a.size(), b.size());
+    if (a.size() != b.size() && a.size() != 1 && b.size() != 1) {
+      std::cerr << "In fold(), batches have different sizes "
+                << a.size() << " and " << b.size() << std::endl;
+      abort();
+    }
+    if (a.empty() || b.empty()) {
+      output.clear();
+      return;
+    }
+    check_batch(a, "A");
+    check_batch(b, "B");
+    const fold_shape shape(a[0], ndx1, b[0], ndx2);
+    std::vector<elt_t *> pC(n);
+    std::vector<const elt_t *> pA(n), pB(n);
+    output.resize(n);
+    for (index i = 0; i < n; i++) {
+      prepare_output(output[i], shape.dims);
+      pC[i] = output[i].begin();
+      pA[i] = a[a.size() == 1? 0 : i].begin();
+      pB[i] = b[b.size() == 1? 0 : i].begin();
+    }
+    const index work =
+      shape.i_len*shape.j_len*shape.k_len*shape.l_len*shape.m_len;
+    if (work == 0)
+      return;
+    const index per_chunk = std::max<index>(1, parallel::CHUNK / work);
+    FoldBatchTask<elt_t,do_conj> task(shape, &pC[0], &pA[0], &pB[0], n, per_chunk);
+    parallel::run_chunks(task, (n + per_chunk - 1) / per_chunk);
+  }
+
 } // namespace tensor
@@ -75,4 +75,108 @@ namespace tensor {
     fold_into(c, m1, -1, m2, 0);
   }
 
+  /**Contraction of a slice of a tensor with a tensor. When the slice is a
+     strided matrix and the contracted indices are the first or the last
+     ones, the slice is passed to BLAS with its leading dimension instead of
+     being copied.
+
+     \ingroup Tensors
+  */
+  const Tensor<double> fold(const Tensor<double>::view &a, int ndx1,
+                            const Tensor<double> &b, int ndx2)
+  {
+    Tensor<double> output;
+    do_fold<double>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<double> fold(const Tensor<double> &a, int ndx1,
+                            const Tensor<double>::view &b, int ndx2)
+  {
+    Tensor<double> output;
+    do_fold<double>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<double> fold(const Tensor<double>::view &a, int ndx1,
+                            const Tensor<double>::view &b, int ndx2)
+  {
+    Tensor<double> output;
+    do_fold<double>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<double> mmult(const Tensor<double>::view &m1, const Tensor<double> &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  const Tensor<double> mmult(const Tensor<double> &m1, const Tensor<double>::view &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  const Tensor<double> mmult(const Tensor<double>::view &m1, const Tensor<double>::view &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  /**Batch of contractions. \c C=fold(A,ndx1,B,ndx2) computes
+     \c C[n]=fold(A[n],ndx1,B[n],ndx2) for vectors of tensors that have all
+     the same dimensions. If \c A or \c B contain a single tensor, it is
+     contracted with all the tensors of the other vector. This is faster than
+     calling fold() repeatedly when the tensors are small, because the shapes
+     are analyzed only once and the contractions are distributed among the
+     threads of the library.
+
+     \ingroup Tensors
+  */
+  const std::vector<RTensor> fold(const std::vector<RTensor> &a, int ndx1,
+                                  const std::vector<RTensor> &b, int ndx2)
+  {
+    std::vector<RTensor> output;
+    do_fold_batch<double, false>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  /**Batch of contractions. For real tensors, \c foldc(A,ndx1,B,ndx2) does
+     the same as \c fold(A,ndx1,B,ndx2).
+
+     \ingroup Tensors
+  */
+  const std::vector<RTensor> foldc(const std::vector<RTensor> &a, int ndx1,
+                                   const std::vector<RTensor> &b, int ndx2)
+  {
+    std::vector<RTensor> output;
+    do_fold_batch<double, false>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  /**Batch of contractions into existing tensors. The tensors in \c C are
+     reused if they have the right dimensions and share no data, so that
+     repeated contractions of the same shapes need no memory allocation.
+
+     \ingroup Tensors
+  */
+  void fold_into(std::vector<RTensor> &c,
+                 const std::vector<RTensor> &a, int ndx1,
+                 const std::vector<RTensor> &b, int ndx2)
+  {
+    do_fold_batch<double, false>(c, a, ndx1, b, ndx2);
+  }
+
+  /**Batch of matrix multiplications. \c mmult(A,B) is equivalent to
+     \c fold(A,-1,B,0). */
+  const std::vector<RTensor> mmult(const std::vector<RTensor> &m1,
+                                   const std::vector<RTensor> &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  void mmult_into(std::vector<RTensor> &c, const std::vector<RTensor> &m1,
+                  const std::vector<RTensor> &m2)
+  {
+    fold_into(c, m1, -1, m2, 0);
+  }
+
 } // namespace tensor
@@ -84,4 +84,108 @@ namespace tensor {
     fold_into(c, m1, -1, m2, 0);
   }
 
+  /**Contraction of a slice of a tensor with a tensor. When the slice is a
+     strided matrix and the contracted indices are the first or the last
+     ones, the slice is passed to BLAS with its leading dimension instead of
+     being copied.
+
+     \ingroup Tensors
+  */
+  const Tensor<cdouble> fold(const Tensor<cdouble>::view &a, int ndx1,
+                             const Tensor<cdouble> &b, int ndx2)
+  {
+    Tensor<cdouble> output;
+    do_fold<cdouble>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<cdouble> fold(const Tensor<cdouble> &a, int ndx1,
+                             const Tensor<cdouble>::view &b, int ndx2)
+  {
+    Tensor<cdouble> output;
+    do_fold<cdouble>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<cdouble> fold(const Tensor<cdouble>::view &a, int ndx1,
+                             const Tensor<cdouble>::view &b, int ndx2)
+  {
+    Tensor<cdouble> output;
+    do_fold<cdouble>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  const Tensor<cdouble> mmult(const Tensor<cdouble>::view &m1, const Tensor<cdouble> &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  const Tensor<cdouble> mmult(const Tensor<cdouble> &m1, const Tensor<cdouble>::view &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  const Tensor<cdouble> mmult(const Tensor<cdouble>::view &m1, const Tensor<cdouble>::view &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  /**Batch of contractions. \c C=fold(A,ndx1,B,ndx2) computes
+     \c C[n]=fold(A[n],ndx1,B[n],ndx2) for vectors of tensors that have all
+     the same dimensions. If \c A or \c B contain a single tensor, it is
+     contracted with all the tensors of the other vector. This is faster than
+     calling fold() repeatedly when the tensors are small, because the shapes
+     are analyzed only once and the contractions are distributed among the
+     threads of the library.
+
+     \ingroup Tensors
+  */
+  const std::vector<CTensor> fold(const std::vector<CTensor> &a, int ndx1,
+                                  const std::vector<CTensor> &b, int ndx2)
+  {
+    std::vector<CTensor> output;
+    do_fold_batch<cdouble, false>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  /**Batch of contractions with the complex conjugate of the tensors in
+     \c A. See the batched fold() for details.
+
+     \ingroup Tensors
+  */
+  const std::vector<CTensor> foldc(const std::vector<CTensor> &a, int ndx1,
+                                   const std::vector<CTensor> &b, int ndx2)
+  {
+    std::vector<CTensor> output;
+    do_fold_batch<cdouble, true>(output, a, ndx1, b, ndx2);
+    return output;
+  }
+
+  /**Batch of contractions into existing tensors. The tensors in \c C are
+     reused if they have the right dimensions and share no data, so that
+     repeated contractions of the same shapes need no memory allocation.
+
+     \ingroup Tensors
+  */
+  void fold_into(std::vector<CTensor> &c,
+                 const std::vector<CTensor> &a, int ndx1,
+                 const std::vector<CTensor> &b, int ndx2)
+  {
+    do_fold_batch<cdouble, false>(c, a, ndx1, b, ndx2);
+  }
+
+  /**Batch of matrix multiplications. \c mmult(A,B) is equivalent to
+     \c fold(A,-1,B,0). */
+  const std::vector<CTensor> mmult(const std::vector<CTensor> &m1,
+                                   const std::vector<CTensor> &m2)
+  {
+    return fold(m1, -1, m2, 0);
+  }
+
+  void mmult_into(std::vector<CTensor> &c, const std::vector<CTensor> &m1,
+                  const std::vector<CTensor> &m2)
+  {
+    fold_into(c, m1, -1, m2, 0);
+  }
+
 } // namespace tensor
@@ -18,13 +18,24 @@
 
 #include <algorithm>
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
+  struct MaxReducer {
+    typedef double value_type;
+    const double *p;
+    value_type partial(index begin, index end) const {
+      return *(std::max_element(p + begin, p + end));
+    }
+    value_type combine(value_type a, value_type b) const { return a < b? b : a; }
+  };
+
   double max(const RTensor &r)
   {
     assert(r.size());
-    return *(std::max_element(r.begin_const(), r.end_const()));
+    MaxReducer reducer = { r.begin_const() };
+    return parallel::reduce(reducer, r.size());
   }
 
 } // namespace tensor
@@ -18,13 +18,24 @@
 
 #include <algorithm>
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
+  struct MinReducer {
+    typedef double value_type;
+    const double *p;
+    value_type partial(index begin, index end) const {
+      return *(std::min_element(p + begin, p + end));
+    }
+    value_type combine(value_type a, value_type b) const { return b < a? b : a; }
+  };
+
   double min(const RTensor &r)
   {
     assert(r.size());
-    return *(std::min_element(r.begin_const(), r.end_const()));
+    MinReducer reducer = { r.begin_const() };
+    return parallel::reduce(reducer, r.size());
   }
 
 } // namespace tensor
@@ -18,16 +18,27 @@
 
 #define TENSOR_LOAD_IMPL
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
+  struct RNorm0Reducer {
+    typedef double value_type;
+    const double *p;
+    value_type partial(index begin, index end) const {
+      double output = 0;
+      for (index i = begin; i < end; i++) {
+        output = std::max(output, abs(p[i]));
+      }
+      return output;
+    }
+    value_type combine(value_type a, value_type b) const { return std::max(a, b); }
+  };
+
   double norm0(const RTensor &r)
   {
-    double output = 0;
-    for (RTensor::const_iterator it = r.begin(); it != r.end(); ++it) {
-      output = std::max(output, abs(*it));
-    }
-    return output;
+    RNorm0Reducer reducer = { r.begin() };
+    return parallel::reduce(reducer, r.size());
   }
 
 } // namespace tensor
@@ -18,6 +18,7 @@
 
 #define TENSOR_LOAD_IMPL
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
@@ -26,13 +27,22 @@ namespace tensor {
     return ::sqrt(scprod(r, r));
   }
 
+  struct RScprodReducer {
+    typedef double value_type;
+    const double *a, *b;
+    value_type partial(index begin, index end) const {
+      double output = 0;
+      for (index i = begin; i < end; i++)
+        output += a[i] * b[i];
+      return output;
+    }
+    value_type combine(value_type x, value_type y) const { return x + y; }
+  };
+
   double scprod(const RTensor &a, const RTensor &b)
   {
-    double output = 0;
-    for (RTensor::const_iterator ia = a.begin(), ib = b.begin();
-	 ia != a.end(); ia++, ib++)
-      output += (*ia) * (*ib);
-    return output;  
+    RScprodReducer reducer = { a.begin(), b.begin() };
+    return parallel::reduce(reducer, a.size());
   }
 
 } // namespace tensor
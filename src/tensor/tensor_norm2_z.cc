@@ -18,6 +18,7 @@
 
 #define TENSOR_LOAD_IMPL
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
@@ -26,13 +27,22 @@ namespace tensor {
     return ::sqrt(real(scprod(r, r)));
   }
 
+  struct CScprodReducer {
+    typedef cdouble value_type;
+    const cdouble *a, *b;
+    value_type partial(index begin, index end) const {
+      cdouble output = 0;
+      for (index i = begin; i < end; i++)
+        output += a[i] * tensor::conj(b[i]);
+      return output;
+    }
+    value_type combine(value_type x, value_type y) const { return x + y; }
+  };
+
   cdouble scprod(const CTensor &a, const CTensor &b)
   {
-    cdouble output = 0;
-    for (CTensor::const_iterator ia = a.begin(), ib = b.begin();
-	 ia != a.end(); ia++, ib++)
-      output += (*ia) * tensor::conj(*ib);
-    return output;  
+    CScprodReducer reducer = { a.begin(), b.begin() };
+    return parallel::reduce(reducer, a.size());
   }
 
 } // namespace tensor
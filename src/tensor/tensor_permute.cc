@@ -19,7 +19,10 @@
 
 #define TENSOR_LOAD_IMPL
 #include <string.h>
+#include <algorithm>
+#include <vector>
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
@@ -193,4 +196,214 @@ namespace tensor {
     return reshape(a, new_dims);
   }
 
+  //////////////////////////////////////////////////////////////////////
+  // GENERAL PERMUTATIONS
+  //
+  // The permutation is first simplified: dimensions of size one are dropped
+  // and input dimensions that remain together and in the same order in the
+  // output are fused. If the first dimension of the input is still the first
+  // one of the output, the permutation copies contiguous columns. Otherwise
+  // it transposes tiles formed by the first dimension of the input and the
+  // first dimension of the output, which are the only ones with unit
+  // stride. All other dimensions are traversed with an odometer, and the
+  // work is split among threads in groups of columns or strips of tiles.
+  //
+
+  struct permutation_plan {
+    std::vector<index> dims;     // Fused dimensions, in input order
+    std::vector<index> perm;     // Output dimension k is input dimension perm[k]
+
+    permutation_plan(const Indices &d, const Indices &p) {
+      index rank = d.size();
+      // Position of each input dimension among those larger than one.
+      std::vector<index> compact(rank, -1);
+      index m = 0;
+      for (index i = 0; i < rank; i++) {
+        if (d[i] > 1) compact[i] = m++;
+      }
+      // Output order, fusing runs of consecutive input dimensions.
+      std::vector<index> first, size;
+      index last = -2;
+      for (index k = 0; k < rank; k++) {
+        index c = compact[p[k]];
+        if (c < 0) continue;
+        if (c == last + 1) {
+          size.back() *= d[p[k]];
+        } else {
+          first.push_back(c);
+          size.push_back(d[p[k]]);
+        }
+        last = c;
+      }
+      // The fused dimensions are numbered in input order.
+      std::vector<index> sorted(first);
+      std::sort(sorted.begin(), sorted.end());
+      dims.resize(first.size());
+      perm.resize(first.size());
+      for (size_t k = 0; k < first.size(); k++) {
+        index i = std::lower_bound(sorted.begin(), sorted.end(), first[k]) - sorted.begin();
+        perm[k] = i;
+        dims[i] = size[k];
+      }
+    }
+
+    bool is_identity() const {
+      for (size_t k = 0; k < perm.size(); k++)
+        if (perm[k] != (index)k) return false;
+      return true;
+    }
+  };
+
+  /* Multi-index over the dimensions that are not handled by the inner
+     loops, tracking the offsets in the input and output tensors. */
+  struct permute_odometer {
+    std::vector<index> dims, in_stride, out_stride, pos;
+    index in, out;
+
+    void add(index d, index is, index os) {
+      dims.push_back(d);
+      in_stride.push_back(is);
+      out_stride.push_back(os);
+      pos.push_back(0);
+    }
+    void seek(index n) {
+      in = out = 0;
+      for (size_t k = 0; k < dims.size(); k++) {
+        pos[k] = n % dims[k];
+        n /= dims[k];
+        in += pos[k] * in_stride[k];
+        out += pos[k] * out_stride[k];
+      }
+    }
+    void next() {
+      for (size_t k = 0; k < dims.size(); k++) {
+        in += in_stride[k];
+        out += out_stride[k];
+        if (++pos[k] < dims[k])
+          return;
+        in -= dims[k] * in_stride[k];
+        out -= dims[k] * out_stride[k];
+        pos[k] = 0;
+      }
+    }
+  };
+
+  /* b[j + i*ldb] = a[i + j*lda] for a block of fixed size, which the
+     compiler unrolls and vectorizes. */
+  template<typename elt_t, int M>
+  inline void permute_micro(elt_t *b, index ldb, const elt_t *a, index lda)
+  {
+    for (int j = 0; j < M; j++)
+      for (int i = 0; i < M; i++)
+        b[j + i*ldb] = a[i + j*lda];
+  }
+
+  template<typename elt_t>
+  class PermuteTask : public parallel::Task {
+  public:
+    /* Tiles of 128 bytes per side; micro blocks of 64 bytes. */
+    enum { TILE = 128 / sizeof(elt_t), MICRO = 64 / sizeof(elt_t) };
+
+    PermuteTask(elt_t *b, const elt_t *a, const permutation_plan &plan) :
+      a_(a), b_(b)
+    {
+      index rank = plan.dims.size();
+      std::vector<index> in_stride(rank), out_stride(rank);
+      for (index i = 0, s = 1; i < rank; s *= plan.dims[i++])
+        in_stride[i] = s;
+      for (index k = 0, s = 1; k < rank; s *= plan.dims[plan.perm[k++]])
+        out_stride[plan.perm[k]] = s;
+      n0_ = plan.dims[0];
+      if (plan.perm[0] == 0) {
+        // Contiguous columns of length n0_
+        n1_ = 0;
+        per_unit_ = n0_;
+      } else {
+        // Tiles of the input dimension 0, which has output stride ldb_,
+        // and of the input dimension perm[0], with input stride lda_.
+        index j = plan.perm[0];
+        n1_ = plan.dims[j];
+        lda_ = in_stride[j];
+        ldb_ = out_stride[0];
+        index strips = (n1_ + TILE - 1) / TILE;
+        outer_.add(strips, TILE * lda_, TILE);
+        per_unit_ = n0_ * TILE;
+      }
+      for (index k = 1; k < rank; k++) {
+        index i = plan.perm[k];
+        if (i != 0)
+          outer_.add(plan.dims[i], in_stride[i], out_stride[i]);
+      }
+      units_ = 1;
+      for (size_t k = 0; k < outer_.dims.size(); k++)
+        units_ *= outer_.dims[k];
+      units_per_chunk_ = std::max<index>(1, parallel::CHUNK / per_unit_);
+    }
+
+    index chunks() const {
+      return (units_ + units_per_chunk_ - 1) / units_per_chunk_;
+    }
+
+    void run(index c) {
+      permute_odometer o = outer_;
+      index u = c * units_per_chunk_;
+      index end = std::min(units_, u + units_per_chunk_);
+      for (o.seek(u); u < end; u++, o.next()) {
+        if (n1_ == 0) {
+          std::copy(a_ + o.in, a_ + o.in + n0_, b_ + o.out);
+        } else {
+          index j0 = o.pos[0] * TILE;
+          strip(b_ + o.out, a_ + o.in, std::min<index>(TILE, n1_ - j0));
+        }
+      }
+    }
+
+  private:
+    const elt_t *a_;
+    elt_t *b_;
+    index n0_, n1_, lda_, ldb_;
+    index units_, units_per_chunk_, per_unit_;
+    permute_odometer outer_;
+
+    /* Transpose the rows 0 <= j < nj of all columns 0 <= i < n0_ */
+    void strip(elt_t *b, const elt_t *a, index nj) {
+      for (index i0 = 0; i0 < n0_; i0 += TILE) {
+        index ni = std::min<index>(TILE, n0_ - i0);
+        if (ni == TILE && nj == TILE) {
+          for (index j = 0; j < TILE; j += MICRO)
+            for (index i = i0; i < i0 + TILE; i += MICRO)
+              permute_micro<elt_t,MICRO>(b + j + i*ldb_, ldb_, a + i + j*lda_, lda_);
+        } else {
+          for (index i = i0; i < i0 + ni; i++)
+            for (index j = 0; j < nj; j++)
+              b[j + i*ldb_] = a[i + j*lda_];
+        }
+      }
+    }
+  };
+
+  template<typename n>
+  const Tensor<n> do_permute(const Tensor<n> &a, const Indices &perm)
+  {
+    index rank = a.rank();
+    assert(perm.size() == rank);
+    const Indices &dims = a.dimensions();
+    Indices new_dims(rank);
+    std::vector<bool> seen(rank, false);
+    for (index k = 0; k < rank; k++) {
+      index i = perm[k];
+      assert(i >= 0 && i < rank && !seen[i]);
+      seen[i] = true;
+      new_dims.at(k) = dims[i];
+    }
+    permutation_plan plan(dims, perm);
+    if (a.size() == 0 || plan.is_identity()) {
+      return reshape(a, new_dims);
+    }
+    Tensor<n> output(new_dims);
+    PermuteTask<n> task(output.begin(), a.begin(), plan);
+    parallel::run_chunks(task, task.chunks());
+    return output;
+  }
+
 } // namespace tensor
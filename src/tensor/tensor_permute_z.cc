@@ -26,4 +26,16 @@ namespace tensor {
     return do_permute(a, i1, i2);
   }
 
+  /**Permutation of the indices of a tensor. The output has dimension k
+     equal to dimension perm[k] of the input, so that, for instance, with
+     perm = [2,0,1] we get \f$B_{kij} = A_{ijk}\f$. All indices are
+     permuted in a single pass over the data.
+
+     \ingroup Tensors
+  */
+  const CTensor permute(const CTensor &a, const Indices &perm)
+  {
+    return do_permute(a, perm);
+  }
+
 } // namespace tensor
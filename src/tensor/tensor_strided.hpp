@@ -0,0 +1,204 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#if !defined(TENSOR_TENSOR_H) || defined(TENSOR_DETAIL_TENSOR_STRIDED_HPP)
+#error "This header cannot be included manually"
+#else
+#define TENSOR_DETAIL_TENSOR_STRIDED_HPP
+
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <tensor/indices.h>
+
+namespace tensor {
+
+  //////////////////////////////////////////////////////////////////////
+  // TRAVERSAL OF SLICES
+  //
+  // A slice is given by a pointer to its first element, the dimensions of
+  // its indices and, for each index, either the distance between
+  // consecutive elements or a table with the position of each element.
+  // The slice is traversed as a nest of loops, the innermost of which is
+  // a plain loop over (pointer, stride, count) that can use memcpy() or
+  // SIMD kernels when the stride is one.
+  //
+
+  /*
+   * Loop nest of a slice. Indices of length one are dropped, and
+   * consecutive indices that can be traversed with a single stride are
+   * merged, so that a block of whole columns is a single run.
+   */
+  struct slice_loops {
+    enum { max_loops = 6 };
+    index n, offset;
+    index len[max_loops], step[max_loops];
+    const Indices *table[max_loops];
+    bool empty;
+
+    slice_loops(const Indices &dims, const Indices &strides,
+                const std::vector<Indices> &tables) :
+      n(0), offset(0), empty(false)
+    {
+      assert(dims.size() <= max_loops);
+      for (index d = 0; d < dims.size(); d++) {
+        const Indices *t = tables.empty()? 0 : &tables[d];
+        if (t && t->size() == 0)
+          t = 0;
+        if (dims[d] == 0) {
+          empty = true;
+        } else if (dims[d] == 1) {
+          offset += t? (*t)[0] : 0;
+        } else if (!t && n && !table[n-1] && strides[d] == step[n-1] * len[n-1]) {
+          len[n-1] *= dims[d];
+        } else {
+          len[n] = dims[d];
+          step[n] = t? 0 : strides[d];
+          table[n] = t;
+          n++;
+        }
+      }
+    }
+
+    // Position of the c-th element along the d-th loop.
+    index position(index d, index c) const {
+      return table[d]? (*table[d])[c] : c * step[d];
+    }
+  };
+
+  /*
+   * Invoke f(p, stride, count) for every run of the elements of a slice,
+   * in the order of the elements of the slice. In loops with a table,
+   * elements with consecutive positions make up a single run.
+   */
+  template<typename ptr_t, class function_t>
+  void
+  for_each_run(ptr_t p, const Indices &dims, const Indices &strides,
+               const std::vector<Indices> &tables, function_t &f)
+  {
+    const slice_loops loops(dims, strides, tables);
+    if (loops.empty)
+      return;
+    p += loops.offset;
+    const index n = loops.n;
+    if (n == 0) {
+      f(p, 1, 1);
+      return;
+    }
+    index counter[slice_loops::max_loops];
+    for (index d = 1; d < n; d++) {
+      counter[d] = 0;
+      p += loops.position(d, 0);
+    }
+    while (1) {
+      if (loops.table[0]) {
+        const Indices &t = *loops.table[0];
+        for (index i = 0, j; i < loops.len[0]; i = j) {
+          for (j = i + 1; j < loops.len[0] && t[j] == t[j-1] + 1; j++)
+            ;
+          f(p + t[i], 1, j - i);
+        }
+      } else {
+        f(p, loops.step[0], loops.len[0]);
+      }
+      index d = 1;
+      for (; d < n; d++) {
+        index c = counter[d];
+        p -= loops.position(d, c);
+        if (++c < loops.len[d]) {
+          counter[d] = c;
+          p += loops.position(d, c);
+          break;
+        }
+        counter[d] = 0;
+        p += loops.position(d, 0);
+      }
+      if (d == n)
+        return;
+    }
+  }
+
+  template<typename ptr_t, class function_t>
+  inline void
+  for_each_run(ptr_t p, const Indices &dims, const Indices &strides,
+               function_t &f)
+  {
+    for_each_run(p, dims, strides, std::vector<Indices>(), f);
+  }
+
+  /*
+   * Copy the runs of a slice one after another into contiguous memory.
+   * Short runs, such as those of an irregular list of indices, are copied
+   * element by element, which is cheaper than calling memcpy().
+   */
+  template<typename elt_t>
+  struct copy_runs {
+    elt_t *output;
+    void operator()(const elt_t *p, index stride, index count) {
+      if (stride == 1 && count > 8) {
+        memcpy(output, p, count * sizeof(elt_t));
+        output += count;
+      } else {
+        for (; count; count--, p += stride) {
+          *(output++) = *p;
+        }
+      }
+    }
+  };
+
+  /*
+   * Copy contiguous memory into the runs of a slice.
+   */
+  template<typename elt_t>
+  struct assign_runs {
+    const elt_t *input;
+    void operator()(elt_t *p, index stride, index count) {
+      if (stride == 1 && count > 8) {
+        memcpy(p, input, count * sizeof(elt_t));
+        input += count;
+      } else {
+        for (; count; count--, p += stride) {
+          *p = *(input++);
+        }
+      }
+    }
+  };
+
+  /*
+   * Set all elements of a slice to the same value.
+   */
+  template<typename elt_t>
+  struct fill_runs {
+    elt_t value;
+    void operator()(elt_t *p, index stride, index count) {
+      if (stride == 1) {
+        std::fill(p, p + count, value);
+      } else {
+        for (; count; count--, p += stride) {
+          *p = value;
+        }
+      }
+    }
+  };
+
+} // namespace tensor
+
+#endif // !TENSOR_DETAIL_TENSOR_STRIDED_HPP
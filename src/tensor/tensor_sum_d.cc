@@ -18,12 +18,23 @@
 
 #include <numeric>
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
+  struct RSumReducer {
+    typedef double value_type;
+    const double *p;
+    value_type partial(index begin, index end) const {
+      return std::accumulate(p + begin, p + end, (double)0.0);
+    }
+    value_type combine(value_type a, value_type b) const { return a + b; }
+  };
+
   double sum(const RTensor &r)
   {
-    return std::accumulate(r.begin_const(), r.end_const(), (double)0.0);
+    RSumReducer reducer = { r.begin_const() };
+    return parallel::reduce(reducer, r.size());
   }
 
 } // namespace tensor
@@ -18,12 +18,23 @@
 
 #include <numeric>
 #include <tensor/tensor.h>
+#include "../tools/parallel.h"
 
 namespace tensor {
 
+  struct CSumReducer {
+    typedef cdouble value_type;
+    const cdouble *p;
+    value_type partial(index begin, index end) const {
+      return std::accumulate(p + begin, p + end, to_complex(0));
+    }
+    value_type combine(value_type a, value_type b) const { return a + b; }
+  };
+
   cdouble sum(const CTensor &r)
   {
-    return std::accumulate(r.begin(), r.end(), to_complex(0));
+    CSumReducer reducer = { r.begin() };
+    return parallel::reduce(reducer, r.size());
   }
 
 } // namespace tensor
@@ -18,6 +18,7 @@
 */
 
 #include <cassert>
+#include "tensor_strided.hpp"
 
 /**\cond IGNORE */
 
@@ -31,11 +32,9 @@ namespace tensor {
   Tensor<elt_t>::view::operator Tensor<elt_t>() const
   {
     Tensor<elt_t> t(dims_);
-    typename Tensor<elt_t>::iterator it = t.begin();
-    ranges_->reset();
-    for (index j; (j = ranges_->pop()) != ranges_->nomore(); it++) {
-      *it = data_[j];
-    }
+    // Runs of consecutive elements are copied with memcpy()
+    copy_runs<elt_t> f = { t.begin() };
+    for_each_run(begin_const(), dims_, strides_, tables_, f);
     return t;
   }
 
@@ -48,96 +47,49 @@ namespace tensor {
   {
     // a(range) is valid for 1D and for ND tensors which are treated
     // as being 1D
-    Indices dims(1);
-    r->set_limit(size());
-    dims.at(0) = r->size();
-    return view(*this, dims, r);
+    Range *ranges[1] = { r };
+    return view(*this, ranges, 1);
   }
 
   template<typename elt_t> const typename Tensor<elt_t>::view
   Tensor<elt_t>::operator()(PRange r1, PRange r2) const
   {
-    Indices dims(2);
     assert(this->rank() == 2);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    Range *r = product(r1, r2);
-    return view(*this, dims, r);
+    Range *ranges[2] = { r1, r2 };
+    return view(*this, ranges, 2);
   }
 
   template<typename elt_t> const typename Tensor<elt_t>::view
   Tensor<elt_t>::operator()(PRange r1, PRange r2, PRange r3) const
   {
-    Indices dims(3);
     assert(this->rank() == 3);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    Range *r = product(r1, product(r2, r3));
-    return view(*this, dims, r);
+    Range *ranges[3] = { r1, r2, r3 };
+    return view(*this, ranges, 3);
   }
 
   template<typename elt_t> const typename Tensor<elt_t>::view
   Tensor<elt_t>::operator()(PRange r1, PRange r2, PRange r3, PRange r4) const
   {
-    Indices dims(4);
     assert(this->rank() == 4);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    Range *r = product(r1, product(r2, product(r3, r4)));
-    return view(*this, dims, r);
+    Range *ranges[4] = { r1, r2, r3, r4 };
+    return view(*this, ranges, 4);
   }
 
   template<typename elt_t> const typename Tensor<elt_t>::view
   Tensor<elt_t>::operator()(PRange r1, PRange r2, PRange r3, PRange r4, PRange r5) const
   {
-    Indices dims(5);
     assert(this->rank() == 5);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    r5->set_limit(dimension(4));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    dims.at(4) = r5->size();
-    PRange r = product(r1, product(r2, product(r3, product(r4, r5))));
-    return view(*this, dims, r);
+    Range *ranges[5] = { r1, r2, r3, r4, r5 };
+    return view(*this, ranges, 5);
   }
 
   template<typename elt_t> const typename  Tensor<elt_t>::view
   Tensor<elt_t>::operator()(PRange r1, PRange r2, PRange r3,
                             PRange r4, PRange r5, PRange r6) const
   {
-    Indices dims(6);
     assert(this->rank() == 6);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    r5->set_limit(dimension(4));
-    r6->set_limit(dimension(5));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    dims.at(4) = r5->size();
-    dims.at(5) = r6->size();
-    Range *r = product(r1, product(r2, product(r3, product(r4, product(r5, r6)))));
-    return view(*this, dims, r);
+    Range *ranges[6] = { r1, r2, r3, r4, r5, r6 };
+    return view(*this, ranges, 6);
   }
 
   ////////////////////////////////////////////////////////////
@@ -147,98 +99,51 @@ namespace tensor {
   template<typename elt_t> typename Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r)
   {
-    Indices dims(1);
     // a(range) is valid for 1D and for ND tensors which are treated
     // as being 1D
-    r->set_limit(size());
-    dims.at(0) = r->size();
-    return mutable_view(*this, dims, r);
+    Range *ranges[1] = { r };
+    return mutable_view(*this, ranges, 1);
   }
 
   template<typename elt_t> typename Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r1, PRange r2)
   {
-    Indices dims(2);
     assert(this->rank() == 2);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    Range *r = product(r1, r2);
-    return mutable_view(*this, dims, r);
+    Range *ranges[2] = { r1, r2 };
+    return mutable_view(*this, ranges, 2);
   }
 
   template<typename elt_t> typename Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r1, PRange r2, PRange r3)
   {
-    Indices dims(3);
     assert(this->rank() == 3);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    Range *r = product(r1, product(r2, r3));
-    return mutable_view(*this, dims, r);
+    Range *ranges[3] = { r1, r2, r3 };
+    return mutable_view(*this, ranges, 3);
   }
 
   template<typename elt_t> typename Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r1, PRange r2, PRange r3, PRange r4)
   {
-    Indices dims(4);
     assert(this->rank() == 4);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    Range *r = product(r1, product(r2, product(r3, r4)));
-    return mutable_view(*this, dims, r);
+    Range *ranges[4] = { r1, r2, r3, r4 };
+    return mutable_view(*this, ranges, 4);
   }
 
   template<typename elt_t> typename Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r1, PRange r2, PRange r3, PRange r4, PRange r5)
   {
-    Indices dims(5);
     assert(this->rank() == 5);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    r5->set_limit(dimension(4));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    dims.at(4) = r5->size();
-    Range *r = product(r1, product(r2, product(r3, product(r4, r5))));
-    return mutable_view(*this, dims, r);
+    Range *ranges[5] = { r1, r2, r3, r4, r5 };
+    return mutable_view(*this, ranges, 5);
   }
 
   template<typename elt_t> typename  Tensor<elt_t>::mutable_view
   Tensor<elt_t>::at(PRange r1, PRange r2, PRange r3,
                     PRange r4, PRange r5, PRange r6)
   {
-    Indices dims(6);
     assert(this->rank() == 6);
-    r1->set_limit(dimension(0));
-    r2->set_limit(dimension(1));
-    r3->set_limit(dimension(2));
-    r4->set_limit(dimension(3));
-    r5->set_limit(dimension(4));
-    r6->set_limit(dimension(5));
-    dims.at(0) = r1->size();
-    dims.at(1) = r2->size();
-    dims.at(2) = r3->size();
-    dims.at(3) = r4->size();
-    dims.at(4) = r5->size();
-    dims.at(5) = r6->size();
-    Range *r = product(r1, product(r2, product(r3, product(r4, product(r5, r6)))));
-    return mutable_view(*this, dims, r);
+    Range *ranges[6] = { r1, r2, r3, r4, r5, r6 };
+    return mutable_view(*this, ranges, 6);
   }
 
   //////////////////////////////////////////////////////////////////////
@@ -249,16 +154,8 @@ namespace tensor {
   Tensor<elt_t>::mutable_view::operator=
   (const typename Tensor<elt_t>::view &t)
   {
-    //assert(verify_tensor_dimensions_match(dims_, t.dims_));
-    assert(dims_.total_size() == t.dims_.total_size());
-    Range *r1 = ranges_;
-    Range *r2 = t.ranges_;
-    r1->reset();
-    r2->reset();
-    for (index i, j;
-         (i = r1->pop(), j = r2->pop(), i != r1->nomore() && j != r2->nomore()); ) {
-      data_.at(i) = t.data_[j];
-    }
+    // The slice is first copied, because it may overlap with this one.
+    *this = Tensor<elt_t>(t);
   }
 
   template<typename elt_t> void
@@ -266,19 +163,16 @@ namespace tensor {
   {
     //assert(verify_tensor_dimensions_match(dims_, t.dimensions()));
     assert(dims_.total_size() == t.dims_.total_size());
-    ranges_->reset();
-    for (index i = 0, j; (j = ranges_->pop()) != ranges_->nomore(); i++) {
-      data_.at(j) = t[i];
-    }
+    // Runs of consecutive elements are copied with memcpy()
+    assign_runs<elt_t> f = { t.begin() };
+    for_each_run(data_.begin() + offset_, dims_, strides_, tables_, f);
   }
 
   template<typename elt_t> void
   Tensor<elt_t>::mutable_view::operator=(elt_t v)
   {
-    ranges_->reset();
-    for (index i; (i = ranges_->pop()) != ranges_->nomore(); ) {
-      data_.at(i) = v;
-    }
+    fill_runs<elt_t> f = { v };
+    for_each_run(data_.begin() + offset_, dims_, strides_, tables_, f);
   }
 
 } // namespace tensor
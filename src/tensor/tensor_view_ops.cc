@@ -0,0 +1,162 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#define TENSOR_LOAD_IMPL
+#include <cassert>
+#include <algorithm>
+#include <tensor/tensor.h>
+#include "tensor_strided.hpp"
+#include "../simd/simd.h"
+
+namespace tensor {
+
+  //////////////////////////////////////////////////////////////////////
+  // OPERATIONS WITH SLICES OF TENSORS
+  //
+  // Strided slices are traversed in place, run by run, instead of being
+  // copied into a new tensor. Other slices are first converted to tensors.
+  //
+
+  template<typename elt_t>
+  struct sum_runs {
+    elt_t value;
+    void operator()(const elt_t *p, index stride, index count) {
+      for (; count; count--, p += stride)
+        value += *p;
+    }
+  };
+
+  template<typename elt_t>
+  static elt_t
+  do_sum(const typename Tensor<elt_t>::view &v)
+  {
+    if (!v.is_strided())
+      return sum(Tensor<elt_t>(v));
+    sum_runs<elt_t> f = { number_zero<elt_t>() };
+    for_each_run(v.begin_const(), v.dimensions(), v.strides(), f);
+    return f.value;
+  }
+
+  template<typename elt_t>
+  struct norm2_runs {
+    double value;
+    void operator()(const elt_t *p, index stride, index count) {
+      for (; count; count--, p += stride)
+        value += abs2(*p);
+    }
+  };
+
+  template<typename elt_t>
+  static double
+  do_norm2(const typename Tensor<elt_t>::view &v)
+  {
+    if (!v.is_strided())
+      return norm2(Tensor<elt_t>(v));
+    norm2_runs<elt_t> f = { 0.0 };
+    for_each_run(v.begin_const(), v.dimensions(), v.strides(), f);
+    return ::sqrt(f.value);
+  }
+
+  /*
+   * output[i] = t[i] op v[i], or v[i] op t[i] when VIEW_FIRST is true, where
+   * v[i] are the elements of the runs of a slice. Runs that are not
+   * contiguous are gathered into a small buffer, so that OUTPUT may be T.
+   */
+  template<typename elt_t>
+  struct binop_runs {
+    simd::binop_t op;
+    bool view_first;
+    elt_t *output;
+    const elt_t *t;
+
+    void apply(const elt_t *p, index count) {
+      if (view_first)
+        simd::binop(op, output, p, t, count);
+      else
+        simd::binop(op, output, t, p, count);
+      output += count;
+      t += count;
+    }
+    void operator()(const elt_t *p, index stride, index count) {
+      if (stride == 1) {
+        apply(p, count);
+      } else {
+        const index buffer_size = 256;
+        elt_t buffer[buffer_size];
+        while (count) {
+          index n = std::min(count, buffer_size);
+          for (index i = 0; i < n; i++, p += stride)
+            buffer[i] = *p;
+          apply(buffer, n);
+          count -= n;
+        }
+      }
+    }
+  };
+
+  template<typename elt_t>
+  static const Tensor<elt_t>
+  do_binop(simd::binop_t op, const Tensor<elt_t> &t,
+           const typename Tensor<elt_t>::view &v, bool view_first)
+  {
+    assert(t.size() == v.size());
+    Tensor<elt_t> output(view_first? v.dimensions() : t.dimensions());
+    if (v.is_strided()) {
+      binop_runs<elt_t> f = { op, view_first, output.begin(), t.begin() };
+      for_each_run(v.begin_const(), v.dimensions(), v.strides(), f);
+    } else {
+      Tensor<elt_t> aux(v);
+      if (view_first)
+        simd::binop(op, output.begin(), aux.begin(), t.begin(), t.size());
+      else
+        simd::binop(op, output.begin(), t.begin(), aux.begin(), t.size());
+    }
+    return output;
+  }
+
+  template<typename elt_t>
+  static const Tensor<elt_t>
+  do_binop(simd::binop_t op, const typename Tensor<elt_t>::view &a,
+           const typename Tensor<elt_t>::view &b)
+  {
+    return do_binop<elt_t>(op, Tensor<elt_t>(a), b, false);
+  }
+
+  template<typename elt_t>
+  static Tensor<elt_t> &
+  do_binop_in_place(simd::binop_t op, Tensor<elt_t> &t,
+                    const typename Tensor<elt_t>::view &v)
+  {
+    assert(t.size() == v.size());
+    if (v.is_strided()) {
+      // If T shares memory with the slice, begin() gives T a fresh copy,
+      // leaving the slice untouched.
+      elt_t *output = t.begin();
+      binop_runs<elt_t> f = { op, false, output, output };
+      for_each_run(v.begin_const(), v.dimensions(), v.strides(), f);
+    } else {
+      Tensor<elt_t> aux(v);
+      elt_t *output = t.begin();
+      simd::binop(op, output, output, aux.begin(), t.size());
+    }
+    return t;
+  }
+
+} // namespace tensor
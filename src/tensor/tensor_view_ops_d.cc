@@ -0,0 +1,106 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "tensor_view_ops.cc"
+
+namespace tensor {
+
+  /**Sum of the elements of a slice of a tensor.*/
+  double sum(const RTensor::view &v)
+  {
+    return do_sum<double>(v);
+  }
+
+  /**Norm-2 of the elements of a slice of a tensor.*/
+  double norm2(const RTensor::view &v)
+  {
+    return do_norm2<double>(v);
+  }
+
+  const RTensor operator+(const RTensor &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::PLUS, a, b, false);
+  }
+
+  const RTensor operator-(const RTensor &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::MINUS, a, b, false);
+  }
+
+  const RTensor operator*(const RTensor &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::TIMES, a, b, false);
+  }
+
+  const RTensor operator/(const RTensor &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::DIVIDE, a, b, false);
+  }
+
+  const RTensor operator+(const RTensor::view &a, const RTensor &b)
+  {
+    return do_binop<double>(simd::PLUS, b, a, true);
+  }
+
+  const RTensor operator-(const RTensor::view &a, const RTensor &b)
+  {
+    return do_binop<double>(simd::MINUS, b, a, true);
+  }
+
+  const RTensor operator*(const RTensor::view &a, const RTensor &b)
+  {
+    return do_binop<double>(simd::TIMES, b, a, true);
+  }
+
+  const RTensor operator/(const RTensor::view &a, const RTensor &b)
+  {
+    return do_binop<double>(simd::DIVIDE, b, a, true);
+  }
+
+  const RTensor operator+(const RTensor::view &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::PLUS, a, b);
+  }
+
+  const RTensor operator-(const RTensor::view &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::MINUS, a, b);
+  }
+
+  const RTensor operator*(const RTensor::view &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::TIMES, a, b);
+  }
+
+  const RTensor operator/(const RTensor::view &a, const RTensor::view &b)
+  {
+    return do_binop<double>(simd::DIVIDE, a, b);
+  }
+
+  RTensor &operator+=(RTensor &a, const RTensor::view &b)
+  {
+    return do_binop_in_place<double>(simd::PLUS, a, b);
+  }
+
+  RTensor &operator-=(RTensor &a, const RTensor::view &b)
+  {
+    return do_binop_in_place<double>(simd::MINUS, a, b);
+  }
+
+} // namespace tensor
@@ -0,0 +1,106 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "tensor_view_ops.cc"
+
+namespace tensor {
+
+  /**Sum of the elements of a slice of a tensor.*/
+  cdouble sum(const CTensor::view &v)
+  {
+    return do_sum<cdouble>(v);
+  }
+
+  /**Norm-2 of the elements of a slice of a tensor.*/
+  double norm2(const CTensor::view &v)
+  {
+    return do_norm2<cdouble>(v);
+  }
+
+  const CTensor operator+(const CTensor &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::PLUS, a, b, false);
+  }
+
+  const CTensor operator-(const CTensor &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::MINUS, a, b, false);
+  }
+
+  const CTensor operator*(const CTensor &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::TIMES, a, b, false);
+  }
+
+  const CTensor operator/(const CTensor &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::DIVIDE, a, b, false);
+  }
+
+  const CTensor operator+(const CTensor::view &a, const CTensor &b)
+  {
+    return do_binop<cdouble>(simd::PLUS, b, a, true);
+  }
+
+  const CTensor operator-(const CTensor::view &a, const CTensor &b)
+  {
+    return do_binop<cdouble>(simd::MINUS, b, a, true);
+  }
+
+  const CTensor operator*(const CTensor::view &a, const CTensor &b)
+  {
+    return do_binop<cdouble>(simd::TIMES, b, a, true);
+  }
+
+  const CTensor operator/(const CTensor::view &a, const CTensor &b)
+  {
+    return do_binop<cdouble>(simd::DIVIDE, b, a, true);
+  }
+
+  const CTensor operator+(const CTensor::view &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::PLUS, a, b);
+  }
+
+  const CTensor operator-(const CTensor::view &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::MINUS, a, b);
+  }
+
+  const CTensor operator*(const CTensor::view &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::TIMES, a, b);
+  }
+
+  const CTensor operator/(const CTensor::view &a, const CTensor::view &b)
+  {
+    return do_binop<cdouble>(simd::DIVIDE, a, b);
+  }
+
+  CTensor &operator+=(CTensor &a, const CTensor::view &b)
+  {
+    return do_binop_in_place<cdouble>(simd::PLUS, a, b);
+  }
+
+  CTensor &operator-=(CTensor &a, const CTensor::view &b)
+  {
+    return do_binop_in_place<cdouble>(simd::MINUS, a, b);
+  }
+
+} // namespace tensor
@@ -0,0 +1,267 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cstdlib>
+#include <new>
+#include <pthread.h>
+#include <tensor/allocator.h>
+
+namespace tensor {
+
+  Allocator::~Allocator()
+  {
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // SYSTEM ALLOCATOR
+  //
+
+  static void *aligned_malloc(size_t bytes)
+  {
+    void *p;
+    if (posix_memalign(&p, TENSOR_ALIGNMENT, bytes? bytes : 1))
+      throw std::bad_alloc();
+    return p;
+  }
+
+  class SystemAllocator : public Allocator {
+  public:
+    virtual void *allocate(size_t bytes) { return aligned_malloc(bytes); }
+    virtual void deallocate(void *p, size_t) { free(p); }
+  };
+
+  Allocator *system_allocator()
+  {
+    // Never deleted, so that it outlives static tensors that use it
+    static SystemAllocator *a = new SystemAllocator;
+    return a;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // POOL ALLOCATOR
+  //
+  // Blocks are rounded up to a size class: multiples of 64 bytes up to 256
+  // bytes, and then four classes per power of two, up to 64 Mb. Each thread
+  // keeps one list of free blocks per class, linked through their first
+  // word, so that reusing a block needs neither locks nor atomic operations.
+  // Only the statistics are shared among threads.
+  //
+
+  static const int first_log2 = 8;
+  static const int last_log2 = 26;
+  static const int n_classes = 4 + 4 * (last_log2 - first_log2);
+
+  /* Size class of a block and, in 'rounded', the size of that class. Returns
+   * n_classes for blocks that are too large to be cached. */
+  static int size_class(size_t bytes, size_t *rounded)
+  {
+    if (bytes <= 256) {
+      int c = bytes? (int)((bytes - 1) / 64) : 0;
+      *rounded = (c + 1) * 64;
+      return c;
+    }
+    size_t b = bytes - 1;
+    int e = first_log2;
+    while ((b >> e) > 1) e++;
+    if (e >= last_log2) {
+      *rounded = bytes;
+      return n_classes;
+    }
+    size_t q = b >> (e - 2);
+    *rounded = (q + 1) << (e - 2);
+    return 4 + 4 * (e - first_log2) + (int)(q - 4);
+  }
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  struct ThreadCache {
+    FreeBlock *free[n_classes];
+    size_t bytes;
+  };
+
+  static size_t pool_limit = 32 << 20;
+
+  static size_t stat_allocations = 0;
+  static size_t stat_hits = 0;
+  static size_t stat_bytes_live = 0;
+  static size_t stat_bytes_peak = 0;
+  static size_t stat_bytes_cached = 0;
+
+  static void count(size_t *counter, long delta)
+  {
+    __atomic_add_fetch(counter, delta, __ATOMIC_RELAXED);
+  }
+
+  static void count_live(size_t bytes)
+  {
+    size_t live = __atomic_add_fetch(&stat_bytes_live, bytes, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&stat_bytes_peak, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&stat_bytes_peak, &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+  }
+
+  static void release_cache(ThreadCache *cache)
+  {
+    for (int c = 0; c < n_classes; c++) {
+      while (FreeBlock *b = cache->free[c]) {
+        cache->free[c] = b->next;
+        free(b);
+      }
+    }
+    count(&stat_bytes_cached, -(long)cache->bytes);
+    cache->bytes = 0;
+  }
+
+  static pthread_key_t cache_key;
+  static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+  static void destroy_cache(void *p)
+  {
+    ThreadCache *cache = static_cast<ThreadCache*>(p);
+    release_cache(cache);
+    free(cache);
+  }
+
+  static void make_cache_key()
+  {
+    pthread_key_create(&cache_key, destroy_cache);
+  }
+
+  static ThreadCache *thread_cache()
+  {
+    pthread_once(&cache_key_once, make_cache_key);
+    ThreadCache *cache = static_cast<ThreadCache*>(pthread_getspecific(cache_key));
+    if (!cache) {
+      cache = static_cast<ThreadCache*>(calloc(1, sizeof(ThreadCache)));
+      if (!cache)
+        throw std::bad_alloc();
+      pthread_setspecific(cache_key, cache);
+    }
+    return cache;
+  }
+
+  class PoolAllocator : public Allocator {
+  public:
+    virtual void *allocate(size_t bytes) {
+      size_t rounded;
+      int c = size_class(bytes, &rounded);
+      count(&stat_allocations, 1);
+      count_live(rounded);
+      if (c < n_classes) {
+        ThreadCache *cache = thread_cache();
+        if (FreeBlock *b = cache->free[c]) {
+          cache->free[c] = b->next;
+          cache->bytes -= rounded;
+          count(&stat_bytes_cached, -(long)rounded);
+          count(&stat_hits, 1);
+          return b;
+        }
+      }
+      return aligned_malloc(rounded);
+    }
+
+    virtual void deallocate(void *p, size_t bytes) {
+      size_t rounded;
+      int c = size_class(bytes, &rounded);
+      count(&stat_bytes_live, -(long)rounded);
+      if (c < n_classes) {
+        ThreadCache *cache = thread_cache();
+        if (cache->bytes + rounded <=
+            __atomic_load_n(&pool_limit, __ATOMIC_RELAXED)) {
+          FreeBlock *b = static_cast<FreeBlock*>(p);
+          b->next = cache->free[c];
+          cache->free[c] = b;
+          cache->bytes += rounded;
+          count(&stat_bytes_cached, rounded);
+          return;
+        }
+      }
+      free(p);
+    }
+  };
+
+  Allocator *pool_allocator()
+  {
+    // Like system_allocator(), never deleted
+    static PoolAllocator *a = new PoolAllocator;
+    return a;
+  }
+
+  /**Statistics of the pool_allocator(). Counters are updated by all threads
+     without synchronization, so that the values are only consistent when no
+     other thread is allocating memory.*/
+  const AllocatorStats pool_allocator_stats()
+  {
+    AllocatorStats output;
+    output.allocations = __atomic_load_n(&stat_allocations, __ATOMIC_RELAXED);
+    output.hits = __atomic_load_n(&stat_hits, __ATOMIC_RELAXED);
+    output.bytes_live = __atomic_load_n(&stat_bytes_live, __ATOMIC_RELAXED);
+    output.bytes_peak = __atomic_load_n(&stat_bytes_peak, __ATOMIC_RELAXED);
+    output.bytes_cached = __atomic_load_n(&stat_bytes_cached, __ATOMIC_RELAXED);
+    return output;
+  }
+
+  void pool_allocator_reset_stats()
+  {
+    __atomic_store_n(&stat_allocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat_hits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat_bytes_peak,
+                     __atomic_load_n(&stat_bytes_live, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+  }
+
+  void pool_allocator_release()
+  {
+    release_cache(thread_cache());
+  }
+
+  /**Maximum number of bytes that each thread keeps in its cache. Blocks that
+     are freed once this limit is reached are returned to the operating
+     system. The default is 32 Mb, and a value of 0 disables the caches.*/
+  void set_pool_allocator_limit(size_t bytes)
+  {
+    __atomic_store_n(&pool_limit, bytes, __ATOMIC_RELAXED);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // CURRENT ALLOCATOR
+  //
+
+  static Allocator *current_allocator = 0;
+
+  Allocator *tensor_allocator()
+  {
+    Allocator *a = __atomic_load_n(&current_allocator, __ATOMIC_ACQUIRE);
+    return a? a : pool_allocator();
+  }
+
+  /**Change the allocator for new vectors and tensors, returning the previous
+     one. The allocator must not be destroyed while there are tensors that
+     were created with it. A null pointer restores the pool_allocator().*/
+  Allocator *set_tensor_allocator(Allocator *a)
+  {
+    Allocator *old = __atomic_exchange_n(&current_allocator, a, __ATOMIC_ACQ_REL);
+    return old? old : pool_allocator();
+  }
+
+} // namespace tensor
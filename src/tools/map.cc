@@ -34,4 +34,30 @@ namespace tensor {
   MatrixMap<Matrix>::operator()(const tensor_t &arg) const
   { return transpose_? mmult(arg, m_) : mmult(m_, arg); }
 
+  template<typename elt>
+  static const SlicedSparse<elt>
+  sliced_form(const Sparse<elt> &m, bool transpose)
+  {
+    if (transpose || !SlicedSparse<elt>::is_suitable(m))
+      return SlicedSparse<elt>();
+    return SlicedSparse<elt>(m);
+  }
+
+  template<typename elt>
+  MatrixMap<Sparse<elt> >::MatrixMap(const Sparse<elt> &m, bool transpose)
+    : m_(m), transpose_(transpose), sliced_(sliced_form(m, transpose))
+  {}
+
+  template<typename elt>
+  MatrixMap<Sparse<elt> >::~MatrixMap() {}
+
+  template<typename elt>
+  const typename MatrixMap<Sparse<elt> >::tensor_t
+  MatrixMap<Sparse<elt> >::operator()(const tensor_t &arg) const
+  {
+    if (transpose_)
+      return mmult(arg, m_);
+    return sliced_.is_empty()? mmult(m_, arg) : mmult(sliced_, arg);
+  }
+
 } // namespace tensor
@@ -0,0 +1,91 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TENSOR_TOOLS_PARALLEL_H
+#define TENSOR_TOOLS_PARALLEL_H
+
+#include <algorithm>
+#include <vector>
+#include <tensor/vector.h>
+#include <tensor/threads.h>
+
+//
+// Reductions among the threads of the library. The partial result of each
+// block of CHUNK elements (see <tensor/threads.h>) is combined pairwise in a
+// fixed order, so that the output does not depend on the number of threads.
+//
+
+namespace tensor {
+namespace parallel {
+
+  template<typename T, class combiner>
+  T pairwise(const T *x, index n, combiner f)
+  {
+    if (n == 1)
+      return x[0];
+    index half = n / 2;
+    return f(pairwise(x, half, f), pairwise(x + half, n - half, f));
+  }
+
+  /* Reduce the range [0,n). The reducer computes the partial result of a
+     range, r.partial(begin, end), and combines two results with
+     r.combine(a, b). */
+  template<class reducer>
+  class ReduceTask : public Task {
+  public:
+    typedef typename reducer::value_type value_type;
+    ReduceTask(const reducer &r, index n, value_type *partials) :
+      r_(r), n_(n), partials_(partials)
+    {}
+    void run(index c) {
+      partials_[c] = r_.partial(chunk_begin(c), chunk_end(c, n_));
+    }
+  private:
+    const reducer &r_;
+    index n_;
+    value_type *partials_;
+  };
+
+  template<class reducer>
+  struct Combiner {
+    typedef typename reducer::value_type value_type;
+    const reducer &r;
+    Combiner(const reducer &reducer_) : r(reducer_) {}
+    value_type operator()(const value_type &a, const value_type &b) const {
+      return r.combine(a, b);
+    }
+  };
+
+  template<class reducer>
+  typename reducer::value_type reduce(const reducer &r, index n)
+  {
+    typedef typename reducer::value_type value_type;
+    index nchunks = chunks(n);
+    if (nchunks <= 1)
+      return r.partial(0, n);
+    std::vector<value_type> partials(nchunks);
+    ReduceTask<reducer> task(r, n, &partials[0]);
+    run_chunks(task, nchunks);
+    return pairwise(&partials[0], nchunks, Combiner<reducer>(r));
+  }
+
+} // namespace parallel
+} // namespace tensor
+
+#endif // !TENSOR_TOOLS_PARALLEL_H
@@ -0,0 +1,256 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#if __cplusplus >= 201103L
+# include <exception>
+#endif
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+namespace tensor {
+namespace parallel {
+
+  //
+  // The pool has tensor_threads()-1 workers; the thread that calls
+  // run_chunks() does its share of the work. Workers wait for a new job,
+  // take blocks from a shared counter until there are none left and report
+  // back when they are done. Only one job runs at a time: other threads that
+  // call run_chunks() meanwhile process their blocks by themselves.
+  //
+  // When a block throws an exception, no more blocks are handed out. The
+  // caller waits for the workers, releases the pool and rethrows it. With
+  // compilers older than C++11, exceptions cannot be passed between threads
+  // and an exception in a worker aborts the program.
+  //
+
+  static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t job_start = PTHREAD_COND_INITIALIZER;
+  static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+
+  static std::vector<pthread_t> workers;
+  static int number_of_threads = 0;
+  static bool quit = false;
+
+  static Task *job = 0;
+  static index job_chunks = 0;
+  static index next_chunk = 0;
+  static unsigned long job_number = 0;
+  static int busy_workers = 0;
+#if __cplusplus >= 201103L
+  static std::exception_ptr job_error;
+#endif
+
+  /* Number of threads set from within a task, to be applied when the job
+     finishes, or zero. */
+  static int pending_threads = 0;
+
+  static __thread bool inside_task = false;
+
+  static void work(Task *task, index nchunks)
+  {
+    index c;
+    while ((c = __atomic_fetch_add(&next_chunk, 1, __ATOMIC_RELAXED)) < nchunks)
+      task->run(c);
+  }
+
+  /* Called by a worker whose block threw an exception. */
+  static void fail_job(index nchunks)
+  {
+    __atomic_store_n(&next_chunk, nchunks, __ATOMIC_RELAXED);
+#if __cplusplus >= 201103L
+    pthread_mutex_lock(&pool_lock);
+    if (!job_error)
+      job_error = std::current_exception();
+    pthread_mutex_unlock(&pool_lock);
+#else
+    std::cerr << "Exception thrown in a thread of the library" << std::endl;
+    abort();
+#endif
+  }
+
+  /* The argument is the number of the last job that was started before the
+     worker was created, which it must not run. */
+  static void *worker(void *data)
+  {
+    inside_task = true;
+    unsigned long last_job = (unsigned long)(size_t)data;
+    pthread_mutex_lock(&pool_lock);
+    while (1) {
+      while (job_number == last_job && !quit)
+        pthread_cond_wait(&job_start, &pool_lock);
+      if (quit)
+        break;
+      last_job = job_number;
+      Task *task = job;
+      index nchunks = job_chunks;
+      pthread_mutex_unlock(&pool_lock);
+      try {
+        work(task, nchunks);
+      } catch (...) {
+        fail_job(nchunks);
+      }
+      pthread_mutex_lock(&pool_lock);
+      if (--busy_workers == 0)
+        pthread_cond_signal(&job_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return 0;
+  }
+
+  static int default_threads()
+  {
+    const char *value = getenv("TENSOR_NUM_THREADS");
+    int n = value? atoi(value) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0)? n : 1;
+  }
+
+  /* Current number of threads. It is read without taking job_lock, which
+     run_chunks() holds while a job runs, so that tasks may call
+     tensor_threads(). It only changes with job_lock held. */
+  static int current_threads()
+  {
+    int n = __atomic_load_n(&number_of_threads, __ATOMIC_ACQUIRE);
+    if (n == 0) {
+      int expected = 0;
+      n = default_threads();
+      if (!__atomic_compare_exchange_n(&number_of_threads, &expected, n, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        n = expected;
+    }
+    return n;
+  }
+
+  /* These functions are called with job_lock held. */
+  static void stop_workers()
+  {
+    pthread_mutex_lock(&pool_lock);
+    quit = true;
+    pthread_cond_broadcast(&job_start);
+    pthread_mutex_unlock(&pool_lock);
+    for (size_t i = 0; i < workers.size(); i++)
+      pthread_join(workers[i], 0);
+    workers.clear();
+    quit = false;
+  }
+
+  static void start_workers()
+  {
+    int n = current_threads();
+    pthread_mutex_lock(&pool_lock);
+    unsigned long last_job = job_number;
+    pthread_mutex_unlock(&pool_lock);
+    while ((int)workers.size() < n - 1) {
+      pthread_t thread;
+      if (pthread_create(&thread, 0, worker, (void *)(size_t)last_job))
+        break;
+      workers.push_back(thread);
+    }
+  }
+
+  static void change_threads(int n)
+  {
+    stop_workers();
+    __atomic_store_n(&number_of_threads, n, __ATOMIC_RELEASE);
+  }
+
+  /* Wait for the workers, apply a pending change of the number of threads
+     and release the pool. The exception of a worker, if any, is rethrown
+     unless the caller has its own. */
+  static void end_job(bool rethrow)
+  {
+    inside_task = false;
+    pthread_mutex_lock(&pool_lock);
+    while (busy_workers)
+      pthread_cond_wait(&job_done, &pool_lock);
+    job = 0;
+#if __cplusplus >= 201103L
+    std::exception_ptr error = job_error;
+    job_error = std::exception_ptr();
+#endif
+    pthread_mutex_unlock(&pool_lock);
+    int n = __atomic_exchange_n(&pending_threads, 0, __ATOMIC_ACQ_REL);
+    if (n)
+      change_threads(n);
+    pthread_mutex_unlock(&job_lock);
+#if __cplusplus >= 201103L
+    if (error && rethrow)
+      std::rethrow_exception(error);
+#endif
+  }
+
+  void run_chunks(Task &task, index nchunks)
+  {
+    if (nchunks > 1 && !inside_task && pthread_mutex_trylock(&job_lock) == 0) {
+      start_workers();
+      if (workers.size()) {
+        pthread_mutex_lock(&pool_lock);
+        job = &task;
+        job_chunks = nchunks;
+        next_chunk = 0;
+        busy_workers = workers.size();
+        job_number++;
+        pthread_cond_broadcast(&job_start);
+        pthread_mutex_unlock(&pool_lock);
+
+        inside_task = true;
+        try {
+          work(&task, nchunks);
+        } catch (...) {
+          __atomic_store_n(&next_chunk, nchunks, __ATOMIC_RELAXED);
+          end_job(false);
+          throw;
+        }
+        end_job(true);
+        return;
+      }
+      pthread_mutex_unlock(&job_lock);
+    }
+    for (index c = 0; c < nchunks; c++)
+      task.run(c);
+  }
+
+} // namespace parallel
+
+  int tensor_threads()
+  {
+    return parallel::current_threads();
+  }
+
+  int set_tensor_threads(int n)
+  {
+    if (n <= 0)
+      n = parallel::default_threads();
+    if (parallel::inside_task) {
+      /* The pool cannot be stopped while it runs this task. */
+      __atomic_store_n(&parallel::pending_threads, n, __ATOMIC_RELEASE);
+      return parallel::current_threads();
+    }
+    pthread_mutex_lock(&parallel::job_lock);
+    int old = parallel::current_threads();
+    parallel::change_threads(n);
+    pthread_mutex_unlock(&parallel::job_lock);
+    return old;
+  }
+
+} // namespace tensor
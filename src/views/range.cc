@@ -19,6 +19,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <vector>
 #include <tensor/indices.h>
 
 namespace tensor {
@@ -62,6 +63,12 @@ namespace tensor {
   {
   }
 
+  bool
+  Range::is_strided(index *, index *) const
+  {
+    return false;
+  }
+
   /************************************************************
    * ALL-INDEX RANGE
    */
@@ -111,6 +118,14 @@ namespace tensor {
     counter_ = 0;
   }
 
+  bool
+  FullRange::is_strided(index *start, index *step) const
+  {
+    *start = 0;
+    *step = get_factor();
+    return true;
+  }
+
   /************************************************************
    * SINGLE INDEX RANGE
    */
@@ -155,6 +170,14 @@ namespace tensor {
     counter_ = 0;
   }
 
+  bool
+  SingleRange::is_strided(index *start, index *step) const
+  {
+    *start = ndx_;
+    *step = get_factor();
+    return true;
+  }
+
   /************************************************************
    * EQUALLY SPACED INDICES RANGE
    */
@@ -205,6 +228,14 @@ namespace tensor {
     ndx_ = start_;
   }
 
+  bool
+  StepRange::is_strided(index *start, index *step) const
+  {
+    *start = start_;
+    *step = step_;
+    return step_ > 0;
+  }
+
   /************************************************************
    * RANGE WITH A VECTOR OF INDICES
    */
@@ -255,6 +286,23 @@ namespace tensor {
     counter_ = 0;
   }
 
+  bool
+  IndexRange::is_strided(index *start, index *step) const
+  {
+    // A list of equally spaced, growing indices, such as the ones created
+    // by iota(), is as good as a StepRange.
+    index n = indices_.size();
+    *start = n? indices_[0] : 0;
+    *step = (n > 1)? (indices_[1] - indices_[0]) : get_factor();
+    if (*step <= 0)
+      return false;
+    for (index i = 2; i < n; i++) {
+      if (indices_[i] - indices_[i-1] != *step)
+        return false;
+    }
+    return true;
+  }
+
   /************************************************************
    * TENSOR PRODUCT RANGE
    */
@@ -316,4 +364,48 @@ namespace tensor {
     return new ProductRange(r1, r2);
   }
 
+  /************************************************************
+   * LAYOUT OF A SLICE
+   */
+
+  /* Given the N ranges that select a slice from a tensor whose dimensions are
+   * LIMITS, compute the dimensions of the slice and the loops that traverse
+   * it: the position of the first element and, for each index, either the
+   * distance between consecutive elements (when the range is equally
+   * spaced) or a table with the position of every element. TABLES is left
+   * empty when all ranges are equally spaced, in which case the output is
+   * true. The ranges are deleted.
+   */
+  bool slice_layout(Range **ranges, int n, const Indices &limits,
+                    Indices *dims, Indices *strides, index *offset,
+                    std::vector<Indices> *tables)
+  {
+    assert(n > 0 && limits.size() == n);
+    *dims = Indices(n);
+    *strides = Indices(n);
+    *offset = 0;
+    tables->clear();
+    for (index i = 0, factor = 1; i < n; factor *= limits[i++]) {
+      Range *r = ranges[i];
+      index start, step;
+      r->set_limit(limits[i]);
+      dims->at(i) = r->size();
+      if (r->is_strided(&start, &step)) {
+        *offset += start * factor;
+        strides->at(i) = step * factor;
+      } else {
+        Indices table(r->size());
+        r->reset();
+        for (index j = 0, k; (k = r->pop()) != r->nomore(); j++) {
+          table.at(j) = k * factor;
+        }
+        strides->at(i) = 0;
+        tables->resize(n);
+        (*tables)[i] = table;
+      }
+      delete r;
+    }
+    return tables->empty();
+  }
+
 } // namespace tensor
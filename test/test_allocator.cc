@@ -0,0 +1,179 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <string>
+#include <pthread.h>
+#include <tensor/refcount.h>
+#include <gtest/gtest.h>
+
+using namespace tensor;
+
+//////////////////////////////////////////////////////////////////////
+// ALLOCATOR
+//
+
+// Counts the blocks that pass through it, to verify that RefPointer
+// uses the allocator only for plain numbers.
+class CountingAllocator : public Allocator {
+public:
+  CountingAllocator() : live(0) {}
+  virtual void *allocate(size_t bytes) {
+    ++live;
+    return system_allocator()->allocate(bytes);
+  }
+  virtual void deallocate(void *p, size_t bytes) {
+    --live;
+    system_allocator()->deallocate(p, bytes);
+  }
+  int live;
+};
+
+template<class allocated>
+void test_alignment()
+{
+  for (size_t i = 0; i < 1000; i = 2*i + 1) {
+    RefPointer<allocated> r(i);
+    EXPECT_EQ(0, (size_t)r.begin_const() % TENSOR_ALIGNMENT);
+  }
+}
+
+TEST(AllocatorTest, Alignment) {
+  test_alignment<double>();
+  test_alignment<cdouble>();
+  test_alignment<long>();
+  test_alignment<bool>();
+}
+
+TEST(AllocatorTest, SystemAlignment) {
+  Allocator *a = system_allocator();
+  for (size_t i = 0; i < 100000; i = 3*i + 1) {
+    void *p = a->allocate(i);
+    EXPECT_EQ(0, (size_t)p % TENSOR_ALIGNMENT);
+    a->deallocate(p, i);
+  }
+}
+
+// A block that is freed is reused by the next allocation of a similar size.
+TEST(AllocatorTest, PoolReuse) {
+  Allocator *a = pool_allocator();
+  void *p = a->allocate(1000);
+  a->deallocate(p, 1000);
+  pool_allocator_reset_stats();
+  void *q = a->allocate(1010);
+  EXPECT_EQ(p, q);
+  const AllocatorStats stats = pool_allocator_stats();
+  EXPECT_EQ(1, stats.allocations);
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1.0, stats.hit_rate());
+  a->deallocate(q, 1010);
+}
+
+// Bytes live and peak follow the allocations of the current thread.
+TEST(AllocatorTest, PoolStats) {
+  pool_allocator_release();
+  pool_allocator_reset_stats();
+  AllocatorStats stats = pool_allocator_stats();
+  size_t live = stats.bytes_live;
+  EXPECT_EQ(0, stats.allocations);
+  EXPECT_EQ(0, stats.bytes_cached);
+  EXPECT_EQ(live, stats.bytes_peak);
+  {
+    RefPointer<double> r(128);
+    stats = pool_allocator_stats();
+    EXPECT_EQ(1, stats.allocations);
+    EXPECT_EQ(0, stats.hits);
+    EXPECT_EQ(live + 128 * sizeof(double), stats.bytes_live);
+    EXPECT_EQ(live + 128 * sizeof(double), stats.bytes_peak);
+  }
+  stats = pool_allocator_stats();
+  EXPECT_EQ(live, stats.bytes_live);
+  EXPECT_EQ(live + 128 * sizeof(double), stats.bytes_peak);
+  EXPECT_EQ(128 * sizeof(double), stats.bytes_cached);
+  pool_allocator_release();
+  stats = pool_allocator_stats();
+  EXPECT_EQ(0, stats.bytes_cached);
+}
+
+// Freed blocks are not cached beyond the limit
+TEST(AllocatorTest, PoolLimit) {
+  pool_allocator_release();
+  set_pool_allocator_limit(0);
+  { RefPointer<double> r(128); }
+  EXPECT_EQ(0, pool_allocator_stats().bytes_cached);
+  set_pool_allocator_limit(32 << 20);
+}
+
+// Data is freed by the allocator that created it, even if the
+// allocator was changed in between.
+TEST(AllocatorTest, SetAllocator) {
+  CountingAllocator counter;
+  Allocator *old = set_tensor_allocator(&counter);
+  {
+    RefPointer<double> r(10);
+    RefPointer<cdouble> c(10);
+    RefPointer<int> s(10);
+    EXPECT_EQ(3, counter.live);
+    RefPointer<std::string> q(10);
+    EXPECT_EQ(3, counter.live);
+    set_tensor_allocator(old);
+    RefPointer<double> r2(10);
+    EXPECT_EQ(3, counter.live);
+  }
+  EXPECT_EQ(0, counter.live);
+  EXPECT_EQ(old, tensor_allocator());
+}
+
+// Copies made on write are allocated with the current allocator
+TEST(AllocatorTest, CloneUsesAllocator) {
+  CountingAllocator counter;
+  Allocator *old = set_tensor_allocator(&counter);
+  {
+    RefPointer<double> r(10);
+    std::fill(r.begin(), r.end(), 1.0);
+    RefPointer<double> r2(r);
+    EXPECT_EQ(1, counter.live);
+    r2.begin()[0] = 2.0;
+    EXPECT_EQ(2, counter.live);
+    EXPECT_EQ(1.0, r.begin_const()[0]);
+    EXPECT_EQ(1.0, r2.begin_const()[1]);
+  }
+  EXPECT_EQ(0, counter.live);
+  set_tensor_allocator(old);
+}
+
+// Blocks may be freed by a different thread than the one that created them
+static void *free_in_thread(void *arg)
+{
+  RefPointer<double> *r = static_cast<RefPointer<double>*>(arg);
+  for (int i = 0; i < 1000; i++) {
+    RefPointer<double> other(i);
+  }
+  delete r;
+  return 0;
+}
+
+TEST(AllocatorTest, ThreadedFree) {
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&threads[i], NULL, free_in_thread, new RefPointer<double>(1000));
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
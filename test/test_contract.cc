@@ -0,0 +1,172 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+
+namespace tensor_test {
+
+  using tensor::index;
+
+  // Position of a multi-index in a tensor of the given dimensions.
+  index position(const Indices &dims, const Indices &i)
+  {
+    index output = 0;
+    for (index k = dims.size(); k--; )
+      output = output * dims[k] + i[k];
+    return output;
+  }
+
+  // Contraction with explicit loops over all indices.
+  template<typename n1, typename n2>
+  const Tensor<typename Binop<n1,n2>::type>
+  slow_contract(const Tensor<n1> &A, const Indices &ia,
+                const Tensor<n2> &B, const Indices &ib, const Indices &out)
+  {
+    typedef typename Binop<n1,n2>::type n3;
+    Indices fa, fb;
+    for (index k = 0; k < A.rank(); k++)
+      if (std::find(ia.begin(), ia.end(), k) == ia.end())
+        fa = fa << Indices(igen << k);
+    for (index k = 0; k < B.rank(); k++)
+      if (std::find(ib.begin(), ib.end(), k) == ib.end())
+        fb = fb << Indices(igen << k);
+    index rank = fa.size() + fb.size();
+    Indices dims(std::max<index>(rank, 1));
+    dims.at(0) = 1;
+    for (index k = 0; k < rank; k++) {
+      index l = out[k];
+      dims.at(k) = (l < fa.size())? A.dimension(fa[l]) : B.dimension(fb[l - fa.size()]);
+    }
+    Indices dl(ia.size());
+    for (index k = 0; k < ia.size(); k++)
+      dl.at(k) = A.dimension(ia[k]);
+    Tensor<n3> C(dims);
+    Indices i(std::max<index>(rank, 1)), l(ia.size());
+    Indices ndxa(A.rank()), ndxb(B.rank());
+    for (index c = 0; c < C.size(); c++) {
+      for (index k = 0, p = c; k < rank; k++) {
+        i.at(k) = p % dims[k];
+        p /= dims[k];
+      }
+      for (index k = 0; k < rank; k++) {
+        index lbl = out[k];
+        if (lbl < fa.size())
+          ndxa.at(fa[lbl]) = i[k];
+        else
+          ndxb.at(fb[lbl - fa.size()]) = i[k];
+      }
+      n3 value = number_zero<n3>();
+      index nl = 1;
+      for (index k = 0; k < dl.size(); k++) nl *= dl[k];
+      for (index s = 0; s < nl; s++) {
+        for (index k = 0, p = s; k < dl.size(); k++) {
+          ndxa.at(ia[k]) = ndxb.at(ib[k]) = p % dl[k];
+          p /= dl[k];
+        }
+        value += A[position(A.dimensions(), ndxa)] * B[position(B.dimensions(), ndxb)];
+      }
+      C.at(c) = value;
+    }
+    return C;
+  }
+
+  // Random contraction of 'pairs' indices between tensors of the given
+  // ranks, with a random order of the output indices.
+  template<typename n1, typename n2>
+  void test_random_contract(int ranka, int rankb, int pairs, int max_dim)
+  {
+    Indices da = random_dimensions(ranka, max_dim);
+    Indices db = random_dimensions(rankb, max_dim);
+    Indices pa = iota(0, ranka - 1), pb = iota(0, rankb - 1);
+    std::random_shuffle(pa.begin(), pa.end());
+    std::random_shuffle(pb.begin(), pb.end());
+    Indices ia(pairs), ib(pairs);
+    for (int k = 0; k < pairs; k++) {
+      ia.at(k) = pa[k];
+      ib.at(k) = pb[k];
+      db.at(pb[k]) = da.at(pa[k]) = std::max<index>(1, da[pa[k]]);
+    }
+    Indices out = iota(0, ranka + rankb - 2*pairs - 1);
+    std::random_shuffle(out.begin(), out.end());
+    Tensor<n1> A(da);
+    Tensor<n2> B(db);
+    A.randomize();
+    B.randomize();
+    Tensor<typename Binop<n1,n2>::type>
+      C = contract(A, ia, B, ib, out),
+      sC = slow_contract(A, ia, B, ib, out);
+    EXPECT_TRUE(all_equal(C.dimensions(), sC.dimensions()));
+    EXPECT_TRUE(approx_eq(C, sC, 1e-12));
+    unique(A);
+    unique(B);
+  }
+
+  template<typename n1, typename n2>
+  void test_contract(int max_dim, int times)
+  {
+    for (int ranka = 1; ranka <= 4; ranka++)
+      for (int rankb = 1; rankb <= 4; rankb++)
+        for (int pairs = 0; pairs <= std::min(ranka, rankb); pairs++)
+          for (int n = 0; n < times; n++)
+            test_random_contract<n1,n2>(ranka, rankb, pairs, max_dim);
+  }
+
+  TEST(ContractTest, RTensorContract) {
+    test_contract<double,double>(5, 20);
+  }
+
+  TEST(ContractTest, CTensorContract) {
+    test_contract<cdouble,cdouble>(5, 20);
+  }
+
+  TEST(ContractTest, RTensorCTensorContract) {
+    test_contract<double,cdouble>(4, 5);
+  }
+
+  TEST(ContractTest, CTensorRTensorContract) {
+    test_contract<cdouble,double>(4, 5);
+  }
+
+  // A single pair of indices in the default order is the same as fold()
+  TEST(ContractTest, RTensorFold) {
+    RTensor A = RTensor::random(40, 30, 50);
+    RTensor B = RTensor::random(20, 30, 45);
+    EXPECT_TRUE(approx_eq(fold(A, 1, B, 1), contract(A, igen << 1, B, igen << 1)));
+    RTensor D = RTensor::random(20, 30, 40);
+    EXPECT_TRUE(approx_eq(fold(A, 0, D, 2), contract(A, igen << 0, D, igen << 2)));
+    RTensor C = RTensor::random(30, 50, 7);
+    EXPECT_TRUE(approx_eq(mmult(reshape(A, 40, 1500), reshape(C, 1500, 7)),
+                          contract(A, igen << 1 << 2, C, igen << 0 << 1)));
+  }
+
+  // Matrix products in all orders
+  TEST(ContractTest, CTensorMatrix) {
+    CTensor A = CTensor::random(13, 17);
+    CTensor B = CTensor::random(17, 11);
+    CTensor AB = mmult(A, B);
+    EXPECT_TRUE(approx_eq(AB, contract(A, igen << 1, B, igen << 0)));
+    EXPECT_TRUE(approx_eq(transpose(AB), contract(A, igen << 1, B, igen << 0, igen << 1 << 0)));
+    EXPECT_TRUE(approx_eq(AB, contract(transpose(A), igen << 0, B, igen << 0)));
+    EXPECT_TRUE(approx_eq(AB, contract(A, igen << 1, transpose(B), igen << 1)));
+  }
+
+} // namespace tensor_test
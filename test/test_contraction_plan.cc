@@ -0,0 +1,215 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+#include <tensor/contraction.h>
+
+namespace tensor_test {
+
+  using tensor::index;
+
+  // Random network: a ring of tensors with some extra bonds, and open
+  // indices on some of the tensors.
+  void random_network(index n, std::vector<Indices> *labels,
+                      std::vector<Indices> *dims)
+  {
+    std::vector<std::vector<index> > l(n), d(n);
+    index next = 0;
+    for (index i = 0; i < n; i++) {
+      for (index j = i + 1; j < n; j++) {
+        if (j == i + 1 || (i == 0 && j == n - 1) || rand<int>(0, 4) == 0) {
+          index dim = rand<int>(1, 4);
+          l[i].push_back(next); d[i].push_back(dim);
+          l[j].push_back(next); d[j].push_back(dim);
+          next++;
+        }
+      }
+      if (n == 1 || rand<int>(0, 2)) {
+        l[i].push_back(next++); d[i].push_back(rand<int>(1, 4));
+      }
+    }
+    labels->clear();
+    dims->clear();
+    for (index i = 0; i < n; i++) {
+      std::vector<index> p(l[i].size());
+      for (size_t k = 0; k < p.size(); k++) p[k] = k;
+      std::random_shuffle(p.begin(), p.end());
+      Indices li(p.size()), di(p.size());
+      for (size_t k = 0; k < p.size(); k++) {
+        li.at(k) = l[i][p[k]];
+        di.at(k) = d[i][p[k]];
+      }
+      labels->push_back(li);
+      dims->push_back(di);
+    }
+  }
+
+  // Contraction of a network with explicit loops over all labels.
+  template<typename elt_t>
+  const Tensor<elt_t>
+  slow_network(const std::vector<Tensor<elt_t> > &tensors,
+               const std::vector<Indices> &labels, const Indices &output)
+  {
+    std::vector<index> all, dim;
+    for (size_t t = 0; t < tensors.size(); t++)
+      for (index k = 0; k < labels[t].size(); k++)
+        if (std::find(all.begin(), all.end(), labels[t][k]) == all.end()) {
+          all.push_back(labels[t][k]);
+          dim.push_back(tensors[t].dimension(k));
+        }
+    Indices odims(std::max<index>(output.size(), 1));
+    odims.at(0) = 1;
+    for (index k = 0; k < output.size(); k++)
+      odims.at(k) = dim[std::find(all.begin(), all.end(), output[k]) - all.begin()];
+    Tensor<elt_t> C = Tensor<elt_t>::zeros(odims);
+    std::vector<index> value(all.size(), 0);
+    while (1) {
+      elt_t x = number_one<elt_t>();
+      for (size_t t = 0; t < tensors.size(); t++) {
+        index p = 0;
+        for (index k = labels[t].size(); k--; ) {
+          index l = std::find(all.begin(), all.end(), labels[t][k]) - all.begin();
+          p = p * tensors[t].dimension(k) + value[l];
+        }
+        x *= tensors[t][p];
+      }
+      index p = 0;
+      for (index k = output.size(); k--; ) {
+        index l = std::find(all.begin(), all.end(), output[k]) - all.begin();
+        p = p * odims[k] + value[l];
+      }
+      C.at(p) += x;
+      size_t k = 0;
+      for (; k < all.size(); k++) {
+        if (++value[k] < dim[k]) break;
+        value[k] = 0;
+      }
+      if (k == all.size()) break;
+    }
+    return C;
+  }
+
+  template<typename elt_t>
+  void test_random_network(ContractionPlan::Method method, index max_tensors)
+  {
+    for (index n = 1; n <= max_tensors; n++) {
+      for (int times = 0; times < 10; times++) {
+        std::vector<Indices> labels, dims;
+        random_network(n, &labels, &dims);
+        std::vector<Tensor<elt_t> > tensors;
+        for (index t = 0; t < n; t++) {
+          tensors.push_back(Tensor<elt_t>(dims[t]));
+          tensors.back().randomize();
+        }
+        ContractionPlan plan(labels, dims, Indices(), method);
+        EXPECT_EQ(n - 1, plan.steps());
+        EXPECT_TRUE(plan.matches(dims));
+        Tensor<elt_t> C = plan.execute(tensors);
+        EXPECT_TRUE(approx_eq(C, slow_network(tensors, labels, plan.output_labels()),
+                              1e-10));
+      }
+    }
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // MATRIX CHAIN
+  //
+
+  TEST(ContractionPlanTest, MatrixChain) {
+    // A(10,100) B(100,5) D(5,50) is cheapest as (A*B)*D
+    RTensor A(igen << 10 << 100), B(igen << 100 << 5), D(igen << 5 << 50);
+    A.randomize();
+    B.randomize();
+    D.randomize();
+    std::vector<Indices> labels, dims;
+    labels.push_back(igen << 0 << 1); dims.push_back(A.dimensions());
+    labels.push_back(igen << 1 << 2); dims.push_back(B.dimensions());
+    labels.push_back(igen << 2 << 3); dims.push_back(D.dimensions());
+    std::vector<RTensor> network;
+    network.push_back(A);
+    network.push_back(B);
+    network.push_back(D);
+    RTensor C = mmult(mmult(A, B), D);
+    for (int m = ContractionPlan::AUTOMATIC; m <= ContractionPlan::GREEDY; m++) {
+      ContractionPlan plan(labels, dims, Indices(), (ContractionPlan::Method)m);
+      EXPECT_EQ(2 * (10*100*5 + 10*5*50), plan.flops());
+      EXPECT_EQ(10*100 + 100*5 + 5*50 + 10*5 + 10*50, plan.peak_memory());
+      EXPECT_TRUE(approx_eq(C, plan.execute(network), 1e-12));
+    }
+    ContractionPlan plan(labels, dims, igen << 3 << 0);
+    EXPECT_TRUE(all_equal(plan.execute(network), transpose(C)));
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // RANDOM NETWORKS
+  //
+
+  TEST(ContractionPlanTest, RTensorExhaustive) {
+    test_random_network<double>(ContractionPlan::EXHAUSTIVE, 5);
+  }
+
+  TEST(ContractionPlanTest, RTensorDynamic) {
+    test_random_network<double>(ContractionPlan::DYNAMIC, 7);
+  }
+
+  TEST(ContractionPlanTest, RTensorGreedy) {
+    test_random_network<double>(ContractionPlan::GREEDY, 7);
+  }
+
+  TEST(ContractionPlanTest, CTensorAutomatic) {
+    test_random_network<cdouble>(ContractionPlan::AUTOMATIC, 7);
+  }
+
+  TEST(ContractionPlanTest, Optimality) {
+    for (index n = 2; n <= 6; n++) {
+      for (int times = 0; times < 10; times++) {
+        std::vector<Indices> labels, dims;
+        random_network(n, &labels, &dims);
+        double exhaustive =
+          ContractionPlan(labels, dims, Indices(), ContractionPlan::EXHAUSTIVE).flops();
+        double dynamic =
+          ContractionPlan(labels, dims, Indices(), ContractionPlan::DYNAMIC).flops();
+        double greedy =
+          ContractionPlan(labels, dims, Indices(), ContractionPlan::GREEDY).flops();
+        EXPECT_EQ(exhaustive, dynamic);
+        EXPECT_LE(dynamic, greedy);
+      }
+    }
+  }
+
+  TEST(ContractionPlanTest, ContractNetwork) {
+    std::vector<Indices> labels, dims;
+    random_network(6, &labels, &dims);
+    std::vector<RTensor> tensors;
+    for (size_t t = 0; t < labels.size(); t++) {
+      tensors.push_back(RTensor(dims[t]));
+      tensors.back().randomize();
+    }
+    Indices output = ContractionPlan(labels, dims).output_labels();
+    std::reverse(output.begin(), output.end());
+    RTensor C = slow_network(tensors, labels, output);
+    for (int times = 0; times < 3; times++) {
+      EXPECT_TRUE(approx_eq(C, contract_network(tensors, labels, output), 1e-10));
+    }
+  }
+
+} // namespace tensor_test
@@ -21,6 +21,8 @@
 #include <gtest/gtest.h>
 #include <tensor/tensor.h>
 #include <tensor/fftw.h>
+#include <tensor/threads.h>
+#include "fftw/fftw_common.hpp"
 
 namespace tensor_test {
 
@@ -270,4 +272,314 @@ namespace tensor_test {
       }
     }
   }
+
+  TEST(FFTWTest, fftShiftInplaceTest) {
+    for (int rank = 1; rank < 4; rank++) {
+      for (DimensionIterator iter(rank, 6); iter; ++iter) {
+        CTensor input = CTensor::random(*iter);
+        if (input.size() == 0) {
+          continue;
+        }
+
+        CTensor output = input;
+        fftshift_inplace(output, FFTW_FORWARD);
+        EXPECT_TRUE(all_equal(all_fft_shift(input, FFTW_FORWARD), output));
+        fftshift_inplace(output, FFTW_BACKWARD);
+        EXPECT_TRUE(all_equal(input, output));
+
+        for (tensor::index dim = 0; dim < rank; dim++) {
+          output = input;
+          fftshift_inplace(output, dim, FFTW_BACKWARD);
+          EXPECT_TRUE(all_equal(single_fft_shift(input, dim, FFTW_BACKWARD), output));
+        }
+        for (BooleansIterator biter(rank); biter; ++biter) {
+          output = input;
+          fftshift_inplace(output, *biter, FFTW_FORWARD);
+          EXPECT_TRUE(all_equal(multiple_fft_shift(input, *biter, FFTW_FORWARD), output));
+          output = input;
+          fftshift_inplace(output, *biter, FFTW_BACKWARD);
+          EXPECT_TRUE(all_equal(multiple_fft_shift(input, *biter, FFTW_BACKWARD), output));
+        }
+      }
+    }
+  }
+
+  TEST(FFTWTest, ShiftedFFTTest) {
+    for (int rank = 1; rank < 4; rank++) {
+      for (DimensionIterator iter(rank, 6); iter; ++iter) {
+        CTensor input = CTensor::random(*iter);
+        if (input.size() == 0) {
+          continue;
+        }
+
+        EXPECT_TRUE(approx_eq(fftshift(fftw(input, FFTW_FORWARD), FFTW_FORWARD),
+                              fftw_shifted(input, FFTW_FORWARD), 1e-10));
+        for (BooleansIterator biter(rank); biter; ++biter) {
+          CTensor expected = fftshift(fftw(input, *biter, FFTW_BACKWARD), *biter,
+                                      FFTW_FORWARD);
+          EXPECT_TRUE(approx_eq(expected, fftw_shifted(input, *biter, FFTW_BACKWARD),
+                                1e-10));
+          CTensor output = input;
+          fftw_shifted_inplace(output, *biter, FFTW_BACKWARD);
+          EXPECT_TRUE(approx_eq(expected, output, 1e-10));
+        }
+      }
+    }
+  }
+
+  TEST(FFTWTest, fftShiftInplaceDeathTest) {
+    for (int rank = 1; rank < 3; rank++) {
+      for (DimensionIterator iter(rank,6); iter; ++iter) {
+        CTensor input = CTensor::random(*iter);
+
+        ASSERT_DEATH(fftshift_inplace(input, -1, FFTW_FORWARD), ".*");
+        ASSERT_DEATH(fftshift_inplace(input, rank, FFTW_FORWARD), ".*");
+        ASSERT_DEATH(fftshift_inplace(input, Booleans(rank+1), FFTW_FORWARD), ".*");
+        ASSERT_DEATH(fftw_shifted(input, Booleans(rank-1), FFTW_FORWARD), ".*");
+      }
+    }
+  }
+
+  TEST(FFTWTest, MeasuredPlanTest) {
+    int old_effort = set_fftw_planner(FFTW_PLAN_MEASURE);
+    for (int rank = 1; rank <= 3; rank++) {
+      for (DimensionIterator iter(rank,4); iter; ++iter) {
+        CTensor input = CTensor::random(*iter);
+        if (input.size() == 0) {
+          continue;
+        }
+        CTensor copy = input;
+        copy.at(0) += 0.0; // a copy that does not share the data
+
+        // planning must not overwrite the data
+        for (int repeat = 0; repeat < 2; repeat++) {
+          EXPECT_TRUE(approx_eq(full_dft(input, -1), fftw(input, FFTW_FORWARD), 1e-10));
+          EXPECT_TRUE(all_equal(input, copy));
+          for (BooleansIterator biter(rank); biter; ++biter) {
+            CTensor inplace = input;
+            fftw_inplace(inplace, *biter, FFTW_BACKWARD);
+            EXPECT_TRUE(approx_eq(partial_dft(input, *biter, +1), inplace, 1e-10));
+          }
+        }
+      }
+    }
+    EXPECT_EQ(FFTW_PLAN_MEASURE, set_fftw_planner(old_effort));
+  }
+
+  TEST(FFTWTest, WisdomTest) {
+    int old_effort = set_fftw_planner(FFTW_PLAN_MEASURE);
+    CTensor input = CTensor::random(16, 12);
+    CTensor output = fftw(input, FFTW_FORWARD);
+    EXPECT_TRUE(fftw_save_wisdom("test_fftw.wisdom"));
+    fftw_forget_plans();
+    EXPECT_TRUE(fftw_load_wisdom("test_fftw.wisdom"));
+    EXPECT_TRUE(approx_eq(output, fftw(input, FFTW_FORWARD)));
+    EXPECT_FALSE(fftw_load_wisdom("test_fftw.nonexistent"));
+    unlink("test_fftw.wisdom");
+    set_fftw_planner(old_effort);
+  }
+
+  // Plans forgotten by one thread while others compute transforms
+  class ForgetPlansTask : public parallel::Task {
+  public:
+    ForgetPlansTask(const CTensor &input, std::vector<CTensor> *output) :
+      input_(input), output_(output)
+    {}
+    void run(tensor::index c) {
+      if (c % 2)
+        fftw_forget_plans();
+      else
+        (*output_)[c] = fftw(input_, FFTW_FORWARD);
+    }
+  private:
+    const CTensor &input_;
+    std::vector<CTensor> *output_;
+  };
+
+  TEST(FFTWTest, ForgetPlansWhileInUseTest) {
+    int old_threads = set_tensor_threads(4);
+    CTensor input = CTensor::random(64, 64);
+    CTensor ref_fft = fftw(input, FFTW_FORWARD);
+    std::vector<CTensor> output(64);
+    ForgetPlansTask task(input, &output);
+    parallel::run_chunks(task, output.size());
+    for (size_t i = 0; i < output.size(); i += 2) {
+      EXPECT_TRUE(approx_eq(ref_fft, output[i], 1e-10));
+    }
+    set_tensor_threads(old_threads);
+  }
+
+  // Part of the output of a complex DFT that is computed by rfft()
+  CTensor half_spectrum(const CTensor& full, const Booleans& convert) {
+    tensor::index dim = 0;
+    while (dim < convert.size() && !convert[dim]) {
+      dim++;
+    }
+    if (dim == convert.size()) {
+      return full;
+    }
+    const Indices& size = full.dimensions();
+    tensor::index before = 1, after = 1;
+    for (tensor::index i = 0; i < dim; i++) {
+      before *= size[i];
+    }
+    for (tensor::index i = dim+1; i < size.size(); i++) {
+      after *= size[i];
+    }
+    Indices half_size(size);
+    half_size.at(dim) = size[dim] / 2 + 1;
+    CTensor half = reshape(full, before, size[dim], after)
+      (range(), range(0, size[dim] / 2), range());
+    return reshape(half, half_size);
+  }
+
+  TEST(FFTWTest, RealFFTTest) {
+    for (int rank = 1; rank <= 3; rank++) {
+      for (DimensionIterator iter(rank,6); iter; ++iter) {
+        RTensor input = RTensor::random(*iter);
+        if (input.size() == 0) {
+          continue;
+        }
+        CTensor cinput = to_complex(input);
+
+        Booleans all(rank);
+        for (tensor::index i = 0; i < rank; i++) {
+          all.at(i) = true;
+        }
+        CTensor output = rfft(input);
+        EXPECT_TRUE(approx_eq(half_spectrum(full_dft(cinput, -1), all),
+                              output, 1e-10));
+        EXPECT_TRUE(approx_eq(input * (double)input.size(),
+                              irfft(output, input.dimension(0)), 1e-10));
+
+        for (tensor::index dim = 0; dim < rank; dim++) {
+          Booleans convert(rank);
+          for (tensor::index i = 0; i < rank; i++) {
+            convert.at(i) = (i == dim);
+          }
+          output = rfft(input, dim);
+          EXPECT_TRUE(approx_eq(half_spectrum(partial_dft(cinput, dim, -1), convert),
+                                output, 1e-10));
+          EXPECT_TRUE(approx_eq(input * (double)input.dimension(dim),
+                                irfft(output, dim, input.dimension(dim)), 1e-10));
+        }
+        for (BooleansIterator biter(rank); biter; ++biter) {
+          double norm = 1.0;
+          tensor::index first = -1;
+          for (tensor::index i = 0; i < rank; i++) {
+            if ((*biter)[i]) {
+              norm *= input.dimension(i);
+              if (first < 0) first = i;
+            }
+          }
+          output = rfft(input, *biter);
+          EXPECT_TRUE(approx_eq(half_spectrum(partial_dft(cinput, *biter, -1), *biter),
+                                output, 1e-10));
+          tensor::index n = (first < 0)? 0 : input.dimension(first);
+          EXPECT_TRUE(approx_eq(input * norm, irfft(output, *biter, n), 1e-10));
+        }
+      }
+    }
+  }
+
+  TEST(FFTWTest, RealFFTDeathTest) {
+    for (int rank = 1; rank < 3; rank++) {
+      for (DimensionIterator iter(rank,6); iter; ++iter) {
+        RTensor input = RTensor::random(*iter);
+
+        ASSERT_DEATH(rfft(input, -1), ".*");
+        ASSERT_DEATH(rfft(input, rank), ".*");
+        ASSERT_DEATH(rfft(input, Booleans(rank+1)), ".*");
+        ASSERT_DEATH(irfft(to_complex(input), Booleans(rank-1), 1), ".*");
+        ASSERT_DEATH(irfft(to_complex(input), 0, 2 * input.dimension(0) + 2), ".*");
+      }
+    }
+  }
+
+  TEST(FFTWTest, BatchFFTTest) {
+    int old_threads = set_tensor_threads(1);
+    for (int threads = 1; threads <= 4; threads += 3) {
+      set_tensor_threads(threads);
+      for (int rank = 1; rank <= 3; rank++) {
+        for (DimensionIterator iter(rank,5); iter; ++iter) {
+          std::vector<CTensor> batch;
+          for (int i = 0; i < 7; i++) {
+            batch.push_back(CTensor::random(*iter));
+          }
+          if (batch[0].size() == 0) {
+            continue;
+          }
+
+          std::vector<CTensor> output = fftw(batch, FFTW_FORWARD);
+          std::vector<CTensor> inplace = batch;
+          fftw_inplace(inplace, FFTW_FORWARD);
+          ASSERT_EQ(batch.size(), output.size());
+          for (size_t i = 0; i < batch.size(); i++) {
+            CTensor ref_fft = fftw(batch[i], FFTW_FORWARD);
+            EXPECT_TRUE(approx_eq(ref_fft, output[i], 1e-10));
+            EXPECT_TRUE(approx_eq(ref_fft, inplace[i], 1e-10));
+          }
+
+          for (BooleansIterator biter(rank); biter; ++biter) {
+            output = fftw(batch, *biter, FFTW_BACKWARD);
+            inplace = batch;
+            fftw_inplace(inplace, *biter, FFTW_BACKWARD);
+            for (size_t i = 0; i < batch.size(); i++) {
+              CTensor ref_ifft = partial_dft(batch[i], *biter, +1);
+              EXPECT_TRUE(approx_eq(ref_ifft, output[i], 1e-10));
+              EXPECT_TRUE(approx_eq(ref_ifft, inplace[i], 1e-10));
+            }
+          }
+        }
+      }
+    }
+    set_tensor_threads(old_threads);
+  }
+
+  TEST(FFTWTest, ThreadedFFTTest) {
+    int old_threads = set_tensor_threads(1);
+    CTensor input = CTensor::random(256, 256);
+    CTensor ref_fft = fftw(input, FFTW_FORWARD);
+    set_tensor_threads(4);
+    EXPECT_TRUE(approx_eq(ref_fft, fftw(input, FFTW_FORWARD), 1e-10));
+    std::vector<CTensor> batch(1, input);
+    fftw_inplace(batch, FFTW_FORWARD);
+    EXPECT_TRUE(approx_eq(ref_fft, batch[0], 1e-10));
+    set_tensor_threads(old_threads);
+  }
+
+  // With a full cache of plans, a batch still makes at most one plan for
+  // aligned tensors and one for the rest
+  TEST(FFTWTest, BatchFullCacheTest) {
+    fftw_forget_plans();
+    for (int n = 1; n <= 300; n++) {
+      fftw(CTensor::random(n), FFTW_FORWARD);
+    }
+    std::vector<CTensor> batch;
+    for (int i = 0; i < 20; i++) {
+      batch.push_back(CTensor::random(7, 43));
+    }
+    unsigned long calls = fftw_planner_calls();
+    std::vector<CTensor> output = fftw(batch, FFTW_FORWARD);
+    EXPECT_LE(fftw_planner_calls() - calls, 2ul);
+    for (size_t i = 0; i < batch.size(); i++) {
+      EXPECT_TRUE(approx_eq(fftw(batch[i], FFTW_FORWARD), output[i], 1e-10));
+    }
+    calls = fftw_planner_calls();
+    fftw_inplace(batch, FFTW_FORWARD);
+    EXPECT_LE(fftw_planner_calls() - calls, 2ul);
+    for (size_t i = 0; i < batch.size(); i++) {
+      EXPECT_TRUE(approx_eq(batch[i], output[i], 1e-10));
+    }
+    fftw_forget_plans();
+  }
+
+  TEST(FFTWTest, BatchDeathTest) {
+    std::vector<CTensor> batch;
+    batch.push_back(CTensor::random(3, 4));
+    batch.push_back(CTensor::random(4, 3));
+    ASSERT_DEATH(fftw(batch, FFTW_FORWARD), ".*");
+    batch.pop_back();
+    ASSERT_DEATH(fftw(batch, Booleans(3), FFTW_FORWARD), ".*");
+  }
 }
@@ -20,6 +20,7 @@
 #include "loops.h"
 #include <gtest/gtest.h>
 #include <tensor/tensor.h>
+#include <tensor/threads.h>
 
 #include "slow_fold.cc"
 
@@ -96,6 +97,117 @@ namespace tensor_test {
   }
  
 
+  //////////////////////////////////////////////////////////////////////
+  // SMALL MATRICES
+  //
+  // The kernels for small matrices give the same results as BLAS for all
+  // combinations of transposed and conjugated arguments.
+  //
+
+  template<typename elt_t>
+  void test_small_gemm(index max_dim) {
+    for (int rankA = 1; rankA <= 3; rankA++) {
+      for (int rankB = 1; rankB <= 3; rankB++) {
+        for (int times = 0; times < 20; times++) {
+          Indices dA = random_dimensions(rankA, max_dim);
+          Indices dB = random_dimensions(rankB, max_dim);
+          int i = rand<int>(0, rankA), j = rand<int>(0, rankB);
+          dA.at(i) = dB.at(j) = rand<int>(1, max_dim + 1);
+          Tensor<elt_t> A(dA), B(dB);
+          A.randomize();
+          B.randomize();
+          index old = set_small_gemm_size(0);
+          Tensor<elt_t> AB = fold(A, i, B, j), AcB = foldc(A, i, B, j);
+          Tensor<elt_t> AiB = foldin(A, i, B, j);
+          set_small_gemm_size(1000000);
+          EXPECT_TRUE(approx_eq(AB, fold(A, i, B, j)));
+          EXPECT_TRUE(approx_eq(AcB, foldc(A, i, B, j)));
+          EXPECT_TRUE(approx_eq(AiB, foldin(A, i, B, j)));
+          set_small_gemm_size(old);
+        }
+      }
+    }
+    // Square matrices have their own kernels
+    for (index d = 1; d <= 5; d++) {
+      Tensor<elt_t> A(d, d), B(d, d);
+      A.randomize();
+      B.randomize();
+      for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+          index old = set_small_gemm_size(0);
+          Tensor<elt_t> AB = fold(A, i, B, j), AcB = foldc(A, i, B, j);
+          Tensor<elt_t> AiB = foldin(A, i, B, j);
+          set_small_gemm_size(1000000);
+          EXPECT_TRUE(approx_eq(AB, fold(A, i, B, j)));
+          EXPECT_TRUE(approx_eq(AcB, foldc(A, i, B, j)));
+          EXPECT_TRUE(approx_eq(AiB, foldin(A, i, B, j)));
+          set_small_gemm_size(old);
+        }
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // BATCHES OF CONTRACTIONS
+  //
+
+  template<typename elt_t>
+  void test_fold_batch(const Indices &dA, int i, const Indices &dB, int j,
+                       index n)
+  {
+    std::vector<Tensor<elt_t> > A, B;
+    for (index k = 0; k < n; k++) {
+      A.push_back(Tensor<elt_t>(dA));
+      A.back().randomize();
+      B.push_back(Tensor<elt_t>(dB));
+      B.back().randomize();
+    }
+    std::vector<Tensor<elt_t> > AB = fold(A, i, B, j);
+    std::vector<Tensor<elt_t> > AcB = foldc(A, i, B, j);
+    std::vector<Tensor<elt_t> > AB0 = fold(A, i, std::vector<Tensor<elt_t> >(1, B[0]), j);
+    ASSERT_EQ(n, (index)AB.size());
+    ASSERT_EQ(n, (index)AB0.size());
+    for (index k = 0; k < n; k++) {
+      EXPECT_TRUE(approx_eq(AB[k], fold(A[k], i, B[k], j), 1e-13));
+      EXPECT_TRUE(approx_eq(AcB[k], foldc(A[k], i, B[k], j), 1e-13));
+      EXPECT_TRUE(approx_eq(AB0[k], fold(A[k], i, B[0], j), 1e-13));
+    }
+  }
+
+  template<typename elt_t>
+  void test_fold_batch(index max_dim) {
+    for (int rankA = 1; rankA <= 3; rankA++) {
+      for (int rankB = 1; rankB <= 3; rankB++) {
+        for (int i = 0; i < rankA; i++) {
+          for (int j = 0; j < rankB; j++) {
+            Indices dA = random_dimensions(rankA, max_dim);
+            Indices dB = random_dimensions(rankB, max_dim);
+            dA.at(i) = dB.at(j) = rand<int>(1, max_dim + 1);
+            test_fold_batch<elt_t>(dA, i, dB, j, 5);
+          }
+        }
+      }
+    }
+    // Many small matrices, handled by several threads
+    int old = set_tensor_threads(4);
+    test_fold_batch<elt_t>(igen << 8 << 8, 1, igen << 8 << 8, 0, 300);
+    set_tensor_threads(old);
+    // Matrices that are multiplied with BLAS
+    test_fold_batch<elt_t>(igen << 40 << 40, 1, igen << 40 << 40, 1, 4);
+  }
+
+  template<typename elt_t>
+  std::vector<Tensor<elt_t> > fold_batch_with_shapes(const Indices &dA,
+                                                     const Indices &dB)
+  {
+    std::vector<Tensor<elt_t> > A, B;
+    A.push_back(Tensor<elt_t>(igen << 2 << 2));
+    A.push_back(Tensor<elt_t>(dA));
+    B.push_back(Tensor<elt_t>(dB));
+    B.push_back(Tensor<elt_t>(dB));
+    return fold(A, 0, B, 0);
+  }
+
   //////////////////////////////////////////////////////////////////////
   // REAL SPECIALIZATIONS
   //
@@ -110,6 +222,33 @@ namespace tensor_test {
     test_fold_death<double,double>();
   }
 
+  TEST(FoldTest, FoldBatchDoubleTest) {
+    test_fold_batch<double>(MATRIX_MAX_DIM);
+    std::vector<RTensor> A(3, RTensor::random(3, 4)), B(3, RTensor::random(4, 2));
+    std::vector<RTensor> AB = mmult(A, B);
+    for (size_t k = 0; k < A.size(); k++)
+      EXPECT_TRUE(approx_eq(AB[k], mmult(A[k], B[k]), 1e-13));
+    // Output tensors are reused
+    std::vector<RTensor> C;
+    mmult_into(C, A, B);
+    const double *p = C[1].begin();
+    mmult_into(C, A, B);
+    EXPECT_EQ(p, C[1].begin());
+    EXPECT_TRUE(all_equal(AB[1], C[1]));
+    // ...unless they are also arguments
+    mmult_into(B, A, B);
+    for (size_t k = 0; k < A.size(); k++)
+      EXPECT_TRUE(all_equal(AB[k], B[k]));
+  }
+
+  TEST(FoldTest, FoldSmallGemmDoubleTest) {
+    test_small_gemm<double>(MATRIX_MAX_DIM);
+  }
+
+  TEST(FoldTest, FoldBatchDoubleDeathTest) {
+    ASSERT_DEATH(fold_batch_with_shapes<double>(igen << 3 << 2, igen << 2 << 2), ".*");
+  }
+
   //////////////////////////////////////////////////////////////////////
   // COMPLEX SPECIALIZATIONS
   //
@@ -122,4 +261,12 @@ namespace tensor_test {
     test_fold_death<cdouble,cdouble>();
   }
 
+  TEST(FoldTest, FoldSmallGemmCdoubleTest) {
+    test_small_gemm<cdouble>(MATRIX_MAX_DIM);
+  }
+
+  TEST(FoldTest, FoldBatchCdoubleTest) {
+    test_fold_batch<cdouble>(MATRIX_MAX_DIM);
+  }
+
 } // namespace tensor_test
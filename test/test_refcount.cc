@@ -18,6 +18,7 @@
  */
 
 #include "alloc_informer.h"
+#include <pthread.h>
 #include <tensor/refcount.h>
 #include <gtest/gtest.h>
 
@@ -171,3 +172,76 @@ TEST(RefPointerTest, Reallocation) {
   EXPECT_NE(r.begin_const(), newPointer.begin_const());
   EXPECT_EQ(newsize, newPointer.size());
 }
+
+// Copies of the same data may be created and destroyed from different
+// threads when the reference counter is atomic.
+struct SharedCopies {
+  const RefPointer<int,tensor::AtomicRefCounter> *shared;
+  int copies;
+};
+
+static void *make_copies(void *arg) {
+  SharedCopies *s = static_cast<SharedCopies*>(arg);
+  for (int i = 0; i < s->copies; i++) {
+    RefPointer<int,tensor::AtomicRefCounter> copy(*s->shared);
+    RefPointer<int,tensor::AtomicRefCounter> other;
+    other = copy;
+  }
+  return 0;
+}
+
+TEST(RefPointerTest, AtomicThreadedCopies) {
+  const int nthreads = 4;
+  RefPointer<int,tensor::AtomicRefCounter> r(10);
+  SharedCopies s = { &r, 100000 };
+  pthread_t threads[nthreads];
+  for (int i = 0; i < nthreads; i++) {
+    pthread_create(&threads[i], 0, make_copies, &s);
+  }
+  for (int i = 0; i < nthreads; i++) {
+    pthread_join(threads[i], 0);
+  }
+  EXPECT_EQ(1, r.ref_count());
+  EXPECT_EQ(10, r.size());
+}
+
+// The serial counter has the same copy-on-write semantics.
+TEST(RefPointerTest, SerialCounter) {
+  RefPointer<int,tensor::SerialRefCounter> r(2);
+  RefPointer<int,tensor::SerialRefCounter> r2(r);
+  EXPECT_EQ(2, r.ref_count());
+  EXPECT_EQ(r.begin_const(), r2.begin_const());
+  EXPECT_NE(r.begin_const(), r2.begin());
+  EXPECT_EQ(1, r.ref_count());
+  EXPECT_EQ(1, r2.ref_count());
+}
+
+#ifdef TENSOR_MOVE_SEMANTICS
+// Moving a pointer transfers the data without changing the number of
+// references, and leaves an empty pointer behind.
+TEST(RefPointerTest, MoveConstructor) {
+  RefPointer<int> r(2);
+  const int *data = r.begin_const();
+  RefPointer<int> r2(std::move(r));
+  EXPECT_EQ(data, r2.begin_const());
+  EXPECT_EQ(1, r2.ref_count());
+  EXPECT_EQ(0, r.size());
+  EXPECT_EQ(0, r.begin_const());
+}
+
+// Move assignment frees the old data at once.
+TEST(RefPointerTest, MoveAssign) {
+  AllocInformer::reset_counters();
+  {
+    RefPointer<AllocInformer> r1(2), r2(3);
+    r1 = std::move(r2);
+    EXPECT_EQ(2, AllocInformer::deallocations);
+    EXPECT_EQ(3, r1.size());
+    EXPECT_EQ(1, r1.ref_count());
+    EXPECT_EQ(0, r2.size());
+    r2 = r1;
+    EXPECT_EQ(2, r1.ref_count());
+  }
+  EXPECT_EQ(5, AllocInformer::deallocations);
+}
+#endif
@@ -17,7 +17,12 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <tensor/sdf.h>
+#include <tensor/threads.h>
 #include <gtest/gtest.h>
 
 using namespace sdf;
@@ -51,6 +56,7 @@ TEST(SDF, RTensor) {
     EXPECT_TRUE(all_equal(d, aux));
   }
   unlink("foo.dat");
+  unlink("foo.dat.idx");
 }
 
 
@@ -83,4 +89,697 @@ TEST(SDF, CTensor) {
     EXPECT_TRUE(all_equal(d, aux));
   }
   unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, MmapRTensor) {
+  RTensor a = RTensor(0);
+  RTensor b = RTensor::random(13);
+  RTensor c = RTensor::random(4,15);
+  RTensor d = RTensor::random(3,7,5);
+  std::vector<RTensor> v(3);
+  v.at(0) = b;
+  v.at(1) = c;
+  v.at(2) = d;
+  {
+    OutDataFile f("foo.dat");
+    f.dump(a, "a");
+    f.dump(b[0], "b0");
+    f.dump(b, "b");
+    f.dump(c, "c");
+    f.dump(d, "d");
+    f.dump(v, "v");
+  }
+  {
+    MmapDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "a");
+    EXPECT_TRUE(all_equal(a, aux));
+    double x;
+    f.load(&x, "b0");
+    EXPECT_EQ(x, b[0]);
+    f.load(&aux, "b");
+    EXPECT_TRUE(all_equal(b, aux));
+    f.load(&aux, "c");
+    EXPECT_TRUE(all_equal(c, aux));
+    EXPECT_TRUE(all_equal(c.dimensions(), aux.dimensions()));
+    f.load(&aux, "d");
+    EXPECT_TRUE(all_equal(d, aux));
+    EXPECT_TRUE(all_equal(d.dimensions(), aux.dimensions()));
+    std::vector<RTensor> w;
+    f.load(&w, "v");
+    ASSERT_EQ(w.size(), v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+      EXPECT_TRUE(all_equal(v[i], w[i]));
+    }
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, MmapCTensor) {
+  CTensor a = CTensor(0);
+  CTensor b = CTensor::random(13);
+  CTensor c = CTensor::random(4,15);
+  CTensor d = CTensor::random(3,7,5);
+  std::vector<CTensor> v(3);
+  v.at(0) = b;
+  v.at(1) = c;
+  v.at(2) = d;
+  {
+    OutDataFile f("foo.dat");
+    f.dump(a, "a");
+    f.dump(b[0], "b0");
+    f.dump(b, "b");
+    f.dump(c, "c");
+    f.dump(d, "d");
+    f.dump(v, "v");
+  }
+  {
+    MmapDataFile f("foo.dat");
+    CTensor aux;
+    f.load(&aux, "a");
+    EXPECT_TRUE(all_equal(a, aux));
+    cdouble x;
+    f.load(&x, "b0");
+    EXPECT_EQ(x, b[0]);
+    f.load(&aux, "b");
+    EXPECT_TRUE(all_equal(b, aux));
+    f.load(&aux, "c");
+    EXPECT_TRUE(all_equal(c, aux));
+    f.load(&aux, "d");
+    EXPECT_TRUE(all_equal(d, aux));
+    std::vector<CTensor> w;
+    f.load(&w, "v");
+    ASSERT_EQ(w.size(), v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+      EXPECT_TRUE(all_equal(v[i], w[i]));
+    }
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, MmapModifyDoesNotChangeFile) {
+  RTensor b = RTensor::random(1000);
+  {
+    OutDataFile f("foo.dat");
+    f.dump(b, "b");
+  }
+  {
+    MmapDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "b");
+    aux.at(0) += 1.0;
+    aux.at(999) += 1.0;
+    EXPECT_EQ(aux[0], b[0] + 1.0);
+    EXPECT_EQ(aux[999], b[999] + 1.0);
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "b");
+    EXPECT_TRUE(all_equal(b, aux));
+  }
+  {
+    MmapDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "b");
+    EXPECT_TRUE(all_equal(b, aux));
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+static const RTensor mmap_load(const char *filename, const char *name)
+{
+  MmapDataFile f(filename);
+  RTensor aux;
+  f.load(&aux, name);
+  return aux;
+}
+
+TEST(SDF, MmapTensorOutlivesFile) {
+  RTensor b = RTensor::random(1000);
+  CTensor c = CTensor::random(30, 20);
+  {
+    OutDataFile f("foo.dat");
+    f.dump(b, "b");
+    f.dump(c, "c");
+  }
+  // The mapping stays alive while some tensor references it
+  RTensor aux = mmap_load("foo.dat", "b");
+  EXPECT_TRUE(all_equal(b, aux));
+  {
+    MmapDataFile f("foo.dat");
+    CTensor aux2, aux3;
+    f.seek("c");
+    f.load(&aux2, "c");
+    f.close();
+    EXPECT_TRUE(all_equal(c, aux2));
+    aux3 = aux2;
+    aux2 = CTensor();
+    EXPECT_TRUE(all_equal(c, aux3));
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+  EXPECT_TRUE(all_equal(b, aux));
+}
+
+//
+// INDEX OF RECORDS
+//
+
+static std::string record_name(int i)
+{
+  std::ostringstream s;
+  s << "t" << i;
+  return s.str();
+}
+
+static RTensor record_tensor(int i)
+{
+  return RTensor::random(i % 5 + 1, i % 3 + 1);
+}
+
+static std::vector<RTensor> write_records(int first, int n)
+{
+  std::vector<RTensor> output;
+  OutDataFile f("foo.dat");
+  for (int i = first; i < first + n; i++) {
+    output.push_back(record_tensor(i));
+    f.dump(output.back(), record_name(i));
+  }
+  return output;
+}
+
+template<class Reader>
+void test_index(const std::vector<RTensor> &data)
+{
+  Reader f("foo.dat");
+  const std::vector<DataFileRecord> &records = f.records();
+  ASSERT_EQ(records.size(), data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    EXPECT_EQ(records[i].name, record_name(i));
+    EXPECT_EQ(records[i].tag, DataFile::TAG_RTENSOR);
+    EXPECT_TRUE(all_equal(records[i].dimensions, data[i].dimensions()));
+  }
+  for (int i = data.size() - 1; i >= 0; i -= 3) {
+    RTensor aux;
+    ASSERT_TRUE(f.seek(record_name(i)));
+    f.load(&aux, record_name(i));
+    EXPECT_TRUE(all_equal(aux, data[i]));
+  }
+  RTensor aux;
+  f.seek(records[1]);
+  f.load(&aux, record_name(1));
+  EXPECT_TRUE(all_equal(aux, data[1]));
+  f.load(&aux, record_name(2));
+  EXPECT_TRUE(all_equal(aux, data[2]));
+  EXPECT_FALSE(f.seek("foo"));
+}
+
+TEST(SDF, Index) {
+  std::vector<RTensor> data = write_records(0, 50);
+  EXPECT_TRUE(file_exists("foo.dat.idx"));
+  test_index<InDataFile>(data);
+  test_index<MmapDataFile>(data);
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, IndexAppend) {
+  std::vector<RTensor> data = write_records(0, 20);
+  std::vector<RTensor> more = write_records(20, 10);
+  data.insert(data.end(), more.begin(), more.end());
+  test_index<InDataFile>(data);
+  test_index<MmapDataFile>(data);
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, IndexVectors) {
+  std::vector<CTensor> v(3);
+  v.at(0) = CTensor::random(3);
+  v.at(1) = CTensor::random(2, 2);
+  v.at(2) = CTensor::random(1, 2, 3);
+  RTensor a = RTensor::random(4, 4);
+  {
+    OutDataFile f("foo.dat");
+    f.dump(v, "v");
+    f.dump(a, "a");
+    f.dump(1.0, "x");
+    f.dump(a + 1.0, "a");
+  }
+  for (int scan = 0; scan < 2; scan++) {
+    if (scan) {
+      unlink("foo.dat.idx");
+    }
+    InDataFile f("foo.dat");
+    const std::vector<DataFileRecord> &records = f.records();
+    ASSERT_EQ(records.size(), 4);
+    EXPECT_EQ(records[0].tag, DataFile::TAG_CTENSOR_VECTOR);
+    EXPECT_TRUE(all_equal(records[0].dimensions, Indices(igen << 3)));
+    EXPECT_EQ(records[2].name, "x");
+    std::vector<CTensor> w;
+    ASSERT_TRUE(f.seek("v"));
+    f.load(&w, "v");
+    ASSERT_EQ(w.size(), 3);
+    EXPECT_TRUE(all_equal(w[2], v[2]));
+    /* With repeated names, the last record is selected */
+    RTensor aux;
+    ASSERT_TRUE(f.seek("a"));
+    f.load(&aux, "a");
+    EXPECT_TRUE(all_equal(aux, a + 1.0));
+    double x;
+    ASSERT_TRUE(f.seek("x"));
+    f.load(&x, "x");
+    EXPECT_EQ(x, 1.0);
+  }
+  /* Readers do not write the index */
+  EXPECT_FALSE(file_exists("foo.dat.idx"));
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, IndexWithoutIndexFile) {
+  std::vector<RTensor> data = write_records(0, 10);
+  unlink("foo.dat.idx");
+  test_index<InDataFile>(data);
+  test_index<MmapDataFile>(data);
+  /* Readers do not write the index */
+  EXPECT_FALSE(file_exists("foo.dat.idx"));
+  unlink("foo.dat");
+}
+
+TEST(SDF, IndexParanoid) {
+  /* The index is only written once the file replaces the original one */
+  std::vector<RTensor> data;
+  {
+    OutDataFile f("foo.dat", DataFile::SDF_PARANOID);
+    for (int i = 0; i < 5; i++) {
+      data.push_back(record_tensor(i));
+      f.dump(data[i], record_name(i));
+    }
+    f.flush();
+    EXPECT_FALSE(file_exists("foo.dat.idx"));
+  }
+  EXPECT_TRUE(file_exists("foo.dat.idx"));
+  test_index<InDataFile>(data);
+  test_index<MmapDataFile>(data);
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, IndexOutOfDate) {
+  /* An index file that belongs to an older version of the data file */
+  write_records(0, 10);
+  rename_file("foo.dat.idx", "foo.idx");
+  unlink("foo.dat");
+  std::vector<RTensor> data = write_records(0, 12);
+  std::reverse(data.begin(), data.end());
+  unlink("foo.dat");
+  {
+    OutDataFile f("foo.dat");
+    for (int i = 0; i < 12; i++) {
+      f.dump(data[i], record_name(i));
+    }
+  }
+  rename_file("foo.idx", "foo.dat.idx");
+  test_index<InDataFile>(data);
+  test_index<MmapDataFile>(data);
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+//
+// COMPRESSED RECORDS
+//
+
+static RTensor sparse_data(tensor::index n)
+{
+  RTensor output = RTensor::zeros(n, 1);
+  for (tensor::index i = 0; i < n; i += 97)
+    output.at(i) = i;
+  return output;
+}
+
+static RTensor smooth_data(tensor::index n)
+{
+  RTensor output(n);
+  for (tensor::index i = 0; i < n; i++)
+    output.at(i) = sin(0.001 * i) + 2.0;
+  return output;
+}
+
+template<class Reader, class Tensor>
+void test_compressed(const Tensor &t)
+{
+  RTensor r = RTensor::random(7);
+  {
+    OutDataFile f("foo.dat");
+    f.dump(r, "r");
+    f.dump_compressed(t, "t");
+    f.dump(r, "r2");
+  }
+  {
+    Reader f("foo.dat");
+    Tensor aux;
+    RTensor aux_r;
+    f.load(&aux_r, "r");
+    EXPECT_TRUE(all_equal(aux_r, r));
+    f.load(&aux, "t");
+    EXPECT_TRUE(all_equal(aux, t));
+    EXPECT_TRUE(all_equal(aux.dimensions(), t.dimensions()));
+    f.load(&aux_r, "r2");
+    EXPECT_TRUE(all_equal(aux_r, r));
+  }
+  {
+    Reader f("foo.dat");
+    ASSERT_EQ(f.records().size(), 3);
+    EXPECT_TRUE(all_equal(f.records()[1].dimensions, t.dimensions()));
+    tensor::index n = t.size();
+    tensor::index ranges[4][2] = {{0, n}, {0, n/3}, {n/3, n/2}, {n-1, 1}};
+    for (int i = 0; i < 4; i++) {
+      tensor::index first = ranges[i][0], count = ranges[i][1];
+      if (first < 0 || first + count > n)
+        continue;
+      Tensor aux;
+      ASSERT_TRUE(f.seek("t"));
+      f.load(&aux, "t", first, count);
+      ASSERT_EQ(aux.size(), count);
+      if (count)
+        EXPECT_TRUE(all_equal(aux, Tensor(t(range(first, first + count - 1)))));
+    }
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, CompressedRTensor) {
+  tensor::index sizes[] = {0, 1, 13, 100000};
+  for (int i = 0; i < 4; i++) {
+    tensor::index n = sizes[i];
+    test_compressed<InDataFile>(RTensor::random(n));
+    test_compressed<InDataFile>(sparse_data(n));
+    test_compressed<InDataFile>(smooth_data(n));
+    test_compressed<MmapDataFile>(RTensor::random(n));
+    test_compressed<MmapDataFile>(sparse_data(n));
+    test_compressed<MmapDataFile>(smooth_data(n));
+  }
+  test_compressed<InDataFile>(RTensor::random(30, 2, 1000));
+  test_compressed<MmapDataFile>(RTensor::random(30, 2, 1000));
+  int threads = set_tensor_threads(4);
+  test_compressed<InDataFile>(smooth_data(300000));
+  test_compressed<MmapDataFile>(sparse_data(300000));
+  set_tensor_threads(threads);
+}
+
+TEST(SDF, CompressedCTensor) {
+  tensor::index sizes[] = {0, 1, 13, 100000};
+  for (int i = 0; i < 4; i++) {
+    tensor::index n = sizes[i];
+    test_compressed<InDataFile>(CTensor::random(n));
+    test_compressed<InDataFile>(to_complex(sparse_data(n), smooth_data(n)));
+    test_compressed<MmapDataFile>(CTensor::random(n));
+    test_compressed<MmapDataFile>(to_complex(sparse_data(n), smooth_data(n)));
+  }
+}
+
+TEST(SDF, CompressedSize) {
+  RTensor t = sparse_data(100000);
+  {
+    OutDataFile f("foo.dat");
+    f.dump_compressed(t, "t");
+  }
+  std::ifstream s("foo.dat", std::ios_base::in | std::ios_base::binary);
+  s.seekg(0, std::ios_base::end);
+  EXPECT_LT((size_t)s.tellg(), t.size() * sizeof(double) / 10);
+  /* Compressed records are also found when scanning the file */
+  unlink("foo.dat.idx");
+  {
+    InDataFile f("foo.dat");
+    ASSERT_EQ(f.records().size(), 1);
+    EXPECT_EQ(f.records()[0].tag, DataFile::TAG_RTENSOR_COMPRESSED);
+    EXPECT_TRUE(all_equal(f.records()[0].dimensions, t.dimensions()));
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+/* Replace the chunk size and number of chunks of the compressed record
+   in "foo.dat", which holds n numbers in a single chunk. */
+static void damage_compressed(size_t n, size_t chunk, size_t nchunks)
+{
+  std::fstream s("foo.dat", std::ios_base::in | std::ios_base::out |
+                 std::ios_base::binary);
+  std::string data((std::istreambuf_iterator<char>(s)),
+                   std::istreambuf_iterator<char>());
+  size_t header[3] = { n, 32768, 1 };
+  size_t where = data.find(std::string((char *)header, sizeof(header)));
+  ASSERT_NE(where, std::string::npos);
+  header[1] = chunk;
+  header[2] = nchunks;
+  s.clear();
+  s.seekp(where);
+  s.write((char *)header, sizeof(header));
+}
+
+template<class DataFile>
+static void load_damaged()
+{
+  DataFile f("foo.dat");
+  RTensor t;
+  f.load(&t, "t");
+}
+
+TEST(SDF, DamagedCompressedDeathTest) {
+  RTensor t = RTensor::random(100);
+  size_t damages[3][2] = { { 0, 1 }, { 32768, 0 }, { 10, 2 } };
+  for (int i = 0; i < 3; i++) {
+    unlink("foo.dat");
+    {
+      OutDataFile f("foo.dat");
+      f.dump_compressed(t, "t");
+    }
+    damage_compressed(100, damages[i][0], damages[i][1]);
+    ASSERT_DEATH(load_damaged<InDataFile>(), "damaged compressed record");
+    ASSERT_DEATH(load_damaged<MmapDataFile>(), "damaged compressed record");
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, PartialRead) {
+  RTensor r = RTensor::random(10, 20);
+  CTensor c = CTensor::random(10, 20);
+  {
+    OutDataFile f("foo.dat");
+    f.dump(r, "r");
+    f.dump(c, "c");
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux_r;
+    CTensor aux_c;
+    f.load(&aux_r, "r", 15, 30);
+    EXPECT_TRUE(all_equal(aux_r, RTensor(r(range(15, 44)))));
+    f.load(&aux_c, "c", 190, 10);
+    EXPECT_TRUE(all_equal(aux_c, CTensor(c(range(190, 199)))));
+  }
+  {
+    MmapDataFile f("foo.dat");
+    RTensor aux_r;
+    CTensor aux_c;
+    f.load(&aux_r, "r", 0, 1);
+    EXPECT_EQ(aux_r[0], r[0]);
+    f.load(&aux_c, "c", 3, 0);
+    EXPECT_EQ(aux_c.size(), 0);
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, AsyncDump) {
+  RTensor r = RTensor::random(300, 200);
+  CTensor c = CTensor::random(1000);
+  std::vector<RTensor> v(3, RTensor::random(4, 5));
+  RTensor r0 = r;
+  CTensor c0 = c;
+  {
+    AsyncOutDataFile f("foo.dat");
+    f.dump(r, "r");
+    f.dump_compressed(c, "c");
+    f.dump(v, "v");
+    f.dump(3, "three");
+    /* The records keep the values that were dumped */
+    r.at(0, 0) = 1.0;
+    c.at(999) = 2.0;
+    f.flush();
+    EXPECT_TRUE(file_exists("foo.dat"));
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux_r;
+    CTensor aux_c;
+    std::vector<RTensor> aux_v;
+    int three;
+    f.load(&aux_r, "r");
+    EXPECT_TRUE(all_equal(aux_r, r0));
+    EXPECT_FALSE(all_equal(aux_r, r));
+    f.load(&aux_c, "c");
+    EXPECT_TRUE(all_equal(aux_c, c0));
+    f.load(&aux_v, "v");
+    ASSERT_EQ(aux_v.size(), 3);
+    EXPECT_TRUE(all_equal(aux_v[2], v[2]));
+    f.load(&three, "three");
+    EXPECT_EQ(three, 3);
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, AsyncDumpMany) {
+  /* Dumps wait for the previous snapshot to be written, and each record
+     keeps the value it had when it was dumped */
+  RTensor r = RTensor::zeros(1000, 100);
+  {
+    AsyncOutDataFile f("foo.dat");
+    for (int i = 0; i < 20; i++) {
+      f.dump(r, "r");
+      f.dump_compressed(r, "rc");
+      r.at(0, 0) = i + 1.0;
+    }
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux;
+    for (int i = 0; i < 20; i++) {
+      f.load(&aux, "r");
+      EXPECT_EQ(aux(0, 0), (double)i);
+      f.load(&aux, "rc");
+      EXPECT_EQ(aux(0, 0), (double)i);
+    }
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, AsyncParanoid) {
+  RTensor r = RTensor::random(100);
+  {
+    AsyncOutDataFile f("foo.dat", DataFile::SDF_PARANOID);
+    f.dump(r, "r");
+    f.flush();
+    /* The file only replaces the old one when it is closed */
+    EXPECT_FALSE(file_exists("foo.dat"));
+    EXPECT_TRUE(file_exists("foo.dat.tmp"));
+    f.close();
+    f.wait();
+    EXPECT_TRUE(file_exists("foo.dat"));
+    EXPECT_FALSE(file_exists("foo.dat.tmp"));
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "r");
+    EXPECT_TRUE(all_equal(aux, r));
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+template<class Tensor>
+void test_slices(const Tensor &t)
+{
+  tensor::index n = t.dimension(t.rank() - 1);
+  Indices slice_dims = t.dimensions();
+  slice_dims.at(t.rank() - 1) = 1;
+  {
+    OutDataFile f("foo.dat");
+    f.dump(RTensor::random(3), "before");
+    f.begin_slices(Indices(igen << t.dimension(0) << t.dimension(1)), "t",
+                   sizeof(typename Tensor::elt_t) != sizeof(double));
+    for (tensor::index i = 0; i < n; i++)
+      f.append_slice(reshape(Tensor(t(range(), range(), range(i))),
+                             t.dimension(0), t.dimension(1)));
+    f.end_slices();
+    f.dump(RTensor::random(3), "after");
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    /* The record is read as any other tensor, with or without the index */
+    InDataFile f("foo.dat");
+    Tensor aux;
+    ASSERT_TRUE(f.seek("t"));
+    f.load(&aux, "t");
+    EXPECT_TRUE(all_equal(aux, t));
+    unlink("foo.dat.idx");
+  }
+  {
+    InDataFile f("foo.dat");
+    ASSERT_TRUE(f.seek("t"));
+    ASSERT_EQ(f.begin_slices("t"), n);
+    for (tensor::index i = 0; i < n; i++) {
+      Tensor slice;
+      f.load_slice(&slice);
+      EXPECT_TRUE(all_equal(slice.dimensions(),
+                            Indices(igen << t.dimension(0) << t.dimension(1))));
+      EXPECT_TRUE(all_equal(reshape(slice, slice_dims),
+                            t(range(), range(), range(i))));
+    }
+    RTensor after;
+    f.load(&after, "after");
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, Slices) {
+  test_slices(RTensor::random(3, 4, 10));
+  test_slices(CTensor::random(5, 1, 7));
+  test_slices(RTensor::random(2, 2, 0));
+}
+
+TEST(SDF, SlicesClosedByClose) {
+  {
+    OutDataFile f("foo.dat");
+    f.begin_slices(Indices(igen << 2), "v");
+    f.append_slice(RTensor(igen << 2, rgen << 1.0 << 2.0));
+    f.append_slice(RTensor(igen << 2, rgen << 3.0 << 4.0));
+  }
+  {
+    InDataFile f("foo.dat");
+    RTensor aux;
+    f.load(&aux, "v");
+    EXPECT_TRUE(all_equal(aux, RTensor(igen << 2 << 2,
+                                       rgen << 1.0 << 2.0 << 3.0 << 4.0)));
+  }
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
+}
+
+TEST(SDF, SlicesWrongLengthDeathTest) {
+  /* A record whose length does not match its dimensions is rejected */
+  unlink("foo.dat");
+  {
+    OutDataFile f("foo.dat");
+    f.dump(RTensor::random(3, 4), "t");
+  }
+  {
+    std::fstream s("foo.dat", std::ios_base::in | std::ios_base::out |
+                   std::ios_base::binary);
+    std::string data((std::istreambuf_iterator<char>(s)),
+                     std::istreambuf_iterator<char>());
+    size_t header[3] = { 3, 4, 12 };
+    size_t where = data.find(std::string((char *)header, sizeof(header)));
+    ASSERT_NE(where, std::string::npos);
+    header[2] = 11;
+    s.clear();
+    s.seekp(where);
+    s.write((char *)header, sizeof(header));
+  }
+  InDataFile f("foo.dat");
+  ASSERT_DEATH(f.begin_slices("t"), "has 11 elements");
+  unlink("foo.dat");
+  unlink("foo.dat.idx");
 }
@@ -0,0 +1,228 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cstring>
+#include <limits>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+#include <tensor/simd.h>
+#include "simd/simd.h"
+
+namespace tensor_test {
+
+  // Values in [-range,range], followed by special numbers.
+  const RTensor wide_values(double range)
+  {
+    RTensor x = (RTensor::random(1001) - 0.5) * (2 * range);
+    x.at(0) = 0.0;
+    x.at(1) = -0.0;
+    x.at(2) = std::numeric_limits<double>::infinity();
+    x.at(3) = -std::numeric_limits<double>::infinity();
+    x.at(4) = std::numeric_limits<double>::quiet_NaN();
+    x.at(5) = 1e-300;
+    x.at(6) = 800.0;
+    x.at(7) = -800.0;
+    return x;
+  }
+
+  bool same_bits(const RTensor &a, const RTensor &b)
+  {
+    return a.size() == b.size() &&
+      memcmp(a.begin(), b.begin(), a.size() * sizeof(double)) == 0;
+  }
+
+  bool same_bits(const CTensor &a, const CTensor &b)
+  {
+    return a.size() == b.size() &&
+      memcmp(a.begin(), b.begin(), a.size() * sizeof(cdouble)) == 0;
+  }
+
+  // Distance in units of the last place
+  double ulps(double a, double b)
+  {
+    if (a == b || (a != a && b != b))
+      return 0;
+    double ulp = std::abs(nextafter(b, 2 * b + 1) - b);
+    return std::abs(a - b) / ulp;
+  }
+
+  // Arithmetic operations give the same results at all levels
+  //
+  template<typename elt_t>
+  void test_simd_binops(Tensor<elt_t> &P)
+  {
+    Tensor<elt_t> Q(P.dimensions());
+    Q.randomize();
+    Q += number_one<elt_t>();
+    elt_t b = rand<elt_t>() + number_one<elt_t>();
+    SimdLevel old = set_simd_level(SIMD_NONE);
+    Tensor<elt_t> plus = P + Q, minus = P - Q, times = P * Q, divide = P / Q;
+    Tensor<elt_t> plus_n = P + b, minus_n = b - P, times_n = P * b, divide_n = b / Q;
+    for (int level = SIMD_SSE2; level <= simd_max_level(); level++) {
+      set_simd_level((SimdLevel)level);
+      SCOPED_TRACE(simd_level_name(simd_level()));
+      EXPECT_TRUE(same_bits(plus, P + Q));
+      EXPECT_TRUE(same_bits(minus, P - Q));
+      EXPECT_TRUE(same_bits(times, P * Q));
+      EXPECT_TRUE(same_bits(divide, P / Q));
+      EXPECT_TRUE(same_bits(plus_n, P + b));
+      EXPECT_TRUE(same_bits(minus_n, b - P));
+      EXPECT_TRUE(same_bits(times_n, P * b));
+      EXPECT_TRUE(same_bits(divide_n, b / Q));
+    }
+    set_simd_level(old);
+  }
+
+  // The complex kernels of each level divide as the C++ library does. They
+  // are called directly, so that no routing in simd.h can hide errors.
+  //
+  void test_simd_zdivide(CTensor &P)
+  {
+    CTensor Q(P.dimensions());
+    Q.randomize();
+    Q += number_one<cdouble>();
+    cdouble b = rand<cdouble>() + number_one<cdouble>();
+    const tensor::index n = P.size();
+    CTensor vv(P.dimensions()), vs(P.dimensions()), sv(P.dimensions());
+    for (tensor::index i = 0; i < n; i++) {
+      vv.at(i) = P[i] / Q[i];
+      vs.at(i) = P[i] / b;
+      sv.at(i) = b / Q[i];
+    }
+    for (int level = SIMD_SSE2; level <= simd_max_level(); level++) {
+      SCOPED_TRACE(simd_level_name((SimdLevel)level));
+      const simd::Kernels *k = simd::x86_kernels((SimdLevel)level);
+      ASSERT_TRUE(k != 0);
+      CTensor out(P.dimensions());
+      k->zbinop_vv(simd::DIVIDE, out.begin(), P.begin(), Q.begin(), n);
+      EXPECT_TRUE(same_bits(vv, out));
+      k->zbinop_vs(simd::DIVIDE, out.begin(), P.begin(), b, n);
+      EXPECT_TRUE(same_bits(vs, out));
+      k->zbinop_sv(simd::DIVIDE, out.begin(), b, Q.begin(), n);
+      EXPECT_TRUE(same_bits(sv, out));
+    }
+  }
+
+  // Vectorized functions are within two units in the last place from
+  // the C library, and give the same result at all levels.
+  //
+  template<double f(double), RTensor fT(const RTensor &)>
+  void test_simd_function(double range)
+  {
+    RTensor x = wide_values(range);
+    SimdLevel old = set_simd_level(SIMD_SSE2);
+    RTensor y = fT(x);
+    for (tensor::index i = 0; i < x.size(); i++) {
+      ASSERT_LE(ulps(y[i], f(x[i])), 2.0);
+    }
+    EXPECT_EQ(std::signbit(f(x[1])), std::signbit(y[1]));
+    for (int level = SIMD_SSE2; level <= simd_max_level(); level++) {
+      set_simd_level((SimdLevel)level);
+      SCOPED_TRACE(simd_level_name(simd_level()));
+      EXPECT_TRUE(same_bits(y, fT(x)));
+    }
+    set_simd_level(old);
+  }
+
+  // Other functions call the C library at all levels
+  //
+  template<double f(double), RTensor fT(const RTensor &)>
+  void test_libm_function(double range)
+  {
+    RTensor x = wide_values(range);
+    RTensor y(x.dimensions());
+    for (tensor::index i = 0; i < x.size(); i++) {
+      y.at(i) = f(x[i]);
+    }
+    SimdLevel old = simd_level();
+    for (int level = SIMD_NONE; level <= simd_max_level(); level++) {
+      set_simd_level((SimdLevel)level);
+      SCOPED_TRACE(simd_level_name(simd_level()));
+      EXPECT_TRUE(same_bits(y, fT(x)));
+    }
+    set_simd_level(old);
+  }
+
+  double _exp(double x) { return std::exp(x); }
+  double _sin(double x) { return std::sin(x); }
+  double _cos(double x) { return std::cos(x); }
+  double _sqrt(double x) { return std::sqrt(x); }
+  double _abs(double x) { return std::abs(x); }
+
+  TEST(SimdTest, Level) {
+    SimdLevel old = set_simd_level(SIMD_NONE);
+    EXPECT_EQ(SIMD_NONE, simd_level());
+    set_simd_level(SIMD_AVX512);
+    EXPECT_EQ(simd_max_level(), simd_level());
+    set_simd_level(old);
+    EXPECT_EQ(old, simd_level());
+  }
+
+  TEST(SimdTest, RTensorBinops) {
+    test_over_tensors<double>(test_simd_binops<double>);
+  }
+
+  TEST(SimdTest, CTensorBinops) {
+    test_over_tensors<cdouble>(test_simd_binops<cdouble>);
+  }
+
+  TEST(SimdTest, CTensorDivideKernels) {
+    test_over_tensors<cdouble>(test_simd_zdivide);
+  }
+
+  TEST(SimdTest, RTensorFastExp) {
+    test_simd_function<_exp,fast_exp>(1.0);
+    test_simd_function<_exp,fast_exp>(750.0);
+  }
+
+  TEST(SimdTest, RTensorExp) {
+    test_libm_function<_exp,exp>(1.0);
+    test_libm_function<_exp,exp>(750.0);
+  }
+
+  TEST(SimdTest, RTensorFastSin) {
+    test_simd_function<_sin,fast_sin>(1.0);
+    test_simd_function<_sin,fast_sin>(1e6);
+  }
+
+  TEST(SimdTest, RTensorSin) {
+    test_libm_function<_sin,sin>(1.0);
+    test_libm_function<_sin,sin>(1e6);
+  }
+
+  TEST(SimdTest, RTensorFastCos) {
+    test_simd_function<_cos,fast_cos>(1.0);
+    test_simd_function<_cos,fast_cos>(1e6);
+  }
+
+  TEST(SimdTest, RTensorCos) {
+    test_libm_function<_cos,cos>(1.0);
+    test_libm_function<_cos,cos>(1e6);
+  }
+
+  TEST(SimdTest, RTensorSqrt) {
+    test_simd_function<_sqrt,sqrt>(1e10);
+  }
+
+  TEST(SimdTest, RTensorAbs) {
+    test_simd_function<_abs,abs>(1e10);
+  }
+
+} // namespace tensor_test
@@ -19,6 +19,8 @@
 
 #include <tensor/tensor.h>
 #include <tensor/sparse.h>
+#include <tensor/threads.h>
+#include <tensor/map.h>
 #include "loops.h"
 #include <gtest/gtest.h>
 
@@ -105,4 +107,266 @@ namespace tensor_test {
     test_over_fixed_rank_tensors<cdouble>(test_sparse_binop_random<cdouble>, 2, 7);
   }
 
+  //
+  // PRODUCT OF SPARSE MATRICES
+  //
+
+  template<typename elt_t>
+  void test_sparse_mmult(const Sparse<elt_t> &A, const Sparse<elt_t> &B) {
+    Sparse<elt_t> C = mmult(A, B);
+    ASSERT_EQ(C.rows(), A.rows());
+    ASSERT_EQ(C.columns(), B.columns());
+    if (A.is_empty() || B.is_empty()) {
+      EXPECT_EQ(C.length(), 0);
+      return;
+    }
+    Tensor<elt_t> D = mmult(full(A), full(B));
+    EXPECT_TRUE(simeq(full(C), D, 1e-12));
+    // Columns are sorted within rows, as in any other sparse matrix
+    EXPECT_TRUE(all_equal(Sparse<elt_t>(full(C)).priv_row_start(), C.priv_row_start()));
+    EXPECT_TRUE(all_equal(Sparse<elt_t>(full(C)).priv_column(), C.priv_column()));
+  }
+
+  template<typename elt_t>
+  void test_sparse_mmult_random(Tensor<elt_t> &t) {
+    tensor::index rows = t.rows(), cols = t.columns();
+    for (int i = 0; i < 5; i++) {
+      Sparse<elt_t> A = Sparse<elt_t>::random(rows, cols);
+      Sparse<elt_t> B = Sparse<elt_t>::random(cols, rows+1, 0.5);
+      test_sparse_mmult(A, B);
+      test_sparse_mmult(Sparse<elt_t>::eye(rows), A);
+      EXPECT_TRUE(all_equal(mmult(Sparse<elt_t>(rows, cols), B),
+                            Sparse<elt_t>(rows, rows+1)));
+    }
+  }
+
+  TEST(RSparseTest, MmultRandom) {
+    test_over_fixed_rank_tensors<double>(test_sparse_mmult_random<double>, 2, 7);
+  }
+
+  TEST(CSparseTest, MmultRandom) {
+    test_over_fixed_rank_tensors<cdouble>(test_sparse_mmult_random<cdouble>, 2, 7);
+  }
+
+  TEST(RSparseTest, MmultCancellation) {
+    RSparse A(RTensor(igen << 1 << 2, rgen << 1.0 << 1.0));
+    RSparse B(RTensor(igen << 2 << 1, rgen << 1.0 << -1.0));
+    EXPECT_EQ(mmult(A, B).length(), 0);
+    EXPECT_EQ(mmult(B, A).length(), 4);
+  }
+
+  // Heisenberg chain with L spins, built from Kronecker products.
+  RSparse heisenberg_chain(int L) {
+    RSparse sz(RTensor(igen << 2 << 2, rgen << 1.0 << 0.0 << 0.0 << -1.0));
+    RSparse sp(RTensor(igen << 2 << 2, rgen << 0.0 << 0.0 << 1.0 << 0.0));
+    RSparse sm = transpose(sp);
+    RSparse H(1 << L, 1 << L);
+    for (int i = 0; i < L - 1; i++) {
+      RSparse left = RSparse::eye(1 << i);
+      RSparse right = RSparse::eye(1 << (L - 2 - i));
+      H = H + kron(kron(left, kron(sz, sz)), right)
+        + 0.5 * kron(kron(left, kron(sp, sm) + kron(sm, sp)), right);
+    }
+    return H;
+  }
+
+  TEST(RSparseTest, MmultHamiltonian) {
+    // The powers of the Hamiltonian have many more nonzero elements than
+    // the matrix itself.
+    RSparse H = heisenberg_chain(8);
+    RSparse H2 = mmult(H, H);
+    test_sparse_mmult(H, H);
+    test_sparse_mmult(H2, H);
+
+    // The output does not depend on the number of threads
+    int old = set_tensor_threads(4);
+    EXPECT_TRUE(all_equal(mmult(H, H), H2));
+    set_tensor_threads(old);
+  }
+
+  TEST(CSparseTest, MmultThreads) {
+    CSparse A = CSparse::random(400, 300, 0.05);
+    CSparse B = CSparse::random(300, 500, 0.05);
+    CSparse C = mmult(A, B);
+    int old = set_tensor_threads(4);
+    EXPECT_TRUE(all_equal(mmult(A, B), C));
+    set_tensor_threads(old);
+    test_sparse_mmult(A, B);
+  }
+
+  TEST(CSparseTest, MmultWide) {
+    // Few rows and many columns: rows are accumulated in hash tables
+    CSparse A = CSparse::random(3, 20, 0.3);
+    CSparse B = CSparse::random(20, 40000, 0.002);
+    test_sparse_mmult(A, B);
+    test_sparse_mmult(mmult(A, B), transpose(B));
+  }
+
+  //
+  // PRODUCT OF SPARSE MATRICES AND TENSORS
+  //
+
+  template<typename elt_t>
+  Sparse<elt_t> random_sparse(tensor::index rows, tensor::index cols,
+                              tensor::index per_row) {
+    tensor::index n = rows * per_row;
+    Indices r(n), c(n);
+    Tensor<elt_t> data = Tensor<elt_t>::random(n);
+    // One element in each of per_row bands of columns
+    int band = cols / per_row;
+    for (tensor::index i = 0; i < n; i++) {
+      r.at(i) = i / per_row;
+      c.at(i) = (i % per_row) * band + rand<int>(band);
+    }
+    return Sparse<elt_t>(r, c, data, rows, cols);
+  }
+
+  template<typename elt_t>
+  void test_sparse_tensor_mmult(const Sparse<elt_t> &S, tensor::index l_len) {
+    Tensor<elt_t> T = Tensor<elt_t>::random(S.columns(), l_len);
+    Tensor<elt_t> ST = mmult(S, T);
+    EXPECT_TRUE(simeq(mmult(full(S), T), ST, 1e-12));
+    // Each column is computed as if it were multiplied alone
+    for (tensor::index l = 0; l < l_len; l++) {
+      Tensor<elt_t> v = T(range(), range(l));
+      EXPECT_TRUE(all_equal(mmult(S, v), ST(range(), range(l))));
+    }
+    // Tensors of higher rank are treated as matrices
+    if (l_len % 2 == 0) {
+      Tensor<elt_t> T3 = reshape(T, T.rows(), 2, l_len / 2);
+      EXPECT_TRUE(all_equal(reshape(mmult(S, T3), ST.dimensions()), ST));
+    }
+
+    Tensor<elt_t> U = Tensor<elt_t>::random(l_len, S.rows());
+    Tensor<elt_t> US = mmult(U, S);
+    EXPECT_TRUE(simeq(mmult(U, full(S)), US, 1e-12));
+
+    // The output does not depend on the number of threads
+    int old = set_tensor_threads(4);
+    EXPECT_TRUE(all_equal(mmult(S, T), ST));
+    EXPECT_TRUE(all_equal(mmult(U, S), US));
+    set_tensor_threads(old);
+  }
+
+  TEST(RSparseTest, MmultTensor) {
+    for (tensor::index l = 1; l <= 17; l += 4) {
+      test_sparse_tensor_mmult(RSparse::random(7, 5), l);
+      test_sparse_tensor_mmult(random_sparse<double>(3000, 2000, 5), l);
+    }
+    test_sparse_tensor_mmult(RSparse(100, 80), 3);
+  }
+
+  TEST(CSparseTest, MmultTensor) {
+    for (tensor::index l = 1; l <= 17; l += 4) {
+      test_sparse_tensor_mmult(CSparse::random(7, 5), l);
+      test_sparse_tensor_mmult(random_sparse<cdouble>(3000, 2000, 5), l);
+    }
+  }
+
+  template<typename elt_t>
+  void test_vector_sparse_mmult(const Sparse<elt_t> &S) {
+    // With a single row, the work is split over blocks of columns
+    Tensor<elt_t> v = Tensor<elt_t>::random(1, S.rows());
+    Tensor<elt_t> vS = mmult(v, S);
+    EXPECT_TRUE(simeq(mmult(v, full(S)), vS, 1e-12));
+    int old = set_tensor_threads(4);
+    EXPECT_TRUE(all_equal(mmult(v, S), vS));
+    set_tensor_threads(old);
+  }
+
+  TEST(RSparseTest, MmultVectorSparse) {
+    test_vector_sparse_mmult(random_sparse<double>(1000, 2000, 200));
+    test_vector_sparse_mmult(random_sparse<double>(1000, 2000, 1));
+  }
+
+  TEST(CSparseTest, MmultVectorSparse) {
+    test_vector_sparse_mmult(random_sparse<cdouble>(1000, 2000, 200));
+  }
+
+  TEST(RSparseTest, MmultDeathTest) {
+    RSparse A = RSparse::random(3, 4);
+    ASSERT_DEATH(mmult(A, A), ".*");
+    ASSERT_DEATH(mmult(A, RSparse(5, 3)), ".*");
+    ASSERT_DEATH(mmult(A, RTensor::random(3, 2)), ".*");
+    ASSERT_DEATH(mmult(RTensor::random(2, 4), A), ".*");
+  }
+
+  //
+  // SLICED SPARSE MATRICES
+  //
+
+  template<typename elt_t>
+  void test_sliced_mmult(const Sparse<elt_t> &S, tensor::index l_len) {
+    SlicedSparse<elt_t> M(S);
+    EXPECT_TRUE(all_equal(M.dimensions(), S.dimensions()));
+    EXPECT_EQ(M.length(), S.length());
+    EXPECT_GE(M.padded_length(), S.length());
+
+    // Same products, summed in the same order, as with the original matrix
+    Tensor<elt_t> T = Tensor<elt_t>::random(S.columns(), l_len);
+    Tensor<elt_t> MT = mmult(M, T);
+    EXPECT_TRUE(all_equal(MT, mmult(S, T)));
+    if (l_len % 2 == 0) {
+      Tensor<elt_t> T3 = reshape(T, T.rows(), 2, l_len / 2);
+      EXPECT_TRUE(all_equal(reshape(mmult(M, T3), MT.dimensions()), MT));
+    }
+
+    // The output does not depend on the number of threads
+    int old = set_tensor_threads(4);
+    EXPECT_TRUE(all_equal(mmult(M, T), MT));
+    set_tensor_threads(old);
+  }
+
+  TEST(RSparseTest, SlicedMmult) {
+    for (tensor::index l = 1; l <= 9; l += 4) {
+      test_sliced_mmult(RSparse::random(7, 5), l);
+      test_sliced_mmult(RSparse::random(300, 200, 0.05), l);
+      test_sliced_mmult(random_sparse<double>(3001, 2000, 5), l);
+      test_sliced_mmult(heisenberg_chain(10), l);
+    }
+    test_sliced_mmult(RSparse(100, 80), 3);
+    test_sliced_mmult(RSparse(0, 80), 3);
+    test_sliced_mmult(RSparse(), 1);
+  }
+
+  TEST(CSparseTest, SlicedMmult) {
+    for (tensor::index l = 1; l <= 9; l += 4) {
+      test_sliced_mmult(CSparse::random(7, 5), l);
+      test_sliced_mmult(CSparse::random(300, 200, 0.05), l);
+      test_sliced_mmult(random_sparse<cdouble>(3001, 2000, 5), l);
+    }
+  }
+
+  TEST(RSparseTest, SlicedSuitable) {
+    EXPECT_TRUE(RSlicedSparse::is_suitable(heisenberg_chain(10)));
+    EXPECT_TRUE(RSlicedSparse::is_suitable(random_sparse<double>(3000, 2000, 5)));
+    EXPECT_TRUE(RSlicedSparse::is_suitable(RSparse::random(100, 100, 0.9)));
+    // Too small, or rows too short
+    EXPECT_FALSE(RSlicedSparse::is_suitable(heisenberg_chain(4)));
+    EXPECT_FALSE(RSlicedSparse::is_suitable(RSparse::eye(1000)));
+    EXPECT_FALSE(RSlicedSparse::is_suitable(RSparse(100, 100)));
+    // Rows of very different lengths leave too much padding
+    RTensor t = RTensor::zeros(512, 600);
+    for (tensor::index i = 0; i < 512; i++) {
+      for (tensor::index j = 0; j < ((i % 256)? 3 : 60); j++)
+        t.at(i, i + j) = 1.0;
+    }
+    EXPECT_FALSE(RSlicedSparse::is_suitable(RSparse(t)));
+  }
+
+  TEST(RSparseTest, SlicedMatrixMap) {
+    RSparse H = heisenberg_chain(10);
+    RTensor v = RTensor::random(H.columns());
+    EXPECT_TRUE(all_equal(MatrixMap<RSparse>(H)(v), mmult(H, v)));
+    EXPECT_TRUE(all_equal(MatrixMap<RSparse>(H, true)(v), mmult(v, H)));
+    RSparse A = RSparse::random(20, 20);
+    RTensor w = RTensor::random(A.columns());
+    EXPECT_TRUE(all_equal(MatrixMap<RSparse>(A)(w), mmult(A, w)));
+  }
+
+  TEST(RSparseTest, SlicedDeathTest) {
+    RSlicedSparse A(RSparse::random(3, 4));
+    ASSERT_DEATH(mmult(A, RTensor::random(3, 2)), ".*");
+  }
+
 } // namespace test
@@ -56,6 +56,32 @@ namespace tensor_test {
     unchanged(P2, P);
   }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  // Moving a tensor transfers its data without copying or sharing it,
+  // and leaves the original tensor empty.
+  template<typename elt_t> void test_move(Tensor<elt_t> &P) {
+    Tensor<elt_t> P1(P);
+    P1.randomize();
+    const elt_t *data = P1.begin_const();
+    const Indices dims = P1.dimensions();
+    Tensor<elt_t> P2(std::move(P1));
+    EXPECT_EQ(data, P2.begin_const());
+    EXPECT_EQ(1, P2.ref_count());
+    EXPECT_TRUE(all_equal(dims, P2.dimensions()));
+    EXPECT_EQ(0, P1.size());
+    Tensor<elt_t> P3(P.dimensions());
+    P3 = std::move(P2);
+    EXPECT_EQ(data, P3.begin_const());
+    EXPECT_EQ(1, P3.ref_count());
+    EXPECT_TRUE(all_equal(dims, P3.dimensions()));
+    EXPECT_EQ(0, P2.size());
+    // Moved-from tensors can be reused
+    P2 = P3;
+    EXPECT_EQ(2, P3.ref_count());
+    EXPECT_EQ(data, P2.begin_const());
+  }
+#endif
+
   // Test proper work of dimension querying routines>
   //	- they must return individual dimensions
   //	- must not change actual data
@@ -241,6 +267,12 @@ namespace tensor_test {
     test_over_tensors(test_copy_constructor<double>);
   }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  TEST(RTensorTest, RTensorMove) {
+    test_over_tensors(test_move<double>);
+  }
+#endif
+
   TEST(RTensorTest, RTensorDims) {
     test_over_tensors(test_dims<double>);
   }
@@ -285,6 +317,12 @@ namespace tensor_test {
     test_over_tensors(test_copy_constructor<cdouble>);
   }
 
+#ifdef TENSOR_MOVE_SEMANTICS
+  TEST(CTensorTest, CTensorMove) {
+    test_over_tensors(test_move<cdouble>);
+  }
+#endif
+
   TEST(CTensorTest, CTensorDims) {
     test_over_tensors(test_dims<cdouble>);
   }
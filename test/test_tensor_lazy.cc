@@ -0,0 +1,187 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+#include <tensor/threads.h>
+
+namespace tensor_test {
+
+  // Lazy expressions give the same values as the eager operators
+  //
+  template<typename elt_t, typename elt_t2>
+  void test_lazy_expression(Tensor<elt_t> &P)
+  {
+    typedef typename Binop<elt_t,elt_t2>::type elt_t3;
+    const Tensor<elt_t> Pcopy(P);
+    Tensor<elt_t2> Q(P.dimensions());
+    Q.randomize();
+    elt_t2 aux = rand<elt_t2>();
+    const Tensor<elt_t3> P1 = lazy(P) + lazy(Q);
+    const Tensor<elt_t3> P2 = lazy(P) - aux * lazy(Q);
+    const Tensor<elt_t3> P3 = -(lazy(P) * Q) / aux;
+    const Tensor<elt_t3> P4 = aux - P / lazy(Q) + 1.0;
+    EXPECT_TRUE(all_equal(P1.dimensions(), P.dimensions()));
+    EXPECT_TRUE(all_equal(P2.dimensions(), P.dimensions()));
+    EXPECT_TRUE(all_equal(P3.dimensions(), P.dimensions()));
+    EXPECT_TRUE(all_equal(P4.dimensions(), P.dimensions()));
+    for (tensor::index i = 0; i < P.size(); i++) {
+      ASSERT_EQ(P1[i], P[i] + Q[i]);
+      ASSERT_EQ(P2[i], P[i] - aux * Q[i]);
+      ASSERT_EQ(P3[i], -(P[i] * Q[i]) / aux);
+      ASSERT_EQ(P4[i], aux - P[i] / Q[i] + 1.0);
+    }
+    unchanged(P, Pcopy);
+  }
+
+  // Assigning to a tensor that is not shared reuses its storage,
+  // even when the tensor itself appears in the expression.
+  //
+  template<typename elt_t>
+  void test_lazy_inplace(Tensor<elt_t> &P)
+  {
+    Tensor<elt_t> Q(P.dimensions());
+    Q.randomize();
+    Tensor<elt_t> R(P.dimensions());
+    R.randomize();
+    Tensor<elt_t> Rcopy(R.dimensions());
+    std::copy(R.begin(), R.end(), Rcopy.begin());
+    const elt_t *data = R.begin_const();
+    R = lazy(Q) + 2.0 * lazy(R);
+    unique(R);
+    if (R.size()) {
+      EXPECT_EQ(data, R.begin_const());
+    }
+    for (tensor::index i = 0; i < R.size(); i++) {
+      ASSERT_EQ(R[i], Q[i] + 2.0 * Rcopy[i]);
+    }
+  }
+
+  // Assigning to a shared tensor does not modify the other references
+  //
+  template<typename elt_t>
+  void test_lazy_shared(Tensor<elt_t> &P)
+  {
+    const Tensor<elt_t> Pcopy(P);
+    Tensor<elt_t> R(P);
+    R = lazy(R) * 3.0;
+    for (tensor::index i = 0; i < R.size(); i++) {
+      ASSERT_EQ(R[i], Pcopy[i] * 3.0);
+      ASSERT_EQ(P[i], Pcopy[i]);
+    }
+    unchanged(P, Pcopy);
+  }
+
+  // norm0() of an expression equals that of the evaluated tensor, also
+  // when it is computed in several blocks.
+  //
+  template<typename elt_t>
+  void test_lazy_norm0(Tensor<elt_t> &P)
+  {
+    Tensor<elt_t> Q(P.dimensions());
+    Q.randomize();
+    elt_t aux = rand<elt_t>();
+    const Tensor<elt_t> R = lazy(P) - aux * lazy(Q);
+    EXPECT_EQ(norm0(R), norm0(lazy(P) - aux * lazy(Q)));
+  }
+
+  template<typename elt_t>
+  void test_lazy_norm0_blocks()
+  {
+    Tensor<elt_t> P(3 * parallel::CHUNK + 5);
+    P.randomize();
+    P.at(2 * parallel::CHUNK + 1) = 4.0;
+    EXPECT_EQ(norm0(lazy(P) * 2.0), 8.0);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // REAL SPECIALIZATIONS
+  //
+
+  TEST(TensorLazyTest, RTensorRTensorLazy) {
+    test_over_tensors<double>(test_lazy_expression<double,double>);
+  }
+
+  TEST(TensorLazyTest, RTensorLazyInplace) {
+    test_over_tensors<double>(test_lazy_inplace<double>);
+  }
+
+  TEST(TensorLazyTest, RTensorLazyShared) {
+    test_over_tensors<double>(test_lazy_shared<double>);
+  }
+
+  TEST(TensorLazyTest, RTensorLazyNorm0) {
+    test_over_tensors<double>(test_lazy_norm0<double>);
+    test_lazy_norm0_blocks<double>();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // COMPLEX SPECIALIZATIONS
+  //
+
+  TEST(TensorLazyTest, CTensorCTensorLazy) {
+    test_over_tensors<cdouble>(test_lazy_expression<cdouble,cdouble>);
+  }
+
+  TEST(TensorLazyTest, CTensorRTensorLazy) {
+    test_over_tensors<cdouble>(test_lazy_expression<cdouble,double>);
+  }
+
+  TEST(TensorLazyTest, RTensorCTensorLazy) {
+    test_over_tensors<double>(test_lazy_expression<double,cdouble>);
+  }
+
+  TEST(TensorLazyTest, CTensorLazyInplace) {
+    test_over_tensors<cdouble>(test_lazy_inplace<cdouble>);
+  }
+
+  TEST(TensorLazyTest, CTensorLazyShared) {
+    test_over_tensors<cdouble>(test_lazy_shared<cdouble>);
+  }
+
+  TEST(TensorLazyTest, CTensorLazyNorm0) {
+    test_over_tensors<cdouble>(test_lazy_norm0<cdouble>);
+    test_lazy_norm0_blocks<cdouble>();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // LARGE TENSORS, EVALUATED BY SEVERAL THREADS
+  //
+
+  TEST(TensorLazyTest, RTensorLazyThreads) {
+    int old = set_tensor_threads(4);
+    for (tensor::index n = 32767; n <= 200000; n += 83617) {
+      RTensor P = RTensor::random(n);
+      test_lazy_expression<double,double>(P);
+      test_lazy_inplace<double>(P);
+      test_lazy_shared<double>(P);
+    }
+    set_tensor_threads(old);
+  }
+
+  TEST(TensorLazyTest, CTensorLazyThreads) {
+    int old = set_tensor_threads(4);
+    CTensor P = CTensor::random(100000);
+    test_lazy_expression<cdouble,double>(P);
+    test_lazy_inplace<cdouble>(P);
+    set_tensor_threads(old);
+  }
+
+} // namespace tensor_test
@@ -21,6 +21,7 @@
 #include "loops.h"
 #include <gtest/gtest.h>
 #include <tensor/tensor.h>
+#include <tensor/threads.h>
 
 namespace tensor_test {
 
@@ -463,5 +464,81 @@ namespace tensor_test {
   CTENSOR_TEST(5,4,6)
   CTENSOR_TEST(5,5,6)
 
+  //////////////////////////////////////////////////////////////////////
+  // GENERAL PERMUTATIONS
+  //
+
+  // The same permutation, as a sequence of exchanges of two indices.
+  template<typename elt_t>
+  const Tensor<elt_t> pairwise_permute(const Tensor<elt_t> &A, const Indices &perm)
+  {
+    Tensor<elt_t> P = A;
+    Indices order = iota(0, A.rank() - 1);
+    for (index k = 0; k < A.rank(); k++) {
+      index m = std::find(order.begin(), order.end(), perm[k]) - order.begin();
+      if (m != k) {
+        P = permute(P, k, m);
+        std::swap(order.at(k), order.at(m));
+      }
+    }
+    return P;
+  }
+
+  template<typename elt_t>
+  void test_general_permute(Tensor<elt_t> &A)
+  {
+    Indices perm = iota(0, A.rank() - 1);
+    do {
+      Tensor<elt_t> P = permute(A, perm);
+      for (index k = 0; k < A.rank(); k++) {
+        EXPECT_EQ(A.dimension(perm[k]), P.dimension(k));
+      }
+      EXPECT_TRUE(all_equal(P, pairwise_permute(A, perm)));
+    } while (std::next_permutation(perm.begin(), perm.end()));
+  }
+
+  template<typename elt_t>
+  void test_large_permute(const Indices &dims, const Indices &perm)
+  {
+    Tensor<elt_t> A(dims);
+    A.randomize();
+    Tensor<elt_t> P = pairwise_permute(A, perm);
+    int old = set_tensor_threads(1);
+    EXPECT_TRUE(all_equal(P, permute(A, perm)));
+    set_tensor_threads(3);
+    EXPECT_TRUE(all_equal(P, permute(A, perm)));
+    set_tensor_threads(old);
+  }
+
+  TEST(TensorPermuteTest, RTensorGeneral) {
+    for (int rank = 0; rank <= 4; rank++)
+      test_over_fixed_rank_tensors<double>(test_general_permute<double>, rank, 3);
+    test_over_fixed_rank_tensors<double>(test_general_permute<double>, 5, 3);
+    test_over_fixed_rank_tensors<double>(test_general_permute<double>, 6, 2);
+  }
+
+  TEST(TensorPermuteTest, CTensorGeneral) {
+    for (int rank = 0; rank <= 4; rank++)
+      test_over_fixed_rank_tensors<cdouble>(test_general_permute<cdouble>, rank, 3);
+    test_over_fixed_rank_tensors<cdouble>(test_general_permute<cdouble>, 5, 3);
+  }
+
+  TEST(TensorPermuteTest, RTensorGeneralLarge) {
+    Indices dims = igen << 67 << 45 << 3 << 70;
+    test_large_permute<double>(dims, igen << 1 << 0 << 2 << 3);
+    test_large_permute<double>(dims, igen << 3 << 2 << 1 << 0);
+    test_large_permute<double>(dims, igen << 2 << 3 << 0 << 1);
+    test_large_permute<double>(dims, igen << 1 << 2 << 3 << 0);
+    test_large_permute<double>(dims, igen << 0 << 3 << 1 << 2);
+    test_large_permute<double>(igen << 512 << 300, igen << 1 << 0);
+  }
+
+  TEST(TensorPermuteTest, CTensorGeneralLarge) {
+    Indices dims = igen << 33 << 5 << 41 << 60;
+    test_large_permute<cdouble>(dims, igen << 3 << 1 << 2 << 0);
+    test_large_permute<cdouble>(dims, igen << 2 << 3 << 0 << 1);
+    test_large_permute<cdouble>(igen << 256 << 256, igen << 1 << 0);
+  }
+
 } // namespace tensor_test
 
@@ -0,0 +1,202 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+#include <tensor/threads.h>
+
+namespace tensor_test {
+
+  // Sizes that span several blocks of the thread pool, with and without
+  // a partial block at the end.
+  const tensor::index sizes[] = { 1, 1000, 32768, 32769, 100000, 1000003 };
+  const int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+  template<typename elt_t>
+  bool same_bits(const Tensor<elt_t> &a, const Tensor<elt_t> &b)
+  {
+    return a.size() == b.size() &&
+      memcmp(a.begin(), b.begin(), a.size() * sizeof(elt_t)) == 0;
+  }
+
+  template<typename elt_t>
+  bool same_bits(const elt_t &a, const elt_t &b)
+  {
+    return memcmp(&a, &b, sizeof(elt_t)) == 0;
+  }
+
+  // Reductions and elementwise operations give the same bits with any
+  // number of threads, and the same values as a plain loop.
+  //
+  template<typename elt_t>
+  void test_threads_reductions(tensor::index size)
+  {
+    Tensor<elt_t> a = Tensor<elt_t>::random(size) - 0.5;
+    Tensor<elt_t> b = Tensor<elt_t>::random(size) - 0.5;
+    int old = set_tensor_threads(1);
+    elt_t s = sum(a), p = scprod(a, b);
+    double n2 = norm2(a), n0 = norm0(a);
+    Tensor<elt_t> plus = a + b, times = a * 3.0, divide = a / b;
+    for (int threads = 2; threads <= 5; threads++) {
+      set_tensor_threads(threads);
+      EXPECT_EQ(threads, tensor_threads());
+      EXPECT_TRUE(same_bits(s, sum(a)));
+      EXPECT_TRUE(same_bits(p, scprod(a, b)));
+      EXPECT_TRUE(same_bits(n2, norm2(a)));
+      EXPECT_TRUE(same_bits(n0, norm0(a)));
+      EXPECT_TRUE(same_bits(plus, a + b));
+      EXPECT_TRUE(same_bits(times, a * 3.0));
+      EXPECT_TRUE(same_bits(divide, a / b));
+    }
+    set_tensor_threads(old);
+    elt_t s0 = std::accumulate(a.begin(), a.end(), number_zero<elt_t>());
+    EXPECT_TRUE(abs(s - s0) < 1e-10 * size);
+    double m = 0;
+    for (tensor::index i = 0; i < size; i++) {
+      m = std::max(m, abs(a[i]));
+    }
+    EXPECT_EQ(m, n0);
+  }
+
+  void test_threads_max_min(tensor::index size)
+  {
+    RTensor a = RTensor::random(size);
+    tensor::index where = size / 3;
+    int old = set_tensor_threads(3);
+    a.at(where) = 2.0;
+    EXPECT_EQ(2.0, max(a));
+    a.at(where) = -1.0;
+    EXPECT_EQ(-1.0, min(a));
+    set_tensor_threads(old);
+  }
+
+  TEST(ThreadsTest, SetThreads) {
+    int old = set_tensor_threads(3);
+    EXPECT_LE(1, old);
+    EXPECT_EQ(3, tensor_threads());
+    EXPECT_EQ(3, set_tensor_threads(0));
+    EXPECT_LE(1, tensor_threads());
+    set_tensor_threads(old);
+    EXPECT_EQ(old, tensor_threads());
+  }
+
+  TEST(ThreadsTest, RTensorReductions) {
+    for (int i = 0; i < nsizes; i++) {
+      test_threads_reductions<double>(sizes[i]);
+    }
+  }
+
+  TEST(ThreadsTest, CTensorReductions) {
+    for (int i = 0; i < nsizes; i++) {
+      test_threads_reductions<cdouble>(sizes[i]);
+    }
+  }
+
+  TEST(ThreadsTest, RTensorMaxMin) {
+    for (int i = 0; i < nsizes; i++) {
+      test_threads_max_min(sizes[i]);
+    }
+  }
+
+  TEST(ThreadsTest, RTensorUnop) {
+    RTensor a = RTensor::random(100000);
+    int old = set_tensor_threads(1);
+    RTensor e = exp(a), s = sin(a);
+    set_tensor_threads(4);
+    EXPECT_TRUE(same_bits(e, exp(a)));
+    EXPECT_TRUE(same_bits(s, sin(a)));
+    set_tensor_threads(old);
+  }
+
+  // Tasks may ask for the number of threads while a job is running
+  class ThreadsQueryTask : public parallel::Task {
+  public:
+    ThreadsQueryTask(int *output) : output_(output) {}
+    void run(tensor::index c) { output_[c] = tensor_threads(); }
+  private:
+    int *output_;
+  };
+
+  TEST(ThreadsTest, QueryInsideTask) {
+    int old = set_tensor_threads(3);
+    int output[8];
+    ThreadsQueryTask task(output);
+    parallel::run_chunks(task, 8);
+    for (int c = 0; c < 8; c++) {
+      EXPECT_EQ(output[c], 3);
+    }
+    set_tensor_threads(old);
+  }
+
+  // Workers created after earlier jobs only run the jobs that follow
+  TEST(ThreadsTest, ChangeThreadsBetweenJobs) {
+    RTensor a = RTensor::random(1000003);
+    int old = set_tensor_threads(1);
+    double s = sum(a);
+    RTensor e = a * 3.0;
+    for (int i = 0; i < 200; i++) {
+      set_tensor_threads(2 + i % 4);
+      EXPECT_TRUE(same_bits(s, sum(a)));
+      EXPECT_TRUE(same_bits(e, a * 3.0));
+    }
+    set_tensor_threads(old);
+  }
+
+  // Tasks may change the number of threads, which happens after the job
+  class ThreadsSetTask : public parallel::Task {
+  public:
+    void run(tensor::index c) { if (c == 0) set_tensor_threads(2); }
+  };
+
+  TEST(ThreadsTest, SetInsideTask) {
+    int old = set_tensor_threads(4);
+    ThreadsSetTask task;
+    parallel::run_chunks(task, 16);
+    EXPECT_EQ(2, tensor_threads());
+    set_tensor_threads(old);
+  }
+
+#if __cplusplus >= 201103L
+  // Exceptions are passed to the caller, and the pool remains usable
+  class ThreadsThrowTask : public parallel::Task {
+  public:
+    void run(tensor::index c) {
+      if (c % 3 == 1) throw std::runtime_error("chunk failed");
+    }
+  };
+
+  TEST(ThreadsTest, ExceptionInTask) {
+    RTensor a = RTensor::random(1000003);
+    int old = set_tensor_threads(1);
+    double s = sum(a);
+    set_tensor_threads(4);
+    for (int i = 0; i < 50; i++) {
+      ThreadsThrowTask task;
+      EXPECT_THROW(parallel::run_chunks(task, 64), std::runtime_error);
+      EXPECT_TRUE(same_bits(s, sum(a)));
+    }
+    EXPECT_EQ(4, set_tensor_threads(old));
+  }
+#endif
+
+} // namespace tensor_test
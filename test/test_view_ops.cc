@@ -0,0 +1,208 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <tensor/tensor.h>
+
+namespace tensor_test {
+
+  using namespace tensor;
+  using tensor::index;
+
+#include "test_view_common.cc"
+
+  //////////////////////////////////////////////////////////////////////
+  // LAYOUT OF STRIDED SLICES
+  //
+
+  template<typename elt_t>
+  void test_view_layout()
+  {
+    Tensor<elt_t> P = Tensor<elt_t>::random(7, 9);
+    {
+      const typename Tensor<elt_t>::view &v = P(range(1,5), range(2,8,3));
+      EXPECT_TRUE(v.is_strided());
+      EXPECT_EQ(v.rank(), 2);
+      EXPECT_TRUE(all_equal(v.dimensions(), Indices(igen << 5 << 3)));
+      EXPECT_EQ(v.offset(), 1 + 2*7);
+      EXPECT_TRUE(all_equal(v.strides(), Indices(igen << 1 << 21)));
+      EXPECT_EQ(v.leading_dimension(), 21);
+      EXPECT_EQ(v.begin_const(), P.begin_const() + v.offset());
+      // The slice shares the memory of P
+      EXPECT_EQ(P.ref_count(), 2);
+    }
+    EXPECT_EQ(P.ref_count(), 1);
+    {
+      // Equally spaced lists of indices are also strided
+      const typename Tensor<elt_t>::view &v = P(range(iota(0,6,2)), range(3));
+      EXPECT_TRUE(v.is_strided());
+      EXPECT_TRUE(all_equal(v.strides(), Indices(igen << 2 << 7)));
+      EXPECT_EQ(v.offset(), 3*7);
+      EXPECT_EQ(v.leading_dimension(), 0);
+    }
+    {
+      const typename Tensor<elt_t>::view &v = P(range(igen << 0 << 1 << 4), range());
+      EXPECT_FALSE(v.is_strided());
+      EXPECT_EQ(v.leading_dimension(), 0);
+      Tensor<elt_t> S(3, 9);
+      for (index j = 0; j < 9; j++) {
+        S.at(0,j) = P(0,j);
+        S.at(1,j) = P(1,j);
+        S.at(2,j) = P(4,j);
+      }
+      EXPECT_TRUE(all_equal(Tensor<elt_t>(v), S));
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // REDUCTIONS AND BINARY OPERATIONS
+  //
+
+  template<typename elt_t>
+  void test_view_binop(Tensor<elt_t> &data)
+  {
+    if (data.rank() != 2 || data.size() == 0)
+      return;
+    // Random elements, because some operations divide by the slices
+    Tensor<elt_t> P(data.dimensions());
+    P.randomize();
+    index rows = P.dimension(0);
+    index cols = P.dimension(1);
+    for (index step = 1; step < 3; step++) {
+      index r0 = rows / 3, r1 = rows - 1;
+      index c0 = 0, c1 = cols - 1;
+      Tensor<elt_t> S = P(range(r0,r1,step), range(c0,c1));
+      Tensor<elt_t> T(S.dimensions());
+      T.randomize();
+
+      EXPECT_TRUE(simeq(sum(P(range(r0,r1,step), range(c0,c1))), sum(S)));
+      EXPECT_TRUE(simeq(norm2(P(range(r0,r1,step), range(c0,c1))), norm2(S)));
+
+      EXPECT_TRUE(all_equal(T + P(range(r0,r1,step), range(c0,c1)), T + S));
+      EXPECT_TRUE(all_equal(T - P(range(r0,r1,step), range(c0,c1)), T - S));
+      EXPECT_TRUE(all_equal(T * P(range(r0,r1,step), range(c0,c1)), T * S));
+      EXPECT_TRUE(all_equal(T / P(range(r0,r1,step), range(c0,c1)), T / S));
+
+      EXPECT_TRUE(all_equal(P(range(r0,r1,step), range(c0,c1)) + T, S + T));
+      EXPECT_TRUE(all_equal(P(range(r0,r1,step), range(c0,c1)) - T, S - T));
+      EXPECT_TRUE(all_equal(P(range(r0,r1,step), range(c0,c1)) * T, S * T));
+      EXPECT_TRUE(all_equal(P(range(r0,r1,step), range(c0,c1)) / T, S / T));
+
+      EXPECT_TRUE(all_equal(P(range(r0,r1,step), range(c0,c1)) -
+                            P(range(r0,r1,step), range(c0,c1)),
+                            S - S));
+
+      Tensor<elt_t> T2 = T;
+      T2 += P(range(r0,r1,step), range(c0,c1));
+      EXPECT_TRUE(all_equal(T2, T + S));
+      T2 = T;
+      T2 -= P(range(r0,r1,step), range(c0,c1));
+      EXPECT_TRUE(all_equal(T2, T - S));
+    }
+    // A tensor combined with a slice of itself.
+    Tensor<elt_t> Paux = P;
+    Tensor<elt_t> Q = P;
+    Q += Q(range(), range());
+    EXPECT_TRUE(all_equal(Q, Paux + Paux));
+    EXPECT_TRUE(all_equal(P, Paux));
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // CONTRACTIONS
+  //
+
+  template<typename elt_t>
+  void test_view_fold()
+  {
+    Tensor<elt_t> P = Tensor<elt_t>::random(8, 10);
+    // Column blocks and blocks with unit stride along the rows
+    {
+      Tensor<elt_t> B = Tensor<elt_t>::random(4, 3);
+      Tensor<elt_t> S = P(range(2,5), range(1,9,2));
+      EXPECT_TRUE(simeq(fold(P(range(2,5), range(1,9,2)), 0, B, 0),
+                        fold(S, 0, B, 0)));
+      EXPECT_TRUE(simeq(fold(B, 0, P(range(2,5), range(1,9,2)), 0),
+                        fold(B, 0, S, 0)));
+      Tensor<elt_t> B2 = Tensor<elt_t>::random(5, 3);
+      EXPECT_TRUE(simeq(mmult(P(range(2,5), range(1,9,2)), B2),
+                        mmult(S, B2)));
+      Tensor<elt_t> B3 = Tensor<elt_t>::random(3, 5);
+      EXPECT_TRUE(simeq(fold(P(range(2,5), range(1,9,2)), 1, B3, 1),
+                        fold(S, 1, B3, 1)));
+      EXPECT_TRUE(simeq(mmult(B3, P(range(0,4), range(0,5))),
+                        mmult(B3, Tensor<elt_t>(P(range(0,4), range(0,5))))));
+      EXPECT_TRUE(simeq(mmult(P(range(2,5), range(1,9,2)),
+                              P(range(0,4), range(0,5))),
+                        mmult(S, Tensor<elt_t>(P(range(0,4), range(0,5))))));
+    }
+    // Slices that have to be copied
+    {
+      Tensor<elt_t> S = P(range(0,6,2), range(0,2));
+      Tensor<elt_t> B = Tensor<elt_t>::random(3, 2, 4);
+      EXPECT_TRUE(simeq(mmult(P(range(0,6,2), range(0,2)), B),
+                        mmult(S, B)));
+      Tensor<elt_t> C = Tensor<elt_t>::random(2, 2, 2);
+      EXPECT_TRUE(simeq(fold(P(range(), range(0,1)), 1, C, 1),
+                        fold(Tensor<elt_t>(P(range(), range(0,1))), 1, C, 1)));
+    }
+    // One-dimensional slices
+    {
+      Tensor<elt_t> v = Tensor<elt_t>::random(10);
+      Tensor<elt_t> S = v(range(2,9));
+      Tensor<elt_t> B = Tensor<elt_t>::random(8, 3);
+      EXPECT_TRUE(simeq(fold(v(range(2,9)), 0, B, 0), fold(S, 0, B, 0)));
+      EXPECT_TRUE(simeq(fold(B, 0, v(range(2,9)), 0), fold(B, 0, S, 0)));
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // REAL SPECIALIZATIONS
+  //
+
+  TEST(SliceOpsTest, SliceRTensorLayout) {
+    test_view_layout<double>();
+  }
+
+  TEST(SliceOpsTest, SliceRTensorBinop) {
+    test_over_fixed_rank_tensors<double>(test_view_binop<double>, 2);
+  }
+
+  TEST(SliceOpsTest, SliceRTensorFold) {
+    test_view_fold<double>();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // COMPLEX SPECIALIZATIONS
+  //
+
+  TEST(SliceOpsTest, SliceCTensorLayout) {
+    test_view_layout<cdouble>();
+  }
+
+  TEST(SliceOpsTest, SliceCTensorBinop) {
+    test_over_fixed_rank_tensors<cdouble>(test_view_binop<cdouble>, 2);
+  }
+
+  TEST(SliceOpsTest, SliceCTensorFold) {
+    test_view_fold<cdouble>();
+  }
+
+} // namespace tensor_test
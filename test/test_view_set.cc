@@ -212,4 +212,109 @@ namespace tensor_test {
   }
 
 
+  //////////////////////////////////////////////////////////////////////
+  // PARTIAL ASSIGNMENT
+  //
+  // Every index of the tensor is sliced with one of these choices: all
+  // elements, the upper half, every second element, all elements in
+  // reverse order, the last element, and all elements but the middle one.
+  //
+
+  const int slice_kinds = 6;
+
+  static Indices slice_indices(int kind, index n)
+  {
+    switch (kind) {
+    case 0:
+      return iota(0, n-1);
+    case 1:
+      return iota(n/2, n-1);
+    case 2:
+      return iota(0, n-1, 2);
+    case 3: {
+      Indices output(n);
+      for (index i = 0; i < n; i++)
+        output.at(i) = n - 1 - i;
+      return output;
+    }
+    case 4:
+      return iota(n-1, n-1);
+    default:
+      if (n < 3)
+        return iota(0, n-1);
+      Indices output(n-1);
+      for (index i = 0, j = 0; i < n; i++) {
+        if (i != n/2)
+          output.at(j++) = i;
+      }
+      return output;
+    }
+  }
+
+  static PRange slice_range(int kind, index n)
+  {
+    switch (kind) {
+    case 0:
+      return range();
+    case 1:
+      return range(n/2, n-1);
+    case 2:
+      return range(0, n-1, 2);
+    case 4:
+      return range(n-1);
+    default:
+      return range(slice_indices(kind, n));
+    }
+  }
+
+  template<typename elt_t>
+  void test_partial_set3(Tensor<elt_t> &P)
+  {
+    if (P.size() == 0)
+      return;
+    Tensor<elt_t> Paux = P;
+    for (int k0 = 0; k0 < slice_kinds; k0++) {
+      for (int k1 = 0; k1 < slice_kinds; k1++) {
+        for (int k2 = 0; k2 < slice_kinds; k2++) {
+          Indices i = slice_indices(k0, P.dimension(0));
+          Indices j = slice_indices(k1, P.dimension(1));
+          Indices k = slice_indices(k2, P.dimension(2));
+          Tensor<elt_t> t(i.size(), j.size(), k.size());
+          t.randomize();
+
+          Tensor<elt_t> Q = P, R = P;
+          for (index x = 0; x < i.size(); x++)
+            for (index y = 0; y < j.size(); y++)
+              for (index z = 0; z < k.size(); z++)
+                R.at(i[x], j[y], k[z]) = t(x, y, z);
+          Q.at(slice_range(k0, P.dimension(0)), slice_range(k1, P.dimension(1)),
+               slice_range(k2, P.dimension(2))) = t;
+          EXPECT_TRUE(all_equal(Q, R));
+          EXPECT_TRUE(all_equal(Q(slice_range(k0, P.dimension(0)),
+                                  slice_range(k1, P.dimension(1)),
+                                  slice_range(k2, P.dimension(2))), t));
+
+          Q = P;
+          R = P;
+          for (index x = 0; x < i.size(); x++)
+            for (index y = 0; y < j.size(); y++)
+              for (index z = 0; z < k.size(); z++)
+                R.at(i[x], j[y], k[z]) = number_one<elt_t>();
+          Q.at(slice_range(k0, P.dimension(0)), slice_range(k1, P.dimension(1)),
+               slice_range(k2, P.dimension(2))) = number_one<elt_t>();
+          EXPECT_TRUE(all_equal(Q, R));
+        }
+      }
+    }
+    unchanged(P, Paux);
+  }
+
+  TEST(SliceSetTest, SliceRTensor3DPartialSet) {
+    test_over_fixed_rank_tensors<double>(test_partial_set3<double>, 3, 5);
+  }
+
+  TEST(SliceSetTest, SliceCTensor3DPartialSet) {
+    test_over_fixed_rank_tensors<cdouble>(test_partial_set3<cdouble>, 3, 5);
+  }
+
 } // namespace tensor_test